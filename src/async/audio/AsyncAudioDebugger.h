@@ -47,6 +47,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  *
  ****************************************************************************/
 
+#include <AsyncApplication.h>
 #include <AsyncAudioSink.h>
 #include <AsyncAudioSource.h>
 
@@ -126,7 +127,7 @@ class AudioDebugger : public AudioSink, public AudioSource
                   const std::string& name="AudioDebugger")
       : name(name), sample_count(0)
     {
-      gettimeofday(&start_time, 0);
+      Async::Application::app().getTimeOfDay(&start_time);
       if (src != 0)
       {
       	Async::AudioSink *sink = src->sink();
@@ -180,7 +181,7 @@ class AudioDebugger : public AudioSink, public AudioSource
       }
 
       struct timeval time, diff;
-      gettimeofday(&time, 0);
+      Async::Application::app().getTimeOfDay(&time);
 
       timersub(&time, &start_time, &diff);
       uint64_t diff_ms = diff.tv_sec * 1000 + diff.tv_usec / 1000;
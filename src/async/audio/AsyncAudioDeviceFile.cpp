@@ -0,0 +1,646 @@
+/**
+@file	 AsyncAudioDeviceFile.cpp
+@brief   Read audio from, or write audio to, a file
+@author  Tobias Blomberg / SM0SVX
+@date	 2026-10-18
+
+Implements an "audio interface" that read audio samples from a file or
+write audio samples to a file. This can for example be used to replay
+recorded audio through an application for testing.
+
+\verbatim
+Async - A library for programming event driven applications
+Copyright (C) 2003-2026 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <cassert>
+#include <cstring>
+#include <cerrno>
+#include <iostream>
+#include <algorithm>
+#include <vector>
+
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+#include <AsyncApplication.h>
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "AsyncAudioDeviceFile.h"
+#include "AsyncAudioDeviceFactory.h"
+
+
+
+/****************************************************************************
+ *
+ * Namespaces to use
+ *
+ ****************************************************************************/
+
+using namespace std;
+using namespace Async;
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local class definitions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Prototypes
+ *
+ ****************************************************************************/
+
+namespace {
+  int64_t monotonicNsec(void)
+  {
+    struct timespec ts;
+    Application::app().clockGetTime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+  }
+
+  uint16_t read16bitValue(const char *ptr)
+  {
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(ptr);
+    return p[0] | (p[1] << 8);
+  }
+
+  uint32_t read32bitValue(const char *ptr)
+  {
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(ptr);
+    return p[0] | (p[1] << 8) | (p[2] << 16) |
+           (static_cast<uint32_t>(p[3]) << 24);
+  }
+
+  int store16bitValue(char *ptr, uint16_t val)
+  {
+    *ptr++ = val & 0xff;
+    *ptr++ = (val >> 8) & 0xff;
+    return 2;
+  }
+
+  int store32bitValue(char *ptr, uint32_t val)
+  {
+    *ptr++ = val & 0xff;
+    *ptr++ = (val >> 8) & 0xff;
+    *ptr++ = (val >> 16) & 0xff;
+    *ptr++ = (val >> 24) & 0xff;
+    return 4;
+  }
+
+  bool hasWavExtension(const string& filename)
+  {
+    if (filename.size() < 4)
+    {
+      return false;
+    }
+    string ext = filename.substr(filename.size() - 4);
+    transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    return ext == ".wav";
+  }
+}; /* End of anonymous namespace */
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ *
+ * Local Global Variables
+ *
+ ****************************************************************************/
+
+REGISTER_AUDIO_DEVICE_TYPE("file", AudioDeviceFile);
+
+
+
+/****************************************************************************
+ *
+ * Public member functions
+ *
+ ****************************************************************************/
+
+size_t AudioDeviceFile::readBlocksize(void)
+{
+  return block_size;
+} /* AudioDeviceFile::readBlocksize */
+
+
+size_t AudioDeviceFile::writeBlocksize(void)
+{
+  return block_size;
+} /* AudioDeviceFile::writeBlocksize */
+
+
+bool AudioDeviceFile::isFullDuplexCapable(void)
+{
+  return false;
+} /* AudioDeviceFile::isFullDuplexCapable */
+
+
+void AudioDeviceFile::audioToWriteAvailable(void)
+{
+  if (!pace_timer.isEnabled())
+  {
+    writeAudio();
+  }
+} /* AudioDeviceFile::audioToWriteAvailable */
+
+
+void AudioDeviceFile::flushSamples(void)
+{
+  if (!pace_timer.isEnabled())
+  {
+    writeAudio();
+  }
+} /* AudioDeviceFile::flushSamples */
+
+
+int AudioDeviceFile::samplesToWrite(void) const
+{
+  return 0;
+} /* AudioDeviceFile::samplesToWrite */
+
+
+
+/****************************************************************************
+ *
+ * Protected member functions
+ *
+ ****************************************************************************/
+
+
+AudioDeviceFile::AudioDeviceFile(const string& dev_name)
+  : AudioDevice(dev_name), block_size(0),
+    pace_timer(0, Timer::TYPE_PERIODIC, false), file(0),
+    file_mode(MODE_NONE), is_wav(false), file_channels(0),
+    frames_written(0), start_time(monotonicNsec())
+{
+  assert(AudioDeviceFile_creator_registered);
+  assert(sampleRate() > 0);
+  size_t pace_interval = 1000 * block_size_hint / sampleRate();
+  block_size = pace_interval * sampleRate() / 1000;
+
+  pace_timer.setTimeout(pace_interval);
+} /* AudioDeviceFile::AudioDeviceFile */
+
+
+AudioDeviceFile::~AudioDeviceFile(void)
+{
+  closeFile();
+} /* AudioDeviceFile::~AudioDeviceFile */
+
+
+bool AudioDeviceFile::openDevice(Mode mode)
+{
+  pace_timer.setEnable(false);
+  pace_timer.expired.clear();
+
+  switch (mode)
+  {
+    case MODE_RD:
+      if (!openFile(mode))
+      {
+        return false;
+      }
+      pace_timer.expired.connect(
+          sigc::hide(mem_fun(*this, &AudioDeviceFile::readAudio)));
+      pace_timer.setEnable(true);
+      break;
+
+    case MODE_WR:
+      if (!openFile(mode))
+      {
+        return false;
+      }
+      pace_timer.expired.connect(
+          sigc::hide(mem_fun(*this, &AudioDeviceFile::writeAudio)));
+      break;
+
+    case MODE_RDWR:
+      cerr << "*** ERROR: The file audio device (" << devName()
+           << ") cannot be used for both reading and writing. Use "
+              "different files for reading and writing.\n";
+      return false;
+
+    case MODE_NONE:
+      break;
+  }
+
+  return true;
+
+} /* AudioDeviceFile::openDevice */
+
+
+void AudioDeviceFile::closeDevice(void)
+{
+  pace_timer.setEnable(false);
+
+    // The file is kept open so that reading continue where it left off and
+    // so that writing can keep the output time aligned. Make sure that the
+    // file is usable even if the application is terminated abnormally.
+  if ((file != 0) && (file_mode == MODE_WR))
+  {
+    if (is_wav)
+    {
+      writeWaveHeader();
+    }
+    fflush(file);
+  }
+} /* AudioDeviceFile::closeDevice */
+
+
+
+/****************************************************************************
+ *
+ * Private member functions
+ *
+ ****************************************************************************/
+
+bool AudioDeviceFile::openFile(Mode mode)
+{
+  if ((file != 0) && (file_mode == mode))
+  {
+    return true;
+  }
+  closeFile();
+
+  const string& filename = devName();
+  if (filename.empty())
+  {
+    cerr << "*** ERROR: Illegal file audio device specification ("
+         << devName() << "). Should be file:filename\n";
+    return false;
+  }
+
+  file = fopen(filename.c_str(), (mode == MODE_RD) ? "r" : "w");
+  if (file == 0)
+  {
+    cerr << "*** ERROR: Could not open audio file \"" << filename
+         << "\": " << strerror(errno) << endl;
+    return false;
+  }
+  file_mode = mode;
+  is_wav = hasWavExtension(filename);
+  file_channels = channels;
+
+  if (mode == MODE_RD)
+  {
+    char magic[4];
+    is_wav = (fread(magic, 1, sizeof(magic), file) == sizeof(magic)) &&
+             (memcmp(magic, "RIFF", sizeof(magic)) == 0);
+    rewind(file);
+    if (is_wav && !readWaveHeader())
+    {
+      closeFile();
+      return false;
+    }
+  }
+  else
+  {
+    frames_written = 0;
+    if (is_wav && !writeWaveHeader())
+    {
+      closeFile();
+      return false;
+    }
+  }
+
+  return true;
+
+} /* AudioDeviceFile::openFile */
+
+
+void AudioDeviceFile::closeFile(void)
+{
+  if (file == 0)
+  {
+    return;
+  }
+
+  if ((file_mode == MODE_WR) && is_wav)
+  {
+    writeWaveHeader();
+  }
+  fclose(file);
+  file = 0;
+  file_mode = MODE_NONE;
+} /* AudioDeviceFile::closeFile */
+
+
+bool AudioDeviceFile::readWaveHeader(void)
+{
+  char buf[16];
+  if ((fread(buf, 1, 12, file) != 12) || (memcmp(buf + 8, "WAVE", 4) != 0))
+  {
+    cerr << "*** ERROR: Audio file \"" << devName()
+         << "\" is not a valid WAV file\n";
+    return false;
+  }
+
+  bool fmt_found = false;
+  for (;;)
+  {
+    if (fread(buf, 1, 8, file) != 8)
+    {
+      cerr << "*** ERROR: No audio data found in WAV file \""
+           << devName() << "\"\n";
+      return false;
+    }
+    uint32_t chunk_size = read32bitValue(buf + 4);
+
+    if (memcmp(buf, "data", 4) == 0)
+    {
+      break;
+    }
+
+    if (memcmp(buf, "fmt ", 4) == 0)
+    {
+      if ((chunk_size < 16) || (fread(buf, 1, 16, file) != 16))
+      {
+        cerr << "*** ERROR: Malformed format chunk in WAV file \""
+             << devName() << "\"\n";
+        return false;
+      }
+      uint16_t format = read16bitValue(buf);
+      uint16_t num_channels = read16bitValue(buf + 2);
+      uint32_t sample_rate = read32bitValue(buf + 4);
+      uint16_t bits_per_sample = read16bitValue(buf + 14);
+      if ((format != 1) || (bits_per_sample != 16))
+      {
+        cerr << "*** ERROR: WAV file \"" << devName()
+             << "\" does not contain 16 bit PCM audio\n";
+        return false;
+      }
+      if (sample_rate != static_cast<uint32_t>(sampleRate()))
+      {
+        cerr << "*** ERROR: The sample rate of WAV file \"" << devName()
+             << "\" (" << sample_rate << "Hz) does not match the sample "
+                "rate of the audio device (" << sampleRate() << "Hz)\n";
+        return false;
+      }
+      if ((num_channels != 1) && (num_channels != channels))
+      {
+        cerr << "*** ERROR: WAV file \"" << devName() << "\" has "
+             << num_channels << " channels. Should be 1 or "
+             << channels << ".\n";
+        return false;
+      }
+      file_channels = num_channels;
+      fmt_found = true;
+      chunk_size -= 16;
+    }
+
+      // Skip the rest of the chunk, which is padded to an even size
+    if (fseek(file, chunk_size + (chunk_size & 1), SEEK_CUR) != 0)
+    {
+      cerr << "*** ERROR: Could not read WAV file \"" << devName()
+           << "\": " << strerror(errno) << endl;
+      return false;
+    }
+  }
+
+  if (!fmt_found)
+  {
+    cerr << "*** ERROR: No format chunk found in WAV file \""
+         << devName() << "\"\n";
+    return false;
+  }
+
+  return true;
+
+} /* AudioDeviceFile::readWaveHeader */
+
+
+bool AudioDeviceFile::writeWaveHeader(void)
+{
+  long pos = ftell(file);
+  rewind(file);
+
+  const uint32_t data_size = frames_written * channels * sizeof(int16_t);
+  char buf[WAVE_HEADER_SIZE];
+  char *ptr = buf;
+
+    // ChunkID
+  memcpy(ptr, "RIFF", 4);
+  ptr += 4;
+
+    // ChunkSize
+  ptr += store32bitValue(ptr, WAVE_HEADER_SIZE - 8 + data_size);
+
+    // Format
+  memcpy(ptr, "WAVE", 4);
+  ptr += 4;
+
+    // Subchunk1ID
+  memcpy(ptr, "fmt ", 4);
+  ptr += 4;
+
+    // Subchunk1Size
+  ptr += store32bitValue(ptr, 16);
+
+    // AudioFormat (PCM)
+  ptr += store16bitValue(ptr, 1);
+
+    // NumChannels
+  ptr += store16bitValue(ptr, channels);
+
+    // SampleRate
+  ptr += store32bitValue(ptr, sampleRate());
+
+    // ByteRate (sample rate * num channels * bytes per sample)
+  ptr += store32bitValue(ptr, sampleRate() * channels * sizeof(int16_t));
+
+    // BlockAlign (num channels * bytes per sample)
+  ptr += store16bitValue(ptr, channels * sizeof(int16_t));
+
+    // BitsPerSample
+  ptr += store16bitValue(ptr, 16);
+
+    // Subchunk2ID
+  memcpy(ptr, "data", 4);
+  ptr += 4;
+
+    // Subchunk2Size (num samples * num channels * bytes per sample)
+  ptr += store32bitValue(ptr, data_size);
+
+  assert(ptr - buf == WAVE_HEADER_SIZE);
+
+  bool success = (fwrite(buf, 1, WAVE_HEADER_SIZE, file) == WAVE_HEADER_SIZE);
+  if (!success)
+  {
+    cerr << "*** ERROR: Could not write WAV header to \"" << devName()
+         << "\": " << strerror(errno) << endl;
+  }
+  if (pos > static_cast<long>(WAVE_HEADER_SIZE))
+  {
+    fseek(file, pos, SEEK_SET);
+  }
+  return success;
+
+} /* AudioDeviceFile::writeWaveHeader */
+
+
+void AudioDeviceFile::readAudio(void)
+{
+  assert(file != 0);
+
+    // The buffers are kept between calls so that no memory is allocated
+    // on each timer tick
+  file_buf.resize(block_size * file_channels);
+  size_t frames_read = fread(&file_buf[0], sizeof(int16_t) * file_channels,
+                             block_size, file);
+
+  samp_buf.assign(block_size * channels, 0);
+  for (size_t i=0; i<frames_read; ++i)
+  {
+    for (size_t ch=0; ch<channels; ++ch)
+    {
+      size_t file_ch = (file_channels == 1) ? 0 : ch;
+      int16_t sample = file_buf[i * file_channels + file_ch];
+      if (is_wav)
+      {
+        sample = read16bitValue(reinterpret_cast<const char *>(&sample));
+      }
+      samp_buf[i * channels + ch] = sample;
+    }
+  }
+
+  if (frames_read > 0)
+  {
+    putBlocks(&samp_buf[0], block_size);
+  }
+
+  if (frames_read < block_size)
+  {
+    cout << "Audio file \"" << devName() << "\": End of file reached\n";
+    pace_timer.setEnable(false);
+  }
+} /* AudioDeviceFile::readAudio */
+
+
+void AudioDeviceFile::writeAudio(void)
+{
+  assert(file != 0);
+  assert(mode() == MODE_WR);
+
+  if (!pace_timer.isEnabled())
+  {
+    fillSilence();
+  }
+
+  samp_buf.resize(block_size * channels);
+  if (getBlocks(&samp_buf[0], 1) == 0)
+  {
+    pace_timer.setEnable(false);
+    return;
+  }
+  writeFrames(&samp_buf[0], block_size);
+
+  pace_timer.setEnable(true);
+
+} /* AudioDeviceFile::writeAudio */
+
+
+void AudioDeviceFile::writeFrames(const int16_t *buf, size_t frame_cnt)
+{
+  const size_t sample_cnt = frame_cnt * channels;
+  out_buf.resize(sample_cnt * sizeof(int16_t));
+  if (is_wav)
+  {
+    for (size_t i=0; i<sample_cnt; ++i)
+    {
+      store16bitValue(&out_buf[i * sizeof(int16_t)], buf[i]);
+    }
+  }
+  else
+  {
+    memcpy(&out_buf[0], buf, out_buf.size());
+  }
+
+  if (fwrite(&out_buf[0], 1, out_buf.size(), file) != out_buf.size())
+  {
+    cerr << "*** ERROR: Could not write to audio file \"" << devName()
+         << "\": " << strerror(errno) << endl;
+    return;
+  }
+  frames_written += frame_cnt;
+} /* AudioDeviceFile::writeFrames */
+
+
+void AudioDeviceFile::fillSilence(void)
+{
+  const int64_t elapsed_us = (monotonicNsec() - start_time) / 1000;
+  const uint64_t frames_expected = elapsed_us * sampleRate() / 1000000;
+  samp_buf.assign(block_size * channels, 0);
+  while (frames_written < frames_expected)
+  {
+    size_t frame_cnt = min(static_cast<uint64_t>(block_size),
+                           frames_expected - frames_written);
+    uint64_t prev_frames_written = frames_written;
+    writeFrames(&samp_buf[0], frame_cnt);
+    if (frames_written == prev_frames_written)
+    {
+      break;
+    }
+  }
+} /* AudioDeviceFile::fillSilence */
+
+
+
+/*
+ * This file has not been truncated
+ */
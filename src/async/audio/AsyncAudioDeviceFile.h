@@ -0,0 +1,247 @@
+/**
+@file	 AsyncAudioDeviceFile.h
+@brief   Read audio from, or write audio to, a file
+@author  Tobias Blomberg / SM0SVX
+@date	 2026-10-18
+
+Implements an "audio interface" that read audio samples from a file or
+write audio samples to a file. This can for example be used to replay
+recorded audio through an application for testing.
+
+\verbatim
+Async - A library for programming event driven applications
+Copyright (C) 2003-2026 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+
+#ifndef ASYNC_AUDIO_DEVICE_FILE_INCLUDED
+#define ASYNC_AUDIO_DEVICE_FILE_INCLUDED
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <stdint.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+#include <AsyncTimer.h>
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "AsyncAudioDevice.h"
+
+
+/****************************************************************************
+ *
+ * Forward declarations
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Namespace
+ *
+ ****************************************************************************/
+
+namespace Async
+{
+
+
+/****************************************************************************
+ *
+ * Forward declarations of classes inside of the declared namespace
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Class definitions
+ *
+ ****************************************************************************/
+
+/**
+@brief	Read audio from, or write audio to, a file
+@author Tobias Blomberg / SM0SVX
+@date   2026-10-18
+
+Implements an "audio interface" that read audio samples from a file or write
+audio samples to a file. The device is specified as "file:filename". A file
+can only be used in one direction so use different files for reading and
+writing.
+
+When reading, the file may be a WAV file containing 16 bit PCM samples or a
+raw file containing 16 bit signed samples in host byte order. A WAV file must
+have the same sample rate as the audio device and either one channel, which
+is then used for all device channels, or the same number of channels as the
+device. A raw file must contain interleaved samples for all device channels.
+Samples are read one block at a time, paced by a timer, so that the audio
+come in at the same rate as it would from a sound card. When the end of the
+file is reached, no more audio is read.
+
+When writing, a WAV file is written if the filename end in ".wav". Otherwise
+raw samples are written. The output is kept time aligned with the input,
+starting from when the device was created, by filling in silence for the
+periods where there is no audio to write. This also apply to the periods
+when the device is closed.
+
+Since the pacing is done using timers, this audio device work well together
+with Async::SimApplication to run an application faster than real time.
+*/
+class AudioDeviceFile : public Async::AudioDevice
+{
+  public:
+    /**
+     * @brief 	Constuctor
+     * @param 	dev_name  The name of the device to associate this object with
+     */
+    explicit AudioDeviceFile(const std::string& dev_name);
+
+    /**
+     * @brief 	Destructor
+     */
+    ~AudioDeviceFile(void);
+
+    /**
+     * @brief 	Find out what the read (recording) blocksize is set to
+     * @return	Returns the currently set blocksize in samples per channel
+     */
+    virtual size_t readBlocksize(void);
+
+    /**
+     * @brief 	Find out what the write (playback) blocksize is set to
+     * @return	Returns the currently set blocksize in samples per channel
+     */
+    virtual size_t writeBlocksize(void);
+
+    /**
+     * @brief 	Check if the audio device has full duplex capability
+     * @return	Returns \em true if the device has full duplex capability
+     *	      	or else \em false
+     */
+    virtual bool isFullDuplexCapable(void);
+
+    /**
+     * @brief 	Tell the audio device handler that there are audio to be
+     *	      	written in the buffer
+     */
+    virtual void audioToWriteAvailable(void);
+
+    /**
+     * @brief	Tell the audio device to flush its buffers
+     */
+    virtual void flushSamples(void);
+
+    /**
+     * @brief 	Find out how many samples there are in the output buffer
+     * @return	Returns the number of samples in the output buffer on
+     *          success or -1 on failure.
+     *
+     * Samples are written to the file directly so this function always
+     * return 0.
+     */
+    virtual int samplesToWrite(void) const;
+
+  protected:
+    /**
+     * @brief 	Open the audio device
+     * @param 	mode The mode to open the audio device in (See AudioIO::Mode)
+     * @return	Returns \em true on success or else \em false
+     */
+    virtual bool openDevice(Mode mode);
+
+    /**
+     * @brief 	Close the audio device
+     */
+    virtual void closeDevice(void);
+
+  private:
+    static const size_t WAVE_HEADER_SIZE = 44;
+
+    size_t      block_size;
+    Timer       pace_timer;
+    FILE *      file;
+    Mode        file_mode;
+    bool        is_wav;
+    size_t      file_channels;
+    uint64_t    frames_written;
+    int64_t     start_time;
+    std::vector<int16_t>  file_buf;
+    std::vector<int16_t>  samp_buf;
+    std::vector<char>     out_buf;
+
+    AudioDeviceFile(const AudioDeviceFile&);
+    AudioDeviceFile& operator=(const AudioDeviceFile&);
+    bool openFile(Mode mode);
+    void closeFile(void);
+    bool readWaveHeader(void);
+    bool writeWaveHeader(void);
+    void readAudio(void);
+    void writeAudio(void);
+    void writeFrames(const int16_t *buf, size_t frame_cnt);
+    void fillSilence(void);
+
+};  /* class AudioDeviceFile */
+
+
+} /* namespace */
+
+#endif /* ASYNC_AUDIO_DEVICE_FILE_INCLUDED */
+
+
+
+/*
+ * This file has not been truncated
+ */
@@ -47,6 +47,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  *
  ****************************************************************************/
 
+#include <AsyncApplication.h>
 
 
 /****************************************************************************
@@ -230,7 +231,7 @@ int AudioRecorder::writeSamples(const float *samples, int count)
     count = min(static_cast<unsigned>(count), max_samples - samples_written);
   }
 
-  gettimeofday(&end_timestamp, NULL);
+  Application::app().getTimeOfDay(&end_timestamp);
   if (!timerisset(&begin_timestamp))
   {
     long usec = static_cast<long>(1000000LL * count / sample_rate);
@@ -165,6 +165,21 @@ void Application::runTask(sigc::slot<void> task)
 } /* Application::runTask */
 
 
+void Application::clockGetTime(clockid_t clk_id, struct timespec *tp)
+{
+  ::clock_gettime(clk_id, tp);
+} /* Application::clockGetTime */
+
+
+void Application::getTimeOfDay(struct timeval *tv)
+{
+  struct timespec ts;
+  clockGetTime(CLOCK_REALTIME, &ts);
+  tv->tv_sec = ts.tv_sec;
+  tv->tv_usec = ts.tv_nsec / 1000;
+} /* Application::getTimeOfDay */
+
+
 
 /****************************************************************************
  *
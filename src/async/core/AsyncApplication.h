@@ -38,7 +38,10 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  ****************************************************************************/
 
 #include <sigc++/sigc++.h>
+#include <sys/time.h>
+#include <time.h>
 
+#include <chrono>
 #include <string>
 
 
@@ -119,6 +122,31 @@ class DnsLookupWorker;
 class Application : public sigc::trackable
 {
   public:
+    /**
+     * @brief   A monotonic clock that read the time through the application
+     *
+     * This clock can be used in place of std::chrono::steady_clock. It read
+     * the CLOCK_MONOTONIC time using the clockGetTime function so that it
+     * follow the simulated time when running under Async::SimApplication.
+     * It must only be used from the main thread.
+     */
+    struct SteadyClock
+    {
+      using duration    = std::chrono::nanoseconds;
+      using rep         = duration::rep;
+      using period      = duration::period;
+      using time_point  = std::chrono::time_point<SteadyClock>;
+      static constexpr bool is_steady = true;
+
+      static time_point now(void) noexcept
+      {
+        struct timespec ts;
+        app().clockGetTime(CLOCK_MONOTONIC, &ts);
+        return time_point(std::chrono::seconds(ts.tv_sec) +
+                          std::chrono::nanoseconds(ts.tv_nsec));
+      }
+    };
+
     /**
      * @brief 	Get the one and only application instance
      *
@@ -177,6 +205,28 @@ class Application : public sigc::trackable
      * and the second is an integer.
      */
     void runTask(sigc::slot<void> task);
+
+    /**
+     * @brief   Read the time of the specified clock
+     * @param   clk_id  The clock to read (e.g. CLOCK_MONOTONIC)
+     * @param   tp      The time is stored here
+     *
+     * Everything in the Async library that need to know the time, like
+     * timers, use this function instead of calling clock_gettime directly.
+     * That make it possible for an application class to supply its own
+     * notion of time, like Async::SimApplication does. The default
+     * implementation just call clock_gettime.
+     */
+    virtual void clockGetTime(clockid_t clk_id, struct timespec *tp);
+
+    /**
+     * @brief   Get the current wall clock time
+     * @param   tv  The time is stored here
+     *
+     * This function work like the gettimeofday function but read the time
+     * using the clockGetTime function.
+     */
+    void getTimeOfDay(struct timeval *tv);
     
   protected:
     void clearTasks(void);
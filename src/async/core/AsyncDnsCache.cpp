@@ -0,0 +1,392 @@
+/**
+@file	 AsyncDnsCache.cpp
+@brief   A process wide cache for DNS lookup results
+@author  Tobias Blomberg / SM0SVX
+@date	 2026-10-18
+
+\verbatim
+Async - A library for programming event driven applications
+Copyright (C) 2003-2026 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <cctype>
+#include <limits>
+#include <algorithm>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "AsyncApplication.h"
+#include "AsyncDnsLookup.h"
+#include "AsyncDnsCache.h"
+
+
+
+/****************************************************************************
+ *
+ * Namespaces to use
+ *
+ ****************************************************************************/
+
+using namespace std;
+using namespace Async;
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local class definitions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Prototypes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ *
+ * Local Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Public member functions
+ *
+ ****************************************************************************/
+
+DnsCache& DnsCache::instance(void)
+{
+    // The cache is never destroyed since the background lookups it may own
+    // cannot be torn down after the application object is gone
+  static DnsCache *the_cache = new DnsCache;
+  return *the_cache;
+} /* DnsCache::instance */
+
+
+void DnsCache::setEnabled(bool enable)
+{
+  m_enabled = enable;
+  if (!m_enabled)
+  {
+    clear();
+  }
+} /* DnsCache::setEnabled */
+
+
+bool DnsCache::lookup(const std::string& label, Type type, RRList& rrs,
+                      bool& failed)
+{
+  if (!m_enabled)
+  {
+    return false;
+  }
+
+  const string k = key(label, type);
+  auto it = m_entries.find(k);
+  if (it == m_entries.end())
+  {
+    ++m_stats.misses;
+    return false;
+  }
+
+  Entry& entry = it->second;
+  const auto age = chrono::duration_cast<chrono::seconds>(
+      Clock::now() - entry.created);
+  const bool is_negative = entry.rrs.empty();
+  const auto stale_time = chrono::seconds(is_negative ? 0 : m_stale_time);
+  if (age >= entry.ttl + stale_time)
+  {
+    m_entries.erase(it);
+    ++m_stats.misses;
+    return false;
+  }
+
+  const bool is_stale = (age >= entry.ttl);
+  rrs.clear();
+  for (const auto& rr : entry.rrs)
+  {
+    DnsResourceRecord::Ttl ttl = 0;
+    if (entry.ttl_known && !is_stale && (age.count() < rr->ttl()))
+    {
+      ttl = rr->ttl() - age.count();
+    }
+    rrs.push_back(unique_ptr<DnsResourceRecord>(rr->clone()));
+    rrs.back()->setTtl(ttl);
+  }
+  failed = entry.failed;
+
+  if (is_negative)
+  {
+    ++m_stats.negative_hits;
+  }
+  else if (is_stale)
+  {
+    ++m_stats.stale_hits;
+    refresh(k, label, type);
+  }
+  else
+  {
+    ++m_stats.hits;
+    const auto ttl = entry.ttl.count();
+    if (age.count() >= ttl - ttl / PREFETCH_DIVISOR)
+    {
+      refresh(k, label, type);
+    }
+  }
+
+  return true;
+} /* DnsCache::lookup */
+
+
+void DnsCache::store(const std::string& label, Type type, const RRList& rrs,
+                     bool failed)
+{
+  if (!m_enabled)
+  {
+    return;
+  }
+
+  const string k = key(label, type);
+  auto it = m_entries.find(k);
+
+    // Keep serving a stale answer rather than replacing it with a failure
+  if (rrs.empty() && (it != m_entries.end()) && !it->second.rrs.empty())
+  {
+    return;
+  }
+
+  Entry entry;
+  entry.failed = failed;
+  entry.created = Clock::now();
+  auto min_ttl = numeric_limits<DnsResourceRecord::Ttl>::max();
+  for (const auto& rr : rrs)
+  {
+    entry.rrs.push_back(unique_ptr<DnsResourceRecord>(rr->clone()));
+    min_ttl = min(min_ttl, rr->ttl());
+  }
+  if (entry.rrs.empty())
+  {
+    entry.ttl = chrono::seconds(m_negative_ttl);
+  }
+  else if (min_ttl == 0)
+  {
+    entry.ttl_known = false;
+    entry.ttl = chrono::seconds(m_unknown_ttl);
+  }
+  else
+  {
+    entry.ttl = chrono::seconds(min_ttl);
+  }
+
+  if (entry.ttl.count() == 0)
+  {
+    if (it != m_entries.end())
+    {
+      m_entries.erase(it);
+    }
+    return;
+  }
+
+  if ((it == m_entries.end()) && (m_entries.size() >= m_max_entries))
+  {
+    makeRoom(entry.created);
+  }
+  m_entries[k] = std::move(entry);
+} /* DnsCache::store */
+
+
+void DnsCache::clear(void)
+{
+  m_entries.clear();
+} /* DnsCache::clear */
+
+
+void DnsCache::printStats(std::ostream& os) const
+{
+  os << "DNS cache: entries=" << m_entries.size()
+     << " hits=" << m_stats.hits
+     << " stale_hits=" << m_stats.stale_hits
+     << " negative_hits=" << m_stats.negative_hits
+     << " misses=" << m_stats.misses
+     << " prefetches=" << m_stats.prefetches
+     << " evictions=" << m_stats.evictions
+     << std::endl;
+} /* DnsCache::printStats */
+
+
+/****************************************************************************
+ *
+ * Protected member functions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Private member functions
+ *
+ ****************************************************************************/
+
+DnsCache::DnsCache(void)
+{
+} /* DnsCache::DnsCache */
+
+
+DnsCache::~DnsCache(void)
+{
+  for (auto& item : m_refreshing)
+  {
+    delete item.second;
+  }
+  m_refreshing.clear();
+} /* DnsCache::~DnsCache */
+
+
+std::string DnsCache::key(const std::string& label, Type type)
+{
+  string k(DnsResourceRecord::typeToString(type));
+  k += ':';
+  for (char ch : label)
+  {
+    k += static_cast<char>(tolower(static_cast<unsigned char>(ch)));
+  }
+  return k;
+} /* DnsCache::key */
+
+
+void DnsCache::makeRoom(Clock::time_point now)
+{
+    // First get rid of entries that cannot be used anymore
+  for (auto it = m_entries.begin(); it != m_entries.end(); )
+  {
+    const Entry& entry = it->second;
+    const auto stale_time =
+      chrono::seconds(entry.rrs.empty() ? 0 : m_stale_time);
+    if (now >= entry.created + entry.ttl + stale_time)
+    {
+      it = m_entries.erase(it);
+    }
+    else
+    {
+      ++it;
+    }
+  }
+
+    // Then evict the entries that expire first
+  while (!m_entries.empty() && (m_entries.size() >= m_max_entries))
+  {
+    auto oldest = min_element(m_entries.begin(), m_entries.end(),
+        [](const EntryMap::value_type& a, const EntryMap::value_type& b)
+        {
+          return a.second.created + a.second.ttl <
+                 b.second.created + b.second.ttl;
+        });
+    m_entries.erase(oldest);
+    ++m_stats.evictions;
+  }
+} /* DnsCache::makeRoom */
+
+
+void DnsCache::refresh(const std::string& key, const std::string& label,
+                       Type type)
+{
+  if (m_refreshing.find(key) != m_refreshing.end())
+  {
+    return;
+  }
+
+  ++m_stats.prefetches;
+  DnsLookup *dns = new DnsLookup;
+  dns->setBypassCache(true);
+  dns->resultsReady.connect(sigc::mem_fun(*this, &DnsCache::onRefreshDone));
+  m_refreshing[key] = dns;
+  dns->lookup(label, type);
+} /* DnsCache::refresh */
+
+
+void DnsCache::onRefreshDone(DnsLookup& dns)
+{
+    // The lookup worker have already stored the answer in the cache. The
+    // lookup object cannot be deleted from within its own signal handler.
+  Application::app().runTask(
+      sigc::bind(sigc::mem_fun(*this, &DnsCache::deleteRefresh),
+                 key(dns.label(), dns.type())));
+} /* DnsCache::onRefreshDone */
+
+
+void DnsCache::deleteRefresh(std::string key)
+{
+  auto it = m_refreshing.find(key);
+  if (it != m_refreshing.end())
+  {
+    delete it->second;
+    m_refreshing.erase(it);
+  }
+} /* DnsCache::deleteRefresh */
+
+
+/*
+ * This file has not been truncated
+ */
@@ -0,0 +1,301 @@
+/**
+@file	 AsyncDnsCache.h
+@brief   A process wide cache for DNS lookup results
+@author  Tobias Blomberg / SM0SVX
+@date	 2026-10-18
+
+\verbatim
+Async - A library for programming event driven applications
+Copyright (C) 2003-2026 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+#ifndef ASYNC_DNS_CACHE_INCLUDED
+#define ASYNC_DNS_CACHE_INCLUDED
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <sigc++/sigc++.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <unordered_map>
+#include <iostream>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+#include <AsyncApplication.h>
+#include <AsyncDnsResourceRecord.h>
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Forward declarations
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Namespace
+ *
+ ****************************************************************************/
+
+namespace Async
+{
+
+
+/****************************************************************************
+ *
+ * Forward declarations of classes inside of the declared namespace
+ *
+ ****************************************************************************/
+
+class DnsLookup;
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Class definitions
+ *
+ ****************************************************************************/
+
+/**
+@brief	A process wide cache for DNS lookup results
+@author Tobias Blomberg / SM0SVX
+@date   2026-10-18
+
+This class implements a cache for DNS lookup results that is shared by all
+Async::DnsLookup objects in the process. A lookup worker first check the cache
+and only ask the resolver when there is no usable entry. Entries are kept for
+as long as the TTL of the looked up resource records say. Some lookup methods,
+like getaddrinfo, does not give any TTL. Those answers are kept for the time
+set using setUnknownTtl but are handed out with a zero TTL.
+
+An entry that is about to expire is refreshed in the background when it is
+used, so that frequently looked up names do not have to wait for the resolver.
+An entry that has expired is still used for a short while (stale time) while
+a new lookup is made in the background. Failed lookups are cached for a short
+time (negative TTL) so that a name that does not resolve does not cause a
+flood of lookups.
+
+The cache is only used from the main thread so no locking is done.
+*/
+class DnsCache : public sigc::trackable
+{
+  public:
+    using Type = DnsResourceRecord::Type;
+    using RRList = std::vector<std::unique_ptr<DnsResourceRecord>>;
+
+    /**
+     * @brief   Cache statistics
+     */
+    struct Stats
+    {
+      uint64_t hits           = 0;  //!< Answered by a valid entry
+      uint64_t stale_hits     = 0;  //!< Answered by an expired entry
+      uint64_t negative_hits  = 0;  //!< Answered by a cached failure
+      uint64_t misses         = 0;  //!< Had to ask the resolver
+      uint64_t prefetches     = 0;  //!< Background refreshes started
+      uint64_t evictions      = 0;  //!< Entries removed to make room
+    };
+
+    /**
+     * @brief   Get the process wide cache instance
+     * @return  Returns the one and only cache object
+     */
+    static DnsCache& instance(void);
+
+    /**
+     * @brief   Enable or disable the cache
+     * @param   enable Set to \em false to disable the cache
+     *
+     * Disabling the cache will also remove all entries from it.
+     */
+    void setEnabled(bool enable);
+
+    /**
+     * @brief   Check if the cache is enabled
+     * @return  Returns \em true if the cache is enabled
+     */
+    bool isEnabled(void) const { return m_enabled; }
+
+    /**
+     * @brief   Set the maximum number of entries in the cache
+     * @param   max_entries The maximum number of entries
+     */
+    void setMaxEntries(size_t max_entries) { m_max_entries = max_entries; }
+
+    /**
+     * @brief   Set how long to remember failed lookups
+     * @param   ttl The time in seconds to cache a failed lookup
+     */
+    void setNegativeTtl(unsigned ttl) { m_negative_ttl = ttl; }
+
+    /**
+     * @brief   Set how long to keep answers that lack a TTL
+     * @param   ttl The time in seconds to keep the answer
+     */
+    void setUnknownTtl(unsigned ttl) { m_unknown_ttl = ttl; }
+
+    /**
+     * @brief   Set for how long an expired entry may be used
+     * @param   stale_time The time in seconds after expiry
+     *
+     * While an expired entry is used, a background lookup is made to refresh
+     * the entry. Set to zero to never use expired entries.
+     */
+    void setStaleTime(unsigned stale_time) { m_stale_time = stale_time; }
+
+    /**
+     * @brief   Find a cached answer
+     * @param   label   The label that is looked up
+     * @param   type    The type of lookup
+     * @param   rrs     Copies of the cached records are stored here
+     * @param   failed  Set to \em true if the cached lookup failed
+     * @return  Returns \em true if an answer was found in the cache
+     *
+     * The TTL of the returned records are adjusted to the time left. If the
+     * entry is about to expire, or has expired but is still within the stale
+     * time, a background refresh is started.
+     */
+    bool lookup(const std::string& label, Type type, RRList& rrs,
+                bool& failed);
+
+    /**
+     * @brief   Store the answer from the resolver
+     * @param   label   The label that was looked up
+     * @param   type    The type of lookup
+     * @param   rrs     The records received from the resolver
+     * @param   failed  Set to \em true if the lookup failed
+     */
+    void store(const std::string& label, Type type, const RRList& rrs,
+               bool failed);
+
+    /**
+     * @brief   Remove all entries from the cache
+     */
+    void clear(void);
+
+    /**
+     * @brief   Get the number of entries in the cache
+     * @return  Returns the number of cached answers
+     */
+    size_t size(void) const { return m_entries.size(); }
+
+    /**
+     * @brief   Get cache statistics
+     * @return  Returns the accumulated cache statistics
+     */
+    const Stats& stats(void) const { return m_stats; }
+
+    /**
+     * @brief   Print cache statistics
+     * @param   os The stream to print to
+     */
+    void printStats(std::ostream& os=std::cout) const;
+
+  private:
+    using Clock = Application::SteadyClock;
+
+    struct Entry
+    {
+      RRList                rrs;
+      bool                  failed    = false;
+      bool                  ttl_known = true;
+      Clock::time_point     created;
+      std::chrono::seconds  ttl;
+    };
+    using EntryMap = std::unordered_map<std::string, Entry>;
+    using RefreshMap = std::unordered_map<std::string, DnsLookup*>;
+
+    static const unsigned DEFAULT_MAX_ENTRIES   = 1024;
+    static const unsigned DEFAULT_NEGATIVE_TTL  = 10;
+    static const unsigned DEFAULT_UNKNOWN_TTL   = 60;
+    static const unsigned DEFAULT_STALE_TIME    = 30;
+    static const unsigned PREFETCH_DIVISOR      = 10;
+
+    bool        m_enabled       = true;
+    size_t      m_max_entries   = DEFAULT_MAX_ENTRIES;
+    unsigned    m_negative_ttl  = DEFAULT_NEGATIVE_TTL;
+    unsigned    m_unknown_ttl   = DEFAULT_UNKNOWN_TTL;
+    unsigned    m_stale_time    = DEFAULT_STALE_TIME;
+    EntryMap    m_entries;
+    RefreshMap  m_refreshing;
+    Stats       m_stats;
+
+    DnsCache(void);
+    ~DnsCache(void);
+    DnsCache(const DnsCache&);
+    DnsCache& operator=(const DnsCache&);
+
+    static std::string key(const std::string& label, Type type);
+    void makeRoom(Clock::time_point now);
+    void refresh(const std::string& key, const std::string& label, Type type);
+    void onRefreshDone(DnsLookup& dns);
+    void deleteRefresh(std::string key);
+
+};  /* class DnsCache */
+
+
+} /* namespace */
+
+#endif /* ASYNC_DNS_CACHE_INCLUDED */
+
+
+
+/*
+ * This file has not been truncated
+ */
@@ -152,6 +152,9 @@ DnsLookup& DnsLookup::operator=(DnsLookup&& other)
   m_type = other.m_type;
   other.m_type = Type::A;
 
+  m_bypass_cache = other.m_bypass_cache;
+  other.m_bypass_cache = false;
+
   *m_worker = std::move(*other.m_worker);
 
   m_static_rrs = std::move(other.m_static_rrs);
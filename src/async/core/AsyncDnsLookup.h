@@ -114,7 +114,9 @@ class DnsLookupWorker;
 @date   2003-04-12
 
 Use this class to make DNS lookups. Right now it supports looking up A, PTR,
-CNAME and SRV records. An example usage can be seen below.
+CNAME and SRV records. Answers are shared between all lookup objects in the
+process through a cache, see Async::DnsCache. An example usage can be seen
+below.
 
 \include AsyncDnsLookup_demo.cpp
 */
@@ -191,6 +193,22 @@ class DnsLookup : public sigc::trackable
      */
     void abort(void);
 
+    /**
+     * @brief   Bypass the process wide DNS cache
+     * @param   bypass Set to \em true to always ask the resolver
+     *
+     * Normally a lookup is answered from the process wide DNS cache, see
+     * Async::DnsCache, if possible. Set bypass to \em true to always ask the
+     * resolver. The answer will still be stored in the cache.
+     */
+    void setBypassCache(bool bypass) { m_bypass_cache = bypass; }
+
+    /**
+     * @brief   Check if the process wide DNS cache is bypassed
+     * @return  Returns \em true if the cache is bypassed
+     */
+    bool bypassCache(void) const { return m_bypass_cache; }
+
     /**
      * @brief   Return the type of lookup
      * @return  Returns the lookup type
@@ -344,6 +362,7 @@ class DnsLookup : public sigc::trackable
     std::string               m_label;
     Type                      m_type          = Type::A;
     DnsLookupWorker*          m_worker        = 0;
+    bool                      m_bypass_cache  = false;
     RRList<DnsResourceRecord> m_static_rrs;
 
     void onResultsReady(void);
@@ -423,12 +423,12 @@ class DnsLookupWorker
     void setLookupFailed(bool failed=true) { m_lookup_failed = failed; }
 
   private:
-    using Clock = std::chrono::steady_clock;
+    using Clock = Application::SteadyClock;
 
     struct CompSRV
     {
       bool operator()(const DnsResourceRecordSRV* lhs,
-                      const DnsResourceRecordSRV* rhs)
+                      const DnsResourceRecordSRV* rhs) const
       {
         return lhs->prio() < rhs->prio();
       }
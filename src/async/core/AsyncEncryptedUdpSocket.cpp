@@ -189,7 +189,7 @@ bool EncryptedUdpSocket::setCipher(const EncryptedUdpSocket::Cipher* cipher)
 } /* EncryptedUdpSocket::setCipher */
 
 
-bool EncryptedUdpSocket::setCipherIV(std::vector<uint8_t> iv)
+bool EncryptedUdpSocket::setCipherIV(const std::vector<uint8_t>& iv)
 {
   m_cipher_iv = iv;
   size_t iv_length = EVP_CIPHER_CTX_iv_length(m_cipher_ctx);
@@ -205,7 +205,7 @@ const std::vector<uint8_t> EncryptedUdpSocket::cipherIV(void) const
 } /* EncryptedUdpSocket::cipherIV */
 
 
-bool EncryptedUdpSocket::setCipherKey(std::vector<uint8_t> key)
+bool EncryptedUdpSocket::setCipherKey(const std::vector<uint8_t>& key)
 {
   //std::cout << "### EncryptedUdpSocket::setCipherKey: key.size()="
   //          << key.size() << std::endl;
@@ -379,11 +379,13 @@ void EncryptedUdpSocket::onDataReceived(const IpAddress& ip, uint16_t port,
     {
       std::cout << "### EncryptedUdpSocket::onDataReceived: count=" << count
                 << " m_aadlen=" << m_aadlen << std::endl;
+      decryptionFailed(ip, port);
       return;
     }
     if(!EVP_DecryptUpdate(m_cipher_ctx, nullptr, &outlen, inbuf, m_aadlen))
     {
       std::cout << "### : EVP_DecryptUpdate AAD failed" << std::endl;
+      decryptionFailed(ip, port);
       return;
     }
     assert(static_cast<size_t>(outlen) == m_aadlen);
@@ -400,6 +402,7 @@ void EncryptedUdpSocket::onDataReceived(const IpAddress& ip, uint16_t port,
     {
       std::cout << "### Required tag does not fit within incoming data"
                 << std::endl;
+      decryptionFailed(ip, port);
       return;
     }
     if (!EVP_CIPHER_CTX_ctrl(
@@ -407,6 +410,7 @@ void EncryptedUdpSocket::onDataReceived(const IpAddress& ip, uint16_t port,
     {
       std::cout << "### EVP_CIPHER_CTX_ctrl(EVP_CTRL_AEAD_SET_TAG) failed"
                 << std::endl;
+      decryptionFailed(ip, port);
       return;
     }
     inbuf += m_taglen;
@@ -416,6 +420,7 @@ void EncryptedUdpSocket::onDataReceived(const IpAddress& ip, uint16_t port,
   if(!EVP_DecryptUpdate(m_cipher_ctx, outbuf, &outlen, inbuf, count))
   {
     std::cout << "### EVP_DecryptUpdate failed" << std::endl;
+    decryptionFailed(ip, port);
     return;
   }
 
@@ -423,6 +428,7 @@ void EncryptedUdpSocket::onDataReceived(const IpAddress& ip, uint16_t port,
   if(!EVP_DecryptFinal_ex(m_cipher_ctx, outbuf+outlen, &outlen))
   {
     std::cout << "### EVP_DecryptFinal_ex failed" << std::endl;
+    decryptionFailed(ip, port);
     return;
   }
   totoutlen += outlen;
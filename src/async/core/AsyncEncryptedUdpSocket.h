@@ -228,7 +228,7 @@ class EncryptedUdpSocket : public UdpSocket
      * the requirements for a specific cipher for constructing a safe IV.
      * The setCipher function must be called before calling this function.
      */
-    bool setCipherIV(std::vector<uint8_t> iv);
+    bool setCipherIV(const std::vector<uint8_t>& iv);
 
     /**
      * @brief   Get a previously set initialization vector (IV)
@@ -246,7 +246,7 @@ class EncryptedUdpSocket : public UdpSocket
      * for a specific cipher for constructing a key. The setCipher function
      * must be called before calling this function.
      */
-    bool setCipherKey(std::vector<uint8_t> key);
+    bool setCipherKey(const std::vector<uint8_t>& key);
 
     /**
      * @brief   Set a random cipher key to use
@@ -345,6 +345,17 @@ class EncryptedUdpSocket : public UdpSocket
     sigc::signal<void, const IpAddress&, uint16_t,
                  void*, void*, int> dataReceived;
 
+    /**
+     * @brief   A signal that is emitted when received data fail to decrypt
+     * @param   ip    The IP-address the data was received from
+     * @param   port  The remote port number
+     *
+     * This signal is emitted when a received datagram is too short, fail
+     * authentication or otherwise could not be decrypted. The datagram is
+     * dropped.
+     */
+    sigc::signal<void, const IpAddress&, uint16_t> decryptionFailed;
+
   protected:
     void onDataReceived(const IpAddress& ip, uint16_t port, void* buf,
         int count) override;
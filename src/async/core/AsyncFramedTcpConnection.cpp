@@ -116,10 +116,6 @@ FramedTcpConnection::FramedTcpConnection(size_t recv_buf_len)
   : TcpConnection(recv_buf_len), m_max_rx_frame_size(DEFAULT_MAX_FRAME_SIZE),
     m_max_tx_frame_size(DEFAULT_MAX_FRAME_SIZE), m_size_received(false)
 {
-#if 0
-  TcpConnection::sendBufferFull.connect(
-      sigc::mem_fun(*this, &FramedTcpConnection::onSendBufferFull));
-#endif
 } /* FramedTcpConnection::FramedTcpConnection */
 
 
@@ -130,21 +126,34 @@ FramedTcpConnection::FramedTcpConnection(
     m_max_rx_frame_size(DEFAULT_MAX_FRAME_SIZE),
     m_max_tx_frame_size(DEFAULT_MAX_FRAME_SIZE), m_size_received(false)
 {
-#if 0
-  TcpConnection::sendBufferFull.connect(
-      sigc::mem_fun(*this, &FramedTcpConnection::onSendBufferFull));
-#endif
 } /* FramedTcpConnection::FramedTcpConnection */
 
 
 FramedTcpConnection::~FramedTcpConnection(void)
 {
-  for (auto& item : m_txq)
+} /* FramedTcpConnection::~FramedTcpConnection */
+
+
+FramedTcpConnection::FrameBuf FramedTcpConnection::makeFrameBuf(
+    const void *buf, int count)
+{
+  if (count < 0)
   {
-    delete item;
+    return nullptr;
   }
-  m_txq.clear();
-} /* FramedTcpConnection::~FramedTcpConnection */
+
+  auto frame = std::make_shared<std::vector<char>>(4 + count);
+  char *ptr = frame->data();
+  *ptr++ = static_cast<uint32_t>(count) >> 24;
+  *ptr++ = (static_cast<uint32_t>(count) >> 16) & 0xff;
+  *ptr++ = (static_cast<uint32_t>(count) >> 8) & 0xff;
+  *ptr++ = (static_cast<uint32_t>(count)) & 0xff;
+  if (count > 0)
+  {
+    std::memcpy(ptr, buf, count);
+  }
+  return frame;
+} /* FramedTcpConnection::makeFrameBuf */
 
 
 TcpConnection& FramedTcpConnection::operator=(TcpConnection&& other_base)
@@ -169,9 +178,6 @@ TcpConnection& FramedTcpConnection::operator=(TcpConnection&& other_base)
   m_frame.swap(other.m_frame);
   other.m_frame.clear();
 
-  m_txq.swap(other.m_txq);
-  other.m_txq.clear();
-
   return *this;
 } /* FramedTcpConnection::operator=(TcpConnection&&) */
 
@@ -189,37 +195,31 @@ int FramedTcpConnection::write(const void *buf, int count)
     return -1;
   }
 
-  QueueItem *qi = new QueueItem(buf, count);
-  if (m_txq.empty())
+  return writeFrame(makeFrameBuf(buf, count));
+} /* FramedTcpConnection::write */
+
+
+int FramedTcpConnection::writeFrame(const FrameBuf& frame)
+{
+  if (!frame || (frame->size() < 4))
   {
-    int ret = TcpConnection::write(qi->m_buf, qi->m_size);
-    //cout << "###   count=" << (qi->m_size-qi->m_pos) << " ret=" << ret << endl;
-    if (ret < 0)
-    {
-      delete qi;
-      qi = 0;
-      return -1;
-    }
-    if (ret >= qi->m_size)
-    {
-      delete qi;
-      qi = 0;
-    }
-    else
-    {
-      //cout << "### Not all bytes were sent: count=" << count
-      //     << " ret=" << ret << endl;
-      qi->m_pos += ret;
-    }
+    errno = EINVAL;
+    return -1;
+  }
+  const int count = frame->size() - 4;
+  if (static_cast<uint32_t>(count) > m_max_tx_frame_size)
+  {
+    errno = EMSGSIZE;
+    return -1;
   }
 
-  if (qi != 0)
+  if (writeBuf(frame) < 0)
   {
-    m_txq.push_back(qi);
+    return -1;
   }
 
   return count;
-} /* FramedTcpConnection::write */
+} /* FramedTcpConnection::writeFrame */
 
 
 /****************************************************************************
@@ -228,20 +228,6 @@ int FramedTcpConnection::write(const void *buf, int count)
  *
  ****************************************************************************/
 
-void FramedTcpConnection::closeConnection(void)
-{
-  disconnectCleanup();
-  TcpConnection::closeConnection();
-} /* FramedTcpConnection::closeConnection */
-
-
-void FramedTcpConnection::onDisconnected(DisconnectReason reason)
-{
-  disconnectCleanup();
-  TcpConnection::onDisconnected(reason);
-} /* FramedTcpConnection::onDisconnected */
-
-
 int FramedTcpConnection::onDataReceived(void *buf, int count)
 {
   int orig_count = count;
@@ -296,44 +282,6 @@ int FramedTcpConnection::onDataReceived(void *buf, int count)
  *
  ****************************************************************************/
 
-#if 0
-void FramedTcpConnection::onSendBufferFull(bool is_full)
-{
-  //cout << "### FramedTcpConnection::onSendBufferFull: is_full="
-  //     << is_full << "\n";
-  if (!is_full)
-  {
-    while (!m_txq.empty())
-    {
-      QueueItem *qi = m_txq.front();
-      int ret = TcpConnection::write(qi->m_buf+qi->m_pos, qi->m_size-qi->m_pos);
-      //cout << "###   count=" << (qi->m_size-qi->m_pos) << " ret=" << ret << endl;
-      if (ret <= 0)
-      {
-        return;
-      }
-      qi->m_pos += ret;
-      if (qi->m_pos < qi->m_size)
-      {
-        break;
-      }
-      m_txq.pop_front();
-      delete qi;
-      qi = 0;
-    }
-  }
-} /* FramedTcpConnection::onSendBufferFull */
-#endif
-
-
-void FramedTcpConnection::disconnectCleanup(void)
-{
-  for (TxQueue::iterator it = m_txq.begin(); it != m_txq.end(); ++it)
-  {
-    delete *it;
-  }
-  m_txq.clear();
-} /* FramedTcpConnection::disconnectCleanup */
 
 
 /*
@@ -45,7 +45,6 @@ An example of how to use the FramedTcpConnection class in a server
 
 #include <stdint.h>
 #include <vector>
-#include <deque>
 #include <cstring>
 
 
@@ -131,6 +130,25 @@ that only want to see completely transfered messages at the other end.
 class FramedTcpConnection : public TcpConnection
 {
   public:
+    /**
+     * @brief   A shared, immutable frame buffer
+     *
+     * A frame buffer contain the frame header followed by the frame payload.
+     * It is created once using makeFrameBuf and may then be written to any
+     * number of connections. Each unencrypted connection only hold a
+     * reference to the buffer in its transmit queue until it has been sent so
+     * the same frame is never copied or reformatted per connection.
+     */
+    using FrameBuf = TxBuf;
+
+    /**
+     * @brief   Create a frame buffer
+     * @param   buf The buffer containing the frame payload
+     * @param   count The number of bytes in the frame payload
+     * @return  Returns a frame buffer or an empty pointer if count < 0
+     */
+    static FrameBuf makeFrameBuf(const void *buf, int count);
+
     /**
      * @brief 	Constructor
      * @param 	recv_buf_len  The length of the receiver buffer to use
@@ -219,6 +237,19 @@ class FramedTcpConnection : public TcpConnection
      */
     virtual int write(const void *buf, int count) override;
 
+    /**
+     * @brief   Send a prepared frame on the TCP connection
+     * @param   frame The frame buffer to send, as created by makeFrameBuf
+     * @return  Return the frame payload size or -1 on failure
+     *
+     * This function will send a frame that have been prepared using the
+     * makeFrameBuf function. It's mainly useful when the same frame is to be
+     * sent to many connections. On an unencrypted connection only a
+     * reference to the frame buffer is put in the transmit queue. On a TLS
+     * connection the frame is encrypted into the TLS transmit buffer.
+     */
+    int writeFrame(const FrameBuf& frame);
+
     /**
      * @brief 	A signal that is emitted when a connection has been terminated
      * @param 	con   	The connection object
@@ -243,23 +274,6 @@ class FramedTcpConnection : public TcpConnection
 
     FramedTcpConnection& operator=(const FramedTcpConnection&) = delete;
 
-    /**
-     * @brief   Disconnect from the remote peer
-     *
-     * This function is used internally to close the connection to the remote
-     * peer.
-     */
-    virtual void closeConnection(void) override;
-
-    /**
-     * @brief 	Called when a connection has been terminated
-     * @param 	reason  The reason for the disconnect
-     *
-     * This function will be called when the connection has been terminated.
-     * The default action for this function is to emit the disconnected signal.
-     */
-    virtual void onDisconnected(DisconnectReason reason) override;
-
     /**
      * @brief 	Called when data has been received on the connection
      * @param 	buf   A buffer containg the read data
@@ -289,37 +303,13 @@ class FramedTcpConnection : public TcpConnection
   private:
     static const uint32_t DEFAULT_MAX_FRAME_SIZE = 1024 * 1024; // 1MB
 
-    struct QueueItem
-    {
-      char* m_buf;
-      int   m_size;
-      int   m_pos;
-
-      QueueItem(const void* buf, int count)
-        : m_buf(0), m_size(4+count), m_pos(0)
-      {
-        m_buf = new char[4+count];
-        char *ptr = m_buf;
-        *ptr++ = static_cast<uint32_t>(count) >> 24;
-        *ptr++ = (static_cast<uint32_t>(count) >> 16) & 0xff;
-        *ptr++ = (static_cast<uint32_t>(count) >> 8) & 0xff;
-        *ptr++ = (static_cast<uint32_t>(count)) & 0xff;
-        std::memcpy(ptr, buf, count);
-      }
-      ~QueueItem(void) { delete [] m_buf; }
-    };
-    typedef std::deque<QueueItem*> TxQueue;
-
     uint32_t              m_max_rx_frame_size;
     uint32_t              m_max_tx_frame_size;
     bool                  m_size_received;
     uint32_t              m_frame_size;
     std::vector<uint8_t>  m_frame;
-    TxQueue               m_txq;
 
     FramedTcpConnection(const FramedTcpConnection&) = delete;
-    //void onSendBufferFull(bool is_full);
-    void disconnectCleanup(void);
 
 };  /* class FramedTcpConnection */
 
@@ -462,6 +462,8 @@ const char* HttpServerConnection::codeToString(unsigned code)
   {
     case 200:
       return "OK";
+    case 304:
+      return "Not Modified";
     case 404:
       return "Not Found";
     case 406:
@@ -221,7 +221,9 @@ bool Pty::open(void)
 
 void Pty::close(void)
 {
-  if (!m_slave_link.empty())
+    // Only remove the symlink if we created it. It may belong to another
+    // process if the creation failed.
+  if (!m_slave_link.empty() && !m_slave_path.empty())
   {
     unlink(m_slave_link.c_str());
   }
@@ -36,10 +36,18 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include <openssl/err.h>
 #include <openssl/pem.h>
+#include <openssl/rand.h>
 #include <openssl/ssl.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 
+#include <algorithm>
 #include <iostream>
 #include <cassert>
+#include <cstdio>
+#include <string>
+#include <vector>
 
 
 /****************************************************************************
@@ -164,6 +172,7 @@ class SslContext
      */
     ~SslContext(void)
     {
+      clearClientSession();
       SSL_CTX_free(m_ctx);
       m_ctx = nullptr;
     }
@@ -204,6 +213,9 @@ class SslContext
       //             "Certificate and private key loaded and verified"
       //          << std::endl;
 
+        // A cached session is bound to the old certificate
+      clearClientSession();
+
       return true;
     }
 
@@ -216,6 +228,150 @@ class SslContext
       return m_cafile_set;
     }
 
+    /**
+     * @brief   Enable the server side session cache
+     * @param   id_context  A string identifying the application
+     * @param   timeout     The session lifetime in seconds
+     * @param   size        The maximum number of cached sessions
+     * @return  Return \em true on success or else \em false
+     *
+     * Enable caching of sessions so that a client that reconnects can resume
+     * its previous session, using a session ID or a session ticket, instead
+     * of doing a full handshake. A resumed handshake does not involve any
+     * public key operations so it is much cheaper for the server. The
+     * id_context must be set since peer certificates are verified.
+     */
+    bool enableServerSessionCache(const std::string& id_context,
+                                  long timeout=3600, long size=20480)
+    {
+      if (SSL_CTX_set_session_id_context(m_ctx,
+            reinterpret_cast<const unsigned char*>(id_context.data()),
+            std::min(id_context.size(),
+                     static_cast<size_t>(SSL_MAX_SID_CTX_LENGTH))) != 1)
+      {
+        sslPrintErrors("SSL_CTX_set_session_id_context failed");
+        return false;
+      }
+      SSL_CTX_set_session_cache_mode(m_ctx, SSL_SESS_CACHE_SERVER);
+      SSL_CTX_sess_set_cache_size(m_ctx, size);
+      SSL_CTX_set_timeout(m_ctx, timeout);
+      return true;
+    }
+
+    /**
+     * @brief   Set the file holding the session ticket encryption keys
+     * @param   keyfile The path to the key file
+     * @return  Return \em true on success or else \em false
+     *
+     * Session tickets are encrypted using a key that by default is generated
+     * at random when the context is created. That means that tickets cannot
+     * be used to resume sessions after the application has been restarted.
+     * Using this function the keys are instead read from a file so that they
+     * persist between restarts. If the file does not exist, new random keys
+     * will be generated and written to the file. Remove the file to rotate
+     * the keys. Note that the peer certificate is not verified again when a
+     * session is resumed, also across restarts when the keys persist.
+     */
+    bool setSessionTicketKeyFile(const std::string& keyfile)
+    {
+      long keylen = SSL_CTX_get_tlsext_ticket_keys(m_ctx, nullptr, 0);
+      if (keylen <= 0)
+      {
+        return false;
+      }
+      std::vector<unsigned char> keys(keylen);
+      FILE* f = fopen(keyfile.c_str(), "rb");
+      if (f != nullptr)
+      {
+        size_t cnt = fread(keys.data(), 1, keys.size(), f);
+        fclose(f);
+        if (cnt != keys.size())
+        {
+          std::cerr << "*** ERROR: Malformed session ticket key file '"
+                    << keyfile << "'" << std::endl;
+          return false;
+        }
+      }
+      else
+      {
+        if (RAND_bytes(keys.data(), keys.size()) != 1)
+        {
+          sslPrintErrors("RAND_bytes failed");
+          return false;
+        }
+          // The file is created readable for the owner only right away so
+          // that there is no window where others can read the keys
+        int fd = open(keyfile.c_str(), O_CREAT | O_WRONLY | O_TRUNC | O_CLOEXEC,
+                      0600);
+        f = (fd >= 0) ? fdopen(fd, "wb") : nullptr;
+        if ((f == nullptr) ||
+            (fwrite(keys.data(), 1, keys.size(), f) != keys.size()))
+        {
+          std::cerr << "*** ERROR: Could not write session ticket key file '"
+                    << keyfile << "'" << std::endl;
+          if (f != nullptr)
+          {
+            fclose(f);
+          }
+          else if (fd >= 0)
+          {
+            close(fd);
+          }
+          return false;
+        }
+        fclose(f);
+      }
+      if (SSL_CTX_set_tlsext_ticket_keys(m_ctx, keys.data(), keys.size()) != 1)
+      {
+        sslPrintErrors("SSL_CTX_set_tlsext_ticket_keys failed");
+        return false;
+      }
+      return true;
+    }
+
+    /**
+     * @brief   Enable the client side session cache
+     *
+     * When enabled, the last session received from a server will be stored
+     * in the context and offered to the server on the next connect. If the
+     * server accept it, the session is resumed without a full handshake.
+     */
+    void enableClientSessionCache(void)
+    {
+      SSL_CTX_set_app_data(m_ctx, this);
+      SSL_CTX_set_session_cache_mode(m_ctx,
+          SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+      SSL_CTX_sess_set_new_cb(m_ctx, clientSessionReceived);
+    }
+
+    /**
+     * @brief   Offer the cached session, if any, to the server
+     * @param   ssl The SSL object for a new client connection
+     *
+     * This function is called by the TcpConnection class before a client
+     * handshake is started.
+     */
+    void applyClientSession(SSL* ssl)
+    {
+      if ((m_client_session != nullptr) &&
+          SSL_SESSION_is_resumable(m_client_session))
+      {
+        SSL_set_session(ssl, m_client_session);
+      }
+    }
+
+    /**
+     * @brief   Forget the cached client session
+     */
+    void clearClientSession(void)
+    {
+      if (m_client_session != nullptr)
+      {
+        SSL_SESSION_free(m_client_session);
+        m_client_session = nullptr;
+      }
+    }
+
     void sslPrintErrors(const char* fname)
     {
       std::cerr << "*** ERROR: OpenSSL failed: ";
@@ -228,8 +384,22 @@ class SslContext
   protected:
 
   private:
-    SSL_CTX*  m_ctx         = nullptr;
-    bool      m_cafile_set  = false;
+    SSL_CTX*      m_ctx             = nullptr;
+    bool          m_cafile_set      = false;
+    SSL_SESSION*  m_client_session  = nullptr;
+
+    static int clientSessionReceived(SSL* ssl, SSL_SESSION* session)
+    {
+      auto ctx = reinterpret_cast<SslContext*>(
+          SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
+      if (ctx == nullptr)
+      {
+        return 0;
+      }
+      ctx->clearClientSession();
+      ctx->m_client_session = session;
+      return 1; // We keep the reference to the session
+    }
 
     static void initializeGlobals(void)
     {
@@ -224,6 +224,18 @@ void TcpClientBase::connect(const IpAddress& remote_ip, uint16_t remote_port)
 } /* TcpClientBase::connect */
 
 
+void TcpClientBase::connect(const string& remote_host,
+                            const IpAddress& remote_ip, uint16_t remote_port)
+{
+  assert(isIdle() && con->isIdle());
+
+  con->setRemoteAddr(remote_ip);
+  con->setRemotePort(remote_port);
+  dns.setLookupParams(IpAddress(remote_host).isEmpty() ? remote_host : "");
+  connectToRemote();
+} /* TcpClientBase::connect */
+
+
 void TcpClientBase::connect(void)
 {
   assert(isIdle() && con->isIdle());
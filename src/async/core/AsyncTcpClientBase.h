@@ -224,6 +224,20 @@ class TcpClientBase : virtual public sigc::trackable
      */
     void connect(const Async::IpAddress& remote_ip, uint16_t remote_port);
 
+    /**
+     * @brief 	Connect to an already resolved remote host
+     * @param 	remote_host   The hostname of the remote host
+     * @param 	remote_ip     The IP address of the remote host
+     * @param 	remote_port   The port on the remote host to connect to
+     *
+     * This function work like the connect function taking an IP address
+     * but the hostname is remembered so that remoteHostName() will return it,
+     * e.g. for checking the name in the certificate of the remote host. No
+     * DNS lookup is made.
+     */
+    void connect(const std::string& remote_host,
+                 const Async::IpAddress& remote_ip, uint16_t remote_port);
+
     /**
      * @brief 	Connect to the remote host
      *
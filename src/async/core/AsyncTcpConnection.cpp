@@ -35,6 +35,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <assert.h>
@@ -114,6 +115,7 @@ using namespace Async;
  ****************************************************************************/
 
 std::map<SSL*, TcpConnection*> TcpConnection::ssl_con_map;
+TcpConnection::TxBufPool TcpConnection::tx_buf_pool;
 
 
 /****************************************************************************
@@ -200,9 +202,17 @@ TcpConnection& TcpConnection::operator=(TcpConnection&& other)
   other.m_recv_buf.clear();
   other.m_recv_buf.reserve(m_recv_buf.capacity());
 
-  m_write_buf = std::move(other.m_write_buf);
-  other.m_write_buf.clear();
-  other.m_write_buf.reserve(m_write_buf.capacity());
+  m_txq = std::move(other.m_txq);
+  other.m_txq.clear();
+
+  m_txq_size = other.m_txq_size;
+  other.m_txq_size = 0;
+
+  m_max_txq_size = other.m_max_txq_size;
+  other.m_max_txq_size = 0;
+
+  m_tx_stats = other.m_tx_stats;
+  other.m_tx_stats = TxStats();
 
   m_ssl_ctx = other.m_ssl_ctx;
   other.m_ssl_ctx = nullptr;
@@ -223,6 +233,9 @@ TcpConnection& TcpConnection::operator=(TcpConnection&& other)
   other.m_ssl_encrypt_buf.clear();
   other.m_ssl_encrypt_buf.reserve(m_ssl_encrypt_buf.capacity());
 
+  m_ssl_decrypt_buf = std::move(other.m_ssl_decrypt_buf);
+  other.m_ssl_decrypt_buf.clear();
+
   return *this;
 } /* TcpConnection::operator= */
 
@@ -239,6 +252,11 @@ void TcpConnection::setRecvBufLen(size_t recv_buf_len)
 int TcpConnection::write(const void *buf, int count)
 {
   assert(sock >= 0);
+  if (txQueueFull(count))
+  {
+    return -1;
+  }
+  m_tx_stats.queued_bytes += count;
   if (m_ssl != nullptr)
   {
     return sslWrite(reinterpret_cast<const char*>(buf), count);
@@ -268,6 +286,7 @@ void TcpConnection::enableSsl(bool enable)
     else
     {
       //SSL_set_tlsext_host_name(m_ssl, "svxreflector.example.com");
+      m_ssl_ctx->applyClientSession(m_ssl);
       SSL_set_connect_state(m_ssl);
       auto ret = sslDoHandshake();
       assert(ret != SSLSTATUS_FAIL);
@@ -310,6 +329,21 @@ Async::SslX509 TcpConnection::sslCertificate(void) const
 } /* TcpConnection::sslCertificate */
 
 
+bool TcpConnection::sslSessionReused(void) const
+{
+  return (m_ssl != nullptr) && (SSL_session_reused(m_ssl) == 1);
+} /* TcpConnection::sslSessionReused */
+
+
+bool TcpConnection::sslExportKeyingMaterial(uint8_t* out, size_t len,
+                                            const std::string& label) const
+{
+  return (m_ssl != nullptr) &&
+         (SSL_export_keying_material(m_ssl, out, len, label.data(),
+                                     label.size(), nullptr, 0, 0) == 1);
+} /* TcpConnection::sslExportKeyingMaterial */
+
+
 long TcpConnection::sslVerifyResult(void) const
 {
   return SSL_get_verify_result(m_ssl);
@@ -370,6 +404,29 @@ void TcpConnection::setSocket(int sock)
 } /* TcpConnection::setSocket */
 
 
+int TcpConnection::writeBuf(const TxBuf& buf)
+{
+  assert(sock >= 0);
+  assert(buf != nullptr);
+  if (txQueueFull(buf->size()))
+  {
+    return -1;
+  }
+  m_tx_stats.queued_bytes += buf->size();
+  if (m_ssl != nullptr)
+  {
+    return sslWrite(buf->data(), buf->size());
+  }
+  if (!buf->empty())
+  {
+    m_txq.emplace_back();
+    m_txq.back().m_shared = buf;
+    txQueueGrown(buf->size());
+  }
+  return buf->size();
+} /* TcpConnection::writeBuf */
+
+
 void TcpConnection::setRemoteAddr(const IpAddress& remote_addr)
 {
   this->remote_addr = remote_addr;
@@ -419,8 +476,9 @@ Async::IpAddress TcpConnection::localHost(void) const
 void TcpConnection::closeConnection(void)
 {
   m_recv_buf.clear();
-  m_write_buf.clear();
+  clearTxQueue();
   m_ssl_encrypt_buf.clear();
+  m_ssl_decrypt_buf.clear();
 
   m_wr_watch.setEnabled(false);
   rd_watch.setEnabled(false);
@@ -537,58 +595,156 @@ void TcpConnection::recvHandler(FdWatch *watch)
 } /* TcpConnection::recvHandler */
 
 
+bool TcpConnection::txQueueFull(size_t count)
+{
+  if ((m_max_txq_size > 0) && (txQueueSize() + count > m_max_txq_size))
+  {
+    m_tx_stats.overflows += 1;
+    errno = ENOBUFS;
+    return true;
+  }
+  return false;
+} /* TcpConnection::txQueueFull */
+
+
 void TcpConnection::addToWriteBuf(const char *buf, size_t len)
 {
-  m_write_buf.insert(m_write_buf.end(), buf, buf+len);
-  m_wr_watch.setEnabled(!m_write_buf.empty());
+  if (len == 0)
+  {
+    return;
+  }
+
+    // Small writes are appended to the last chunk in the queue if it's not
+    // shared and there is room for the data. New chunks are preferably
+    // taken from the buffer pool to avoid memory allocations.
+  if (m_txq.empty() || m_txq.back().m_shared ||
+      (m_txq.back().m_buf.size() + len > TX_CHUNK_SIZE))
+  {
+    m_txq.emplace_back();
+    auto& chunk_buf = m_txq.back().m_buf;
+    if (!tx_buf_pool.empty())
+    {
+      chunk_buf = std::move(tx_buf_pool.back());
+      tx_buf_pool.pop_back();
+    }
+    chunk_buf.reserve(std::max(len, TX_CHUNK_SIZE));
+  }
+  auto& chunk_buf = m_txq.back().m_buf;
+  chunk_buf.insert(chunk_buf.end(), buf, buf+len);
+  txQueueGrown(len);
 } /* TcpConnection::addToWriteBuf */
 
 
+void TcpConnection::txQueueGrown(size_t len)
+{
+  m_txq_size += len;
+  m_tx_stats.queue_peak = std::max(m_tx_stats.queue_peak, txQueueSize());
+  m_wr_watch.setEnabled(true);
+} /* TcpConnection::txQueueGrown */
+
+
+void TcpConnection::clearTxQueue(void)
+{
+  for (auto& chunk : m_txq)
+  {
+    releaseTxChunk(chunk);
+  }
+  m_txq.clear();
+  m_txq_size = 0;
+} /* TcpConnection::clearTxQueue */
+
+
+void TcpConnection::releaseTxChunk(TxChunk& chunk)
+{
+  if (!chunk.m_shared && (chunk.m_buf.capacity() <= TX_CHUNK_SIZE) &&
+      (tx_buf_pool.size() < TX_POOL_SIZE))
+  {
+    chunk.m_buf.clear();
+    tx_buf_pool.push_back(std::move(chunk.m_buf));
+  }
+} /* TcpConnection::releaseTxChunk */
+
+
 void TcpConnection::onWriteSpaceAvailable(Async::FdWatch* w)
 {
-  ssize_t n = rawWrite(m_write_buf.data(), m_write_buf.size());
-  //std::cout << "### TcpConnection::onWriteSpaceAvailabe:"
-  //          << "  fd=" << w->fd()
-  //          << "  n=" << n
-  //          << "  bufsize=" << m_write_buf.size()
-  //          << std::endl;
-  assert(n <= static_cast<ssize_t>(m_write_buf.size()));
-  if (n >= 0)
+    // Encrypt all data written since the last time the socket was writable
+    // so that it end up in as few TLS records as possible
+  if ((m_ssl != nullptr) && (sslEncrypt() != 0))
   {
-    if (n == static_cast<ssize_t>(m_write_buf.size()))
-    {
-      m_write_buf.clear();
-    }
-    else if (n > 0)
-    {
-      std::rotate(m_write_buf.begin(), m_write_buf.begin() + n,
-                  m_write_buf.end());
-      m_write_buf.resize(m_write_buf.size() - n);
-    }
+    sslPrintErrors("sslEncrypt");
   }
-  else
+
+  if (sendTxQueue() < 0)
+  {
+    perror("### TcpConnection::onWriteSpaceAvailable: sendmsg()");
+  }
+  w->setEnabled(!m_txq.empty());
+  if (txQueueSize() == 0)
   {
-    perror("### TcpConnection::onWriteSpaceAvailable: rawWrite()");
+    txQueueEmptied(this);
   }
-  w->setEnabled(!m_write_buf.empty());
 } /* TcpConnection::onWriteSpaceAvailable */
 
 
-int TcpConnection::rawWrite(const void* buf, int count)
+int TcpConnection::sendTxQueue(void)
 {
   assert(sock != -1);
-  int cnt = ::send(sock, buf, count, MSG_NOSIGNAL);
-  if (cnt < 0)
+  while (!m_txq.empty())
   {
-    if (errno != EAGAIN)
+    struct iovec iov[TX_IOV_MAX];
+    int iovcnt = 0;
+    size_t count = 0;
+    for (auto it = m_txq.begin();
+         (it != m_txq.end()) && (iovcnt < TX_IOV_MAX); ++it)
     {
-      return -1;
+      iov[iovcnt].iov_base = const_cast<char*>(it->data());
+      iov[iovcnt].iov_len = it->size();
+      count += it->size();
+      ++iovcnt;
+    }
+
+    struct msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iovcnt;
+    ssize_t n = ::sendmsg(sock, &msg, MSG_NOSIGNAL);
+    m_tx_stats.send_calls += 1;
+    //std::cout << "### TcpConnection::sendTxQueue:"
+    //          << "  fd=" << sock
+    //          << "  iovcnt=" << iovcnt
+    //          << "  count=" << count
+    //          << "  n=" << n
+    //          << std::endl;
+    if (n < 0)
+    {
+      return (errno == EAGAIN) ? 0 : -1;
+    }
+    assert(static_cast<size_t>(n) <= count);
+    m_tx_stats.sent_bytes += n;
+    m_txq_size -= n;
+
+    size_t left = n;
+    while (left > 0)
+    {
+      TxChunk& chunk = m_txq.front();
+      if (left < chunk.size())
+      {
+        chunk.m_pos += left;
+        break;
+      }
+      left -= chunk.size();
+      releaseTxChunk(chunk);
+      m_txq.pop_front();
+    }
+
+    if (static_cast<size_t>(n) < count)
+    {
+      break;
     }
-    cnt = 0;
   }
 
-  return cnt;
-} /* TcpConnection::rawWrite */
+  return 0;
+} /* TcpConnection::sendTxQueue */
 
 
 void TcpConnection::sslPrintErrors(const char* fname)
@@ -667,7 +823,20 @@ int TcpConnection::sslRecvHandler(char* src, int count)
       //std::cout << "### SSL_read: n=" << n << std::endl;
       if (n > 0)
       {
-        onDataReceived(buf, n);
+          // Decrypted data not processed by the receiver is kept until more
+          // data arrive, just like for unencrypted connections
+        m_ssl_decrypt_buf.insert(m_ssl_decrypt_buf.end(), buf, buf+n);
+        int processed = onDataReceived(m_ssl_decrypt_buf.data(),
+                                       m_ssl_decrypt_buf.size());
+        if (processed >= static_cast<int>(m_ssl_decrypt_buf.size()))
+        {
+          m_ssl_decrypt_buf.clear();
+        }
+        else if (processed > 0)
+        {
+          m_ssl_decrypt_buf.erase(m_ssl_decrypt_buf.begin(),
+                                  m_ssl_decrypt_buf.begin() + processed);
+        }
       }
     } while (n > 0);
 
@@ -795,7 +964,14 @@ int TcpConnection::sslWrite(const void* buf, int count)
 {
   const char* ptr = reinterpret_cast<const char*>(buf);
   m_ssl_encrypt_buf.insert(m_ssl_encrypt_buf.end(), ptr, ptr+count);
-  sslEncrypt();
+  m_tx_stats.queue_peak = std::max(m_tx_stats.queue_peak, txQueueSize());
+
+    // The encryption is deferred until the socket is writable so that all
+    // data written during this main loop iteration is coalesced
+  if (SSL_is_init_finished(m_ssl))
+  {
+    m_wr_watch.setEnabled(true);
+  }
   return count;
 } /* TcpConnection::sslWrite */
 
@@ -48,7 +48,9 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <cassert>
 #include <cstring>
 #include <vector>
+#include <deque>
 #include <map>
+#include <memory>
 
 
 /****************************************************************************
@@ -134,6 +136,14 @@ be encrypted using the setSslContext() and enableSsl() functions.
 The reception buffer size given at construction time or using the
 setRecvBufLen() function is an initial value. If during the connection a larger
 buffer is needed the size will be automatically increased.
+
+Written data is put in a transmit queue which is flushed, using one gathering
+send system call for many queued buffers, when the socket is writable. For
+TLS connections, data written during one main loop iteration is encrypted in
+one go so that small writes are coalesced into as few TLS records as
+possible. The transmit queue size can be limited using setMaxTxQueueSize()
+and queue statistics, e.g. for detecting slow receivers, can be retrieved
+using txQueueSize() and txStats().
 */
 class TcpConnection : virtual public sigc::trackable
 {
@@ -177,6 +187,23 @@ class TcpConnection : virtual public sigc::trackable
      * @brief The default size of the reception buffer
      */
     static const int DEFAULT_RECV_BUF_LEN = 1024;
+
+    /**
+     * @brief A shared, immutable transmit buffer
+     */
+    using TxBuf = std::shared_ptr<const std::vector<char>>;
+
+    /**
+     * @brief Transmit statistics
+     */
+    struct TxStats
+    {
+      uint64_t  queued_bytes  = 0;  ///< Total number of bytes written
+      uint64_t  sent_bytes    = 0;  ///< Total number of bytes sent to socket
+      uint64_t  send_calls    = 0;  ///< Number of send system calls
+      size_t    queue_peak    = 0;  ///< Largest transmit queue size in bytes
+      uint64_t  overflows     = 0;  ///< Writes rejected due to a full queue
+    };
     
     /**
      * @brief Translate disconnect reason to a string
@@ -246,6 +273,37 @@ class TcpConnection : virtual public sigc::trackable
      */
     virtual int write(const void *buf, int count);
 
+    /**
+     * @brief   Set the maximum size of the transmit queue
+     * @param   max_size The maximum queue size in bytes, 0 is unlimited
+     *
+     * When the transmit queue limit has been set, writes that would make the
+     * queue grow larger than the limit will fail, setting errno to ENOBUFS.
+     * The default is to not limit the transmit queue size.
+     */
+    void setMaxTxQueueSize(size_t max_size) { m_max_txq_size = max_size; }
+
+    /**
+     * @brief   Get the maximum size of the transmit queue
+     * @return  Returns the maximum queue size in bytes, 0 is unlimited
+     */
+    size_t maxTxQueueSize(void) const { return m_max_txq_size; }
+
+    /**
+     * @brief   Get the current size of the transmit queue
+     * @return  Returns the number of bytes that have not been sent yet
+     */
+    size_t txQueueSize(void) const
+    {
+      return m_txq_size + m_ssl_encrypt_buf.size();
+    }
+
+    /**
+     * @brief   Get transmit statistics for this connection
+     * @return  Returns the transmit statistics
+     */
+    const TxStats& txStats(void) const { return m_tx_stats; }
+
     /**
      * @brief   Get the local IP address associated with this connection
      * @return  Returns an IP address
@@ -314,6 +372,31 @@ class TcpConnection : virtual public sigc::trackable
      */
     long sslVerifyResult(void) const;
 
+    /**
+     * @brief   Check if the TLS session was resumed
+     * @return  Returns \em true if an earlier session was resumed
+     *
+     * A resumed session has been set up using an abbreviated handshake,
+     * without any certificate exchange, using a session ID or ticket from an
+     * earlier connection (@see SslContext::enableServerSessionCache).
+     */
+    bool sslSessionReused(void) const;
+
+    /**
+     * @brief   Export keying material from the TLS session
+     * @param   out   The buffer to store the keying material in
+     * @param   len   The number of bytes to export
+     * @param   label The label to use, as described in RFC 5705
+     * @return  Returns \em true on success or \em false on failure
+     *
+     * The exported keying material is the same on both sides of a connection
+     * but different for each TLS session. It can be used to bind an
+     * application level authentication to the TLS session so that it cannot
+     * be relayed by a man in the middle.
+     */
+    bool sslExportKeyingMaterial(uint8_t* out, size_t len,
+                                 const std::string& label) const;
+
     /**
      * @brief   Set the OpenSSL context to use when setting up the connection
      * @param   ctx The context object to use
@@ -382,6 +465,17 @@ class TcpConnection : virtual public sigc::trackable
      */
     sigc::signal<void, TcpConnection*> sslConnectionReady;
 
+    /**
+     * @brief   A signal that is emitted when the transmit queue is emptied
+     * @param   con The connection object
+     *
+     * This signal is emitted when all queued data has been handed over to the
+     * operating system. It can be used to implement flow control, where the
+     * application keep its own queue of data to send and only write more
+     * when the connection transmit queue has been emptied.
+     */
+    sigc::signal<void, TcpConnection*> txQueueEmptied;
+
   protected:
     /**
      * @brief 	Setup information about the connection
@@ -416,6 +510,18 @@ class TcpConnection : virtual public sigc::trackable
      */
     int socket(void) const { return sock; }
 
+    /**
+     * @brief   Write a shared buffer to the TCP connection
+     * @param   buf The buffer to write
+     * @return  Returns the number of bytes written or -1 on failure
+     *
+     * This function works like the write function but for unencrypted
+     * connections, only a reference to the buffer is stored in the transmit
+     * queue. The buffer is thus never copied, even if it's written to many
+     * connections.
+     */
+    int writeBuf(const TxBuf& buf);
+
     /**
      * @brief   Disconnect from the remote peer
      *
@@ -497,8 +603,30 @@ class TcpConnection : virtual public sigc::trackable
     };
 
     static constexpr const size_t DEFAULT_BUF_SIZE = 1024;
+    static constexpr const size_t TX_CHUNK_SIZE    = 16384;
+    static constexpr const size_t TX_POOL_SIZE     = 64;
+    static constexpr const int    TX_IOV_MAX       = 64;
+
+    struct TxChunk
+    {
+      TxBuf             m_shared;
+      std::vector<char> m_buf;
+      size_t            m_pos = 0;
+
+      const char* data(void) const
+      {
+        return (m_shared ? m_shared->data() : m_buf.data()) + m_pos;
+      }
+      size_t size(void) const
+      {
+        return (m_shared ? m_shared->size() : m_buf.size()) - m_pos;
+      }
+    };
+    using TxQueue = std::deque<TxChunk>;
+    using TxBufPool = std::vector<std::vector<char>>;
 
     static std::map<SSL*, TcpConnection*> ssl_con_map;
+    static TxBufPool tx_buf_pool;
 
     IpAddress         remote_addr;
     uint16_t          remote_port         = 0;
@@ -506,7 +634,10 @@ class TcpConnection : virtual public sigc::trackable
     FdWatch           rd_watch;
     std::vector<Char> m_recv_buf;
     Async::FdWatch    m_wr_watch;
-    std::vector<char> m_write_buf;
+    TxQueue           m_txq;
+    size_t            m_txq_size          = 0;
+    size_t            m_max_txq_size      = 0;
+    TxStats           m_tx_stats;
 
     SslContext*       m_ssl_ctx           = nullptr;
     bool              m_ssl_is_server     = false;
@@ -514,6 +645,7 @@ class TcpConnection : virtual public sigc::trackable
     BIO*              m_ssl_rd_bio        = nullptr; // SSL reads, we write
     BIO*              m_ssl_wr_bio        = nullptr; // SSL writes, we read
     std::vector<char> m_ssl_encrypt_buf;
+    std::vector<char> m_ssl_decrypt_buf;
 
     static TcpConnection* lookupConnection(SSL* ssl)
     {
@@ -524,9 +656,13 @@ class TcpConnection : virtual public sigc::trackable
                                  X509_STORE_CTX* x509_store_ctx);
 
     void recvHandler(FdWatch *watch);
+    bool txQueueFull(size_t count);
     void addToWriteBuf(const char *buf, size_t len);
+    void txQueueGrown(size_t len);
+    void clearTxQueue(void);
+    void releaseTxChunk(TxChunk& chunk);
     void onWriteSpaceAvailable(Async::FdWatch* w);
-    int rawWrite(const void* buf, int count);
+    int sendTxQueue(void);
 
     void sslPrintErrors(const char* fname);
     SslStatus sslGetStatus(int n);
@@ -32,6 +32,10 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include <sys/time.h>
 #include <cassert>
+#include <chrono>
+#include <list>
+#include <memory>
+#include <vector>
 
 
 /****************************************************************************
@@ -41,6 +45,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  ****************************************************************************/
 
 #include <AsyncApplication.h>
+#include <AsyncTimer.h>
 
 
 /****************************************************************************
@@ -113,6 +118,16 @@ class TcpPrioClientBase::Machine
           {
             m.state().bgDisconnectedEvent();
           });
+      ctx.race.connected.connect(
+          [&](void)
+          {
+            m.state().raceConnectedEvent();
+          });
+      ctx.race.failed.connect(
+          [&](void)
+          {
+            m.state().raceFailedEvent();
+          });
       m.start();
     }
 
@@ -132,6 +147,15 @@ class TcpPrioClientBase::Machine
     {
       ctx.connect_retry_wait.setRandomizePercent(p);
     }
+    void setConnectAttemptDelay(unsigned t)
+    {
+      ctx.race.setAttemptDelay(t);
+    }
+
+    const ConnectStats& connectStats(void) const
+    {
+      return ctx.stats;
+    }
 
     void setLookupParams(const std::string& label, DnsLookup::Type type)
     {
@@ -230,10 +254,281 @@ class TcpPrioClientBase::Machine
     }; /* BackoffTime */
 
 
+    using DnsSRVList = DnsLookup::SharedRRList<const DnsResourceRecordSRV>;
+
+      // Staggered parallel connection attempts (RFC 8305)
+    class ConnectRace
+    {
+      public:
+        using Clock = Application::SteadyClock;
+
+        ConnectRace(TcpPrioClientBase *client, ConnectStats& stats)
+          : m_client(client), m_stats(stats)
+        {
+          m_delay_timer.expired.connect(
+              [&](Timer*)
+              {
+                startNext(true);
+              });
+        }
+
+        ~ConnectRace(void)
+        {
+          stop();
+        }
+
+        void setAttemptDelay(unsigned t)
+        {
+          m_delay = t;
+        }
+
+        void start(DnsSRVList::iterator first, DnsSRVList::iterator last)
+        {
+          stop();
+          m_start = Clock::now();
+          m_stats.connect_time = 0;
+          m_stats.attempts = 0;
+          m_stats.failures = 0;
+          m_stats.host.clear();
+          m_stats.addr.clear();
+          m_stats.port = 0;
+          for (auto it = first; it != last; ++it)
+          {
+            m_targets.emplace_back();
+            Target& t = m_targets.back();
+            t.rr = it;
+            IpAddress ip((*it)->target());
+            if (!ip.isEmpty())
+            {
+              t.addrs.push_back(ip);
+              t.resolved = true;
+            }
+            else
+            {
+              const size_t idx = m_targets.size() - 1;
+              t.dns.reset(new DnsLookup);
+              t.dns->resultsReady.connect(
+                  [this, idx](DnsLookup&)
+                  {
+                    onResolved(idx);
+                  });
+            }
+          }
+          m_running = true;
+          for (auto& t : m_targets)
+          {
+            if (t.dns != nullptr)
+            {
+              t.dns->lookup((*t.rr)->target());
+            }
+          }
+          startNext();
+        }
+
+        void stop(void)
+        {
+          m_running = false;
+          m_delay_timer.setEnable(false);
+          for (auto& t : m_targets)
+          {
+            if (t.dns != nullptr)
+            {
+              t.dns->abort();
+              deleteLater(t.dns.release());
+            }
+          }
+          m_targets.clear();
+          for (auto& a : m_attempts)
+          {
+            a.con->disconnect();
+            deleteLater(a.con.release());
+          }
+          m_attempts.clear();
+          m_winner = nullptr;
+        }
+
+        TcpClientBase& winner(void) { return *m_winner; }
+        DnsSRVList::iterator winnerRR(void) const { return m_winner_rr; }
+
+        sigc::signal<void> connected;
+        sigc::signal<void> failed;
+
+      private:
+        struct Target
+        {
+          DnsSRVList::iterator        rr;
+          std::unique_ptr<DnsLookup>  dns;
+          std::vector<IpAddress>      addrs;
+          size_t                      next_addr = 0;
+          bool                        resolved  = false;
+        };
+        struct Attempt
+        {
+          size_t                          target;
+          IpAddress                       addr;
+          std::unique_ptr<TcpClientBase>  con;
+        };
+        using AttemptList = std::list<Attempt>;
+
+        TcpPrioClientBase*    m_client;
+        ConnectStats&         m_stats;
+        unsigned              m_delay         = 250;
+        Timer                 m_delay_timer   {0, Timer::TYPE_ONESHOT, false};
+        std::vector<Target>   m_targets;
+        AttemptList           m_attempts;
+        bool                  m_running       = false;
+        TcpClientBase*        m_winner        = nullptr;
+        DnsSRVList::iterator  m_winner_rr;
+        Clock::time_point     m_start;
+
+        template <typename T>
+        static void deleteLater(T* obj)
+        {
+            // The object may be the one emitting the signal we are called from
+          Application::app().runTask([obj]{ delete obj; });
+        }
+
+        void startNext(bool force=false)
+        {
+          if (!m_running)
+          {
+            return;
+          }
+
+            // Take the first address of each target in SRV order before
+            // trying the second address of any target. A target that is
+            // still being looked up is waited for, for at most one attempt
+            // delay, so that a lower prioritized target does not win just
+            // because it was quicker to resolve.
+          Target* t = nullptr;
+          for (auto& target : m_targets)
+          {
+            if ((target.next_addr < target.addrs.size()) &&
+                ((t == nullptr) || (target.next_addr < t->next_addr)))
+            {
+              t = &target;
+            }
+          }
+          if (t == nullptr)
+          {
+            checkFailed();
+            return;
+          }
+          bool wait = false;
+          for (auto it = m_targets.begin(); &*it != t; ++it)
+          {
+            wait = wait || !it->resolved;
+          }
+          if (wait && !force)
+          {
+            if ((m_delay > 0) && !m_delay_timer.isEnabled())
+            {
+              m_delay_timer.setTimeout(m_delay);
+              m_delay_timer.setEnable(true);
+            }
+            return;
+          }
+
+          m_attempts.emplace_back();
+          Attempt& a = m_attempts.back();
+          a.target = t - &m_targets.front();
+          a.addr = t->addrs[t->next_addr++];
+          a.con.reset(m_client->newTcpClient());
+          a.con->conObj()->setRecvBufLen(m_client->conObj()->recvBufLen());
+          auto attempt = std::prev(m_attempts.end());
+          a.con->connected.connect(
+              [this, attempt](void)
+              {
+                onAttemptConnected(attempt);
+              });
+          a.con->conObj()->disconnected.connect(
+              [this, attempt](TcpConnection*, TcpConnection::DisconnectReason)
+              {
+                onAttemptFailed(attempt);
+              });
+          ++m_stats.attempts;
+          if (m_delay > 0)
+          {
+            m_delay_timer.setTimeout(m_delay);
+            m_delay_timer.setEnable(true);
+          }
+#ifdef ASYNC_STATE_MACHINE_DEBUG
+          std::cout << "### Connecting to " << (*t->rr)->target()
+                    << " (" << a.addr << "):" << (*t->rr)->port()
+                    << std::endl;
+#endif
+            // Note that the attempt may finish before connect returns
+          a.con->connect((*t->rr)->target(), a.addr, (*t->rr)->port());
+        }
+
+        void checkFailed(void)
+        {
+          if (!m_running || !m_attempts.empty())
+          {
+            return;
+          }
+          for (const auto& t : m_targets)
+          {
+            if (!t.resolved)
+            {
+              return;
+            }
+          }
+          stop();
+          failed();
+        }
+
+        void onResolved(size_t idx)
+        {
+          Target& t = m_targets[idx];
+          for (const auto& addr : t.dns->addresses())
+          {
+            if (!addr.isEmpty())
+            {
+              t.addrs.push_back(addr);
+            }
+          }
+          t.resolved = true;
+          if (m_attempts.empty() ||
+              ((m_delay > 0) && !m_delay_timer.isEnabled()))
+          {
+            startNext();
+          }
+          else
+          {
+            checkFailed();
+          }
+        }
+
+        void onAttemptConnected(AttemptList::iterator attempt)
+        {
+          const Target& t = m_targets[attempt->target];
+          m_stats.connect_time = std::chrono::duration_cast<
+            std::chrono::milliseconds>(Clock::now() - m_start).count();
+          m_stats.host = (*t.rr)->target();
+          m_stats.addr = attempt->addr;
+          m_stats.port = (*t.rr)->port();
+          m_winner = attempt->con.get();
+          m_winner_rr = t.rr;
+          m_running = false;
+          m_delay_timer.setEnable(false);
+          connected();
+        }
+
+        void onAttemptFailed(AttemptList::iterator attempt)
+        {
+          ++m_stats.failures;
+          attempt->con->disconnect();
+          deleteLater(attempt->con.release());
+          m_attempts.erase(attempt);
+          startNext();
+        }
+    }; /* ConnectRace */
+
+
       // State machine context
     struct Context
     {
-      using DnsSRVList = DnsLookup::SharedRRList<const DnsResourceRecordSRV>;
 
       TcpPrioClientBase*              client                  = nullptr;
       std::unique_ptr<TcpClientBase>  bg_con;
@@ -242,9 +537,13 @@ class TcpPrioClientBase::Machine
       DnsSRVList::iterator            next_rr                 = rrs.end();
       BackoffTime                     connect_retry_wait;
       bool                            marked_as_established   = false;
+      ConnectStats                    stats;
+      ConnectRace                     race;
+      Application::SteadyClock::time_point lookup_start;
 
       Context(TcpPrioClientBase *client)
-        : client(client), bg_con(client->newTcpClient()) {}
+        : client(client), bg_con(client->newTcpClient()),
+          race(client, stats) {}
 
       void closeConnection(void)
       {
@@ -256,9 +555,14 @@ class TcpPrioClientBase::Machine
         client->emitDisconnected(reason);
       }
 
-      void connect(const std::string &remote_host, uint16_t remote_port)
+      void takeOver(TcpClientBase& con)
       {
-        client->TcpClientBase::connect(remote_host, remote_port);
+        auto ssl_ctx = client->conObj()->sslContext();
+        *reinterpret_cast<TcpClientBase*>(client) = std::move(con);
+        if (ssl_ctx != nullptr)
+        {
+          client->conObj()->setSslContext(*ssl_ctx, false);
+        }
       }
 
       void emitConnected(void)
@@ -317,6 +621,8 @@ class TcpPrioClientBase::Machine
       virtual void disconnectedEvent(void) noexcept {}
       virtual void bgConnectedEvent(void) noexcept {}
       virtual void bgDisconnectedEvent(void) noexcept {}
+      virtual void raceConnectedEvent(void) noexcept {}
+      virtual void raceFailedEvent(void) noexcept {}
     }; /* StateTop */
 
 
@@ -356,6 +662,7 @@ class TcpPrioClientBase::Machine
 
       void entry(void) noexcept
       {
+        ctx().lookup_start = Application::SteadyClock::now();
         ctx().dns.lookup();
       }
 
@@ -367,6 +674,9 @@ class TcpPrioClientBase::Machine
       virtual void dnsResultsReadyEvent(void) noexcept override
       {
         DEBUG_EVENT;
+        ctx().stats.lookup_time = std::chrono::duration_cast<
+          std::chrono::milliseconds>(
+              Application::SteadyClock::now() - ctx().lookup_start).count();
         ctx().dns.resourceRecords(ctx().rrs);
 #ifdef ASYNC_STATE_MACHINE_DEBUG
         std::cout << "### Found " << ctx().rrs.size() << " records"
@@ -396,45 +706,42 @@ class TcpPrioClientBase::Machine
 
       void entry(void) noexcept
       {
-        connectToNext();
+        auto first = ctx().next_rr;
+        if (first == ctx().rrs.end())
+        {
+          first = ctx().rrs.begin();
+        }
+        else if (!ctx().marked_as_established)
+        {
+          first = std::next(first);
+        }
+        if (first == ctx().rrs.end())
+        {
+          setState<StateConnectingIdle>();
+          return;
+        }
+        ctx().marked_as_established = false;
+        ctx().race.start(first, ctx().rrs.end());
+      }
+
+      void exit(void) noexcept
+      {
+        ctx().race.stop();
       }
 
-      virtual void connectedEvent(void) noexcept override
+      virtual void raceConnectedEvent(void) noexcept override
       {
         DEBUG_EVENT;
+        ctx().next_rr = ctx().race.winnerRR();
+        ctx().takeOver(ctx().race.winner());
         setState<StateConnected>();
       }
 
-      virtual void disconnectedEvent(void) noexcept override
+      virtual void raceFailedEvent(void) noexcept override
       {
         DEBUG_EVENT;
-        connectToNext();
+        setState<StateConnectingIdle>();
       }
-
-      private:
-        void connectToNext(void)
-        {
-          auto& next_rr = ctx().next_rr;
-          if (next_rr == ctx().rrs.end())
-          {
-            next_rr = ctx().rrs.begin();
-          }
-          else if (!ctx().marked_as_established)
-          {
-            next_rr = std::next(next_rr);
-          }
-          if (next_rr == ctx().rrs.end())
-          {
-            setState<StateConnectingIdle>();
-            return;
-          }
-#ifdef ASYNC_STATE_MACHINE_DEBUG
-          std::cout << "### Connecting to " << (*next_rr)->target()
-                    << ":" << (*next_rr)->port() << std::endl;
-#endif
-          ctx().marked_as_established = false;
-          ctx().connect((*next_rr)->target(), (*next_rr)->port());
-        }
     }; /* StateConnectingTryConnect */
 
 
@@ -525,8 +832,7 @@ class TcpPrioClientBase::Machine
       void entry(void) noexcept
       {
         struct timeval tv;
-        auto err = gettimeofday(&tv, NULL);
-        assert(err == 0);
+        Application::app().getTimeOfDay(&tv);
         struct tm tm;
         time_t timeout_at = tv.tv_sec + 60;
         auto tm_ret = localtime_r(&timeout_at, &tm);
@@ -622,10 +928,7 @@ class TcpPrioClientBase::Machine
           ctx().closeConnection();
           ctx().emitDisconnected(TcpConnection::DR_SWITCH_PEER);
         }
-        auto ssl_ctx = ctx().client->conObj()->sslContext();
-        *reinterpret_cast<TcpClientBase*>(ctx().client) =
-            std::move(*ctx().bg_con);
-        ctx().client->conObj()->setSslContext(*ssl_ctx, false);
+        ctx().takeOver(*ctx().bg_con);
         Application::app().runTask(sigc::bind(
               [](Context& ctx)
               {
@@ -716,6 +1019,19 @@ void TcpPrioClientBase::setReconnectRandomizePercent(unsigned p)
 }
 
 
+void TcpPrioClientBase::setConnectAttemptDelay(unsigned t)
+{
+  m_machine->setConnectAttemptDelay(t);
+} /* TcpPrioClientBase::setConnectAttemptDelay */
+
+
+const TcpPrioClientBase::ConnectStats&
+TcpPrioClientBase::connectStats(void) const
+{
+  return m_machine->connectStats();
+} /* TcpPrioClientBase::connectStats */
+
+
 void TcpPrioClientBase::setService(const std::string& srv_name,
                                    const std::string& srv_proto,
                                    const std::string& srv_domain)
@@ -116,6 +116,20 @@ Async::TcpPrioClient for more information.
 class TcpPrioClientBase : public TcpClientBase
 {
   public:
+    /**
+     * @brief   Timing information for the last connection attempt
+     */
+    struct ConnectStats
+    {
+      unsigned          lookup_time   = 0;  //!< SRV lookup time in ms
+      unsigned          connect_time  = 0;  //!< Time to connect in ms
+      unsigned          attempts      = 0;  //!< Connection attempts started
+      unsigned          failures      = 0;  //!< Connection attempts failed
+      std::string       host;               //!< The host that won
+      Async::IpAddress  addr;               //!< The address that won
+      uint16_t          port          = 0;  //!< The port that won
+    };
+
     /**
      * @brief   Constructor
      * @param   con The connection object associated with this client
@@ -169,6 +183,29 @@ class TcpPrioClientBase : public TcpClientBase
      */
     void setReconnectRandomizePercent(unsigned p);
 
+    /**
+     * @brief   Set the delay between parallel connection attempts
+     * @param   t Time in milliseconds
+     *
+     * When connecting, the addresses of all SRV targets are tried in SRV
+     * order. A new connection attempt is started each time this delay has
+     * passed without any of the previous attempts having succeeded, or
+     * directly when an attempt fail. The first attempt to succeed is used and
+     * the rest are closed. Setting the delay to zero will make the attempts
+     * strictly sequential. The default is 250ms.
+     */
+    void setConnectAttemptDelay(unsigned t);
+
+    /**
+     * @brief   Get timing information for the last connection
+     * @return  Returns the timing information
+     *
+     * The information is updated when the connected signal is emitted for
+     * connections made in the foreground, that is, not for switches to a
+     * higher prioritized server.
+     */
+    const ConnectStats& connectStats(void) const;
+
     /**
      * @brief   Use a DNS service resource record for connections
      * @param   srv_name    The name of the service
@@ -250,6 +287,13 @@ class TcpPrioClientBase : public TcpClientBase
     void connect(const Async::IpAddress& remote_ip,
                  uint16_t remote_port) = delete;
 
+    /**
+     * @brief   Deleted function not making sense in this context
+     */
+    void connect(const std::string& remote_host,
+                 const Async::IpAddress& remote_ip,
+                 uint16_t remote_port) = delete;
+
     /**
      * @brief 	Disconnect from the remote host
      *
@@ -343,10 +387,10 @@ class TcpPrioClientBase : public TcpClientBase
      * @brief   Allocate a new TcpClient object
      * @return  Returns a new TcpClient object
      *
-     * This function is used to allocate a new TcpClient object.  That object
-     * is used when in the background trying to connect to a higher prioritized
-     * server. Note that the object should be a "normal" TcpClient and not a
-     * TcpPrioClient.
+     * This function is used to allocate a new TcpClient object. Such objects
+     * are used for the parallel connection attempts and when in the background
+     * trying to connect to a higher prioritized server. Note that the object
+     * should be a "normal" TcpClient and not a TcpPrioClient.
      */
     virtual TcpClientBase *newTcpClient(void) = 0;
 
@@ -137,6 +137,12 @@ class TcpServer : public TcpServerBase
       : TcpServerBase(port_str, bind_ip)
     {
     }
+
+    /**
+     * @brief 	Constuctor taking over an already listening socket
+     * @param 	sock A socket that is bound and listening
+     */
+    explicit TcpServer(int sock) : TcpServerBase(sock) {}
   
     /**
      * @brief 	Destructor
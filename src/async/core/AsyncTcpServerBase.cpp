@@ -204,6 +204,28 @@ TcpServerBase::TcpServerBase(const string& port_str,
 } /* TcpServerBase::TcpServerBase */
 
 
+TcpServerBase::TcpServerBase(int sock)
+  : sock(sock), rd_watch(0)
+{
+  if (sock < 0)
+  {
+    this->sock = -1;
+    return;
+  }
+
+  /* Force close on exec */
+  if (fcntl(sock, F_SETFD, 1) == -1)
+  {
+    perror("fcntl(F_SETFD)");
+    cleanup();
+    return;
+  }
+
+  rd_watch = new FdWatch(sock, FdWatch::FD_WATCH_RD);
+  rd_watch->activity.connect(mem_fun(*this, &TcpServerBase::onConnection));
+} /* TcpServerBase::TcpServerBase */
+
+
 TcpServerBase::~TcpServerBase(void)
 {
   cleanup();
@@ -290,6 +312,15 @@ void TcpServerBase::setSslContext(SslContext& ctx)
 } /* TcpServerBase::setSslContext */
 
 
+void TcpServerBase::setAcceptEnabled(bool enabled)
+{
+  if (rd_watch != 0)
+  {
+    rd_watch->setEnabled(enabled);
+  }
+} /* TcpServerBase::setAcceptEnabled */
+
+
 /****************************************************************************
  *
  * Protected member functions
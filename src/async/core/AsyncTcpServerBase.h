@@ -121,6 +121,16 @@ class TcpServerBase : public sigc::trackable
     TcpServerBase(const std::string& port_str,
                   const Async::IpAddress &bind_ip);
 
+    /**
+     * @brief 	Constuctor taking over an already listening socket
+     * @param 	sock A socket that is bound and listening
+     *
+     * This constructor is used when a listening socket is inherited from
+     * another process, e.g. when handing over a server to a new process
+     * without closing the port. The object take ownership of the socket.
+     */
+    explicit TcpServerBase(int sock);
+
     /**
      * @brief 	Destructor
      */
@@ -181,6 +191,23 @@ class TcpServerBase : public sigc::trackable
      */
     void setSslContext(SslContext& ctx);
 
+    /**
+     * @brief   Get the file descriptor for the listening socket
+     * @return  Returns the file descriptor or -1 on error
+     */
+    int fd(void) const { return sock; }
+
+    /**
+     * @brief   Enable or disable accepting new connections
+     * @param   enabled Set to \em false to stop accepting connections
+     *
+     * When disabled, incoming connections are left in the listen queue of
+     * the socket. This can be used when the listening socket is shared with
+     * another process that should accept all new connections. Connections
+     * are accepted by default.
+     */
+    void setAcceptEnabled(bool enabled);
+
   protected:
     virtual void createConnection(int sock, const IpAddress& remote_addr,
                                   uint16_t remote_port) = 0;
@@ -178,6 +178,28 @@ class UdpSocket : public sigc::trackable
      */
     virtual int fd(void) const { return sock; }
 
+    /**
+     * @brief   Replace the socket with an already bound socket
+     * @param   fd The file descriptor of a bound UDP socket
+     * @return  Returns \em true on success or \em false on failure
+     *
+     * This function is used when a bound socket is inherited from another
+     * process, e.g. when handing over a server to a new process without
+     * closing the port. The current socket is closed and this object take
+     * ownership of the given file descriptor.
+     */
+    bool adoptFd(int fd);
+
+    /**
+     * @brief   Enable or disable reading received datagrams
+     * @param   enabled Set to \em false to stop reading datagrams
+     *
+     * When disabled, received datagrams are left in the receive buffer of
+     * the socket. This can be used when the socket is shared with another
+     * process that should read all datagrams. Reading is enabled by default.
+     */
+    void setReceiveEnabled(bool enabled);
+
     /**
      * @brief 	A signal that is emitted when data has been received
      * @param 	ip    The IP-address the data was received from
@@ -205,6 +227,7 @@ class UdpSocket : public sigc::trackable
     UdpPacket * send_buf;
     
     void cleanup(void);
+    void setupWatches(void);
     void handleInput(FdWatch *watch);
     void sendRest(FdWatch *watch);
 
@@ -213,7 +213,7 @@ void CppApplication::exec(void)
       if (titer->second != 0)
       {
 	struct timespec ts;
-	clock_gettime(CLOCK_MONOTONIC, &ts);
+	clockGetTime(CLOCK_MONOTONIC, &ts);
 	clock_timersub(&titer->first, &ts, &timeout);
 	if (timeout.tv_sec < 0)
 	{
@@ -232,8 +232,8 @@ void CppApplication::exec(void)
     
     fd_set local_rd_set = rd_set;
     fd_set local_wr_set = wr_set;
-    int dcnt = pselect(max_desc, &local_rd_set, &local_wr_set, NULL,
-	timeout_ptr, NULL);
+    int dcnt = waitForEvents(max_desc, &local_rd_set, &local_wr_set,
+                             timeout_ptr);
     if (dcnt == -1)
     {
       if ((errno == EINTR) || (errno == EAGAIN))
@@ -332,6 +332,12 @@ void CppApplication::quit(void)
 } /* CppApplication::quit */
 
 
+void CppApplication::setMaxDnsLookupThreads(unsigned max_threads)
+{
+  CppDnsLookupWorker::setMaxThreads(max_threads);
+} /* CppApplication::setMaxDnsLookupThreads */
+
+
 void CppApplication::catchUnixSignal(int signum)
 {
   UnixSignalMap::iterator it = unix_signals.find(signum);
@@ -385,19 +391,11 @@ void CppApplication::uncatchUnixSignal(int signum)
  *
  ****************************************************************************/
 
-
-/*
- *------------------------------------------------------------------------
- * Method:    
- * Purpose:   
- * Input:     
- * Output:    
- * Author:    
- * Created:   
- * Remarks:   
- * Bugs:      
- *------------------------------------------------------------------------
- */
+int CppApplication::waitForEvents(int nfds, fd_set *rd_set, fd_set *wr_set,
+                                  struct timespec *timeout)
+{
+  return pselect(nfds, rd_set, wr_set, NULL, timeout, NULL);
+} /* CppApplication::waitForEvents */
 
 
 
@@ -503,7 +501,7 @@ void CppApplication::delFdWatch(FdWatch *fd_watch)
 void CppApplication::addTimer(Timer *timer)
 {
   struct timespec current;
-  clock_gettime(CLOCK_MONOTONIC, &current);
+  clockGetTime(CLOCK_MONOTONIC, &current);
   addTimerP(timer, current);
 } /* CppApplication::addTimer */
 
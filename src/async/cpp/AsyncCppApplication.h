@@ -174,6 +174,15 @@ class CppApplication : public Application
      */
     void quit(void);
 
+    /**
+     * @brief   Set the maximum number of threads used for DNS lookups
+     * @param   max_threads The maximum number of resolver threads
+     *
+     * DNS lookups are run in a pool of threads since the resolver functions
+     * are blocking. When all threads are busy, lookups are queued.
+     */
+    void setMaxDnsLookupThreads(unsigned max_threads);
+
     /**
      * @brief   A signal that is emitted when a monitored UNIX signal is caught
      * @param   signum The signal number that was caught
@@ -185,7 +194,23 @@ class CppApplication : public Application
     sigc::signal<void, int> unixSignalCaught;
     
   protected:
-    
+    /**
+     * @brief   Wait for file descriptor activity or a timeout
+     * @param   nfds    The highest file descriptor number plus one
+     * @param   rd_set  The file descriptors to watch for read activity
+     * @param   wr_set  The file descriptors to watch for write activity
+     * @param   timeout The time until the next timer expire or null
+     * @return  Returns the number of active file descriptors or -1 on error
+     *
+     * This function is called from the main loop to wait for something to
+     * happen. The default implementation just call pselect. It may be
+     * overridden to change how the main loop wait, e.g. to implement a
+     * simulated clock. The file descriptor sets and the timeout are updated
+     * in the same way that pselect does.
+     */
+    virtual int waitForEvents(int nfds, fd_set *rd_set, fd_set *wr_set,
+                              struct timespec *timeout);
+
   private:
     struct lttimespec
     {
@@ -44,6 +44,12 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include <cassert>
 #include <cstring>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <functional>
 
 
 /****************************************************************************
@@ -89,6 +95,72 @@ using namespace Async;
  *
  ****************************************************************************/
 
+namespace {
+  /**
+   * A bounded pool of threads running blocking resolver calls. Threads are
+   * started on demand up to the maximum number and then kept around waiting
+   * for more work.
+   */
+  class ResolverThreadPool
+  {
+    public:
+      static ResolverThreadPool& instance(void)
+      {
+          // The pool is never destroyed since its threads may still be
+          // blocked in the resolver when the process exit
+        static ResolverThreadPool *pool = new ResolverThreadPool;
+        return *pool;
+      }
+
+      void setMaxThreads(unsigned max_threads)
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_max_threads = std::max(1U, max_threads);
+      }
+
+      void submit(std::function<void()> job)
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push_back(std::move(job));
+        if ((m_jobs.size() > m_idle_cnt) && (m_thread_cnt < m_max_threads))
+        {
+          ++m_thread_cnt;
+          std::thread(&ResolverThreadPool::threadFunc, this).detach();
+        }
+        else
+        {
+          m_cond.notify_one();
+        }
+      }
+
+    private:
+      static const unsigned DEFAULT_MAX_THREADS = 4;
+
+      std::mutex                          m_mutex;
+      std::condition_variable             m_cond;
+      std::deque<std::function<void()>>   m_jobs;
+      unsigned                            m_max_threads = DEFAULT_MAX_THREADS;
+      unsigned                            m_thread_cnt  = 0;
+      unsigned                            m_idle_cnt    = 0;
+
+      void threadFunc(void)
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;)
+        {
+          ++m_idle_cnt;
+          m_cond.wait(lock, [this]{ return !m_jobs.empty(); });
+          --m_idle_cnt;
+          std::function<void()> job = std::move(m_jobs.front());
+          m_jobs.pop_front();
+          lock.unlock();
+          job();
+          lock.lock();
+        }
+      }
+  };
+}; /* End of anonymous namespace */
+
 
 
 /****************************************************************************
@@ -123,6 +195,12 @@ using namespace Async;
  ****************************************************************************/
 
 
+void CppDnsLookupWorker::setMaxThreads(unsigned max_threads)
+{
+  ResolverThreadPool::instance().setMaxThreads(max_threads);
+} /* CppDnsLookupWorker::setMaxThreads */
+
+
 CppDnsLookupWorker::CppDnsLookupWorker(const DnsLookup& dns)
   : DnsLookupWorker(dns)
 {
@@ -144,11 +222,17 @@ DnsLookupWorker& CppDnsLookupWorker::operator=(DnsLookupWorker&& other_base)
 
   abortLookup();
 
-  m_result = std::move(other.m_result);
-  assert(!other.m_result.valid());
-
+  m_ctx = std::move(other.m_ctx);
   m_notifier_watch = std::move(other.m_notifier_watch);
 
+  if (other.m_cache_hit_pending)
+  {
+    other.m_cache_hit_pending = false;
+    m_cache_hit_pending = true;
+    Application::app().runTask(
+        sigc::mem_fun(*this, &CppDnsLookupWorker::deliverCachedAnswer));
+  }
+
   return *this;
 } /* CppDnsLookupWorker::operator=(DnsLookupWorker&&) */
 
@@ -162,13 +246,18 @@ DnsLookupWorker& CppDnsLookupWorker::operator=(DnsLookupWorker&& other_base)
 bool CppDnsLookupWorker::doLookup(void)
 {
     // A lookup is already running
-  if (m_result.valid())
+  if ((m_ctx != nullptr) || m_cache_hit_pending)
   {
     return true;
   }
 
   setLookupFailed(false);
 
+  if (!dns().bypassCache() && lookupInCache())
+  {
+    return true;
+  }
+
   int fd[2];
   if (pipe(fd) != 0)
   {
@@ -179,13 +268,25 @@ bool CppDnsLookupWorker::doLookup(void)
   m_notifier_watch.setFd(fd[0], FdWatch::FD_WATCH_RD);
   m_notifier_watch.setEnabled(true);
 
-  m_ctx = std::unique_ptr<ThreadContext>(new ThreadContext);
+  m_ctx = std::make_shared<ThreadContext>();
   m_ctx->label = dns().label();
   m_ctx->type = dns().type();
   m_ctx->notifier_wr = fd[1];
-  m_ctx->anslen = 0;
-  m_ctx->thread_cerr.clear();
-  m_result = std::async(std::launch::async, workerFunc, std::ref(*m_ctx));
+
+    // The context is shared with the job so that an aborted lookup does not
+    // have to wait for the resolver to return
+  std::shared_ptr<ThreadContext> ctx = m_ctx;
+  ResolverThreadPool::instance().submit(
+      [ctx]()
+      {
+        if (ctx->aborted)
+        {
+          close(ctx->notifier_wr);
+          ctx->notifier_wr = -1;
+          return;
+        }
+        workerFunc(*ctx);
+      });
 
   return true;
 
@@ -194,9 +295,11 @@ bool CppDnsLookupWorker::doLookup(void)
 
 void CppDnsLookupWorker::abortLookup(void)
 {
-  if (m_result.valid())
+  m_cache_hit_pending = false;
+
+  if (m_ctx != nullptr)
   {
-    m_result.get();
+    m_ctx->aborted = true;
   }
 
   int fd = m_notifier_watch.fd();
@@ -248,6 +351,8 @@ void CppDnsLookupWorker::workerFunc(CppDnsLookupWorker::ThreadContext& ctx)
       {
         th_cerr << "*** WARNING[getaddrinfo]: Could not look up host \""
                 << ctx.label << "\": " << gai_strerror(ret) << std::endl;
+        ctx.cacheable = (ret != EAI_AGAIN) && (ret != EAI_SYSTEM) &&
+                        (ret != EAI_MEMORY);
       }
       else if (ctx.addrinfo == nullptr)
       {
@@ -284,6 +389,8 @@ void CppDnsLookupWorker::workerFunc(CppDnsLookupWorker::ThreadContext& ctx)
         {
           th_cerr << "*** WARNING[getnameinfo]: Could not look up IP \""
                   << ctx.label << "\": " << gai_strerror(ret) << std::endl;
+          ctx.cacheable = (ret != EAI_AGAIN) && (ret != EAI_SYSTEM) &&
+                          (ret != EAI_MEMORY);
         }
       }
       else
@@ -317,6 +424,7 @@ void CppDnsLookupWorker::workerFunc(CppDnsLookupWorker::ThreadContext& ctx)
       {
         th_cerr << "*** ERROR: Name resolver failure -- res_nsearch: "
                 << hstrerror(h_errno) << std::endl;
+        ctx.cacheable = (h_errno == HOST_NOT_FOUND) || (h_errno == NO_DATA);
       }
 
         // FIXME: Valgrind complain about leaked memory in the resolver library
@@ -330,6 +438,7 @@ void CppDnsLookupWorker::workerFunc(CppDnsLookupWorker::ThreadContext& ctx)
     {
       th_cerr << "*** ERROR: Name resolver failure -- res_ninit: "
               << hstrerror(h_errno) << std::endl;
+      ctx.cacheable = false;
     }
   }
 
@@ -338,6 +447,41 @@ void CppDnsLookupWorker::workerFunc(CppDnsLookupWorker::ThreadContext& ctx)
 } /* CppDnsLookupWorker::workerFunc */
 
 
+bool CppDnsLookupWorker::lookupInCache(void)
+{
+  DnsCache::RRList rrs;
+  bool failed = false;
+  if (!DnsCache::instance().lookup(dns().label(), dns().type(), rrs, failed))
+  {
+    return false;
+  }
+
+  for (auto& rr : rrs)
+  {
+    addResourceRecord(rr.release());
+  }
+  setLookupFailed(failed);
+
+    // The answer is delivered from the main loop since the user may not
+    // have connected to the resultsReady signal yet
+  m_cache_hit_pending = true;
+  Application::app().runTask(
+      sigc::mem_fun(*this, &CppDnsLookupWorker::deliverCachedAnswer));
+
+  return true;
+} /* CppDnsLookupWorker::lookupInCache */
+
+
+void CppDnsLookupWorker::deliverCachedAnswer(void)
+{
+  if (m_cache_hit_pending)
+  {
+    m_cache_hit_pending = false;
+    workerDone();
+  }
+} /* CppDnsLookupWorker::deliverCachedAnswer */
+
+
 /*
  *----------------------------------------------------------------------------
  * Method:    CppDnsLookupWorker::notificationReceived
@@ -360,22 +504,23 @@ void CppDnsLookupWorker::notificationReceived(FdWatch *w)
   close(w->fd());
   w->setFd(-1, FdWatch::FD_WATCH_RD);
 
-  m_result.get();
+  std::shared_ptr<ThreadContext> ctx = std::move(m_ctx);
+  DnsCache::RRList cache_rrs;
 
-  const std::string& thread_errstr = m_ctx->thread_cerr.str();
+  const std::string& thread_errstr = ctx->thread_cerr.str();
   if (!thread_errstr.empty())
   {
     std::cerr << thread_errstr;
     setLookupFailed();
   }
 
-  if (m_ctx->type == DnsResourceRecord::Type::A)
+  if (ctx->type == DnsResourceRecord::Type::A)
   {
-    if (m_ctx->addrinfo != nullptr)
+    if (ctx->addrinfo != nullptr)
     {
       struct addrinfo *entry;
       std::vector<IpAddress> the_addresses;
-      for (entry = m_ctx->addrinfo; entry != 0; entry = entry->ai_next)
+      for (entry = ctx->addrinfo; entry != 0; entry = entry->ai_next)
       {
         IpAddress ip_addr(
             reinterpret_cast<struct sockaddr_in*>(entry->ai_addr)->sin_addr);
@@ -387,38 +532,36 @@ void CppDnsLookupWorker::notificationReceived(FdWatch *w)
             the_addresses.end())
         {
           the_addresses.push_back(ip_addr);
-          addResourceRecord(
-              new DnsResourceRecordA(m_ctx->label, 0, ip_addr));
+          addRecord(cache_rrs, new DnsResourceRecordA(ctx->label, 0, ip_addr));
         }
       }
-      m_ctx.reset();
     }
   }
-  else if (m_ctx->type == DnsResourceRecord::Type::PTR)
+  else if (ctx->type == DnsResourceRecord::Type::PTR)
   {
-    if (m_ctx->host[0] != '\0')
+    if (ctx->host[0] != '\0')
     {
-      addResourceRecord(
-          new DnsResourceRecordPTR(m_ctx->label, 0, m_ctx->host));
+      addRecord(cache_rrs,
+                new DnsResourceRecordPTR(ctx->label, 0, ctx->host));
     }
   }
   else
   {
-    if (m_ctx->anslen == -1)
+    if (ctx->anslen == -1)
     {
-      workerDone();
+      lookupDone(*ctx, cache_rrs);
       return;
     }
 
     ns_msg msg;
-    int ret = ns_initparse(m_ctx->answer, m_ctx->anslen, &msg);
+    int ret = ns_initparse(ctx->answer, ctx->anslen, &msg);
     if (ret == -1)
     {
       std::stringstream ss;
-      ss << "WARNING: ns_initparse failed (anslen=" << m_ctx->anslen << ")";
+      ss << "WARNING: ns_initparse failed (anslen=" << ctx->anslen << ")";
       printErrno(ss.str());
       setLookupFailed();
-      workerDone();
+      lookupDone(*ctx, cache_rrs);
       return;
     }
 
@@ -456,7 +599,7 @@ void CppDnsLookupWorker::notificationReceived(FdWatch *w)
           struct in_addr in_addr;
           uint32_t ip = ns_get32(cp);
           in_addr.s_addr = ntohl(ip);
-          addResourceRecord(
+          addRecord(cache_rrs,
               new DnsResourceRecordA(name, ttl, IpAddress(in_addr)));
           break;
         }
@@ -475,7 +618,7 @@ void CppDnsLookupWorker::notificationReceived(FdWatch *w)
           size_t exp_dn_len = strlen(exp_dn);
           exp_dn[exp_dn_len] = '.';
           exp_dn[exp_dn_len+1] = 0;
-          addResourceRecord(new DnsResourceRecordPTR(name, ttl, exp_dn));
+          addRecord(cache_rrs, new DnsResourceRecordPTR(name, ttl, exp_dn));
           break;
         }
 
@@ -493,7 +636,7 @@ void CppDnsLookupWorker::notificationReceived(FdWatch *w)
           size_t exp_dn_len = strlen(exp_dn);
           exp_dn[exp_dn_len] = '.';
           exp_dn[exp_dn_len+1] = 0;
-          addResourceRecord(new DnsResourceRecordCNAME(name, ttl, exp_dn));
+          addRecord(cache_rrs, new DnsResourceRecordCNAME(name, ttl, exp_dn));
           break;
         }
 
@@ -517,7 +660,7 @@ void CppDnsLookupWorker::notificationReceived(FdWatch *w)
           size_t exp_dn_len = strlen(exp_dn);
           exp_dn[exp_dn_len] = '.';
           exp_dn[exp_dn_len+1] = 0;
-          addResourceRecord(
+          addRecord(cache_rrs,
               new DnsResourceRecordSRV(name, ttl, prio, weight, port, exp_dn));
           break;
         }
@@ -530,10 +673,30 @@ void CppDnsLookupWorker::notificationReceived(FdWatch *w)
       }
     }
   }
-  workerDone();
+  lookupDone(*ctx, cache_rrs);
 } /* CppDnsLookupWorker::notificationReceived */
 
 
+void CppDnsLookupWorker::addRecord(DnsCache::RRList& cache_rrs,
+                                   DnsResourceRecord *rr)
+{
+  cache_rrs.push_back(std::unique_ptr<DnsResourceRecord>(rr->clone()));
+  addResourceRecord(rr);
+} /* CppDnsLookupWorker::addRecord */
+
+
+void CppDnsLookupWorker::lookupDone(const ThreadContext& ctx,
+                                    DnsCache::RRList& cache_rrs)
+{
+  if (ctx.cacheable)
+  {
+    DnsCache::instance().store(ctx.label, ctx.type, cache_rrs,
+                               lookupFailed());
+  }
+  workerDone();
+} /* CppDnsLookupWorker::lookupDone */
+
+
 void CppDnsLookupWorker::printErrno(const std::string& msg)
 {
   char errbuf[1024];
@@ -45,7 +45,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include <string>
 #include <sstream>
-#include <future>
+#include <memory>
+#include <atomic>
 #include <netdb.h>
 
 
@@ -56,6 +57,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  ****************************************************************************/
 
 #include <AsyncFdWatch.h>
+#include <AsyncDnsCache.h>
 
 
 /****************************************************************************
@@ -123,10 +125,22 @@ namespace Async
 This is the DNS lookup worker for the Cpp variant of the async environment.
 It is an internal class that should only be used from within the async
 library.
+
+Lookups are first looked for in the process wide Async::DnsCache. The
+blocking resolver functions are run in a pool of threads that is shared by
+all lookup workers. The number of threads is bounded, see setMaxThreads.
 */
 class CppDnsLookupWorker : public DnsLookupWorker, public sigc::trackable
 {
   public:
+    /**
+     * @brief   Set the maximum number of resolver threads
+     * @param   max_threads The maximum number of threads to use
+     *
+     * Lookups are queued when all threads are busy.
+     */
+    static void setMaxThreads(unsigned max_threads);
+
     /**
      * @brief 	Constructor
      * @param 	dns The lookup object
@@ -164,12 +178,16 @@ class CppDnsLookupWorker : public DnsLookupWorker, public sigc::trackable
       std::string         label;
       DnsLookup::Type     type                = DnsLookup::Type::A;
       int                 notifier_wr         = -1;
+      std::atomic<bool>   aborted;
+      bool                cacheable           = true;
       unsigned char       answer[NS_MAXMSG];
       int                 anslen              = 0;
       struct addrinfo*    addrinfo            = nullptr;
       char                host[NI_MAXHOST]    = {0};
       std::ostringstream  thread_cerr;
 
+      ThreadContext(void) : aborted(false) {}
+
       ~ThreadContext(void)
       {
         if (addrinfo != nullptr)
@@ -181,11 +199,15 @@ class CppDnsLookupWorker : public DnsLookupWorker, public sigc::trackable
     };
 
     Async::FdWatch                  m_notifier_watch;
-    std::future<void>               m_result;
-    std::unique_ptr<ThreadContext>  m_ctx;
+    std::shared_ptr<ThreadContext>  m_ctx;
+    bool                            m_cache_hit_pending = false;
 
     static void workerFunc(ThreadContext& ctx);
+    bool lookupInCache(void);
+    void deliverCachedAnswer(void);
     void notificationReceived(FdWatch *w);
+    void addRecord(DnsCache::RRList& cache_rrs, DnsResourceRecord *rr);
+    void lookupDone(const ThreadContext& ctx, DnsCache::RRList& cache_rrs);
     void printErrno(const std::string& msg);
 
 };  /* class CppDnsLookupWorker */
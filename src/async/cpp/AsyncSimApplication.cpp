@@ -0,0 +1,242 @@
+/**
+@file	 AsyncSimApplication.cpp
+@brief   An application class that run on a simulated clock
+@author  Tobias Blomberg / SM0SVX
+@date	 2026-10-18
+
+\verbatim
+Async - A library for programming event driven applications
+Copyright (C) 2003-2026 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <cassert>
+#include <climits>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "AsyncSimApplication.h"
+
+
+
+/****************************************************************************
+ *
+ * Namespaces to use
+ *
+ ****************************************************************************/
+
+using namespace std;
+using namespace Async;
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local class definitions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Prototypes
+ *
+ ****************************************************************************/
+
+namespace {
+  const int64_t NSEC_PER_SEC = 1000000000;
+
+  int64_t toNsec(const struct timespec& ts)
+  {
+    return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+  }
+
+  void toTimespec(int64_t nsec, struct timespec *ts)
+  {
+    ts->tv_sec = nsec / NSEC_PER_SEC;
+    ts->tv_nsec = nsec % NSEC_PER_SEC;
+  }
+}; /* End of anonymous namespace */
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ *
+ * Local Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Public member functions
+ *
+ ****************************************************************************/
+
+SimApplication::SimApplication(void)
+  : m_start(0), m_now(0), m_realtime_offset(0),
+    m_run_timer(0, Timer::TYPE_ONESHOT, false)
+{
+  struct timespec ts;
+  ::clock_gettime(CLOCK_MONOTONIC, &ts);
+  m_start = m_now = toNsec(ts);
+  ::clock_gettime(CLOCK_REALTIME, &ts);
+  m_realtime_offset = toNsec(ts) - m_now;
+
+  m_run_timer.expired.connect(
+      sigc::hide(mem_fun(*this, &SimApplication::quit)));
+} /* SimApplication::SimApplication */
+
+
+SimApplication::~SimApplication(void)
+{
+} /* SimApplication::~SimApplication */
+
+
+void SimApplication::setRunTime(unsigned run_time_ms)
+{
+  assert(run_time_ms <= static_cast<unsigned>(INT_MAX));
+  m_run_timer.setEnable(false);
+  if (run_time_ms > 0)
+  {
+    m_run_timer.setTimeout(run_time_ms);
+    m_run_timer.setEnable(true);
+  }
+} /* SimApplication::setRunTime */
+
+
+void SimApplication::setStartTime(time_t start_time)
+{
+  m_realtime_offset = start_time * NSEC_PER_SEC - m_now;
+} /* SimApplication::setStartTime */
+
+
+uint64_t SimApplication::simulatedTime(void) const
+{
+  return (m_now - m_start) / 1000000;
+} /* SimApplication::simulatedTime */
+
+
+void SimApplication::clockGetTime(clockid_t clk_id, struct timespec *tp)
+{
+  switch (clk_id)
+  {
+    case CLOCK_MONOTONIC:
+    case CLOCK_MONOTONIC_RAW:
+    case CLOCK_MONOTONIC_COARSE:
+    case CLOCK_BOOTTIME:
+      toTimespec(m_now, tp);
+      break;
+    case CLOCK_REALTIME:
+    case CLOCK_REALTIME_COARSE:
+      toTimespec(m_now + m_realtime_offset, tp);
+      break;
+    default:
+      ::clock_gettime(clk_id, tp);
+      break;
+  }
+} /* SimApplication::clockGetTime */
+
+
+
+/****************************************************************************
+ *
+ * Protected member functions
+ *
+ ****************************************************************************/
+
+int SimApplication::waitForEvents(int nfds, fd_set *rd_set, fd_set *wr_set,
+                                  struct timespec *timeout)
+{
+    // First check, without waiting, if any file descriptor is ready
+  fd_set saved_rd_set = *rd_set;
+  fd_set saved_wr_set = *wr_set;
+  struct timespec no_wait = { 0, 0 };
+  int dcnt = CppApplication::waitForEvents(nfds, rd_set, wr_set, &no_wait);
+  if (dcnt != 0)
+  {
+    return dcnt;
+  }
+
+    // With no timer running there is nothing to advance the clock to so we
+    // have to wait for something to happen in the real world
+  if (timeout == 0)
+  {
+    *rd_set = saved_rd_set;
+    *wr_set = saved_wr_set;
+    return CppApplication::waitForEvents(nfds, rd_set, wr_set, 0);
+  }
+
+    // Jump directly to the time when the next timer expire
+  m_now += toNsec(*timeout);
+  *timeout = no_wait;
+  return 0;
+} /* SimApplication::waitForEvents */
+
+
+
+/****************************************************************************
+ *
+ * Private member functions
+ *
+ ****************************************************************************/
+
+
+
+/*
+ * This file has not been truncated
+ */
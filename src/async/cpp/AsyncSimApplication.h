@@ -0,0 +1,214 @@
+/**
+@file	 AsyncSimApplication.h
+@brief   An application class that run on a simulated clock
+@author  Tobias Blomberg / SM0SVX
+@date	 2026-10-18
+
+\verbatim
+Async - A library for programming event driven applications
+Copyright (C) 2003-2026 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+#ifndef ASYNC_SIM_APPLICATION_INCLUDED
+#define ASYNC_SIM_APPLICATION_INCLUDED
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <stdint.h>
+#include <time.h>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+#include <AsyncTimer.h>
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "AsyncCppApplication.h"
+
+
+/****************************************************************************
+ *
+ * Forward declarations
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Namespace
+ *
+ ****************************************************************************/
+
+namespace Async
+{
+
+
+/****************************************************************************
+ *
+ * Forward declarations of classes inside of the declared namespace
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Class definitions
+ *
+ ****************************************************************************/
+
+/**
+@brief	An application class that run on a simulated clock
+@author Tobias Blomberg / SM0SVX
+@date   2026-10-18
+
+This class work just like Async::CppApplication except that time is
+simulated. When there is nothing to do, that is when no file descriptor is
+ready, the clock is advanced directly to the time when the next timer
+expire instead of waiting for it. An application that is driven by timers
+only, like when reading audio from file using the "file" audio device, will
+run as fast as the CPU allow. Since all timers expire in the same order as
+they would in real time, the outcome will be the same each time the
+application is run.
+
+File descriptors are still checked for activity before the clock is advanced
+so real network I/O and DNS lookups still work. However, since the clock
+does not wait for such events the result is no longer deterministic when
+they are involved.
+
+The simulated CLOCK_MONOTONIC start at the real monotonic time when the
+object is created. The simulated CLOCK_REALTIME follow the simulated
+monotonic clock, starting at the real wall clock time or at the time set
+using setStartTime. Other clocks are not simulated.
+*/
+class SimApplication : public CppApplication
+{
+  public:
+    /**
+     * @brief 	Default constructor
+     */
+    SimApplication(void);
+
+    /**
+     * @brief 	Destructor
+     */
+    ~SimApplication(void);
+
+    /**
+     * @brief   Quit the application after the given simulated time
+     * @param   run_time_ms The simulated time to run in milliseconds
+     *
+     * Set to zero to run until quit is called. The run time must not be
+     * larger than INT_MAX milliseconds.
+     */
+    void setRunTime(unsigned run_time_ms);
+
+    /**
+     * @brief   Set the simulated wall clock time
+     * @param   start_time The wall clock time, in seconds since the epoch
+     *
+     * Set the simulated CLOCK_REALTIME to the given time. This is useful to
+     * get the same timestamps each time a simulation is run.
+     */
+    void setStartTime(time_t start_time);
+
+    /**
+     * @brief   Get how much time that has been simulated
+     * @return  Returns the simulated time, in milliseconds, since start
+     */
+    uint64_t simulatedTime(void) const;
+
+    /**
+     * @brief   Read the time of the specified clock
+     * @param   clk_id  The clock to read (e.g. CLOCK_MONOTONIC)
+     * @param   tp      The time is stored here
+     *
+     * The monotonic and real time clocks are simulated. Other clocks are
+     * read using clock_gettime.
+     */
+    virtual void clockGetTime(clockid_t clk_id, struct timespec *tp);
+
+  protected:
+    /**
+     * @brief   Wait for file descriptor activity or a timeout
+     * @param   nfds    The highest file descriptor number plus one
+     * @param   rd_set  The file descriptors to watch for read activity
+     * @param   wr_set  The file descriptors to watch for write activity
+     * @param   timeout The time until the next timer expire or null
+     * @return  Returns the number of active file descriptors or -1 on error
+     *
+     * If no file descriptor is ready the simulated clock is advanced by the
+     * timeout and the function return immediately. Only if there is no
+     * timer active, the function block waiting for file descriptor activity.
+     */
+    virtual int waitForEvents(int nfds, fd_set *rd_set, fd_set *wr_set,
+                              struct timespec *timeout);
+
+  private:
+    int64_t m_start;
+    int64_t m_now;
+    int64_t m_realtime_offset;
+    Timer   m_run_timer;
+
+    SimApplication(const SimApplication&);
+    SimApplication& operator=(const SimApplication&);
+
+};  /* class SimApplication */
+
+
+} /* namespace */
+
+#endif /* ASYNC_SIM_APPLICATION_INCLUDED */
+
+
+
+/*
+ * This file has not been truncated
+ */
@@ -140,7 +140,7 @@ Directory::Directory(const vector<string>& servers, const string& callsign,
     const IpAddress &bind_ip)
   : com_state(CS_IDLE),       	      	      the_servers(servers),
     the_password(password),   	      	      the_description(""),
-    error_str(""),    	      	      	      get_call_cnt(0),
+    index_gen(0),     	      	      	      error_str(""),    	      	      	      get_call_cnt(0),
     ctrl_con(0),
     the_status(StationData::STAT_OFFLINE),    reg_refresh_timer(0),
     current_status(StationData::STAT_OFFLINE),server_changed(false),
@@ -150,6 +150,7 @@ Directory::Directory(const vector<string>& servers, const string& callsign,
   transform(callsign.begin(), callsign.end(), the_callsign.begin(), ::toupper);
   
   setDescription(description);
+  clearStationList();
   
   createClientObject();
   
@@ -207,10 +208,7 @@ void Directory::getCalls(void)
   }
   else
   {
-    the_links.clear();
-    the_repeaters.clear();
-    the_conferences.clear();
-    the_stations.clear();
+    clearStationList();
     error("Trying to update the directory list while not registered with the "
       	  "directory server");
     //stationListUpdated();
@@ -251,140 +249,76 @@ void Directory::setDescription(const string& description)
 
 const StationData *Directory::findCall(const string& call)
 {
-  list<StationData> calls;
-  list<StationData>::const_iterator iter;
-  
-  for (iter=the_links.begin(); iter!=the_links.end(); ++iter)
-  {
-    if (iter->callsign() == call)
-    {
-      return &(*iter);
-    }
-  }
-  
-  for (iter=the_repeaters.begin(); iter!=the_repeaters.end(); ++iter)
-  {
-    if (iter->callsign() == call)
-    {
-      return &(*iter);
-    }
-  }
-  
-  for (iter=the_conferences.begin(); iter!=the_conferences.end(); ++iter)
-  {
-    if (iter->callsign() == call)
-    {
-      return &(*iter);
-    }
-  }
-  
-  for (iter=the_stations.begin(); iter!=the_stations.end(); ++iter)
+  CallIndex::const_iterator it = call_idx.find(call);
+  if (it == call_idx.end())
   {
-    if (iter->callsign() == call)
-    {
-      return &(*iter);
-    }
+    return 0;
   }
-  
-  return 0;
-  
+  return stationFromRef(it->second.refs.front());
 } /* Directory::findCall */
 
 
 const StationData *Directory::findStation(int id)
 {
-  list<StationData> calls;
-  list<StationData>::const_iterator iter;
-  
-  for (iter=the_links.begin(); iter!=the_links.end(); ++iter)
-  {
-    if (iter->id() == id)
-    {
-      return &(*iter);
-    }
-  }
-  
-  for (iter=the_repeaters.begin(); iter!=the_repeaters.end(); ++iter)
+  IdIndex::const_iterator it = id_idx.find(id);
+  if (it == id_idx.end())
   {
-    if (iter->id() == id)
-    {
-      return &(*iter);
-    }
+    return 0;
   }
-  
-  for (iter=the_conferences.begin(); iter!=the_conferences.end(); ++iter)
-  {
-    if (iter->id() == id)
-    {
-      return &(*iter);
-    }
-  }
-  
-  for (iter=the_stations.begin(); iter!=the_stations.end(); ++iter)
-  {
-    if (iter->id() == id)
-    {
-      return &(*iter);
-    }
-  }
-  
-  return 0;
-  
+  return stationFromRef(it->second);
 } /* Directory::findStation */
 
 
-bool Directory::stationCodeEq(const StationData& stn, string code, bool exact)
-{
-  if (exact)
-  {
-    return (stn.code() == code);
-  }
-  else
-  {
-    return (stn.code().find(code) == 0);
-  }
-} /* Directory::stationCodeEq  */
-
-
 void Directory::findStationsByCode(vector<StationData> &stns,
 		const string& code, bool exact)
 {
-  list<StationData>::const_iterator iter;
-  
   stns.clear();
 
-  for (iter=the_links.begin(); iter!=the_links.end(); ++iter)
+  int node = codeTrieFind(code);
+  if (node < 0)
   {
-    if (stationCodeEq(*iter, code, exact))
-    {
-      stns.push_back(*iter);
-    }
+    return;
   }
-  
-  for (iter=the_repeaters.begin(); iter!=the_repeaters.end(); ++iter)
+
+    // Collect the callsigns for the exact match or for the whole subtree
+    // when doing a prefix match
+  vector<StationRef> refs;
+  vector<int> stack(1, node);
+  while (!stack.empty())
   {
-    if (stationCodeEq(*iter, code, exact))
+    const CodeTrieNode& n = code_trie[stack.back()];
+    stack.pop_back();
+    vector<string>::const_iterator cit;
+    for (cit=n.calls.begin(); cit!=n.calls.end(); ++cit)
     {
-      stns.push_back(*iter);
+      CallIndex::const_iterator it = call_idx.find(*cit);
+      assert(it != call_idx.end());
+      refs.insert(refs.end(), it->second.refs.begin(), it->second.refs.end());
     }
-  }
-  
-  for (iter=the_conferences.begin(); iter!=the_conferences.end(); ++iter)
-  {
-    if (stationCodeEq(*iter, code, exact))
+    if (!exact)
     {
-      stns.push_back(*iter);
+      for (int i=0; i<10; ++i)
+      {
+        if (n.child[i] >= 0)
+        {
+          stack.push_back(n.child[i]);
+        }
+      }
     }
   }
-  
-  for (iter=the_stations.begin(); iter!=the_stations.end(); ++iter)
+
+    // Return the stations in list order
+  sort(refs.begin(), refs.end(),
+      [](const StationRef& a, const StationRef& b)
+      {
+        return (a.cat < b.cat) || ((a.cat == b.cat) && (a.idx < b.idx));
+      });
+  stns.reserve(refs.size());
+  vector<StationRef>::const_iterator rit;
+  for (rit=refs.begin(); rit!=refs.end(); ++rit)
   {
-    if (stationCodeEq(*iter, code, exact))
-    {
-      stns.push_back(*iter);
-    }
+    stns.push_back(*stationFromRef(*rit));
   }
-
 } /* Directory::findStationsByCode  */
 
 
@@ -495,9 +429,13 @@ int Directory::handleCallList(char *buf, int len)
 	buf[read_len-1] = 0;
 	get_call_cnt = atoi(buf);
 	//printf("Number of calls to get: %d\n", get_call_cnt);
+	for (int cat=0; cat<CAT_COUNT; ++cat)
+	{
+	  get_call_lists[cat].clear();
+	  get_call_lists[cat].reserve(the_lists[cat].size());
+	}
 	if (get_call_cnt > 0)
 	{
-	  get_call_list.clear();
 	  the_message = "";
 	  com_state = CS_WAITING_FOR_CALL;
 	}
@@ -585,7 +523,8 @@ int Directory::handleCallList(char *buf, int len)
 	}
 	else
 	{
-      	  get_call_list.push_back(get_call_entry);
+	  const string& callsign = get_call_entry.callsign();
+      	  get_call_lists[stationCategory(callsign)].push_back(get_call_entry);
 	}
 
 	if (--get_call_cnt <= 0)
@@ -607,32 +546,12 @@ int Directory::handleCallList(char *buf, int len)
 	if (memcmp(buf, "+++", 3) == 0)
 	{
 	  //printf("End received!\n");
-	  the_links.clear();
-	  the_repeaters.clear();
-	  the_conferences.clear();
-	  the_stations.clear();
-	  list<StationData>::const_iterator it;
-	  for (it = get_call_list.begin(); it != get_call_list.end(); ++it)
+	  for (int cat=0; cat<CAT_COUNT; ++cat)
 	  {
-	    const string &callsign = it->callsign();
-	    if (callsign.rfind("-L") == callsign.size()-2)
-	    {
-	      the_links.push_back(*it);
-	    }
-	    else if (callsign.rfind("-R") == callsign.size()-2)
-	    {
-	      the_repeaters.push_back(*it);
-	    }
-	    else if (callsign.find("*") == 0)
-	    {
-	      the_conferences.push_back(*it);
-	    }
-	    else
-	    {
-	      the_stations.push_back(*it);
-	    }
+	    the_lists[cat].swap(get_call_lists[cat]);
+	    get_call_lists[cat].clear();
 	  }
-	  get_call_list.clear();
+	  updateIndexes();
 	  com_state = CS_IDLE;
 	  read_len = 3;
 
@@ -1008,6 +927,211 @@ void Directory::onCmdTimeout(Timer *timer)
 } /* Directory::onCmdTimeout */
 
 
+Directory::Category Directory::stationCategory(const string& callsign)
+{
+  if (callsign.rfind("-L") == callsign.size()-2)
+  {
+    return CAT_LINK;
+  }
+  else if (callsign.rfind("-R") == callsign.size()-2)
+  {
+    return CAT_REPEATER;
+  }
+  else if (callsign.find("*") == 0)
+  {
+    return CAT_CONFERENCE;
+  }
+  return CAT_STATION;
+} /* Directory::stationCategory */
+
+
+void Directory::clearStationList(void)
+{
+  for (int cat=0; cat<CAT_COUNT; ++cat)
+  {
+    the_lists[cat].clear();
+  }
+  call_idx.clear();
+  id_idx.clear();
+  code_trie.assign(1, CodeTrieNode());
+  code_trie_free.clear();
+} /* Directory::clearStationList */
+
+
+void Directory::updateIndexes(void)
+{
+    // The station list is usually almost the same from one refresh to the
+    // next so the indexes are updated in place. Only stations that have
+    // appeared or disappeared cause allocations or trie updates.
+  ++index_gen;
+  for (int cat=0; cat<CAT_COUNT; ++cat)
+  {
+    const StationList& stns = the_lists[cat];
+    for (size_t idx=0; idx<stns.size(); ++idx)
+    {
+      const StationData& stn = stns[idx];
+      StationRef ref = { static_cast<Category>(cat), idx, index_gen };
+
+      CallIndex::iterator cit = call_idx.find(stn.callsign());
+      if (cit == call_idx.end())
+      {
+        CallIndexEntry& entry = call_idx[stn.callsign()];
+        entry.refs.push_back(ref);
+        entry.code = stn.code();
+        codeTrieAdd(entry.code, stn.callsign());
+      }
+      else
+      {
+          // The same callsign may occur more than once in the list. All of
+          // them are kept so that findStationsByCode return all of them,
+          // like the old linear search did. The first one is used by
+          // findCall.
+        vector<StationRef>& refs = cit->second.refs;
+        if (refs.front().gen != index_gen)
+        {
+          refs.clear();
+        }
+        refs.push_back(ref);
+      }
+
+      IdIndex::iterator iit = id_idx.find(stn.id());
+      if (iit == id_idx.end())
+      {
+        id_idx[stn.id()] = ref;
+      }
+      else if (iit->second.gen != index_gen)
+      {
+        iit->second = ref;
+      }
+    }
+  }
+
+    // Remove stations that were not in the new list
+  CallIndex::iterator cit = call_idx.begin();
+  while (cit != call_idx.end())
+  {
+    if (cit->second.refs.front().gen != index_gen)
+    {
+      codeTrieRemove(cit->second.code, cit->first);
+      cit = call_idx.erase(cit);
+    }
+    else
+    {
+      ++cit;
+    }
+  }
+  IdIndex::iterator iit = id_idx.begin();
+  while (iit != id_idx.end())
+  {
+    if (iit->second.gen != index_gen)
+    {
+      iit = id_idx.erase(iit);
+    }
+    else
+    {
+      ++iit;
+    }
+  }
+} /* Directory::updateIndexes */
+
+
+void Directory::codeTrieAdd(const string& code, const string& call)
+{
+  int node = 0;
+  string::const_iterator it;
+  for (it=code.begin(); it!=code.end(); ++it)
+  {
+    assert(isdigit(*it));
+    int digit = *it - '0';
+    if (code_trie[node].child[digit] < 0)
+    {
+      int new_node;
+      if (code_trie_free.empty())
+      {
+        new_node = code_trie.size();
+        code_trie.push_back(CodeTrieNode());
+      }
+      else
+      {
+        new_node = code_trie_free.back();
+        code_trie_free.pop_back();
+      }
+      code_trie[node].child[digit] = new_node;
+    }
+    node = code_trie[node].child[digit];
+  }
+  code_trie[node].calls.push_back(call);
+} /* Directory::codeTrieAdd */
+
+
+void Directory::codeTrieRemove(const string& code, const string& call)
+{
+    // Remember the path from the root so that nodes left empty can be
+    // unlinked from their parents afterwards
+  vector<int> path(1, 0);
+  string::const_iterator it;
+  for (it=code.begin(); it!=code.end(); ++it)
+  {
+    if (!isdigit(*it))
+    {
+      return;
+    }
+    int node = code_trie[path.back()].child[*it - '0'];
+    if (node < 0)
+    {
+      return;
+    }
+    path.push_back(node);
+  }
+
+  vector<string>& calls = code_trie[path.back()].calls;
+  vector<string>::iterator cit = find(calls.begin(), calls.end(), call);
+  if (cit == calls.end())
+  {
+    return;
+  }
+  calls.erase(cit);
+
+    // Prune the chain of nodes that no longer lead to any callsign. The
+    // nodes are put on the free list to be reused by codeTrieAdd.
+  for (size_t i=path.size()-1; i>0; --i)
+  {
+    CodeTrieNode& n = code_trie[path[i]];
+    if (!n.calls.empty() ||
+        (find_if(n.child, n.child+10, [](int c) { return c >= 0; })
+          != n.child+10))
+    {
+      break;
+    }
+    vector<string>().swap(n.calls);
+    code_trie[path[i-1]].child[code[i-1] - '0'] = -1;
+    code_trie_free.push_back(path[i]);
+  }
+} /* Directory::codeTrieRemove */
+
+
+int Directory::codeTrieFind(const string& code) const
+{
+  int node = 0;
+  string::const_iterator it;
+  for (it=code.begin(); (it!=code.end()) && (node >= 0); ++it)
+  {
+    if (!isdigit(*it))
+    {
+      return -1;
+    }
+    node = code_trie[node].child[*it - '0'];
+  }
+  return node;
+} /* Directory::codeTrieFind */
+
+
+const StationData *Directory::stationFromRef(const StationRef& ref) const
+{
+  return &the_lists[ref.cat][ref.idx];
+} /* Directory::stationFromRef */
+
+
 
 /*
  * This file has not been truncated
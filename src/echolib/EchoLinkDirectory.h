@@ -48,6 +48,8 @@ An example of how to use the EchoLink::Directory class
 #include <string>
 #include <list>
 #include <vector>
+#include <unordered_map>
+#include <algorithm>
 #include <iostream>
 
 
@@ -268,7 +270,10 @@ class Directory : public sigc::trackable
      * where the callsign end with "-L". For this function to return anything,
      * a previous call to Directory::getCalls must have been made.
      */
-    const std::list<StationData>& links(void) const { return the_links; }
+    const std::vector<StationData>& links(void) const
+    {
+      return the_lists[CAT_LINK];
+    }
     
     /**
      * @brief 	Get a list of all active repeasters
@@ -278,9 +283,9 @@ class Directory : public sigc::trackable
      * stations where the callsign end with "-R". For this function to return
      * anything, a previous call to Directory::getCalls must have been made.
      */
-    const std::list<StationData>& repeaters(void) const
+    const std::vector<StationData>& repeaters(void) const
     {
-      return the_repeaters;
+      return the_lists[CAT_REPEATER];
     }
     
     /**
@@ -292,16 +297,19 @@ class Directory : public sigc::trackable
      * to return anything, a previous call to Directory::getCalls must have been
      * made.
      */
-    const std::list<StationData>& conferences(void) const
+    const std::vector<StationData>& conferences(void) const
     {
-      return the_conferences;
+      return the_lists[CAT_CONFERENCE];
     }
     
     /**
      * @brief 	Get a list of all active "normal" stations
      * @return	Returns a reference to a list of StationData objects
      */
-    const std::list<StationData>& stations(void) const { return the_stations; }
+    const std::vector<StationData>& stations(void) const
+    {
+      return the_lists[CAT_STATION];
+    }
     
     /**
      * @brief 	Get the message returned by the directory server
@@ -318,6 +326,8 @@ class Directory : public sigc::trackable
      * @param 	call  The callsign to find
      * @return	Returns a pointer to a StationData object if the callsign was
      *	      	found. Otherwise a NULL-pointer is returned.
+     *
+     * The returned pointer is valid until the station list is updated.
      */
     const StationData *findCall(const std::string& call);
     
@@ -338,6 +348,8 @@ class Directory : public sigc::trackable
      *
      * Find stations matching the given code. For a description of how the
      * callsign to code mapping is done see @see EchoLink::StationData::code.
+     * The stations are returned in the same order as they appear in the
+     * links, repeaters, conferences and stations lists.
      */
     void findStationsByCode(std::vector<StationData> &stns,
 		    const std::string& code, bool exact=true);
@@ -368,6 +380,37 @@ class Directory : public sigc::trackable
       CS_WAITING_FOR_DATA,  CS_WAITING_FOR_ID,    CS_WAITING_FOR_IP,
       CS_WAITING_FOR_END,   CS_IDLE,  	      	  CS_WAITING_FOR_OK
     } ComState;
+
+    typedef enum
+    {
+      CAT_LINK, CAT_REPEATER, CAT_CONFERENCE, CAT_STATION, CAT_COUNT
+    } Category;
+
+    typedef std::vector<StationData> StationList;
+
+    struct StationRef
+    {
+      Category  cat;
+      size_t    idx;
+      unsigned  gen;
+    };
+
+    struct CallIndexEntry
+    {
+      std::vector<StationRef> refs;   // All stations using the callsign
+      std::string             code;
+    };
+    typedef std::unordered_map<std::string, CallIndexEntry> CallIndex;
+    typedef std::unordered_map<int, StationRef> IdIndex;
+
+    struct CodeTrieNode
+    {
+      int                       child[10];
+      std::vector<std::string>  calls;
+
+      CodeTrieNode(void) { std::fill(child, child+10, -1); }
+    };
+    typedef std::vector<CodeTrieNode> CodeTrie;
     
     static const int DIRECTORY_SERVER_PORT    	= 5200;
     static const int REGISTRATION_REFRESH_TIME  = 5 * 60 * 1000; // 5 minutes
@@ -378,16 +421,18 @@ class Directory : public sigc::trackable
     std::string       	      the_callsign;
     std::string       	      the_password;
     std::string       	      the_description;
-    std::list<StationData>    the_links;
-    std::list<StationData>    the_repeaters;
-    std::list<StationData>    the_stations;
-    std::list<StationData>    the_conferences;
+    StationList               the_lists[CAT_COUNT];
+    CallIndex                 call_idx;
+    IdIndex                   id_idx;
+    CodeTrie                  code_trie;
+    std::vector<int>          code_trie_free;   // Unused code_trie nodes
+    unsigned                  index_gen;
     std::string       	      the_message;
     std::string       	      error_str;
     
     int       	      	      get_call_cnt;
     StationData       	      get_call_entry;
-    std::list<StationData>    get_call_list;
+    StationList               get_call_lists[CAT_COUNT];
     
     DirectoryCon *            ctrl_con;
     std::list<Cmd>    	      cmd_queue;
@@ -414,7 +459,13 @@ class Directory : public sigc::trackable
     void createClientObject(void);
     void onRefreshRegistration(Async::Timer *timer);
     void onCmdTimeout(Async::Timer *timer);
-    bool stationCodeEq(const StationData& stn, std::string code, bool exact);
+    static Category stationCategory(const std::string& callsign);
+    void clearStationList(void);
+    void updateIndexes(void);
+    void codeTrieAdd(const std::string& code, const std::string& call);
+    void codeTrieRemove(const std::string& code, const std::string& call);
+    int codeTrieFind(const std::string& code) const;
+    const StationData *stationFromRef(const StationRef& ref) const;
 
 };  /* class Directory */
 
@@ -63,6 +63,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "rtpacket.h"
 #include "EchoLinkDispatcher.h"
 #include "EchoLinkQso.h"
+#include "EchoLinkVoiceEncoder.h"
 
 
 
@@ -444,6 +445,45 @@ bool Qso::sendAudioRaw(RawPacket *raw_packet)
 } /* Qso::sendAudioRaw */
 
 
+bool Qso::sendAudioEncoded(VoiceEncoder& encoder)
+{
+  if (state != STATE_CONNECTED)
+  {
+    return false;
+  }
+
+  RawPacket *raw_packet = 0;
+#ifdef SPEEX_MAJOR
+  if (p->remote_codec == Private::CODEC_SPEEX)
+  {
+    raw_packet = encoder.speexPacket();
+  }
+  else
+#endif
+  {
+    raw_packet = encoder.gsmPacket();
+  }
+  if (raw_packet == 0)
+  {
+    return false;
+  }
+
+    // The packet is shared between all connections so only the sequence
+    // number is set before it is sent
+  raw_packet->voice_packet->header.seqNum = htons(next_audio_seq++);
+  bool success = Dispatcher::instance()->sendAudioMsg(remote_ip,
+      raw_packet->voice_packet, raw_packet->length);
+  if (!success)
+  {
+    perror("sendAudioMsg in Qso::sendAudioEncoded");
+    return false;
+  }
+
+  return true;
+
+} /* Qso::sendAudioEncoded */
+
+
 void Qso::setRemoteParams(const string& priv)
 {
 #ifdef SPEEX_MAJOR  
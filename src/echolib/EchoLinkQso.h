@@ -99,6 +99,7 @@ namespace EchoLink
  *
  ****************************************************************************/
 
+class VoiceEncoder;
 
 
 /****************************************************************************
@@ -315,6 +316,18 @@ class Qso
      */
     bool sendAudioRaw(RawPacket *raw_packet);
 
+    /**
+     * @brief 	Send a voice packet encoded by a shared encoder
+     * @param 	encoder The encoder holding the current voice packet
+     * @return	Returns \em true on success or \em false on failure
+     *
+     * Use this function, from a VoiceEncoder::packetReady signal handler, to
+     * send the same audio to many stations while only encoding it once for
+     * each codec in use. The packet for the codec used by the remote station
+     * is taken from the encoder.
+     */
+    bool sendAudioEncoded(VoiceEncoder& encoder);
+
     /**
       * @brief Set parameters of the remote station connection
       * @param priv A private string for passing connection parameters
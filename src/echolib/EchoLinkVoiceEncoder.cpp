@@ -0,0 +1,298 @@
+/**
+@file	 EchoLinkVoiceEncoder.cpp
+@brief   Encode audio once for many EchoLink connections
+@author  Tobias Blomberg / SM0SVX
+@date	 2026-10-18
+
+\verbatim
+EchoLib - A library for EchoLink communication
+Copyright (C) 2003-2026 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <arpa/inet.h>
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef SPEEX_MAJOR
+#include <speex/speex.h>
+#endif
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "EchoLinkVoiceEncoder.h"
+
+
+
+/****************************************************************************
+ *
+ * Namespaces to use
+ *
+ ****************************************************************************/
+
+using namespace std;
+using namespace Async;
+using namespace EchoLink;
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local class definitions
+ *
+ ****************************************************************************/
+
+struct VoiceEncoder::Private
+{
+#ifdef SPEEX_MAJOR
+  SpeexBits         enc_bits;
+  void *            enc_state;
+  Qso::VoicePacket  voice_packet;
+  Qso::RawPacket    packet;
+  bool              encoded;
+
+  Private(void) : enc_bits(), enc_state(0), encoded(false) {}
+#endif
+};
+
+
+
+/****************************************************************************
+ *
+ * Prototypes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ *
+ * Local Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Public member functions
+ *
+ ****************************************************************************/
+
+VoiceEncoder::VoiceEncoder(void)
+  : gsmh(0), buffer_cnt(0), gsm_encoded(false), p(new Private)
+{
+  gsmh = gsm_create();
+  gsm_voice_packet.header.version = 0xc0;
+  gsm_voice_packet.header.pt = 0x03;
+  gsm_voice_packet.header.seqNum = 0;
+  gsm_voice_packet.header.time = htonl(0);
+  gsm_voice_packet.header.ssrc = htonl(0);
+  gsm_packet.voice_packet = &gsm_voice_packet;
+  gsm_packet.length = sizeof(gsm_voice_packet.header) + FRAME_COUNT * 33;
+  gsm_packet.samples = buffer;
+
+#ifdef SPEEX_MAJOR
+    // Use the same encoder settings as EchoLink::Qso
+  speex_bits_init(&p->enc_bits);
+  p->enc_state = speex_encoder_init(&speex_nb_mode);
+  int val = 25000;
+  speex_encoder_ctl(p->enc_state, SPEEX_SET_BITRATE, &val);
+  val = 8;
+  speex_encoder_ctl(p->enc_state, SPEEX_SET_QUALITY, &val);
+  val = 4;
+  speex_encoder_ctl(p->enc_state, SPEEX_SET_COMPLEXITY, &val);
+  p->voice_packet.header.version = 0xc0;
+  p->voice_packet.header.pt = 0x96;
+  p->voice_packet.header.seqNum = 0;
+  p->voice_packet.header.time = htonl(0);
+  p->voice_packet.header.ssrc = htonl(0);
+  p->packet.voice_packet = &p->voice_packet;
+  p->packet.length = 0;
+  p->packet.samples = buffer;
+#endif
+} /* VoiceEncoder::VoiceEncoder */
+
+
+VoiceEncoder::~VoiceEncoder(void)
+{
+  gsm_destroy(gsmh);
+  gsmh = 0;
+
+#ifdef SPEEX_MAJOR
+  speex_bits_destroy(&p->enc_bits);
+  speex_encoder_destroy(p->enc_state);
+#endif
+
+  delete p;
+  p = 0;
+} /* VoiceEncoder::~VoiceEncoder */
+
+
+Qso::RawPacket *VoiceEncoder::gsmPacket(void)
+{
+  if (!gsm_encoded)
+  {
+    for (int i=0; i<FRAME_COUNT; ++i)
+    {
+      gsm_encode(gsmh, buffer + i*160, gsm_voice_packet.data + i*33);
+    }
+    gsm_encoded = true;
+  }
+  return &gsm_packet;
+} /* VoiceEncoder::gsmPacket */
+
+
+Qso::RawPacket *VoiceEncoder::speexPacket(void)
+{
+#ifdef SPEEX_MAJOR
+  if (!p->encoded)
+  {
+    for (int i=0; i<BUFFER_SIZE; i+=160)
+    {
+      speex_encode_int(p->enc_state, buffer + i, &p->enc_bits);
+    }
+    speex_bits_insert_terminator(&p->enc_bits);
+    size_t nsize = speex_bits_nbytes(&p->enc_bits);
+    size_t nbytes = 0;
+    if (nsize < sizeof(p->voice_packet.data))
+    {
+      nbytes = speex_bits_write(&p->enc_bits,
+                                (char*)p->voice_packet.data, nsize);
+    }
+    speex_bits_reset(&p->enc_bits);
+    p->packet.length = (nbytes > 0)
+        ? nbytes + sizeof(p->voice_packet.header) : 0;
+    p->encoded = true;
+  }
+  return (p->packet.length > 0) ? &p->packet : 0;
+#else
+  return 0;
+#endif
+} /* VoiceEncoder::speexPacket */
+
+
+int VoiceEncoder::writeSamples(const float *samples, int count)
+{
+  for (int i=0; i<count; ++i)
+  {
+    float sample = samples[i];
+    if (sample > 1)
+    {
+      buffer[buffer_cnt++] = 32767;
+    }
+    else if (sample < -1)
+    {
+      buffer[buffer_cnt++] = -32767;
+    }
+    else
+    {
+      buffer[buffer_cnt++] = static_cast<int16_t>(32767.0 * sample);
+    }
+
+    if (buffer_cnt == BUFFER_SIZE)
+    {
+      emitPacket();
+    }
+  }
+
+  return count;
+
+} /* VoiceEncoder::writeSamples */
+
+
+void VoiceEncoder::flushSamples(void)
+{
+  if (buffer_cnt > 0)
+  {
+    memset(buffer + buffer_cnt, 0,
+           sizeof(buffer) - sizeof(*buffer) * buffer_cnt);
+    emitPacket();
+  }
+  sourceAllSamplesFlushed();
+} /* VoiceEncoder::flushSamples */
+
+
+
+/****************************************************************************
+ *
+ * Protected member functions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Private member functions
+ *
+ ****************************************************************************/
+
+void VoiceEncoder::emitPacket(void)
+{
+  gsm_encoded = false;
+#ifdef SPEEX_MAJOR
+  p->encoded = false;
+#endif
+  packetReady();
+  buffer_cnt = 0;
+} /* VoiceEncoder::emitPacket */
+
+
+
+/*
+ * This file has not been truncated
+ */
@@ -0,0 +1,200 @@
+/**
+@file	 EchoLinkVoiceEncoder.h
+@brief   Encode audio once for many EchoLink connections
+@author  Tobias Blomberg / SM0SVX
+@date	 2026-10-18
+
+\verbatim
+EchoLib - A library for EchoLink communication
+Copyright (C) 2003-2026 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+
+#ifndef ECHOLINK_VOICE_ENCODER_INCLUDED
+#define ECHOLINK_VOICE_ENCODER_INCLUDED
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <sigc++/sigc++.h>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+extern "C" {
+#include <gsm.h>
+}
+#include <AsyncAudioSink.h>
+#include <EchoLinkQso.h>
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Forward declarations
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Namespace
+ *
+ ****************************************************************************/
+
+namespace EchoLink
+{
+
+/****************************************************************************
+ *
+ * Forward declarations inside the declared namespace
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Class definitions
+ *
+ ****************************************************************************/
+
+/**
+@brief	Encode audio once for many EchoLink connections
+@author Tobias Blomberg / SM0SVX
+@date   2026-10-18
+
+When the same audio is to be sent to many EchoLink stations, like in a
+conference, it is a waste to let each Qso object encode it. Write the audio,
+sampled at 8000Hz, to an object of this class instead. Each time a full voice
+packet worth of audio has been collected, the packetReady signal is emitted.
+Call Qso::sendAudioEncoded for each connection from the signal handler. The
+audio is encoded, at most once for each codec, when the first connection using
+that codec ask for it.
+*/
+class VoiceEncoder : public Async::AudioSink, public sigc::trackable
+{
+  public:
+    /**
+     * @brief 	Default constuctor
+     */
+    VoiceEncoder(void);
+
+    /**
+     * @brief 	Destructor
+     */
+    ~VoiceEncoder(void);
+
+    /**
+     * @brief   Get the current packet encoded using GSM
+     * @return  Returns the encoded packet
+     *
+     * Only valid to call from a packetReady signal handler.
+     */
+    Qso::RawPacket *gsmPacket(void);
+
+    /**
+     * @brief   Get the current packet encoded using Speex
+     * @return  Returns the encoded packet or 0 if Speex is not supported
+     *
+     * Only valid to call from a packetReady signal handler.
+     */
+    Qso::RawPacket *speexPacket(void);
+
+    /**
+     * @brief 	Write samples into this audio sink
+     * @param 	samples The buffer containing the samples
+     * @param 	count The number of samples in the buffer
+     * @return	Returns the number of samples that has been taken care of
+     */
+    virtual int writeSamples(const float *samples, int count);
+
+    /**
+     * @brief 	Tell the sink to flush the previously written samples
+     *
+     * A partially filled packet is padded with silence and sent.
+     */
+    virtual void flushSamples(void);
+
+    /**
+     * @brief   A signal that is emitted when a voice packet is ready to send
+     */
+    sigc::signal<void> packetReady;
+
+  private:
+    struct Private;
+
+    static const int    FRAME_COUNT = 4;
+    static const int    BUFFER_SIZE = FRAME_COUNT*160;
+
+    gsm                 gsmh;
+    short               buffer[BUFFER_SIZE];
+    int                 buffer_cnt;
+    Qso::VoicePacket    gsm_voice_packet;
+    Qso::RawPacket      gsm_packet;
+    bool                gsm_encoded;
+    Private *           p;
+
+    VoiceEncoder(const VoiceEncoder&);
+    VoiceEncoder& operator=(const VoiceEncoder&);
+    void emitPacket(void);
+
+};  /* class VoiceEncoder */
+
+
+} /* namespace */
+
+#endif /* ECHOLINK_VOICE_ENCODER_INCLUDED */
+
+
+
+/*
+ * This file has not been truncated
+ */
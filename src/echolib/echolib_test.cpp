@@ -113,7 +113,7 @@ static void on_error_msg(const string& msg);
 static void on_status_changed(StationData::Status status);
 static void echolink_qso_done(EchoLinkQsoTest *con);
 static void on_station_list_updated(void);
-static void print_call_list(const list<StationData>& calls);
+static void print_call_list(const vector<StationData>& calls);
 static void parse_arguments(int argc, const char **argv);
 
 
@@ -548,9 +548,9 @@ static void on_station_list_updated(void)
  * Bugs:      
  *----------------------------------------------------------------------------
  */
-static void print_call_list(const list<StationData>& calls)
+static void print_call_list(const vector<StationData>& calls)
 {
-  list<StationData>::const_iterator iter;
+  vector<StationData>::const_iterator iter;
   for (iter=calls.begin(); iter!=calls.end(); ++iter)
   {
     if ((filter == 0) || (strstr(iter->callsign().c_str(), filter) != 0))
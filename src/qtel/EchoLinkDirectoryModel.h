@@ -42,8 +42,11 @@ An example of how to use the EchoLinkDirectoryModel class
  ****************************************************************************/
 
 #include <QList>
+#include <QVector>
 #include <QAbstractItemModel>
 
+#include <vector>
+
 
 /****************************************************************************
  *
@@ -139,7 +142,7 @@ class EchoLinkDirectoryModel : public QAbstractItemModel
      * @param 	param1 Description_of_param1
      * @return	Return_value_of_this_member_function
      */
-    void updateStationList(const std::list<EchoLink::StationData> &stn_list);
+    void updateStationList(const std::vector<EchoLink::StationData> &stn_list);
     
     QModelIndex index(int row, int column,
 			      const QModelIndex &parent = QModelIndex()) const;
@@ -549,7 +549,7 @@ void MainWindow::initEchoLink(void)
 
 void MainWindow::updateBookmarkModel(void)
 {
-  list<StationData> bookmarks;
+  vector<StationData> bookmarks;
   QStringList callsigns = Settings::instance()->bookmarks();
   QStringList::iterator it;
   foreach (QString callsign, callsigns)
@@ -49,12 +49,13 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include <AsyncTimer.h>
 #include <AsyncConfig.h>
-#include <AsyncAudioSplitter.h>
 #include <AsyncAudioValve.h>
 #include <AsyncAudioSelector.h>
+#include <AsyncAudioDecimator.h>
 #include <EchoLinkDirectory.h>
 #include <EchoLinkDispatcher.h>
 #include <EchoLinkProxy.h>
+#include <EchoLinkVoiceEncoder.h>
 #include <LocationInfo.h>
 #include <common.h>
 
@@ -71,6 +72,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "version/MODULE_ECHO_LINK.h"
 #include "ModuleEchoLink.h"
 #include "QsoImpl.h"
+#include "multirate_filter_coeff.h"
 
 
 /****************************************************************************
@@ -165,7 +167,7 @@ ModuleEchoLink::ModuleEchoLink(void *dl_handle, Logic *logic,
     max_connections(1), max_qsos(1), talker(0), squelch_is_open(false),
     state(STATE_NORMAL), cbc_timer(0), dbc_timer(0), drop_incoming_regex(0),
     reject_incoming_regex(0), accept_incoming_regex(0),
-    reject_outgoing_regex(0), accept_outgoing_regex(0), splitter(0),
+    reject_outgoing_regex(0), accept_outgoing_regex(0), voice_enc(0),
     listen_only_valve(0), selector(0), num_con_max(0), num_con_ttl(5*60),
     num_con_block_time(120*60), num_con_update_timer(0), reject_conf(false),
     autocon_echolink_id(0), autocon_time(DEFAULT_AUTOCON_TIME),
@@ -369,12 +371,25 @@ bool ModuleEchoLink::initialize(void)
   }
 
     // Create audio pipe chain for audio transmitted to the remote EchoLink
-    // stations: <from core> -> Valve -> Splitter (-> QsoImpl ...)
+    // stations: <from core> -> Valve -> Decimator -> VoiceEncoder.
+    // The audio is encoded once and the encoded packets are then sent to
+    // all connected stations.
   listen_only_valve = new AudioValve;
   AudioSink::setHandler(listen_only_valve);
-  
-  splitter = new AudioSplitter;
-  listen_only_valve->registerSink(splitter);
+  AudioSource *prev_src = listen_only_valve;
+
+#if INTERNAL_SAMPLE_RATE == 16000
+  AudioDecimator *down_sampler = new AudioDecimator(
+          2, coeff_16_8, coeff_16_8_taps);
+  prev_src->registerSink(down_sampler, true);
+  prev_src = down_sampler;
+#endif
+
+  voice_enc = new VoiceEncoder;
+  voice_enc->packetReady.connect(
+      mem_fun(*this, &ModuleEchoLink::audioFromLocalEncoded));
+  prev_src->registerSink(voice_enc, true);
+  prev_src = 0;
 
     // Create audio pipe chain for audio received from the remove EchoLink
     // stations: (QsoImpl -> ) Selector -> Fifo -> <to core>
@@ -589,10 +604,9 @@ void ModuleEchoLink::moduleCleanup(void)
   autocon_timer = 0;
   
   AudioSink::clearHandler();
-  delete splitter;
-  splitter = 0;
   delete listen_only_valve;
   listen_only_valve = 0;
+  voice_enc = 0;
   
   AudioSource::clearHandler();
   delete selector;
@@ -1049,7 +1063,6 @@ void ModuleEchoLink::onIncomingConnection(const IpAddress& ip,
       	  mem_fun(*this, &ModuleEchoLink::audioFromRemoteRaw));
   qso->destroyMe.connect(mem_fun(*this, &ModuleEchoLink::destroyQsoObject));
 
-  splitter->addSink(qso);
   selector->addSource(qso);
   selector->enableAutoSelect(qso, 0);
 
@@ -1302,7 +1315,6 @@ void ModuleEchoLink::destroyQsoObject(QsoImpl *qso)
   //cout << qso->remoteCallsign() << ": Destroying QSO object" << endl;
   string callsign = qso->remoteCallsign();
 
-  splitter->removeSink(qso);
   selector->removeSource(qso);
       
   vector<QsoImpl*>::iterator it = find(qsos.begin(), qsos.end(), qso);
@@ -1454,7 +1466,6 @@ void ModuleEchoLink::createOutgoingConnection(const StationData &station)
       	    mem_fun(*this, &ModuleEchoLink::audioFromRemoteRaw));
     qso->destroyMe.connect(mem_fun(*this, &ModuleEchoLink::destroyQsoObject));
 
-    splitter->addSink(qso);
     selector->addSource(qso);
     selector->enableAutoSelect(qso, 0);
   }
@@ -1503,6 +1514,16 @@ void ModuleEchoLink::audioFromRemoteRaw(Qso::RawPacket *packet,
 } /* ModuleEchoLink::audioFromRemoteRaw */
 
 
+void ModuleEchoLink::audioFromLocalEncoded(void)
+{
+  vector<QsoImpl*>::iterator it;
+  for (it=qsos.begin(); it!=qsos.end(); ++it)
+  {
+    (*it)->sendAudioEncoded(*voice_enc);
+  }
+} /* ModuleEchoLink::audioFromLocalEncoded */
+
+
 QsoImpl *ModuleEchoLink::findFirstTalker(void) const
 {
   vector<QsoImpl*>::const_iterator it;
@@ -1894,26 +1915,15 @@ void ModuleEchoLink::handleCommand(const string& cmd)
     
     if (cmd[1] == '1')	// Random connect to link or repeater
     {
-      const list<StationData>& links = dir->links();
-      const list<StationData>& repeaters = dir->repeaters();
-      list<StationData>::const_iterator it;
-      for (it=links.begin(); it!=links.end(); it++)
-      {
-	nodes.push_back(*it);
-      }
-      for (it=repeaters.begin(); it!=repeaters.end(); it++)
-      {
-	nodes.push_back(*it);
-      }
+      const vector<StationData>& links = dir->links();
+      const vector<StationData>& repeaters = dir->repeaters();
+      nodes.reserve(links.size() + repeaters.size());
+      nodes.insert(nodes.end(), links.begin(), links.end());
+      nodes.insert(nodes.end(), repeaters.begin(), repeaters.end());
     }
     else if (cmd[1] == '2') // Random connect to conference
     {
-      const list<StationData>& conferences = dir->conferences();
-      list<StationData>::const_iterator it;
-      for (it=conferences.begin(); it!=conferences.end(); it++)
-      {
-	nodes.push_back(*it);
-      }
+      nodes = dir->conferences();
     }
     else
     {
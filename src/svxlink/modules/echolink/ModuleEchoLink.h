@@ -72,7 +72,6 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 namespace Async
 {
   class Timer;
-  class AudioSplitter;
   class AudioValve;
   class AudioSelector;
   class Pty;
@@ -82,6 +81,7 @@ namespace EchoLink
   class Directory;
   class StationData;
   class Proxy;
+  class VoiceEncoder;
 };
 
 
@@ -198,7 +198,7 @@ class ModuleEchoLink : public Module
     regex_t   	      	  *reject_outgoing_regex;
     regex_t   	      	  *accept_outgoing_regex;
     EchoLink::StationData last_disc_stn;
-    Async::AudioSplitter  *splitter;
+    EchoLink::VoiceEncoder *voice_enc;
     Async::AudioValve 	  *listen_only_valve;
     Async::AudioSelector  *selector;
     unsigned              num_con_max;
@@ -245,6 +245,7 @@ class ModuleEchoLink : public Module
     int audioFromRemote(float *samples, int count, QsoImpl *qso);
     void audioFromRemoteRaw(EchoLink::Qso::RawPacket *packet,
       	      	      	    QsoImpl *qso);
+    void audioFromLocalEncoded(void);
     QsoImpl *findFirstTalker(void) const;
     void broadcastTalkerStatus(void);
     void updateDescription(void);
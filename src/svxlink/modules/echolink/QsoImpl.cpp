@@ -49,8 +49,6 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include <AsyncConfig.h>
 #include <AsyncAudioPacer.h>
-#include <AsyncAudioSelector.h>
-#include <AsyncAudioPassthrough.h>
 #include <AsyncAudioFifo.h>
 #include <AsyncAudioDecimator.h>
 #include <AsyncAudioInterpolator.h>
@@ -134,9 +132,9 @@ using namespace sigc;
 
 QsoImpl::QsoImpl(const StationData &station, ModuleEchoLink *module)
   : m_qso(station.ip()), module(module), event_handler(0), msg_handler(0),
-    output_sel(0), init_ok(false), reject_qso(false), last_message(""),
+    init_ok(false), reject_qso(false), last_message(""),
     last_info_msg(""), idle_timer(0), disc_when_done(false), idle_timer_cnt(0),
-    idle_timeout(0), destroy_timer(0), station(station), sink_handler(0),
+    idle_timeout(0), destroy_timer(0), station(station),
     logic_is_idle(true)
 {
   assert(module != 0);
@@ -192,9 +190,6 @@ QsoImpl::QsoImpl(const StationData &station, ModuleEchoLink *module)
     idle_timer->expired.connect(mem_fun(*this, &QsoImpl::idleTimeoutCheck));
   }
   
-  sink_handler = new AudioPassthrough;
-  AudioSink::setHandler(sink_handler);
-
   msg_handler = new MsgHandler(INTERNAL_SAMPLE_RATE);
   msg_handler->allMsgsWritten.connect(
       	  mem_fun(*this, &QsoImpl::allRemoteMsgsWritten));
@@ -204,12 +199,7 @@ QsoImpl::QsoImpl(const StationData &station, ModuleEchoLink *module)
 					 500);
   msg_handler->registerSink(msg_pacer, true);
   
-  output_sel = new AudioSelector;
-  output_sel->addSource(sink_handler);
-  output_sel->enableAutoSelect(sink_handler, 0);
-  output_sel->addSource(msg_pacer);
-  output_sel->enableAutoSelect(msg_pacer, 10);
-  AudioSource *prev_src = output_sel;
+  AudioSource *prev_src = msg_pacer;
 
 #if INTERNAL_SAMPLE_RATE == 16000
   AudioDecimator *down_sampler = new AudioDecimator(
@@ -280,12 +270,9 @@ QsoImpl::QsoImpl(const StationData &station, ModuleEchoLink *module)
 
 QsoImpl::~QsoImpl(void)
 {
-  AudioSink::clearHandler();
   AudioSource::clearHandler();
   delete event_handler;
-  delete output_sel;
   delete msg_handler;
-  delete sink_handler;
   delete idle_timer;
   delete destroy_timer;
 } /* QsoImpl::~QsoImpl */
@@ -322,6 +309,18 @@ bool QsoImpl::sendAudioRaw(Qso::RawPacket *packet)
 } /* QsoImpl::sendAudioRaw */
 
 
+bool QsoImpl::sendAudioEncoded(VoiceEncoder& encoder)
+{
+  if (!msg_handler->isWritingMessage())
+  {
+    return m_qso.sendAudioEncoded(encoder);
+  }
+
+  return true;
+
+} /* QsoImpl::sendAudioEncoded */
+
+
 bool QsoImpl::connect(void)
 {
   if (destroy_timer != 0)
@@ -47,7 +47,6 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  *
  ****************************************************************************/
 
-#include <AsyncAudioSink.h>
 #include <AsyncAudioSource.h>
 #include <EchoLinkQso.h>
 #include <EchoLinkStationData.h>
@@ -71,7 +70,6 @@ namespace Async
 {
   class Config;
   class AudioPacer;
-  class AudioPassthrough;
 };
 
 
@@ -126,8 +124,7 @@ class ModuleEchoLink;
 
 A class that implementes the things needed for one EchoLink Qso.
 */
-class QsoImpl
-  : public Async::AudioSink, public Async::AudioSource, public sigc::trackable
+class QsoImpl : public Async::AudioSource, public sigc::trackable
 {
   public:
     /**
@@ -167,6 +164,16 @@ class QsoImpl
      * audioReceivedRaw signal.
      */
     bool sendAudioRaw(EchoLink::Qso::RawPacket *packet);
+
+    /**
+     * @brief 	Send the current packet of a shared voice encoder
+     * @param 	encoder The voice encoder holding the packet to send
+     *
+     * This function is used to send local audio to the remote station. The
+     * audio is encoded once in a shared encoder for all connections. Nothing
+     * is sent while a message is being played to the remote station.
+     */
+    bool sendAudioEncoded(EchoLink::VoiceEncoder& encoder);
     
     /**
      * @brief 	Initiate a connection to the remote station
@@ -321,7 +328,6 @@ class QsoImpl
     ModuleEchoLink    	    *module;
     EventHandler      	    *event_handler;
     MsgHandler	      	    *msg_handler;
-    Async::AudioSelector    *output_sel;
     bool      	      	    init_ok;
     bool      	      	    reject_qso;
     std::string       	    last_message;
@@ -332,7 +338,6 @@ class QsoImpl
     int       	      	    idle_timeout;
     Async::Timer	    *destroy_timer;
     EchoLink::StationData   station;
-    Async::AudioPassthrough *sink_handler;
     std::string             sysop_name;
     bool                    logic_is_idle;
     
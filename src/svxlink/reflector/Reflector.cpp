@@ -37,6 +37,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <fstream>
 #include <iterator>
 #include <regex>
+#include <strings.h>
 
 
 /****************************************************************************
@@ -173,6 +174,30 @@ namespace {
     timer.setExpireOffset(10000);
     timer.start();
   } /* startCertRenewTimer */
+
+
+  const std::string* findHeader(
+      const Async::HttpServerConnection::Headers& headers,
+      const std::string& key)
+  {
+    for (const auto& header : headers)
+    {
+      if (strcasecmp(header.first.c_str(), key.c_str()) == 0)
+      {
+        return &header.second;
+      }
+    }
+    return nullptr;
+  } /* findHeader */
+
+
+  std::string jsonString(const Json::Value& value)
+  {
+    Json::StreamWriterBuilder builder;
+    builder["commentStyle"] = "None";
+    builder["indentation"] = ""; //The JSON document is written on a single line
+    return Json::writeString(builder, value);
+  } /* jsonString */
 };
 
 
@@ -197,6 +222,10 @@ namespace {
   //    ProtoVer(2, 0), ProtoVer(2, 999));
   ReflectorClient::ProtoVerLargerOrEqualFilter ge_v2_client_filter(
       ProtoVer(2, 0));
+  ReflectorClient::ProtoVerRangeFilter no_node_delta_client_filter(
+      ProtoVer(0, 0), ProtoVer(3, 0));
+  ReflectorClient::ProtoVerLargerOrEqualFilter node_delta_client_filter(
+      ProtoVer(3, 1));
 };
 
 
@@ -210,8 +239,26 @@ Reflector::Reflector(void)
   : m_srv(0), m_udp_sock(0), m_tg_for_v1_clients(1), m_random_qsy_lo(0),
     m_random_qsy_hi(0), m_random_qsy_tg(0), m_http_server(0), m_cmd_pty(0),
     m_keys_dir("private/"), m_pending_csrs_dir("pending_csrs/"),
-    m_csrs_dir("csrs/"), m_certs_dir("certs/"), m_pki_dir("pki/")
+    m_csrs_dir("csrs/"), m_certs_dir("certs/"), m_pki_dir("pki/"),
+    m_status_stream_timer(STATUS_STREAM_INTERVAL, Timer::TYPE_ONESHOT, false),
+    m_node_event_timer(NODE_EVENT_COALESCE_TIME, Timer::TYPE_ONESHOT, false),
+    m_metrics_probe_timer(METRICS_PROBE_INTERVAL, Timer::TYPE_PERIODIC, false),
+    m_trunk_interest_timer(TRUNK_INTEREST_COALESCE_TIME, Timer::TYPE_ONESHOT,
+                           false),
+    m_ca_workers(m_metrics)
 {
+  std::ostringstream etag_prefix_ss;
+  etag_prefix_ss << std::hex << time(NULL);
+  m_status_etag_prefix = etag_prefix_ss.str();
+  m_status_stream_timer.expired.connect(
+      mem_fun(*this, &Reflector::flushStatusStreams));
+  m_node_event_timer.expired.connect(
+      mem_fun(*this, &Reflector::flushNodeEvents));
+  m_metrics_probe_timer.expired.connect(
+      mem_fun(*this, &Reflector::metricsProbeExpired));
+  m_trunk_interest_timer.expired.connect(
+      mem_fun(*this, &Reflector::updateTrunkInterest));
+
   TGHandler::instance()->talkerUpdated.connect(
       mem_fun(*this, &Reflector::onTalkerUpdated));
   TGHandler::instance()->requestAutoQsy.connect(
@@ -239,8 +286,19 @@ Reflector::Reflector(void)
 
 Reflector::~Reflector(void)
 {
+  delete m_handoff;
+  m_handoff = nullptr;
+  for (auto trunk : m_trunks)
+  {
+    delete trunk;
+  }
+  m_trunks.clear();
+  delete m_trunk_srv;
+  m_trunk_srv = nullptr;
   delete m_http_server;
   m_http_server = 0;
+  delete m_udp_rx;
+  m_udp_rx = nullptr;
   delete m_udp_sock;
   m_udp_sock = 0;
   delete m_srv;
@@ -253,14 +311,56 @@ Reflector::~Reflector(void)
 } /* Reflector::~Reflector */
 
 
-bool Reflector::initialize(Async::Config &cfg)
+bool Reflector::initialize(Async::Config &cfg, bool takeover)
 {
   m_cfg = &cfg;
   TGHandler::instance()->setConfig(m_cfg);
 
+  unsigned ca_worker_threads = 1;
+  cfg.getValue("GLOBAL", "CA_WORKER_THREADS", ca_worker_threads);
+  if (!m_ca_workers.initialize(ca_worker_threads, CA_WORKER_QUEUE_MAX))
+  {
+    std::cerr << "*** ERROR: Could not start the CA worker threads"
+              << std::endl;
+    return false;
+  }
+
+  std::string handoff_path;
+  if (cfg.getValue("GLOBAL", "HANDOFF_SOCKET", handoff_path) &&
+      !handoff_path.empty())
+  {
+    m_handoff = new ReflectorHandoff(handoff_path);
+    m_handoff->handoffRequested.connect(
+        mem_fun(*this, &Reflector::onHandoffRequested));
+    m_handoff->handoffAborted.connect(
+        mem_fun(*this, &Reflector::onHandoffAborted));
+    m_handoff->handedOver.connect(mem_fun(*this, &Reflector::onHandedOver));
+  }
+  if (takeover)
+  {
+    if (m_handoff == nullptr)
+    {
+      std::cerr << "*** ERROR: GLOBAL/HANDOFF_SOCKET must be set to take "
+                   "over from a running reflector" << std::endl;
+      return false;
+    }
+    if (!m_handoff->takeOver())
+    {
+      return false;
+    }
+  }
+
   std::string listen_port("5300");
   cfg.getValue("GLOBAL", "LISTEN_PORT", listen_port);
-  m_srv = new TcpServer<FramedTcpConnection>(listen_port);
+  int srv_sock = inheritedSocket("tcp", listen_port);
+  if (srv_sock >= 0)
+  {
+    m_srv = new TcpServer<FramedTcpConnection>(srv_sock);
+  }
+  else
+  {
+    m_srv = new TcpServer<FramedTcpConnection>(listen_port);
+  }
   m_srv->clientConnected.connect(
       mem_fun(*this, &Reflector::clientConnected));
   m_srv->clientDisconnected.connect(
@@ -275,9 +375,36 @@ bool Reflector::initialize(Async::Config &cfg)
 
   uint16_t udp_listen_port = 5300;
   cfg.getValue("GLOBAL", "LISTEN_PORT", udp_listen_port);
-  m_udp_sock = new Async::EncryptedUdpSocket(udp_listen_port);
+  unsigned udp_rx_threads = 0;
+  cfg.getValue("GLOBAL", "UDP_RX_THREADS", udp_rx_threads);
+  if (udp_rx_threads > UDP_RX_THREADS_MAX)
+  {
+    std::cout << "*** WARNING: GLOBAL/UDP_RX_THREADS limited to "
+              << UDP_RX_THREADS_MAX << std::endl;
+    udp_rx_threads = UDP_RX_THREADS_MAX;
+  }
+  int udp_sock = inheritedSocket("udp", std::to_string(udp_listen_port));
+  if (udp_rx_threads > 0)
+  {
+      // All sockets sharing the UDP port must use SO_REUSEPORT so the main
+      // socket have to be bound by us and then adopted
+    if (udp_sock >= 0)
+    {
+      ReflectorUdpRx::setReusePort(udp_sock);
+    }
+    else
+    {
+      udp_sock = ReflectorUdpRx::bindSocket(udp_listen_port);
+    }
+  }
+  m_udp_sock = new Async::EncryptedUdpSocket(
+      (udp_sock >= 0) ? 0 : udp_listen_port);
   const char* err = "unknown reason";
   if ((err="bad allocation",          (m_udp_sock == 0)) ||
+      (err="socket bind failure",
+       (udp_rx_threads > 0) && (udp_sock < 0)) ||
+      (err="socket takeover failure",
+       (udp_sock >= 0) && !m_udp_sock->adoptFd(udp_sock)) ||
       (err="initialization failure",  !m_udp_sock->initOk()) ||
       (err="unsupported cipher",      !m_udp_sock->setCipher(UdpCipher::NAME)))
   {
@@ -290,7 +417,51 @@ bool Reflector::initialize(Async::Config &cfg)
   m_udp_sock->cipherDataReceived.connect(
       mem_fun(*this, &Reflector::udpCipherDataReceived));
   m_udp_sock->dataReceived.connect(
-      mem_fun(*this, &Reflector::udpDatagramReceived));
+      [&](const IpAddress& addr, uint16_t port, void* aad, void* buf,
+          int count)
+      {
+        udpDatagramReceived(addr, port, aad, m_udp_sock->cipherAADLength(),
+                            buf, count);
+      });
+  m_udp_sock->decryptionFailed.connect(
+      [&](const IpAddress&, uint16_t)
+      {
+        m_metrics.udp_decrypt_failures.inc();
+      });
+
+  if (udp_rx_threads > 0)
+  {
+    std::vector<int> udp_socks;
+    for (unsigned i=1; i<=udp_rx_threads; ++i)
+    {
+      int sock = inheritedSocket("udp" + std::to_string(i),
+                                 std::to_string(udp_listen_port));
+      if (sock < 0)
+      {
+        sock = ReflectorUdpRx::bindSocket(udp_listen_port);
+      }
+      if (sock < 0)
+      {
+        std::cerr << "*** ERROR: Could not bind UDP socket for receiver "
+                     "thread " << i << std::endl;
+        for (int udp_sock : udp_socks)
+        {
+          close(udp_sock);
+        }
+        return false;
+      }
+      udp_socks.push_back(sock);
+    }
+    m_udp_rx = new ReflectorUdpRx(m_metrics);
+    m_udp_rx->datagramReceived.connect(
+        mem_fun(*this, &Reflector::udpDatagramReceived));
+    if (!m_udp_rx->initialize(udp_socks))
+    {
+      std::cerr << "*** ERROR: Could not start the UDP receiver threads"
+                << std::endl;
+      return false;
+    }
+  }
 
   unsigned sql_timeout = 0;
   cfg.getValue("GLOBAL", "SQL_TIMEOUT", sql_timeout);
@@ -316,14 +487,50 @@ bool Reflector::initialize(Async::Config &cfg)
     m_random_qsy_tg = m_random_qsy_hi;
   }
 
+    // Only talk groups that are configured get metrics series of their own
+    // so that clients cannot make the number of series grow without limit
+  std::set<uint32_t> metrics_tgs;
+  cfg.getValue("GLOBAL", "METRICS_TGS", metrics_tgs);
+  for (const auto& section : cfg.listSections())
+  {
+    uint32_t tg = 0;
+    if ((section.rfind("TG#", 0) == 0) &&
+        SvxLink::setValueFromString(tg, section.substr(3)))
+    {
+      metrics_tgs.insert(tg);
+    }
+  }
+  m_metrics.setTgSeries(metrics_tgs);
+
   std::string http_srv_port;
   if (m_cfg->getValue("GLOBAL", "HTTP_SRV_PORT", http_srv_port))
   {
-    m_http_server = new Async::TcpServer<Async::HttpServerConnection>(http_srv_port);
+    int http_sock = inheritedSocket("http", http_srv_port);
+    if (http_sock >= 0)
+    {
+      m_http_server =
+        new Async::TcpServer<Async::HttpServerConnection>(http_sock);
+    }
+    else
+    {
+      m_http_server =
+        new Async::TcpServer<Async::HttpServerConnection>(http_srv_port);
+    }
     m_http_server->clientConnected.connect(
         sigc::mem_fun(*this, &Reflector::httpClientConnected));
     m_http_server->clientDisconnected.connect(
         sigc::mem_fun(*this, &Reflector::httpClientDisconnected));
+
+      // The probe timer is only used to measure the event loop for the
+      // /metrics endpoint so there is no need to run it without the server
+    m_metrics_probe_expire = ReflectorMetrics::Clock::now() +
+        std::chrono::milliseconds(METRICS_PROBE_INTERVAL);
+    m_metrics_probe_timer.setEnable(true);
+  }
+
+  if (!initTrunks())
+  {
+    return false;
   }
 
     // Path for command PTY
@@ -346,6 +553,32 @@ bool Reflector::initialize(Async::Config &cfg)
 
   m_cfg->valueUpdated.connect(sigc::mem_fun(*this, &Reflector::cfgUpdated));
 
+  if (m_handoff != nullptr)
+  {
+    m_handoff->addSocket("tcp", m_srv->fd());
+    m_handoff->addSocket("udp", m_udp_sock->fd());
+    if (m_udp_rx != nullptr)
+    {
+      const auto& udp_socks = m_udp_rx->sockets();
+      for (size_t i=0; i<udp_socks.size(); ++i)
+      {
+        m_handoff->addSocket("udp" + std::to_string(i+1), udp_socks[i]);
+      }
+    }
+    if (m_http_server != nullptr)
+    {
+      m_handoff->addSocket("http", m_http_server->fd());
+    }
+    if (m_trunk_srv != nullptr)
+    {
+      m_handoff->addSocket("trunk", m_trunk_srv->fd());
+    }
+    if (!m_handoff->listen())
+    {
+      return false;
+    }
+  }
+
   return true;
 } /* Reflector::initialize */
 
@@ -367,13 +600,22 @@ void Reflector::nodeList(std::vector<std::string>& nodes) const
 void Reflector::broadcastMsg(const ReflectorMsg& msg,
                              const ReflectorClient::Filter& filter)
 {
+    // The message is serialized once, when the first receiver is found, and
+    // the resulting frame buffer is then shared by all receivers.
+  FramedTcpConnection::FrameBuf frame;
+  std::string key;
   for (const auto& item : m_client_con_map)
   {
     ReflectorClient *client = item.second;
     if (filter(client) &&
         (client->conState() == ReflectorClient::STATE_CONNECTED))
     {
-      client->sendMsg(msg);
+      if (!frame)
+      {
+        frame = ReflectorClient::packMsg(msg);
+        key = ReflectorClient::txKey(msg);
+      }
+      client->sendFrame(msg.type(), frame, key);
     }
   }
 } /* Reflector::broadcastMsg */
@@ -382,6 +624,7 @@ void Reflector::broadcastMsg(const ReflectorMsg& msg,
 bool Reflector::sendUdpDatagram(ReflectorClient *client,
     const ReflectorUdpMsg& msg)
 {
+  size_t payload_size = 0;
   if (client->protoVer() >= ProtoVer(3, 0))
   {
     ReflectorUdpMsg header(msg.type());
@@ -399,9 +642,13 @@ bool Reflector::sendUdpDatagram(ReflectorClient *client,
                 << client->remotePort() << std::endl;
       return false;
     }
-    return m_udp_sock->write(client->remoteHost(), client->remoteUdpPort(),
-                             aadss.str().data(), aadss.str().size(),
-                             ss.str().data(), ss.str().size());
+    if (!m_udp_sock->write(client->remoteHost(), client->remoteUdpPort(),
+                           aadss.str().data(), aadss.str().size(),
+                           ss.str().data(), ss.str().size()))
+    {
+      return false;
+    }
+    payload_size = ss.str().size();
   }
   else
   {
@@ -409,10 +656,19 @@ bool Reflector::sendUdpDatagram(ReflectorClient *client,
         client->udpCipherIVCntrNext() & 0xffff);
     ostringstream ss;
     assert(header.pack(ss) && msg.pack(ss));
-    return m_udp_sock->UdpSocket::write(
-        client->remoteHost(), client->remoteUdpPort(),
-        ss.str().data(), ss.str().size());
+    if (!m_udp_sock->UdpSocket::write(
+          client->remoteHost(), client->remoteUdpPort(),
+          ss.str().data(), ss.str().size()))
+    {
+      return false;
+    }
+    payload_size = ss.str().size();
   }
+
+  auto& tg_metrics = client->tgMetrics();
+  tg_metrics.tx_packets.inc();
+  tg_metrics.tx_bytes.inc(payload_size);
+  return true;
 } /* Reflector::sendUdpDatagram */
 
 
@@ -475,89 +731,166 @@ Reflector::loadClientCsr(const std::string& callsign)
 } /* Reflector::loadClientPendingCsr */
 
 
-bool Reflector::signClientCert(Async::SslX509& cert, const std::string& ca_op)
+void Reflector::signClientCert(Async::SslX509& cert, const std::string& ca_op,
+                               CertHandler handler)
 {
   //std::cout << "### Reflector::signClientCert" << std::endl;
 
-  cert.setSerialNumber();
-  cert.setIssuerName(m_issue_ca_cert.subjectName());
-  cert.setValidityTime(CERT_VALIDITY_DAYS, CERT_VALIDITY_OFFSET_DAYS);
-  auto cn = cert.commonName();
-  if (!cert.sign(m_issue_ca_pkey))
+  auto job = std::make_shared<SignJob>(m_issue_ca_pkey);
+  job->ca_cert_pem = m_issue_ca_cert.pem();
+  job->certs_dir = m_certs_dir;
+    // Work on a private copy since the certificate may be shared with a
+    // connection that is used by the event loop
+  if (cert.isNull() || !job->cert.readPem(cert.pem()))
   {
-    std::cerr << "*** ERROR: Certificate signing failed for client "
-              << cn << std::endl;
-    return false;
+    Async::SslX509 null_cert(nullptr);
+    handler(null_cert);
+    return;
   }
-  auto crtfile = m_certs_dir + "/" + cn + ".crt";
-  if (cert.writePemFile(crtfile) && m_issue_ca_cert.appendPemFile(crtfile))
-  {
-    runCAHook({
-        { "CA_OP",      ca_op },
-        { "CA_CRT_PEM", cert.pem() }
+
+  bool queued = m_ca_workers.submit(cert.commonName(),
+      [job]()
+      {
+        signCert(*job);
+      },
+      [this, job, ca_op, handler]()
+      {
+        signJobDone(*job, ca_op);
+        handler(job->cert);
       });
-  }
-  else
+  if (!queued)
   {
-    std::cerr << "*** WARNING: Failed to write client certificate file '"
-              << crtfile << "'" << std::endl;
+    std::cerr << "*** WARNING: CA worker queue full. Could not sign "
+                 "certificate for client " << cert.commonName() << std::endl;
+    Async::SslX509 null_cert(nullptr);
+    handler(null_cert);
   }
-  return true;
 } /* Reflector::signClientCert */
 
 
-Async::SslX509 Reflector::signClientCsr(const std::string& cn)
+void Reflector::signClientCsr(const std::string& cn, CertHandler handler)
 {
   //std::cout << "### Reflector::signClientCsr" << std::endl;
 
-  Async::SslX509 cert(nullptr);
+  auto job = std::make_shared<SignJob>(m_issue_ca_pkey);
+  job->ca_cert_pem = m_issue_ca_cert.pem();
+  job->certs_dir = m_certs_dir;
+  job->pending_csr_path = m_pending_csrs_dir + "/" + cn + ".csr";
+  job->csr_path = m_csrs_dir + "/" + cn + ".csr";
 
-  auto req = loadClientPendingCsr(cn);
-  if (req.isNull())
+  bool queued = m_ca_workers.submit(cn,
+      [job]()
+      {
+        Async::SslCertSigningReq req;
+        if (!req.readPemFile(job->pending_csr_path) || req.isNull())
+        {
+          job->log << "*** ERROR: Cannot find CSR to sign '"
+                   << job->pending_csr_path << "'" << std::endl;
+          return;
+        }
+
+        Async::SslX509& cert = job->cert;
+        cert.clear();
+        cert.setVersion(Async::SslX509::VERSION_3);
+        cert.setSubjectName(req.subjectName());
+        const Async::SslX509Extensions exts(req.extensions());
+        Async::SslX509Extensions cert_exts;
+        cert_exts.addBasicConstraints("critical, CA:FALSE");
+        cert_exts.addKeyUsage(
+            "critical, digitalSignature, keyEncipherment, keyAgreement");
+        cert_exts.addExtKeyUsage("clientAuth");
+        Async::SslX509ExtSubjectAltName san(exts.subjectAltName());
+        cert_exts.addExtension(san);
+        cert.addExtensions(cert_exts);
+        Async::SslKeypair csr_pkey(req.publicKey());
+        cert.setPublicKey(csr_pkey);
+
+        signCert(*job);
+
+        if (rename(job->pending_csr_path.c_str(),
+                   job->csr_path.c_str()) != 0)
+        {
+          char errstr[256];
+          (void)strerror_r(errno, errstr, sizeof(errstr));
+          job->log << "*** WARNING: Failed to move signed CSR from '"
+                   << job->pending_csr_path << "' to '" << job->csr_path
+                   << "': " << errstr << std::endl;
+        }
+      },
+      [this, job, cn, handler]()
+      {
+        signJobDone(*job, "CSR_SIGNED");
+
+        auto client = ReflectorClient::lookup(cn);
+        if ((client != nullptr) && !job->cert.isNull())
+        {
+          client->certificateUpdated(job->cert);
+        }
+
+        handler(job->cert);
+      });
+  if (!queued)
   {
-    std::cerr << "*** ERROR: Cannot find CSR to sign '" << req.filePath()
-              << "'" << std::endl;
-    return cert;
+    std::cerr << "*** WARNING: CA worker queue full. Could not sign CSR for "
+              << cn << std::endl;
+    Async::SslX509 null_cert(nullptr);
+    handler(null_cert);
   }
+} /* Reflector::signClientCsr */
 
-  cert.clear();
-  cert.setVersion(Async::SslX509::VERSION_3);
-  cert.setSubjectName(req.subjectName());
-  const Async::SslX509Extensions exts(req.extensions());
-  Async::SslX509Extensions cert_exts;
-  cert_exts.addBasicConstraints("critical, CA:FALSE");
-  cert_exts.addKeyUsage(
-      "critical, digitalSignature, keyEncipherment, keyAgreement");
-  cert_exts.addExtKeyUsage("clientAuth");
-  Async::SslX509ExtSubjectAltName san(exts.subjectAltName());
-  cert_exts.addExtension(san);
-  cert.addExtensions(cert_exts);
-  Async::SslKeypair csr_pkey(req.publicKey());
-  cert.setPublicKey(csr_pkey);
 
-  if (!signClientCert(cert, "CSR_SIGNED"))
+void Reflector::signCert(SignJob& job)
+{
+  Async::SslX509 ca_cert(nullptr);
+  if (!ca_cert.readPem(job.ca_cert_pem))
   {
-    cert.set(nullptr);
+    job.log << "*** ERROR: Could not parse the issuing CA certificate"
+            << std::endl;
+    return;
   }
 
-  std::string csr_path = m_csrs_dir + "/" + cn + ".csr";
-  if (rename(req.filePath().c_str(), csr_path.c_str()) != 0)
+  Async::SslX509& cert = job.cert;
+  cert.setSerialNumber();
+  cert.setIssuerName(ca_cert.subjectName());
+  cert.setValidityTime(CERT_VALIDITY_DAYS, CERT_VALIDITY_OFFSET_DAYS);
+  auto cn = cert.commonName();
+  if (!cert.sign(job.ca_pkey))
   {
-    char errstr[256];
-    (void)strerror_r(errno, errstr, sizeof(errstr));
-    std::cerr << "*** WARNING: Failed to move signed CSR from '"
-              << req.filePath() << "' to '" << csr_path << "': "
-              << errstr << std::endl;
+    job.log << "*** ERROR: Certificate signing failed for client "
+            << cn << std::endl;
+    return;
   }
+  job.signed_ok = true;
 
-  auto client = ReflectorClient::lookup(cn);
-  if ((client != nullptr) && !cert.isNull())
+  auto crtfile = job.certs_dir + "/" + cn + ".crt";
+  job.written = cert.writePemFile(crtfile) && ca_cert.appendPemFile(crtfile);
+  if (!job.written)
   {
-    client->certificateUpdated(cert);
+    job.log << "*** WARNING: Failed to write client certificate file '"
+            << crtfile << "'" << std::endl;
   }
+} /* Reflector::signCert */
 
-  return cert;
-} /* Reflector::signClientCsr */
+
+void Reflector::signJobDone(SignJob& job, const std::string& ca_op)
+{
+  if (!job.log.str().empty())
+  {
+    std::cerr << job.log.str() << std::flush;
+  }
+  if (!job.signed_ok)
+  {
+    job.cert.set(nullptr);
+    return;
+  }
+  if (job.written)
+  {
+    runCAHook({
+        { "CA_OP",      ca_op },
+        { "CA_CRT_PEM", job.cert.pem() }
+      });
+  }
+} /* Reflector::signJobDone */
 
 
 Async::SslX509 Reflector::loadClientCertificate(const std::string& callsign)
@@ -648,11 +981,15 @@ bool Reflector::callsignOk(const std::string& callsign) const
 } /* Reflector::callsignOk */
 
 
-Async::SslX509 Reflector::csrReceived(Async::SslCertSigningReq& req)
+void Reflector::csrReceived(Async::SslCertSigningReq& req,
+                            CsrHandler handler)
 {
+  Async::SslX509 null_cert(nullptr);
+
   if (req.isNull())
   {
-    return nullptr;
+    handler(null_cert, false);
+    return;
   }
 
   std::string callsign(req.commonName());
@@ -660,67 +997,153 @@ Async::SslX509 Reflector::csrReceived(Async::SslCertSigningReq& req)
   {
     std::cerr << "*** WARNING: The CSR CN (callsign) check failed"
               << std::endl;
-    return nullptr;
+    handler(null_cert, false);
+    return;
   }
 
-  std::string csr_path(m_csrs_dir + "/" + callsign + ".csr");
-  Async::SslCertSigningReq csr;
-  if (!csr.readPemFile(csr_path))
+  auto job = std::make_shared<CsrJob>(req, m_issue_ca_pkey);
+  job->csr_path = m_csrs_dir + "/" + callsign + ".csr";
+  job->crt_path = m_certs_dir + "/" + callsign + ".crt";
+  job->pending_csr_path = m_pending_csrs_dir + "/" + callsign + ".csr";
+
+  bool queued = m_ca_workers.submit(callsign,
+      [job]()
+      {
+        Async::SslCertSigningReq csr;
+        if (!csr.readPemFile(job->csr_path))
+        {
+          csr.set(nullptr);
+        }
+
+        if (!csr.isNull() && (job->req.publicKey() != csr.publicKey()))
+        {
+          job->key_mismatch = true;
+          return;
+        }
+        job->csr_current =
+          !csr.isNull() && (job->req.digest() == csr.digest());
+
+        Async::SslX509& cert = job->cert;
+        if (!cert.readPemFile(job->crt_path) || !cert.verify(job->ca_pkey) ||
+            !cert.timeIsWithinRange() ||
+            (cert.publicKey() != job->req.publicKey()))
+        {
+          cert.set(nullptr);
+        }
+
+        Async::SslCertSigningReq pending_csr;
+        if ((
+              csr.isNull() ||
+              (job->req.digest() != csr.digest()) ||
+              cert.isNull()
+            ) && (
+              !pending_csr.readPemFile(job->pending_csr_path) ||
+              (job->req.digest() != pending_csr.digest())
+            ))
+        {
+          job->pending_added = true;
+          if (job->req.writePemFile(job->pending_csr_path))
+          {
+            job->ca_op = pending_csr.isNull() ?
+              "PENDING_CSR_CREATE" : "PENDING_CSR_UPDATE";
+          }
+        }
+      },
+      [this, job, callsign, handler]()
+      {
+        if (job->key_mismatch)
+        {
+          std::cerr << "*** WARNING: The received CSR with callsign '"
+                    << callsign << "' has a different public key "
+                       "than the current CSR. That may be a sign of someone "
+                       "trying to hijack a callsign or the owner of the "
+                       "callsign has generated a new private/public key "
+                       "pair." << std::endl;
+          Async::SslX509 null_cert(nullptr);
+          handler(null_cert, false);
+          return;
+        }
+
+        if (job->pending_added)
+        {
+          std::cout << callsign << ": Add pending CSR '"
+                    << job->pending_csr_path << "' to CA" << std::endl;
+          if (!job->ca_op.empty())
+          {
+            runCAHook({
+                { "CA_OP",      job->ca_op },
+                { "CA_CSR_PEM", job->req.pem() }
+              });
+          }
+          else
+          {
+            std::cerr << "*** WARNING: Could not write CSR file '"
+                      << job->pending_csr_path << "'" << std::endl;
+          }
+        }
+
+        handler(job->cert, job->csr_current);
+      });
+  if (!queued)
   {
-    csr.set(nullptr);
+    std::cerr << "*** WARNING: CA worker queue full. Could not process "
+                 "CSR from " << callsign << std::endl;
+    handler(null_cert, false);
   }
+} /* Reflector::csrReceived */
+
 
-  if (!csr.isNull() && (req.publicKey() != csr.publicKey()))
+void Reflector::statusUpdated(ReflectorClient* client)
+{
+  if (client->conState() != ReflectorClient::STATE_CONNECTED)
   {
-    std::cerr << "*** WARNING: The received CSR with callsign '"
-              << callsign << "' has a different public key "
-                 "than the current CSR. That may be a sign of someone "
-                 "trying to hijack a callsign or the owner of the "
-                 "callsign has generated a new private/public key pair."
-              << std::endl;
-    return nullptr;
+    return;
+  }
+  m_status_dirty.insert(client);
+  m_status_version += 1;
+  if (!m_trunks.empty())
+  {
+    m_trunk_interest_timer.setEnable(true);
   }
+  if (!m_status_streams.empty())
+  {
+    m_status_stream_timer.setEnable(true);
+  }
+} /* Reflector::statusUpdated */
 
-  std::string crtfile(m_certs_dir + "/" + callsign + ".crt");
-  Async::SslX509 cert;
-  if (!cert.readPemFile(crtfile) || !cert.verify(m_issue_ca_pkey) ||
-      !cert.timeIsWithinRange() || (cert.publicKey() != req.publicKey()))
-  {
-    cert.set(nullptr);
-  }
-
-  const std::string pending_csr_path(
-      m_pending_csrs_dir + "/" + callsign + ".csr");
-  Async::SslCertSigningReq pending_csr;
-  if ((
-        csr.isNull() ||
-        (req.digest() != csr.digest()) ||
-        cert.isNull()
-      ) && (
-        !pending_csr.readPemFile(pending_csr_path) ||
-        (req.digest() != pending_csr.digest())
-      ))
-  {
-    std::cout << callsign << ": Add pending CSR '" << pending_csr_path
-              << "' to CA" << std::endl;
-    if (req.writePemFile(pending_csr_path))
-    {
-      const auto ca_op =
-        pending_csr.isNull() ? "PENDING_CSR_CREATE" : "PENDING_CSR_UPDATE";
-      runCAHook({
-          { "CA_OP",      ca_op },
-          { "CA_CSR_PEM", req.pem() }
-        });
-    }
-    else
-    {
-      std::cerr << "*** WARNING: Could not write CSR file '"
-                << pending_csr_path << "'" << std::endl;
-    }
+
+void Reflector::udpCipherKeyUpdated(ReflectorClient* client)
+{
+  if (m_udp_rx != nullptr)
+  {
+    m_udp_rx->setClientKey(client->clientId(), client->udpCipherIVRand(),
+                           client->udpCipherKey());
   }
+} /* Reflector::udpCipherKeyUpdated */
 
-  return cert;
-} /* Reflector::csrReceived */
+
+void Reflector::announceNode(ReflectorClient* client, bool joined)
+{
+  const std::string& callsign = client->callsign();
+  if (callsign.empty())
+  {
+    return;
+  }
+
+  auto filter = ReflectorClient::mkAndFilter(
+      ReflectorClient::ExceptFilter(client), no_node_delta_client_filter);
+  if (joined)
+  {
+    broadcastMsg(MsgNodeJoined(callsign), filter);
+  }
+  else
+  {
+    broadcastMsg(MsgNodeLeft(callsign), filter);
+  }
+
+  m_node_events[callsign] = joined;
+  m_node_event_timer.setEnable(true);
+} /* Reflector::announceNode */
 
 
 /****************************************************************************
@@ -768,12 +1191,28 @@ void Reflector::clientDisconnected(Async::FramedTcpConnection *con,
        << endl;
 
   m_client_con_map.erase(it);
+  if (m_udp_rx != nullptr)
+  {
+    m_udp_rx->removeClient(client->clientId());
+  }
+  if (!m_trunks.empty())
+  {
+    m_trunk_interest_timer.setEnable(true);
+  }
 
-  if (!client->callsign().empty())
+  m_status_dirty.erase(client);
+  if (!client->callsign().empty() &&
+      (m_status_nodes.erase(client->callsign()) > 0))
   {
-    broadcastMsg(MsgNodeLeft(client->callsign()),
-        ReflectorClient::ExceptFilter(client));
+    m_status_version += 1;
+    if (!m_status_streams.empty())
+    {
+      m_status_stream_changed.insert(client->callsign());
+      m_status_stream_timer.setEnable(true);
+    }
   }
+
+  announceNode(client, false);
   Application::app().runTask([=]{ delete client; });
 } /* Reflector::clientDisconnected */
 
@@ -847,7 +1286,7 @@ bool Reflector::udpCipherDataReceived(const IpAddress& addr, uint16_t port,
   }
   else
   {
-    udpDatagramReceived(addr, port, nullptr, buf, count);
+    udpDatagramReceived(addr, port, nullptr, 0, buf, count);
     return true;
   }
 
@@ -856,7 +1295,8 @@ bool Reflector::udpCipherDataReceived(const IpAddress& addr, uint16_t port,
 
 
 void Reflector::udpDatagramReceived(const IpAddress& addr, uint16_t port,
-                                    void* aadptr, void *buf, int count)
+                                    void* aadptr, size_t aadlen,
+                                    void *buf, int count)
 {
   //std::cout << "### Reflector::udpDatagramReceived:"
   //          << " addr=" << addr
@@ -864,7 +1304,7 @@ void Reflector::udpDatagramReceived(const IpAddress& addr, uint16_t port,
   //          << " count=" << count
   //          << std::endl;
 
-  assert(m_udp_sock->cipherAADLength() >= UdpCipher::AADLEN);
+  assert((aadptr == nullptr) || (aadlen >= UdpCipher::AADLEN));
 
   stringstream ss;
   ss.write(reinterpret_cast<const char *>(buf), static_cast<size_t>(count));
@@ -886,8 +1326,7 @@ void Reflector::udpDatagramReceived(const IpAddress& addr, uint16_t port,
     //          << m_aad.iv_cntr << std::endl;
 
     stringstream aadss;
-    aadss.write(reinterpret_cast<const char *>(aadptr),
-        m_udp_sock->cipherAADLength());
+    aadss.write(reinterpret_cast<const char *>(aadptr), aadlen);
 
     if (!aad.unpack(aadss))
     {
@@ -987,11 +1426,16 @@ void Reflector::udpDatagramReceived(const IpAddress& addr, uint16_t port,
     return;
   }
 
+  auto& tg_metrics = client->tgMetrics();
+  tg_metrics.rx_packets.inc();
+  tg_metrics.rx_bytes.inc(count);
+
     // Check sequence number
   if (client->protoVer() >= ProtoVer(3, 0))
   {
     if (aad.iv_cntr < client->nextUdpRxSeq()) // Frame out of sequence (ignore)
     {
+      m_metrics.udp_out_of_seq.inc();
       std::cout << client->callsign()
                 << ": Dropping out of sequence UDP frame with seq="
                 << aad.iv_cntr << std::endl;
@@ -999,6 +1443,8 @@ void Reflector::udpDatagramReceived(const IpAddress& addr, uint16_t port,
     }
     else if (aad.iv_cntr > client->nextUdpRxSeq()) // Frame lost
     {
+      m_metrics.udp_seq_gaps.inc();
+      m_metrics.udp_lost_frames.inc(aad.iv_cntr - client->nextUdpRxSeq());
       std::cout << client->callsign() << ": UDP frame(s) lost. Expected seq="
                 << client->nextUdpRxSeq()
                 << " but received " << aad.iv_cntr
@@ -1013,6 +1459,7 @@ void Reflector::udpDatagramReceived(const IpAddress& addr, uint16_t port,
     uint16_t udp_rx_seq_diff = header_v2.sequenceNum() - next_udp_rx_seq;
     if (udp_rx_seq_diff > 0x7fff) // Frame out of sequence (ignore)
     {
+      m_metrics.udp_out_of_seq.inc();
       std::cout << client->callsign()
                 << ": Dropping out of sequence frame with seq="
                 << header_v2.sequenceNum() << ". Expected seq="
@@ -1021,6 +1468,8 @@ void Reflector::udpDatagramReceived(const IpAddress& addr, uint16_t port,
     }
     else if (udp_rx_seq_diff > 0) // Frame(s) lost
     {
+      m_metrics.udp_seq_gaps.inc();
+      m_metrics.udp_lost_frames.inc(udp_rx_seq_diff);
       cout << client->callsign()
            << ": UDP frame(s) lost. Expected seq=" << next_udp_rx_seq
            << ". Received seq=" << header_v2.sequenceNum() << endl;
@@ -1052,7 +1501,8 @@ void Reflector::udpDatagramReceived(const IpAddress& addr, uint16_t port,
         if (!msg.audioData().empty() && (tg > 0))
         {
           ReflectorClient* talker = TGHandler::instance()->talkerForTG(tg);
-          if (talker == 0)
+          if ((talker == 0) &&
+              (m_trunk_talkers.find(tg) == m_trunk_talkers.end()))
           {
             TGHandler::instance()->setTalkerForTG(tg, client);
             talker = TGHandler::instance()->talkerForTG(tg);
@@ -1064,6 +1514,10 @@ void Reflector::udpDatagramReceived(const IpAddress& addr, uint16_t port,
                 ReflectorClient::mkAndFilter(
                   ReflectorClient::ExceptFilter(client),
                   ReflectorClient::TgFilter(tg)));
+            for (auto trunk : m_trunks)
+            {
+              trunk->sendAudio(tg, msg.audioData());
+            }
             //broadcastUdpMsgExcept(tg, client, msg,
             //    ProtoVerRange(ProtoVer(0, 6),
             //                  ProtoVer(1, ProtoVer::max().minor())));
@@ -1159,6 +1613,7 @@ void Reflector::udpDatagramReceived(const IpAddress& addr, uint16_t port,
           client->setRxSqlOpen(rx.id(), rx.sqlOpen());
           client->setRxActive(rx.id(), rx.active());
         }
+        statusUpdated(client);
       }
       break;
     }
@@ -1178,157 +1633,473 @@ void Reflector::udpDatagramReceived(const IpAddress& addr, uint16_t port,
 void Reflector::onTalkerUpdated(uint32_t tg, ReflectorClient* old_talker,
                                 ReflectorClient *new_talker)
 {
+  const auto now = ReflectorMetrics::Clock::now();
+  auto talker_start_it = m_talker_start.find(tg);
+  if (talker_start_it != m_talker_start.end())
+  {
+    m_metrics.talker_duration.observe(now - talker_start_it->second);
+    m_talker_start.erase(talker_start_it);
+  }
+
   if (old_talker != 0)
   {
     cout << old_talker->callsign() << ": Talker stop on TG #" << tg << endl;
-    broadcastMsg(MsgTalkerStop(tg, old_talker->callsign()),
-        ReflectorClient::mkAndFilter(
-          ge_v2_client_filter,
-          ReflectorClient::mkOrFilter(
-            ReflectorClient::TgFilter(tg),
-            ReflectorClient::TgMonitorFilter(tg))));
-    if (tg == tgForV1Clients())
+    announceTalkerStop(tg, old_talker->callsign(), old_talker);
+    for (auto trunk : m_trunks)
     {
-      broadcastMsg(MsgTalkerStopV1(old_talker->callsign()), v1_client_filter);
+      trunk->sendTalkerStop(tg, old_talker->callsign());
     }
-    broadcastUdpMsg(MsgUdpFlushSamples(),
-          ReflectorClient::mkAndFilter(
-            ReflectorClient::TgFilter(tg),
-            ReflectorClient::ExceptFilter(old_talker)));
+    statusUpdated(old_talker);
   }
   if (new_talker != 0)
   {
+    m_talker_start[tg] = now;
     cout << new_talker->callsign() << ": Talker start on TG #" << tg << endl;
-    broadcastMsg(MsgTalkerStart(tg, new_talker->callsign()),
-        ReflectorClient::mkAndFilter(
-          ge_v2_client_filter,
-          ReflectorClient::mkOrFilter(
-            ReflectorClient::TgFilter(tg),
-            ReflectorClient::TgMonitorFilter(tg))));
-    if (tg == tgForV1Clients())
+    announceTalkerStart(tg, new_talker->callsign());
+    for (auto trunk : m_trunks)
     {
-      broadcastMsg(MsgTalkerStartV1(new_talker->callsign()), v1_client_filter);
+      trunk->sendTalkerStart(tg, new_talker->callsign());
     }
+    statusUpdated(new_talker);
   }
 } /* Reflector::setTalker */
 
 
-void Reflector::httpRequestReceived(Async::HttpServerConnection *con,
-                                    Async::HttpServerConnection::Request& req)
+void Reflector::announceTalkerStart(uint32_t tg, const std::string& callsign)
 {
-  //std::cout << "### " << req.method << " " << req.target << std::endl;
-
-  Async::HttpServerConnection::Response res;
-  if ((req.method != "GET") && (req.method != "HEAD"))
+  broadcastMsg(MsgTalkerStart(tg, callsign),
+      ReflectorClient::mkAndFilter(
+        ge_v2_client_filter,
+        ReflectorClient::mkOrFilter(
+          ReflectorClient::TgFilter(tg),
+          ReflectorClient::TgMonitorFilter(tg))));
+  if (tg == tgForV1Clients())
   {
-    res.setCode(501);
-    res.setContent("application/json",
-        "{\"msg\":\"" + req.method + ": Method not implemented\"}");
-    con->write(res);
-    return;
+    broadcastMsg(MsgTalkerStartV1(callsign), v1_client_filter);
   }
+} /* Reflector::announceTalkerStart */
 
-  if (req.target != "/status")
+
+void Reflector::announceTalkerStop(uint32_t tg, const std::string& callsign,
+                                   ReflectorClient* except)
+{
+  broadcastMsg(MsgTalkerStop(tg, callsign),
+      ReflectorClient::mkAndFilter(
+        ge_v2_client_filter,
+        ReflectorClient::mkOrFilter(
+          ReflectorClient::TgFilter(tg),
+          ReflectorClient::TgMonitorFilter(tg))));
+  if (tg == tgForV1Clients())
+  {
+    broadcastMsg(MsgTalkerStopV1(callsign), v1_client_filter);
+  }
+  broadcastUdpMsg(MsgUdpFlushSamples(),
+        ReflectorClient::mkAndFilter(
+          ReflectorClient::TgFilter(tg),
+          ReflectorClient::ExceptFilter(except)));
+} /* Reflector::announceTalkerStop */
+
+
+int Reflector::inheritedSocket(const std::string& name,
+                               const std::string& port_str)
+{
+  if (m_handoff == nullptr)
+  {
+    return -1;
+  }
+  std::istringstream is(port_str);
+  uint16_t port = 0;
+  if (!(is >> port))
+  {
+    return -1;
+  }
+  return m_handoff->takeSocket(name, port);
+} /* Reflector::inheritedSocket */
+
+
+void Reflector::onHandoffRequested(void)
+{
+    // The new process cannot create the command PTY symlink while we hold it
+  if (m_cmd_pty != nullptr)
+  {
+    m_cmd_pty->close();
+  }
+
+    // Leave new connections and datagrams on the shared sockets for the new
+    // process to pick up
+  setServerSocketsEnabled(false);
+} /* Reflector::onHandoffRequested */
+
+
+void Reflector::onHandoffAborted(void)
+{
+  setServerSocketsEnabled(true);
+  if ((m_cmd_pty != nullptr) && !m_cmd_pty->open())
+  {
+    std::cerr << "*** WARNING: Could not reopen the command PTY after an "
+                 "aborted handoff" << std::endl;
+  }
+} /* Reflector::onHandoffAborted */
+
+
+void Reflector::setServerSocketsEnabled(bool enabled)
+{
+  m_srv->setAcceptEnabled(enabled);
+  m_udp_sock->setReceiveEnabled(enabled);
+  if (m_udp_rx != nullptr)
+  {
+    m_udp_rx->setPaused(!enabled);
+  }
+  if (m_http_server != nullptr)
+  {
+    m_http_server->setAcceptEnabled(enabled);
+  }
+  if (m_trunk_srv != nullptr)
+  {
+    m_trunk_srv->setAcceptEnabled(enabled);
+  }
+} /* Reflector::setServerSocketsEnabled */
+
+
+void Reflector::onHandedOver(void)
+{
+  std::cout << "Sockets handed over to the new reflector process. Exiting."
+            << std::endl;
+  Application::app().quit();
+} /* Reflector::onHandedOver */
+
+
+bool Reflector::initTrunks(void)
+{
+  std::vector<std::string> trunk_sections;
+  m_cfg->getValue("GLOBAL", "TRUNKS", trunk_sections);
+  if (trunk_sections.empty())
+  {
+    return true;
+  }
+
+  if (!m_cfg->getValue("GLOBAL", "TRUNK_ID", m_trunk_id) ||
+      m_trunk_id.empty())
+  {
+    std::cerr << "*** ERROR: GLOBAL/TRUNK_ID must be set when using trunks"
+              << std::endl;
+    return false;
+  }
+
+  for (const auto& section : trunk_sections)
+  {
+    auto trunk = new ReflectorTrunk(*m_cfg, section, m_trunk_id);
+    m_trunks.push_back(trunk);
+    if (!trunk->initialize())
+    {
+      return false;
+    }
+    for (auto other : m_trunks)
+    {
+      if ((other != trunk) && (other->peerId() == trunk->peerId()))
+      {
+        std::cerr << "*** ERROR: Trunks " << other->name() << " and "
+                  << trunk->name() << " have the same PEER_ID" << std::endl;
+        return false;
+      }
+    }
+    trunk->linkUp.connect(mem_fun(*this, &Reflector::onTrunkLinkUp));
+    trunk->linkDown.connect(mem_fun(*this, &Reflector::onTrunkLinkDown));
+    trunk->talkerStartReceived.connect(
+        mem_fun(*this, &Reflector::onTrunkTalkerStart));
+    trunk->talkerStopReceived.connect(
+        mem_fun(*this, &Reflector::onTrunkTalkerStop));
+    trunk->audioReceived.connect(
+        mem_fun(*this, &Reflector::onTrunkAudioReceived));
+  }
+
+  std::string trunk_port("5302");
+  m_cfg->getValue("GLOBAL", "TRUNK_LISTEN_PORT", trunk_port);
+  int trunk_sock = inheritedSocket("trunk", trunk_port);
+  if (trunk_sock >= 0)
+  {
+    m_trunk_srv = new FramedTcpServer(trunk_sock);
+  }
+  else
+  {
+    m_trunk_srv = new FramedTcpServer(trunk_port);
+  }
+  m_trunk_srv->setSslContext(m_ssl_ctx);
+  m_trunk_srv->clientConnected.connect(
+      mem_fun(*this, &Reflector::trunkClientConnected));
+  m_trunk_srv->clientDisconnected.connect(
+      mem_fun(*this, &Reflector::trunkClientDisconnected));
+
+  return true;
+} /* Reflector::initTrunks */
+
+
+void Reflector::trunkClientConnected(Async::FramedTcpConnection *con)
+{
+  std::cout << "Incoming trunk connection from " << con->remoteHost() << ":"
+            << con->remotePort() << std::endl;
+  con->setMaxFrameSize(ReflectorMsg::MAX_SSL_SETUP_FRAME_SIZE);
+  con->frameReceived.connect(
+      mem_fun(*this, &Reflector::trunkFrameReceived));
+  m_trunk_con_map[con] = nullptr;
+    // Trunk connections use TLS from the start. The first frame, the
+    // MsgTrunkHello, will arrive when the TLS session has been established.
+  con->enableSsl(true);
+} /* Reflector::trunkClientConnected */
+
+
+void Reflector::trunkClientDisconnected(Async::FramedTcpConnection *con,
+    Async::FramedTcpConnection::DisconnectReason reason)
+{
+  auto it = m_trunk_con_map.find(con);
+  assert(it != m_trunk_con_map.end());
+  ReflectorTrunk* trunk = it->second;
+  m_trunk_con_map.erase(it);
+  if (trunk != nullptr)
+  {
+    trunk->connectionClosed(con);
+  }
+} /* Reflector::trunkClientDisconnected */
+
+
+void Reflector::trunkFrameReceived(Async::FramedTcpConnection *con,
+                                   std::vector<uint8_t>& data)
+{
+  auto con_it = m_trunk_con_map.find(con);
+  if (con_it == m_trunk_con_map.end())
   {
-    res.setCode(404);
-    res.setContent("application/json",
-        "{\"msg\":\"Not found!\"}");
-    con->write(res);
     return;
   }
+  if (con_it->second != nullptr)
+  {
+    con_it->second->handleFrame(con, data);
+    return;
+  }
+
+    // The first frame on a new trunk connection identify the peer
 
-  Json::Value status;
-  status["nodes"] = Json::Value(Json::objectValue);
+  stringstream ss;
+  ss.write(reinterpret_cast<const char*>(data.data()), data.size());
+  ReflectorMsg header;
+  MsgTrunkHello hello;
+  if (!header.unpack(ss) || (header.type() != MsgTrunkHello::TYPE) ||
+      !hello.unpack(ss))
+  {
+    std::cerr << "*** WARNING: Expected MsgTrunkHello on trunk connection "
+                 "from " << con->remoteHost() << ":" << con->remotePort()
+              << std::endl;
+    closeTrunkConnection(con);
+    return;
+  }
+
+  auto trunk_it = std::find_if(m_trunks.begin(), m_trunks.end(),
+      [&](ReflectorTrunk* trunk) { return trunk->peerId() == hello.id(); });
+  if (trunk_it == m_trunks.end())
+  {
+    std::cerr << "*** WARNING: Unknown peer \"" << hello.id()
+              << "\" on trunk connection from " << con->remoteHost() << ":"
+              << con->remotePort() << std::endl;
+    closeTrunkConnection(con);
+    return;
+  }
+  con_it->second = *trunk_it;
+  if (!(*trunk_it)->acceptConnection(con, hello))
+  {
+    con_it->second = nullptr;
+    closeTrunkConnection(con);
+  }
+} /* Reflector::trunkFrameReceived */
+
+
+void Reflector::closeTrunkConnection(Async::FramedTcpConnection *con)
+{
+  con->disconnect();
+  con->disconnected(con, FramedTcpConnection::DR_ORDERED_DISCONNECT);
+} /* Reflector::closeTrunkConnection */
+
+
+void Reflector::onTrunkLinkUp(ReflectorTrunk* trunk)
+{
+    // Tell the peer about the talkers that are already active here
   for (const auto& item : m_client_con_map)
   {
     ReflectorClient* client = item.second;
-    if (client->conState() != ReflectorClient::STATE_CONNECTED)
+    uint32_t tg = TGHandler::instance()->TGForClient(client);
+    if ((tg > 0) && (TGHandler::instance()->talkerForTG(tg) == client))
     {
-      continue;
+      trunk->sendTalkerStart(tg, client->callsign());
     }
+  }
+} /* Reflector::onTrunkLinkUp */
+
 
-    Json::Value node(client->nodeInfo());
-    //node["addr"] = client->remoteHost().toString();
-    node["protoVer"]["majorVer"] = client->protoVer().majorVer();
-    node["protoVer"]["minorVer"] = client->protoVer().minorVer();
-    auto tg = client->currentTG();
-    if (!TGHandler::instance()->showActivity(tg))
+void Reflector::onTrunkLinkDown(ReflectorTrunk* trunk)
+{
+  auto it = m_trunk_talkers.begin();
+  while (it != m_trunk_talkers.end())
+  {
+    if (it->second.trunk == trunk)
     {
-      tg = 0;
+      cout << it->second.callsign << ": Talker stop on TG #" << it->first
+           << " since trunk " << trunk->name() << " went down" << endl;
+      announceTalkerStop(it->first, it->second.callsign, nullptr);
+      it = m_trunk_talkers.erase(it);
     }
-    node["tg"] = tg;
-    node["restrictedTG"] = TGHandler::instance()->isRestricted(tg);
-    Json::Value tgs = Json::Value(Json::arrayValue);
-    const std::set<uint32_t>& monitored_tgs = client->monitoredTGs();
-    for (std::set<uint32_t>::const_iterator mtg_it=monitored_tgs.begin();
-         mtg_it!=monitored_tgs.end(); ++mtg_it)
+    else
     {
-      tgs.append(*mtg_it);
+      ++it;
     }
-    node["monitoredTGs"] = tgs;
-    bool is_talker = TGHandler::instance()->talkerForTG(tg) == client;
-    node["isTalker"] = is_talker;
+  }
+} /* Reflector::onTrunkLinkDown */
+
 
-    if (node.isMember("qth") && node["qth"].isArray())
+void Reflector::onTrunkTalkerStart(ReflectorTrunk* trunk, uint32_t tg,
+                                   const std::string& callsign)
+{
+    // If a talker claim the same talk group on more than one reflector at
+    // the same time, the reflector with the lowest trunk ID win. Since all
+    // reflectors apply the same rule, the cluster agree on the talker.
+  ReflectorClient* local_talker = TGHandler::instance()->talkerForTG(tg);
+  if (local_talker != 0)
+  {
+    if (m_trunk_id < trunk->peerId())
     {
-      //std::cout << "### Found qth" << std::endl;
-      Json::Value& qths(node["qth"]);
-      for (Json::Value::ArrayIndex i=0; i<qths.size(); ++i)
-      {
-        Json::Value& qth(qths[i]);
-        if (qth.isMember("rx") && qth["rx"].isObject())
-        {
-          //std::cout << "### Found rx" << std::endl;
-          Json::Value::Members rxs(qth["rx"].getMemberNames());
-          for (Json::Value::Members::const_iterator it=rxs.begin(); it!=rxs.end(); ++it)
-          {
-            //std::cout << "### member=" << *it << std::endl;
-            const std::string& rx_id_str(*it);
-            if (rx_id_str.size() == 1)
-            {
-              char rx_id(rx_id_str[0]);
-              Json::Value& rx(qth["rx"][rx_id_str]);
-              if (client->rxExist(rx_id))
-              {
-                rx["siglev"] = client->rxSiglev(rx_id);
-                rx["enabled"] = client->rxEnabled(rx_id);
-                rx["sql_open"] = client->rxSqlOpen(rx_id);
-                rx["active"] = client->rxActive(rx_id);
-              }
-            }
-          }
-        }
-        if (qth.isMember("tx") && qth["tx"].isObject())
-        {
-          //std::cout << "### Found tx" << std::endl;
-          Json::Value::Members txs(qth["tx"].getMemberNames());
-          for (Json::Value::Members::const_iterator it=txs.begin(); it!=txs.end(); ++it)
-          {
-            //std::cout << "### member=" << *it << std::endl;
-            const std::string& tx_id_str(*it);
-            if (tx_id_str.size() == 1)
-            {
-              char tx_id(tx_id_str[0]);
-              Json::Value& tx(qth["tx"][tx_id_str]);
-              if (client->txExist(tx_id))
-              {
-                tx["transmit"] = client->txTransmit(tx_id);
-              }
-            }
-          }
-        }
-      }
+      return;
     }
-    status["nodes"][client->callsign()] = node;
+    cout << local_talker->callsign() << ": Talker on TG #" << tg
+         << " preempted by " << callsign << " on trunk " << trunk->name()
+         << endl;
+    TGHandler::instance()->setTalkerForTG(tg, 0);
   }
-  std::ostringstream os;
-  Json::StreamWriterBuilder builder;
-  builder["commentStyle"] = "None";
-  builder["indentation"] = ""; //The JSON document is written on a single line
-  Json::StreamWriter* writer = builder.newStreamWriter();
-  writer->write(status, &os);
-  delete writer;
-  res.setContent("application/json", os.str());
+
+  auto it = m_trunk_talkers.find(tg);
+  if (it != m_trunk_talkers.end())
+  {
+    if ((it->second.trunk == trunk) && (it->second.callsign == callsign))
+    {
+      return;
+    }
+    if ((it->second.trunk != trunk) &&
+        (it->second.trunk->peerId() < trunk->peerId()))
+    {
+      return;
+    }
+    announceTalkerStop(tg, it->second.callsign, nullptr);
+  }
+
+  m_trunk_talkers[tg] = {trunk, callsign};
+  cout << callsign << ": Talker start on TG #" << tg << " via trunk "
+       << trunk->name() << endl;
+  announceTalkerStart(tg, callsign);
+} /* Reflector::onTrunkTalkerStart */
+
+
+void Reflector::onTrunkTalkerStop(ReflectorTrunk* trunk, uint32_t tg,
+                                  const std::string& callsign)
+{
+  auto it = m_trunk_talkers.find(tg);
+  if ((it == m_trunk_talkers.end()) || (it->second.trunk != trunk) ||
+      (it->second.callsign != callsign))
+  {
+    return;
+  }
+  m_trunk_talkers.erase(it);
+  cout << callsign << ": Talker stop on TG #" << tg << " via trunk "
+       << trunk->name() << endl;
+  announceTalkerStop(tg, callsign, nullptr);
+} /* Reflector::onTrunkTalkerStop */
+
+
+void Reflector::onTrunkAudioReceived(ReflectorTrunk* trunk, uint32_t tg,
+                                     const std::vector<uint8_t>& audio)
+{
+  auto it = m_trunk_talkers.find(tg);
+  if ((it == m_trunk_talkers.end()) || (it->second.trunk != trunk) ||
+      (TGHandler::instance()->talkerForTG(tg) != 0))
+  {
+    return;
+  }
+    // Audio received on a trunk is never forwarded to other trunks. With a
+    // full mesh of trunks each frame then cross each trunk at most once.
+  broadcastUdpMsg(MsgUdpAudio(audio), ReflectorClient::TgFilter(tg));
+} /* Reflector::onTrunkAudioReceived */
+
+
+void Reflector::updateTrunkInterest(Async::Timer *t)
+{
+  t->setEnable(false);
+    // Only selected talk groups count. Nodes that just monitor a talk group
+    // get talker start/stop, which always cross the trunk, but no audio.
+  std::set<uint32_t> tgs;
+  for (const auto& item : m_client_con_map)
+  {
+    uint32_t tg = TGHandler::instance()->TGForClient(item.second);
+    if (tg > 0)
+    {
+      tgs.insert(tg);
+    }
+  }
+  for (auto trunk : m_trunks)
+  {
+    trunk->setLocalInterest(tgs);
+  }
+} /* Reflector::updateTrunkInterest */
+
+
+void Reflector::httpRequestReceived(Async::HttpServerConnection *con,
+                                    Async::HttpServerConnection::Request& req)
+{
+  //std::cout << "### " << req.method << " " << req.target << std::endl;
+
+  Async::HttpServerConnection::Response res;
+  if ((req.method != "GET") && (req.method != "HEAD"))
+  {
+    res.setCode(501);
+    res.setContent("application/json",
+        "{\"msg\":\"" + req.method + ": Method not implemented\"}");
+    con->write(res);
+    return;
+  }
+
+  if (req.target == "/status/stream")
+  {
+    startStatusStream(con, req.method != "HEAD");
+    return;
+  }
+
+  if (req.target == "/metrics")
+  {
+    res.setHeader("Cache-Control", "no-cache");
+    res.setContent("text/plain; version=0.0.4; charset=utf-8", metricsBody());
+    if (req.method == "HEAD")
+    {
+      res.setSendContent(false);
+    }
+    res.setCode(200);
+    con->write(res);
+    return;
+  }
+
+  if (req.target != "/status")
+  {
+    res.setCode(404);
+    res.setContent("application/json",
+        "{\"msg\":\"Not found!\"}");
+    con->write(res);
+    return;
+  }
+
+  const std::string& body = statusBody();
+  res.setHeader("ETag", m_status_etag);
+  res.setHeader("Cache-Control", "no-cache");
+  const std::string* if_none_match = findHeader(req.headers, "If-None-Match");
+  if ((if_none_match != nullptr) && (*if_none_match == m_status_etag))
+  {
+    res.setCode(304);
+    con->write(res);
+    return;
+  }
+  res.setContent("application/json", body);
   if (req.method == "HEAD")
   {
     res.setSendContent(false);
@@ -1353,9 +2124,341 @@ void Reflector::httpClientDisconnected(Async::HttpServerConnection *con,
   //          << con->remoteHost() << ":" << con->remotePort()
   //          << ": " << Async::HttpServerConnection::disconnectReasonStr(reason)
   //          << std::endl;
+  m_status_streams.erase(con);
+  if (m_status_streams.empty())
+  {
+    m_status_stream_changed.clear();
+    m_status_stream_timer.setEnable(false);
+  }
 } /* Reflector::httpClientDisconnected */
 
 
+Json::Value Reflector::clientStatus(ReflectorClient* client)
+{
+  Json::Value node(client->nodeInfo());
+  //node["addr"] = client->remoteHost().toString();
+  node["protoVer"]["majorVer"] = client->protoVer().majorVer();
+  node["protoVer"]["minorVer"] = client->protoVer().minorVer();
+  auto tg = client->currentTG();
+  if (!TGHandler::instance()->showActivity(tg))
+  {
+    tg = 0;
+  }
+  node["tg"] = tg;
+  node["restrictedTG"] = TGHandler::instance()->isRestricted(tg);
+  Json::Value tgs = Json::Value(Json::arrayValue);
+  const std::set<uint32_t>& monitored_tgs = client->monitoredTGs();
+  for (std::set<uint32_t>::const_iterator mtg_it=monitored_tgs.begin();
+       mtg_it!=monitored_tgs.end(); ++mtg_it)
+  {
+    tgs.append(*mtg_it);
+  }
+  node["monitoredTGs"] = tgs;
+  bool is_talker = TGHandler::instance()->talkerForTG(tg) == client;
+  node["isTalker"] = is_talker;
+
+  if (node.isMember("qth") && node["qth"].isArray())
+  {
+    //std::cout << "### Found qth" << std::endl;
+    Json::Value& qths(node["qth"]);
+    for (Json::Value::ArrayIndex i=0; i<qths.size(); ++i)
+    {
+      Json::Value& qth(qths[i]);
+      if (qth.isMember("rx") && qth["rx"].isObject())
+      {
+        //std::cout << "### Found rx" << std::endl;
+        Json::Value::Members rxs(qth["rx"].getMemberNames());
+        for (Json::Value::Members::const_iterator it=rxs.begin(); it!=rxs.end(); ++it)
+        {
+          //std::cout << "### member=" << *it << std::endl;
+          const std::string& rx_id_str(*it);
+          if (rx_id_str.size() == 1)
+          {
+            char rx_id(rx_id_str[0]);
+            Json::Value& rx(qth["rx"][rx_id_str]);
+            if (client->rxExist(rx_id))
+            {
+              rx["siglev"] = client->rxSiglev(rx_id);
+              rx["enabled"] = client->rxEnabled(rx_id);
+              rx["sql_open"] = client->rxSqlOpen(rx_id);
+              rx["active"] = client->rxActive(rx_id);
+            }
+          }
+        }
+      }
+      if (qth.isMember("tx") && qth["tx"].isObject())
+      {
+        //std::cout << "### Found tx" << std::endl;
+        Json::Value::Members txs(qth["tx"].getMemberNames());
+        for (Json::Value::Members::const_iterator it=txs.begin(); it!=txs.end(); ++it)
+        {
+          //std::cout << "### member=" << *it << std::endl;
+          const std::string& tx_id_str(*it);
+          if (tx_id_str.size() == 1)
+          {
+            char tx_id(tx_id_str[0]);
+            Json::Value& tx(qth["tx"][tx_id_str]);
+            if (client->txExist(tx_id))
+            {
+              tx["transmit"] = client->txTransmit(tx_id);
+            }
+          }
+        }
+      }
+    }
+  }
+  return node;
+} /* Reflector::clientStatus */
+
+
+void Reflector::updateStatusNodes(void)
+{
+  for (const auto& client : m_status_dirty)
+  {
+    if (client->conState() == ReflectorClient::STATE_CONNECTED)
+    {
+      m_status_nodes[client->callsign()] = jsonString(clientStatus(client));
+    }
+    else
+    {
+      m_status_nodes.erase(client->callsign());
+    }
+    if (!m_status_streams.empty())
+    {
+      m_status_stream_changed.insert(client->callsign());
+    }
+  }
+  m_status_dirty.clear();
+} /* Reflector::updateStatusNodes */
+
+
+const std::string& Reflector::statusBody(void)
+{
+  if (m_status_body.empty() || (m_status_body_version != m_status_version))
+  {
+    updateStatusNodes();
+
+      // The document is assembled from the cached per node JSON objects so
+      // only nodes that have changed since the last request need to be
+      // serialized again.
+    m_status_body = "{\"nodes\":{";
+    for (auto it = m_status_nodes.begin(); it != m_status_nodes.end(); ++it)
+    {
+      if (it != m_status_nodes.begin())
+      {
+        m_status_body += ",";
+      }
+      m_status_body += jsonString(it->first);
+      m_status_body += ":";
+      m_status_body += it->second;
+    }
+    m_status_body += "}}";
+    m_status_body_version = m_status_version;
+
+    std::ostringstream etag_ss;
+    etag_ss << "\"" << m_status_etag_prefix << "-" << m_status_version << "\"";
+    m_status_etag = etag_ss.str();
+  }
+  return m_status_body;
+} /* Reflector::statusBody */
+
+
+void Reflector::startStatusStream(Async::HttpServerConnection *con,
+                                  bool send_content)
+{
+  if (m_status_streams.count(con) > 0)
+  {
+    return;
+  }
+
+  Async::HttpServerConnection::Response res;
+  res.setCode(200);
+  res.setHeader("Content-type", "text/event-stream");
+  res.setHeader("Cache-Control", "no-cache");
+  if (!send_content)
+  {
+    con->write(res);
+    return;
+  }
+  con->setChunked();
+  if (!con->write(res))
+  {
+    return;
+  }
+
+    // Start with a full snapshot. After that, only the nodes that have
+    // changed are sent as deltas.
+  const std::string& body = statusBody();
+  std::ostringstream os;
+  os << "event: snapshot\n"
+     << "id: " << m_status_version << "\n"
+     << "data: " << body << "\n\n";
+  if (con->write(os.str().data(), os.str().size()))
+  {
+    m_status_streams.insert(con);
+  }
+} /* Reflector::startStatusStream */
+
+
+void Reflector::flushStatusStreams(Async::Timer *t)
+{
+  m_status_stream_timer.setEnable(false);
+
+  updateStatusNodes();
+  if (m_status_stream_changed.empty() || m_status_streams.empty())
+  {
+    m_status_stream_changed.clear();
+    return;
+  }
+
+    // The delta is assembled from the cached per node JSON objects. Nodes
+    // that have disconnected are set to null.
+  std::ostringstream delta;
+  delta << "{\"version\":" << m_status_version << ",\"nodes\":{";
+  for (auto it = m_status_stream_changed.begin();
+       it != m_status_stream_changed.end(); ++it)
+  {
+    if (it != m_status_stream_changed.begin())
+    {
+      delta << ",";
+    }
+    delta << jsonString(*it) << ":";
+    auto node_it = m_status_nodes.find(*it);
+    if (node_it != m_status_nodes.end())
+    {
+      delta << node_it->second;
+    }
+    else
+    {
+      delta << "null";
+    }
+  }
+  delta << "}}";
+  m_status_stream_changed.clear();
+
+    // The delta is serialized once and then written to all streams
+  std::ostringstream os;
+  os << "event: delta\n"
+     << "id: " << m_status_version << "\n"
+     << "data: " << delta.str() << "\n\n";
+  const std::string event(os.str());
+  auto streams = m_status_streams;
+  for (auto& con : streams)
+  {
+    con->write(event.data(), event.size());
+  }
+} /* Reflector::flushStatusStreams */
+
+
+void Reflector::flushNodeEvents(Async::Timer *t)
+{
+  m_node_event_timer.setEnable(false);
+
+  MsgNodeListDelta msg;
+  for (const auto& event : m_node_events)
+  {
+    if (event.second)
+    {
+      msg.joined().push_back(event.first);
+    }
+    else
+    {
+      msg.left().push_back(event.first);
+    }
+  }
+  m_node_events.clear();
+
+  if (!msg.joined().empty() || !msg.left().empty())
+  {
+    broadcastMsg(msg, node_delta_client_filter);
+  }
+} /* Reflector::flushNodeEvents */
+
+
+void Reflector::metricsProbeExpired(Async::Timer *t)
+{
+    // A periodic timer is rescheduled relative to its previous expiration
+    // time so the expected expiration time advance by exactly one interval
+  const auto now = ReflectorMetrics::Clock::now();
+  m_metrics.timer_lateness.observe(now - m_metrics_probe_expire);
+  m_metrics_probe_expire += std::chrono::milliseconds(t->timeout());
+
+    // Measure how long it take until a queued task is run by the event loop
+  Application::app().runTask(
+      sigc::bind(mem_fun(*this, &Reflector::metricsProbeTaskRun), now));
+} /* Reflector::metricsProbeExpired */
+
+
+void Reflector::metricsProbeTaskRun(MetricsTime queued)
+{
+  m_metrics.event_loop_lag.observe(ReflectorMetrics::Clock::now() - queued);
+} /* Reflector::metricsProbeTaskRun */
+
+
+std::string Reflector::metricsBody(void)
+{
+  std::ostringstream os;
+  m_metrics.write(os);
+
+  size_t connected_cnt = 0;
+  for (const auto& item : m_client_con_map)
+  {
+    if (item.second->conState() == ReflectorClient::STATE_CONNECTED)
+    {
+      ++connected_cnt;
+    }
+  }
+  ReflectorMetrics::writeHeader(os, "svxreflector_connections", "gauge",
+      "Open client TCP connections, including unauthenticated ones");
+  os << "svxreflector_connections " << m_client_con_map.size() << "\n";
+  ReflectorMetrics::writeHeader(os, "svxreflector_clients", "gauge",
+      "Authenticated clients");
+  os << "svxreflector_clients " << connected_cnt << "\n";
+  ReflectorMetrics::writeHeader(os, "svxreflector_ca_jobs_pending", "gauge",
+      "CA operations queued or running in a worker thread");
+  os << "svxreflector_ca_jobs_pending " << m_ca_workers.pendingCount() << "\n";
+
+  ReflectorMetrics::writeHeader(os, "svxreflector_tcp_tx_queue_bytes", "gauge",
+      "Bytes waiting to be sent to each client over TCP");
+  for (const auto& item : m_client_con_map)
+  {
+    ReflectorClient* client = item.second;
+    if (client->conState() == ReflectorClient::STATE_CONNECTED)
+    {
+      os << "svxreflector_tcp_tx_queue_bytes{callsign=\""
+         << ReflectorMetrics::escapeLabel(client->callsign()) << "\"} "
+         << client->txQueueSize() << "\n";
+    }
+  }
+  ReflectorMetrics::writeHeader(os, "svxreflector_tcp_tx_queue_peak_bytes",
+      "gauge", "Largest TCP send queue size seen for each client");
+  for (const auto& item : m_client_con_map)
+  {
+    ReflectorClient* client = item.second;
+    if (client->conState() == ReflectorClient::STATE_CONNECTED)
+    {
+      os << "svxreflector_tcp_tx_queue_peak_bytes{callsign=\""
+         << ReflectorMetrics::escapeLabel(client->callsign()) << "\"} "
+         << client->txQueueStats().peak_size << "\n";
+    }
+  }
+  ReflectorMetrics::writeHeader(os,
+      "svxreflector_tcp_tx_queue_overflows_total", "counter",
+      "TCP send queue overflows for each client");
+  for (const auto& item : m_client_con_map)
+  {
+    ReflectorClient* client = item.second;
+    if (client->conState() == ReflectorClient::STATE_CONNECTED)
+    {
+      os << "svxreflector_tcp_tx_queue_overflows_total{callsign=\""
+         << ReflectorMetrics::escapeLabel(client->callsign()) << "\"} "
+         << client->txQueueStats().overflows << "\n";
+    }
+  }
+  return os.str();
+} /* Reflector::metricsBody */
+
+
 void Reflector::onRequestAutoQsy(uint32_t from_tg)
 {
   uint32_t tg = nextRandomQsyTg();
@@ -1444,19 +2547,31 @@ void Reflector::ctrlPtyDataReceived(const void *buf, size_t count)
                  "Usage: CA SIGN <callsign>";
         goto write_status;
       }
-      auto cert = signClientCsr(cn);
-      if (!cert.isNull())
-      {
-        std::cout << "---------- Signed Client Certificate ----------"
-                  << std::endl;
-        cert.print(" ");
-        std::cout << "-----------------------------------------------"
-                  << std::endl;
-      }
-      else
-      {
-        errss << "Certificate signing failed";
-      }
+        // The PTY status is written when the signing is finished
+      signClientCsr(cn,
+          [this](Async::SslX509& cert)
+          {
+            std::string status("OK\n");
+            if (!cert.isNull())
+            {
+              std::cout << "---------- Signed Client Certificate ----------"
+                        << std::endl;
+              cert.print(" ");
+              std::cout << "-----------------------------------------------"
+                        << std::endl;
+            }
+            else
+            {
+              std::cerr << "*** ERROR: Certificate signing failed"
+                        << std::endl;
+              status = "ERR:Certificate signing failed\n";
+            }
+            if (m_cmd_pty != nullptr)
+            {
+              m_cmd_pty->write(status);
+            }
+          });
+      return;
     }
     else if (subcmd == "RM")
     {
@@ -1547,6 +2662,14 @@ void Reflector::cfgUpdated(const std::string& section, const std::string& tag)
       //std::cout << "### New value for " << tag << "=" << t << std::endl;
     }
   }
+  else if (section.rfind("TG#", 0) == 0)
+  {
+      // Talk group configuration affect the reported status of all nodes
+    for (const auto& item : m_client_con_map)
+    {
+      statusUpdated(item.second);
+    }
+  }
 } /* Reflector::cfgUpdated */
 
 
@@ -1589,6 +2712,27 @@ bool Reflector::loadCertificateFiles(void)
     return false;
   }
 
+    // Make it possible for reconnecting clients to resume their TLS session
+    // so that a full handshake is not needed, e.g. after a reflector restart.
+  long tls_session_timeout = 3600;
+  m_cfg->getValue("GLOBAL", "TLS_SESSION_TIMEOUT", tls_session_timeout);
+  if (tls_session_timeout > 0)
+  {
+    std::string ticket_keyfile;
+    if (!m_cfg->getValue("GLOBAL", "TLS_SESSION_TICKET_KEYFILE",
+                         ticket_keyfile))
+    {
+      ticket_keyfile = m_keys_dir + "/svxreflector_session_ticket.key";
+    }
+    if (!m_ssl_ctx.enableServerSessionCache("SvxReflector",
+                                            tls_session_timeout) ||
+        !m_ssl_ctx.setSessionTicketKeyFile(ticket_keyfile))
+    {
+      std::cerr << "*** WARNING: Failed to set up TLS session resumption"
+                << std::endl;
+    }
+  }
+
   struct stat st;
   if (stat(m_ca_bundle_file.c_str(), &st) != 0)
   {
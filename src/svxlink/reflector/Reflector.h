@@ -36,8 +36,12 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include <sigc++/sigc++.h>
 #include <sys/time.h>
+#include <json/json.h>
 #include <vector>
 #include <string>
+#include <set>
+#include <functional>
+#include <sstream>
 
 
 /****************************************************************************
@@ -62,6 +66,11 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include "ProtoVer.h"
 #include "ReflectorClient.h"
+#include "ReflectorHandoff.h"
+#include "ReflectorMetrics.h"
+#include "ReflectorTrunk.h"
+#include "ReflectorUdpRx.h"
+#include "ReflectorWorkerPool.h"
 
 
 /****************************************************************************
@@ -135,9 +144,11 @@ class Reflector : public sigc::trackable
     /**
      * @brief 	Initialize the reflector
      * @param 	cfg A previously initialized configuration object
+     * @param   takeover Set to \em true to take over the server sockets from
+     *                   a running reflector (see GLOBAL/HANDOFF_SOCKET)
      * @return	Return \em true on success or else \em false
      */
-    bool initialize(Async::Config &cfg);
+    bool initialize(Async::Config &cfg, bool takeover=false);
 
     /**
      * @brief   Return a list of all connected nodes
@@ -189,10 +200,41 @@ class Reflector : public sigc::trackable
     uint32_t randomQsyLo(void) const { return m_random_qsy_lo; }
     uint32_t randomQsyHi(void) const { return m_random_qsy_hi; }
 
+    /**
+     * @brief   A function called when a certificate operation is finished
+     * @param   cert The resulting certificate, null on failure
+     */
+    using CertHandler = std::function<void(Async::SslX509& cert)>;
+
+    /**
+     * @brief   A function called when a received CSR has been processed
+     * @param   cert        A valid certificate matching the CSR, or null
+     * @param   csr_current \em true if the CSR is the currently signed one
+     */
+    using CsrHandler =
+      std::function<void(Async::SslX509& cert, bool csr_current)>;
+
     Async::SslCertSigningReq loadClientPendingCsr(const std::string& callsign);
     Async::SslCertSigningReq loadClientCsr(const std::string& callsign);
-    bool signClientCert(Async::SslX509& cert, const std::string& ca_op);
-    Async::SslX509 signClientCsr(const std::string& cn);
+
+    /**
+     * @brief   Sign a client certificate again
+     * @param   cert    The certificate to sign
+     * @param   ca_op   The CA operation to report to the CA hook
+     * @param   handler Called with the signed certificate when finished
+     *
+     * The signing is done in a worker thread so the handler is normally
+     * called after this function has returned.
+     */
+    void signClientCert(Async::SslX509& cert, const std::string& ca_op,
+                        CertHandler handler);
+
+    /**
+     * @brief   Sign a pending client CSR
+     * @param   cn      The common name (callsign) of the CSR to sign
+     * @param   handler Called with the signed certificate when finished
+     */
+    void signClientCsr(const std::string& cn, CertHandler handler);
     Async::SslX509 loadClientCertificate(const std::string& callsign);
 
     size_t caSize(void) const { return m_ca_size; }
@@ -202,7 +244,57 @@ class Reflector : public sigc::trackable
     std::string caBundlePem(void) const;
     std::string issuingCertPem(void) const;
     bool callsignOk(const std::string& callsign) const;
-    Async::SslX509 csrReceived(Async::SslCertSigningReq& req);
+
+    /**
+     * @brief   Process a CSR received from a client
+     * @param   req     The received CSR
+     * @param   handler Called when the CSR has been processed
+     *
+     * The CSR is checked against the already signed CSR and certificate for
+     * the callsign and stored as a pending CSR if it is new. The file
+     * operations are done in a worker thread.
+     */
+    void csrReceived(Async::SslCertSigningReq& req, CsrHandler handler);
+
+    /**
+     * @brief   Notify the reflector that the status of a client has changed
+     * @param   client The client which status has changed
+     *
+     * This function should be called when some state that is reported in
+     * the HTTP status document has changed for the given client, like
+     * selected talk group, monitored talk groups, node info or signal
+     * levels. The cached status document will then be updated the next time
+     * it is requested and streaming status clients will receive a delta.
+     */
+    void statusUpdated(ReflectorClient* client);
+
+    /**
+     * @brief   Announce that a node has joined or left the reflector
+     * @param   client The client object for the node
+     * @param   joined Set to \em true if the node joined or \em false if it
+     *                 left
+     *
+     * Clients using a protocol version older than 3.1 immediately receive a
+     * MsgNodeJoined or MsgNodeLeft message. Newer clients receive all join
+     * and leave events that happen within NODE_EVENT_COALESCE_TIME
+     * milliseconds coalesced into one MsgNodeListDelta message.
+     */
+    void announceNode(ReflectorClient* client, bool joined);
+
+    /**
+     * @brief   Get the metrics object for the reflector
+     * @return  Returns the object holding the exported metrics
+     *
+     * The metrics are served in Prometheus text format on the /metrics
+     * endpoint of the HTTP server.
+     */
+    ReflectorMetrics& metrics(void) { return m_metrics; }
+
+    /**
+     * @brief   Notify the reflector that a client has set its UDP cipher key
+     * @param   client The client that set the key
+     */
+    void udpCipherKeyUpdated(ReflectorClient* client);
 
   protected:
 
@@ -211,11 +303,62 @@ class Reflector : public sigc::trackable
                      ReflectorClient*> ReflectorClientConMap;
     typedef Async::TcpServer<Async::FramedTcpConnection> FramedTcpServer;
     using HttpServer = Async::TcpServer<Async::HttpServerConnection>;
+    using StatusNodeMap = std::map<std::string, std::string>;
+    using StatusClientSet = std::set<ReflectorClient*>;
+    using StatusStreamSet = std::set<Async::HttpServerConnection*>;
+    using NodeEventMap = std::map<std::string, bool>;
+    using MetricsTime = ReflectorMetrics::Clock::time_point;
+    using TalkerStartMap = std::map<uint32_t, MetricsTime>;
+    struct TrunkTalker
+    {
+      ReflectorTrunk* trunk;
+      std::string     callsign;
+    };
+    using TrunkTalkerMap = std::map<uint32_t, TrunkTalker>;
+    using TrunkConMap = std::map<Async::FramedTcpConnection*,
+                                 ReflectorTrunk*>;
+    struct SignJob
+    {
+      Async::SslKeypair   ca_pkey;
+      std::string         ca_cert_pem;
+      std::string         certs_dir;
+      std::string         pending_csr_path;
+      std::string         csr_path;
+      Async::SslX509      cert;
+      bool                signed_ok       = false;
+      bool                written         = false;
+      std::ostringstream  log;
+
+      explicit SignJob(Async::SslKeypair& pkey)
+        : ca_pkey(pkey), cert(nullptr) {}
+    };
+    struct CsrJob
+    {
+      Async::SslCertSigningReq  req;
+      Async::SslKeypair         ca_pkey;
+      std::string               csr_path;
+      std::string               crt_path;
+      std::string               pending_csr_path;
+      Async::SslX509            cert;
+      bool                      key_mismatch    = false;
+      bool                      csr_current     = false;
+      bool                      pending_added   = false;
+      std::string               ca_op;
+
+      CsrJob(Async::SslCertSigningReq& r, Async::SslKeypair& pkey)
+        : req(r), ca_pkey(pkey) {}
+    };
 
     static constexpr unsigned ROOT_CA_VALIDITY_DAYS     = 25*365;
     static constexpr unsigned ISSUING_CA_VALIDITY_DAYS  = 4*90;
     static constexpr unsigned CERT_VALIDITY_DAYS        = 90;
     static constexpr int      CERT_VALIDITY_OFFSET_DAYS = -1;
+    static constexpr unsigned STATUS_STREAM_INTERVAL    = 250;
+    static constexpr unsigned NODE_EVENT_COALESCE_TIME  = 100;
+    static constexpr unsigned METRICS_PROBE_INTERVAL    = 1000;
+    static constexpr unsigned TRUNK_INTEREST_COALESCE_TIME = 100;
+    static constexpr unsigned CA_WORKER_QUEUE_MAX       = 256;
+    static constexpr unsigned UDP_RX_THREADS_MAX        = 16;
 
     FramedTcpServer*            m_srv;
     Async::EncryptedUdpSocket*  m_udp_sock;
@@ -245,6 +388,31 @@ class Reflector : public sigc::trackable
     size_t                      m_ca_size = 0;
     std::vector<uint8_t>        m_ca_md;
     std::vector<uint8_t>        m_ca_sig;
+    uint64_t                    m_status_version = 0;
+    uint64_t                    m_status_body_version = 0;
+    std::string                 m_status_body;
+    std::string                 m_status_etag;
+    std::string                 m_status_etag_prefix;
+    StatusNodeMap               m_status_nodes;
+    StatusClientSet             m_status_dirty;
+    std::set<std::string>       m_status_stream_changed;
+    StatusStreamSet             m_status_streams;
+    Async::Timer                m_status_stream_timer;
+    NodeEventMap                m_node_events;
+    Async::Timer                m_node_event_timer;
+    ReflectorMetrics            m_metrics;
+    Async::Timer                m_metrics_probe_timer;
+    MetricsTime                 m_metrics_probe_expire;
+    TalkerStartMap              m_talker_start;
+    std::string                 m_trunk_id;
+    FramedTcpServer*            m_trunk_srv = nullptr;
+    std::vector<ReflectorTrunk*> m_trunks;
+    TrunkConMap                 m_trunk_con_map;
+    TrunkTalkerMap              m_trunk_talkers;
+    Async::Timer                m_trunk_interest_timer;
+    ReflectorHandoff*           m_handoff = nullptr;
+    ReflectorWorkerPool         m_ca_workers;
+    ReflectorUdpRx*             m_udp_rx = nullptr;
 
     Reflector(const Reflector&);
     Reflector& operator=(const Reflector&);
@@ -254,14 +422,51 @@ class Reflector : public sigc::trackable
     bool udpCipherDataReceived(const Async::IpAddress& addr, uint16_t port,
                                void *buf, int count);
     void udpDatagramReceived(const Async::IpAddress& addr, uint16_t port,
-                             void* aad, void *buf, int count);
+                             void* aad, size_t aadlen, void *buf, int count);
     void onTalkerUpdated(uint32_t tg, ReflectorClient* old_talker,
                          ReflectorClient *new_talker);
+    void announceTalkerStart(uint32_t tg, const std::string& callsign);
+    void announceTalkerStop(uint32_t tg, const std::string& callsign,
+                            ReflectorClient* except);
+    static void signCert(SignJob& job);
+    void signJobDone(SignJob& job, const std::string& ca_op);
+    int inheritedSocket(const std::string& name,
+                        const std::string& port_str);
+    void onHandoffRequested(void);
+    void onHandoffAborted(void);
+    void setServerSocketsEnabled(bool enabled);
+    void onHandedOver(void);
+    bool initTrunks(void);
+    void trunkClientConnected(Async::FramedTcpConnection *con);
+    void trunkClientDisconnected(Async::FramedTcpConnection *con,
+        Async::FramedTcpConnection::DisconnectReason reason);
+    void trunkFrameReceived(Async::FramedTcpConnection *con,
+                            std::vector<uint8_t>& data);
+    void closeTrunkConnection(Async::FramedTcpConnection *con);
+    void onTrunkLinkUp(ReflectorTrunk* trunk);
+    void onTrunkLinkDown(ReflectorTrunk* trunk);
+    void onTrunkTalkerStart(ReflectorTrunk* trunk, uint32_t tg,
+                            const std::string& callsign);
+    void onTrunkTalkerStop(ReflectorTrunk* trunk, uint32_t tg,
+                           const std::string& callsign);
+    void onTrunkAudioReceived(ReflectorTrunk* trunk, uint32_t tg,
+                              const std::vector<uint8_t>& audio);
+    void updateTrunkInterest(Async::Timer *t);
     void httpRequestReceived(Async::HttpServerConnection *con,
                              Async::HttpServerConnection::Request& req);
     void httpClientConnected(Async::HttpServerConnection *con);
     void httpClientDisconnected(Async::HttpServerConnection *con,
         Async::HttpServerConnection::DisconnectReason reason);
+    Json::Value clientStatus(ReflectorClient* client);
+    void updateStatusNodes(void);
+    const std::string& statusBody(void);
+    void startStatusStream(Async::HttpServerConnection *con,
+                           bool send_content);
+    void flushStatusStreams(Async::Timer *t);
+    void flushNodeEvents(Async::Timer *t);
+    void metricsProbeExpired(Async::Timer *t);
+    void metricsProbeTaskRun(MetricsTime queued);
+    std::string metricsBody(void);
     void onRequestAutoQsy(uint32_t from_tg);
     uint32_t nextRandomQsyTg(void);
     void ctrlPtyDataReceived(const void *buf, size_t count);
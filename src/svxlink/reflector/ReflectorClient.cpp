@@ -45,6 +45,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  *
  ****************************************************************************/
 
+#include <AsyncApplication.h>
 #include <AsyncTimer.h>
 #include <AsyncAudioEncoder.h>
 #include <AsyncAudioDecoder.h>
@@ -115,9 +116,13 @@ using namespace Async;
  *
  ****************************************************************************/
 
-ReflectorClient::ClientMap ReflectorClient::client_map;
-ReflectorClient::ClientSrcMap ReflectorClient::client_src_map;
-ReflectorClient::ClientCallsignMap ReflectorClient::client_callsign_map;
+ReflectorClient::ClientMap ReflectorClient::client_map(CLIENT_MAP_RESERVE);
+ReflectorClient::ClientSrcMap ReflectorClient::client_src_map(
+    CLIENT_MAP_RESERVE);
+ReflectorClient::ClientCallsignMap ReflectorClient::client_callsign_map(
+    CLIENT_MAP_RESERVE);
+ReflectorClient::ClientSrc ReflectorClient::last_src;
+ReflectorClient* ReflectorClient::last_src_client = nullptr;
 std::mt19937 ReflectorClient::id_gen(std::random_device{}());
 ReflectorClient::ClientIdRandomDist ReflectorClient::id_dist(
     CLIENT_ID_MIN, CLIENT_ID_MAX);
@@ -142,11 +147,18 @@ ReflectorClient* ReflectorClient::lookup(const ClientId& id)
 
 ReflectorClient* ReflectorClient::lookup(const ClientSrc& src)
 {
+  if ((last_src_client != nullptr) && (src.second == last_src.second) &&
+      (src.first == last_src.first))
+  {
+    return last_src_client;
+  }
   auto it = client_src_map.find(src);
   if (it == client_src_map.end())
   {
     return nullptr;
   }
+  last_src = src;
+  last_src_client = it->second;
   return it->second;
 } /* ReflectorClient::lookup */
 
@@ -193,7 +205,8 @@ ReflectorClient::ReflectorClient(Reflector *ref, Async::FramedTcpConnection *con
     m_udp_heartbeat_tx_cnt(UDP_HEARTBEAT_TX_CNT_RESET),
     m_udp_heartbeat_rx_cnt(UDP_HEARTBEAT_RX_CNT_RESET),
     m_reflector(ref), m_blocktime(0), m_remaining_blocktime(0),
-    m_current_tg(0), m_udp_cipher_iv_cntr(0)
+    m_current_tg(0), m_tg_metrics(&ref->metrics().tg(0)),
+    m_udp_cipher_iv_cntr(0)
 {
   m_con->setMaxRxFrameSize(ReflectorMsg::MAX_PREAUTH_FRAME_SIZE);
   m_con->setMaxTxFrameSize(ReflectorMsg::MAX_POSTAUTH_FRAME_SIZE);
@@ -207,6 +220,10 @@ ReflectorClient::ReflectorClient(Reflector *ref, Async::FramedTcpConnection *con
       sigc::mem_fun(*this, &ReflectorClient::handleHeartbeat));
   m_renew_cert_timer.expired.connect(sigc::hide(
       sigc::mem_fun(*this, &ReflectorClient::renewClientCertificate)));
+  m_con->txQueueEmptied.connect(
+      sigc::mem_fun(*this, &ReflectorClient::onTxQueueEmptied));
+
+  m_cfg->getValue("GLOBAL", "TCP_TX_QUEUE_MAX", m_txq_max_size);
 
   string codecs;
   if (m_cfg->getValue("GLOBAL", "CODECS", codecs))
@@ -244,7 +261,15 @@ ReflectorClient::~ReflectorClient(void)
   auto client_it = client_map.find(m_client_id);
   assert(client_it != client_map.end());
   client_map.erase(client_it);
-  client_src_map.erase(m_client_src);
+  auto src_it = client_src_map.find(m_client_src);
+  if ((src_it != client_src_map.end()) && (src_it->second == this))
+  {
+    client_src_map.erase(src_it);
+  }
+  if (last_src_client == this)
+  {
+    last_src_client = nullptr;
+  }
   if (!m_callsign.empty())
   {
     client_callsign_map.erase(m_callsign);
@@ -266,30 +291,51 @@ void ReflectorClient::setRemoteUdpPort(uint16_t port)
 
 int ReflectorClient::sendMsg(const ReflectorMsg& msg)
 {
+  return sendFrame(msg.type(), packMsg(msg), txKey(msg));
+} /* ReflectorClient::sendMsg */
+
+
+int ReflectorClient::sendFrame(unsigned type,
+                               const Async::FramedTcpConnection::FrameBuf& frame,
+                               const std::string& key)
+{
+  if (m_txq_overflow)
+  {
+    errno = ENOBUFS;
+    return -1;
+  }
+
   errno = 0;
 
-  if (((m_con_state != STATE_CONNECTED) && (msg.type() >= 100)) ||
+  if (((m_con_state != STATE_CONNECTED) && (type >= 100)) ||
       !m_con->isConnected())
   {
     errno = ENOTCONN;
   }
+  else if (!frame)
+  {
+    errno = EBADMSG;
+  }
 
-  ostringstream ss;
   if (errno == 0)
   {
     m_heartbeat_tx_cnt = HEARTBEAT_TX_CNT_RESET;
 
-    ReflectorMsg header(msg.type());
-    if (!header.pack(ss) || !msg.pack(ss))
+      // Messages are queued when connected and the connection is lagging
+      // behind. Before that, all messages are part of the ordered connection
+      // setup sequence and are written directly.
+    if ((m_con_state == STATE_CONNECTED) &&
+        ((m_txq_size > 0) ||
+         (m_con->txQueueSize() >= TX_QUEUE_HIGH_WATERMARK)))
     {
-      cerr << "*** ERROR: Failed to pack TCP message\n";
-      errno = EBADMSG;
+      if (!queueFrame(type, frame, key))
+      {
+        return -1;
+      }
+      return frame->size() - 4;
     }
-  }
 
-  if (errno == 0)
-  {
-    auto ret = m_con->write(ss.str().data(), ss.str().size());
+    auto ret = m_con->writeFrame(frame);
     if (ret >= 0)
     {
       return ret;
@@ -297,11 +343,68 @@ int ReflectorClient::sendMsg(const ReflectorMsg& msg)
   }
   std::cerr << "*** ERROR[" << m_con->remoteHost() << ":"
             << m_con->remotePort() << "]: Write to client failed due to '"
-            << strerror(errno) << "'. Message type=" << msg.type() << "."
+            << strerror(errno) << "'. Message type=" << type << "."
             << std::endl;
   disconnect();
   return -1;
-} /* ReflectorClient::sendMsg */
+} /* ReflectorClient::sendFrame */
+
+
+Async::FramedTcpConnection::FrameBuf ReflectorClient::packMsg(
+    const ReflectorMsg& msg)
+{
+  ostringstream ss;
+  ReflectorMsg header(msg.type());
+  if (!header.pack(ss) || !msg.pack(ss))
+  {
+    cerr << "*** ERROR: Failed to pack TCP message\n";
+    return nullptr;
+  }
+  const std::string& buf = ss.str();
+  return Async::FramedTcpConnection::makeFrameBuf(buf.data(), buf.size());
+} /* ReflectorClient::packMsg */
+
+
+std::string ReflectorClient::txKey(const ReflectorMsg& msg)
+{
+  switch (msg.type())
+  {
+    case MsgNodeJoined::TYPE:
+    case MsgNodeLeft::TYPE:
+    case MsgTalkerStart::TYPE:
+    case MsgTalkerStop::TYPE:
+      break;
+    default:
+      return std::string();
+  }
+
+  std::ostringstream ss;
+  if (auto m = dynamic_cast<const MsgTalkerStart*>(&msg))
+  {
+    ss << m->tg() << "/" << m->callsign();
+  }
+  else if (auto m = dynamic_cast<const MsgTalkerStop*>(&msg))
+  {
+    ss << m->tg() << "/" << m->callsign();
+  }
+  else if (auto m = dynamic_cast<const MsgTalkerStartV1*>(&msg))
+  {
+    ss << "/" << m->callsign();
+  }
+  else if (auto m = dynamic_cast<const MsgTalkerStopV1*>(&msg))
+  {
+    ss << "/" << m->callsign();
+  }
+  else if (auto m = dynamic_cast<const MsgNodeJoined*>(&msg))
+  {
+    ss << m->callsign();
+  }
+  else if (auto m = dynamic_cast<const MsgNodeLeft*>(&msg))
+  {
+    ss << m->callsign();
+  }
+  return ss.str();
+} /* ReflectorClient::txKey */
 
 
 void ReflectorClient::udpMsgReceived(const ReflectorUdpMsg &header)
@@ -384,6 +487,7 @@ ReflectorClient::ClientSrc ReflectorClient::newClientSrc(ReflectorClient* client
   ClientSrc src{std::make_pair(client->m_con->remoteHost(),
                                client->m_remote_udp_port)};
   client_src_map[src] = client;
+  last_src_client = nullptr;
   return src;
 } /* ReflectorClient::newClientSrc */
 
@@ -425,9 +529,13 @@ void ReflectorClient::onSslConnectionReady(TcpConnection *con)
     //return;
   }
 
-  std::cout << "------------- Client Certificate --------------" << std::endl;
-  peer_cert.print();
-  std::cout << "-----------------------------------------------" << std::endl;
+  const bool session_reused = con->sslSessionReused();
+  if (!session_reused)
+  {
+    std::cout << "------------- Client Certificate --------------" << std::endl;
+    peer_cert.print();
+    std::cout << "-----------------------------------------------" << std::endl;
+  }
 
   std::string callsign = peer_cert.commonName();
   if (!m_reflector->callsignOk(callsign))
@@ -451,7 +559,12 @@ void ReflectorClient::onSslConnectionReady(TcpConnection *con)
   m_renew_cert_timer.setExpireOffset(10000);
   m_renew_cert_timer.start();
 
-  std::cout << callsign << ": " << peer_cert.subjectNameString() << std::endl;
+  std::cout << callsign << ": " << peer_cert.subjectNameString();
+  if (session_reused)
+  {
+    std::cout << " (TLS session resumed)";
+  }
+  std::cout << std::endl;
   connectionAuthenticated(callsign);
 } /* ReflectorClient::onSslConnectionReady */
 
@@ -787,26 +900,59 @@ void ReflectorClient::handleMsgClientCsr(std::istream& is)
   }
   req.print(idss.str() + ":   ");
 
-  auto cert = m_reflector->csrReceived(req);
-  auto current_req = m_reflector->loadClientCsr(req.commonName());
-  if ((
-        (m_con_state == STATE_EXPECT_CSR) ||
-        (!current_req.isNull() && (req.digest() == current_req.digest()))
-      ) &&
+  if (m_csr_pending)
+  {
+    std::cout << "*** WARNING[" << idss.str() << "]: Ignoring CSR since "
+                 "the previous one is still being processed" << std::endl;
+    return;
+  }
+  m_csr_pending = true;
+
+    // The CSR is processed in a worker thread so this client may be gone
+    // when the result arrive
+  const ClientId client_id = m_client_id;
+  const std::string id = idss.str();
+  m_reflector->csrReceived(req,
+      [client_id, id](Async::SslX509& cert, bool csr_current)
+      {
+        auto client = ReflectorClient::lookup(client_id);
+        if (client != nullptr)
+        {
+          client->csrProcessed(id, cert, csr_current);
+        }
+      });
+} /* ReflectorClient::handleMsgClientCsr */
+
+
+void ReflectorClient::csrProcessed(const std::string& id,
+                                   Async::SslX509& cert, bool csr_current)
+{
+  if (!m_csr_pending)
+  {
+    return;
+  }
+  m_csr_pending = false;
+
+  if ((m_con_state != STATE_EXPECT_CSR) && (m_con_state != STATE_CONNECTED))
+  {
+    return;
+  }
+
+  if (((m_con_state == STATE_EXPECT_CSR) || csr_current) &&
       sendClientCert(cert))
   {
-    std::cout << idss.str() << ": Sent certificate to peer" << std::endl;
+    std::cout << id << ": Sent certificate to peer" << std::endl;
     //cert.print();
     m_con_state = STATE_EXPECT_DISCONNECT;
   }
   else if (m_con_state == STATE_EXPECT_CSR)
   {
-    std::cout << idss.str() << ": No valid certificate found matching CSR. "
+    std::cout << id << ": No valid certificate found matching CSR. "
                  "Sending authentication challenge." << std::endl;
     sendAuthChallenge();
     m_con_state = STATE_EXPECT_AUTH_RESPONSE;
   }
-} /* ReflectorClient::handleMsgClientCsr */
+} /* ReflectorClient::csrProcessed */
 
 
 void ReflectorClient::handleSelectTG(std::istream& is)
@@ -836,7 +982,7 @@ void ReflectorClient::handleSelectTG(std::istream& is)
     if (TGHandler::instance()->switchTo(this, msg.tg()))
     {
       cout << m_callsign << ": Select TG #" << msg.tg() << endl;
-      m_current_tg = msg.tg();
+      setCurrentTG(msg.tg());
     }
     else
     {
@@ -844,8 +990,9 @@ void ReflectorClient::handleSelectTG(std::istream& is)
       std::cout << m_callsign << ": Not allowed to use TG #"
                 << msg.tg() << std::endl;
       TGHandler::instance()->switchTo(this, 0);
-      m_current_tg = 0;
+      setCurrentTG(0);
     }
+    m_reflector->statusUpdated(this);
   }
 } /* ReflectorClient::handleSelectTG */
 
@@ -879,6 +1026,7 @@ void ReflectorClient::handleTgMonitor(std::istream& is)
   cout << "]" << endl;
 
   m_monitored_tgs = tgs;
+  m_reflector->statusUpdated(this);
 } /* ReflectorClient::handleTgMonitor */
 
 
@@ -900,6 +1048,7 @@ void ReflectorClient::handleNodeInfo(std::istream& is)
     //setRemoteUdpPort(msg.udpSrcPort());
     setUdpCipherIVRand(msg.ivRand());
     setUdpCipherKey(msg.udpCipherKey());
+    m_reflector->udpCipherKeyUpdated(this);
     jsonstr = msg.json();
 
     sendMsg(MsgStartUdpEncryption());
@@ -928,6 +1077,7 @@ void ReflectorClient::handleNodeInfo(std::istream& is)
               << "]: Failed to parse MsgNodeInfo JSON object: "
               << e.what() << std::endl;
   }
+  m_reflector->statusUpdated(this);
 } /* ReflectorClient::handleNodeInfo */
 
 
@@ -957,6 +1107,7 @@ void ReflectorClient::handleMsgSignalStrengthValues(std::istream& is)
     setRxSqlOpen(rx.id(), rx.sqlOpen());
     setRxActive(rx.id(), rx.active());
   }
+  m_reflector->statusUpdated(this);
 } /* ReflectorClient::handleMsgSignalStrengthValues */
 
 
@@ -979,6 +1130,7 @@ void ReflectorClient::handleMsgTxStatus(std::istream& is)
     //  << std::endl;
     setTxTransmit(tx.id(), tx.transmit());
   }
+  m_reflector->statusUpdated(this);
 } /* ReflectorClient::handleMsgTxStatus */
 
 
@@ -1117,6 +1269,13 @@ void ReflectorClient::handleMsgError(std::istream& is)
 } /* ReflectorClient::handleMsgError */
 
 
+void ReflectorClient::setCurrentTG(uint32_t tg)
+{
+  m_current_tg = tg;
+  m_tg_metrics = &m_reflector->metrics().tg(tg);
+} /* ReflectorClient::setCurrentTG */
+
+
 void ReflectorClient::sendError(const std::string& msg)
 {
   sendMsg(MsgError(msg));
@@ -1138,6 +1297,11 @@ void ReflectorClient::disconnect(void)
 {
   m_heartbeat_timer.setEnable(false);
   m_remote_udp_port = 0;
+  for (auto& txq : m_txq)
+  {
+    txq.clear();
+  }
+  m_txq_size = 0;
   m_con->disconnect();
   m_con_state = STATE_DISCONNECTED;
   m_con->disconnected(m_con, FramedTcpConnection::DR_ORDERED_DISCONNECT);
@@ -1231,6 +1395,8 @@ void ReflectorClient::connectionAuthenticated(const std::string& callsign)
     m_con->setMaxRxFrameSize(ReflectorMsg::MAX_POSTAUTH_FRAME_SIZE);
     m_callsign = callsign;
     sendMsg(MsgAuthOk());
+    m_reflector->metrics().auth_duration.observe(
+        std::chrono::steady_clock::now() - m_connect_time);
     cout << m_callsign << ": Login OK from "
          << m_con->remoteHost() << ":" << m_con->remotePort()
          << " with protocol version " << m_client_proto_ver.majorVer()
@@ -1266,7 +1432,7 @@ void ReflectorClient::connectionAuthenticated(const std::string& callsign)
       {
         std::cout << m_callsign << ": Select TG #"
                   << m_reflector->tgForV1Clients() << std::endl;
-        m_current_tg = m_reflector->tgForV1Clients();
+        setCurrentTG(m_reflector->tgForV1Clients());
       }
       else
       {
@@ -1275,7 +1441,8 @@ void ReflectorClient::connectionAuthenticated(const std::string& callsign)
                   << m_reflector->tgForV1Clients() << std::endl;
       }
     }
-    m_reflector->broadcastMsg(MsgNodeJoined(m_callsign), ExceptFilter(this));
+    m_reflector->announceNode(this, true);
+    m_reflector->statusUpdated(this);
   }
   else
   {
@@ -1324,7 +1491,26 @@ void ReflectorClient::renewClientCertificate(void)
 {
   std::cout << m_callsign << ": Renew client certificate" << std::endl;
   auto cert = m_con->sslPeerCertificate();
-  if (cert.isNull() || !m_reflector->signClientCert(cert, "CRT_RENEWED"))
+  const ClientId client_id = m_client_id;
+  m_reflector->signClientCert(cert, "CRT_RENEWED",
+      [client_id](Async::SslX509& cert)
+      {
+        auto client = ReflectorClient::lookup(client_id);
+        if (client != nullptr)
+        {
+          client->certificateRenewed(cert);
+        }
+      });
+} /* ReflectorClient::renewClientCertificate */
+
+
+void ReflectorClient::certificateRenewed(Async::SslX509& cert)
+{
+  if (m_con_state != STATE_CONNECTED)
+  {
+    return;
+  }
+  if (cert.isNull())
   {
     std::cerr << "*** WARNING: Certificate resigning for '"
               << m_callsign << "' failed" << std::endl;
@@ -1332,7 +1518,122 @@ void ReflectorClient::renewClientCertificate(void)
   }
   sendClientCert(cert);
   m_con_state = STATE_EXPECT_DISCONNECT;
-} /* ReflectorClient::renewClientCertificate */
+} /* ReflectorClient::certificateRenewed */
+
+
+ReflectorClient::MsgPrio ReflectorClient::msgPrio(unsigned type)
+{
+  switch (type)
+  {
+    case MsgClientCert::TYPE:
+    case MsgCABundle::TYPE:
+      return PRIO_BULK;
+    case MsgServerInfo::TYPE:
+    case MsgNodeList::TYPE:
+    case MsgNodeJoined::TYPE:
+    case MsgNodeLeft::TYPE:
+    case MsgNodeListDelta::TYPE:
+      return PRIO_STATE;
+    default:
+      return PRIO_CONTROL;
+  }
+} /* ReflectorClient::msgPrio */
+
+
+bool ReflectorClient::queueFrame(unsigned type,
+                                 const Async::FramedTcpConnection::FrameBuf& frame,
+                                 const std::string& key)
+{
+  TxQueue& txq = m_txq[msgPrio(type)];
+
+    // A talker stop or node left message make a still queued talker start
+    // or node joined message for the same talker or node obsolete. Both
+    // messages are then dropped.
+  unsigned obsoleted_type = 0;
+  switch (type)
+  {
+    case MsgTalkerStop::TYPE:
+      obsoleted_type = MsgTalkerStart::TYPE;
+      break;
+    case MsgNodeLeft::TYPE:
+      obsoleted_type = MsgNodeJoined::TYPE;
+      break;
+  }
+  if ((obsoleted_type != 0) && !key.empty())
+  {
+    auto it = std::find_if(txq.begin(), txq.end(),
+        [&](const TxItem& item)
+        {
+          return (item.type == obsoleted_type) && (item.key == key);
+        });
+    if (it != txq.end())
+    {
+      m_txq_size -= it->frame->size();
+      txq.erase(it);
+      m_txq_stats.cancelled += 2;
+      return true;
+    }
+  }
+
+  if (m_txq_size + frame->size() > m_txq_max_size)
+  {
+    m_txq_stats.overflows += 1;
+    m_txq_overflow = true;
+    std::cerr << "*** WARNING[";
+    if (!m_callsign.empty())
+    {
+      std::cerr << m_callsign;
+    }
+    else
+    {
+      std::cerr << m_con->remoteHost() << ":" << m_con->remotePort();
+    }
+    std::cerr << "]: TCP send queue overflow (" << txQueueSize()
+              << " bytes). Disconnecting slow client." << std::endl;
+
+      // The disconnect is deferred since we may be called while the
+      // reflector is iterating over its clients
+    Application::app().runTask([this]{
+        if (m_con->isConnected())
+        {
+          disconnect();
+        }
+      });
+    errno = ENOBUFS;
+    return false;
+  }
+
+  txq.push_back({type, frame, key});
+  m_txq_size += frame->size();
+  m_txq_stats.queued += 1;
+  m_txq_stats.peak_size = std::max(m_txq_stats.peak_size, txQueueSize());
+  return true;
+} /* ReflectorClient::queueFrame */
+
+
+void ReflectorClient::onTxQueueEmptied(Async::TcpConnection *con)
+{
+  for (auto& txq : m_txq)
+  {
+    while (!txq.empty() && !m_txq_overflow && m_con->isConnected() &&
+           (m_con->txQueueSize() < TX_QUEUE_HIGH_WATERMARK))
+    {
+      TxItem item = std::move(txq.front());
+      txq.pop_front();
+      m_txq_size -= item.frame->size();
+      if (m_con->writeFrame(item.frame) < 0)
+      {
+        std::cerr << "*** ERROR[" << m_con->remoteHost() << ":"
+                  << m_con->remotePort()
+                  << "]: Write to client failed due to '"
+                  << strerror(errno) << "'. Message type=" << item.type
+                  << "." << std::endl;
+        disconnect();
+        return;
+      }
+    }
+  }
+} /* ReflectorClient::onTxQueueEmptied */
 
 
 /*
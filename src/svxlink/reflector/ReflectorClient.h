@@ -35,9 +35,12 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  ****************************************************************************/
 
 #include <string>
+#include <deque>
+#include <chrono>
 #include <json/json.h>
 #include <sigc++/sigc++.h>
 #include <random>
+#include <unordered_map>
 
 
 /****************************************************************************
@@ -61,6 +64,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  ****************************************************************************/
 
 #include "ReflectorMsg.h"
+#include "ReflectorMetrics.h"
 #include "ProtoVer.h"
 
 
@@ -148,6 +152,28 @@ class ReflectorClient
     };
     typedef std::map<char, Tx> TxMap;
 
+    /**
+     * @brief Priority classes for queued TCP messages
+     */
+    enum MsgPrio
+    {
+      PRIO_CONTROL,   ///< Protocol control and talker messages
+      PRIO_STATE,     ///< Node list messages
+      PRIO_BULK,      ///< Large messages, like certificates
+      PRIO_CNT
+    };
+
+    /**
+     * @brief Send queue statistics
+     */
+    struct TxQueueStats
+    {
+      uint64_t  queued      = 0;  ///< Messages put in the send queue
+      uint64_t  cancelled   = 0;  ///< Messages removed as obsolete
+      uint64_t  overflows   = 0;  ///< Send queue overflows
+      size_t    peak_size   = 0;  ///< Largest send queue size in bytes
+    };
+
     class Filter
     {
       public:
@@ -272,6 +298,10 @@ class ReflectorClient
      * @brief   Get the client object associated with the given source addr
      * @param   src The source address of the client object to find
      * @return  Return the client object associated with the given source addr
+     *
+     * This function is called for each received UDP datagram so the last
+     * found client is cached. Consecutive datagrams from the same source
+     * will then not need a hash table lookup.
      */
     static ReflectorClient* lookup(const ClientSrc& src);
 
@@ -398,6 +428,61 @@ class ReflectorClient
      */
     int sendMsg(const ReflectorMsg& msg);
 
+    /**
+     * @brief   Send an already packed TCP message to the remote end
+     * @param   type The type of the packed message
+     * @param   frame The packed message, as returned by packMsg
+     * @param   key The coalescing key for the message, as returned by txKey
+     * @return  On success 0 is returned or else -1
+     *
+     * This function is used when the same message is sent to many clients so
+     * that the message only have to be serialized once.
+     *
+     * When the client is connected and the TCP connection cannot keep up,
+     * messages are put in a send queue with one priority class per message
+     * type (@see MsgPrio). A queued message that is made obsolete by a newer
+     * message, e.g. a talker start followed by a talker stop for the same
+     * talker, is removed from the queue together with the newer message. If
+     * the send queue grow larger than the GLOBAL/TCP_TX_QUEUE_MAX
+     * configuration variable, the client is disconnected.
+     */
+    int sendFrame(unsigned type,
+                  const Async::FramedTcpConnection::FrameBuf& frame,
+                  const std::string& key="");
+
+    /**
+     * @brief   Serialize a TCP message into a frame buffer
+     * @param   msg The message to serialize
+     * @return  Returns the frame buffer or an empty pointer on failure
+     */
+    static Async::FramedTcpConnection::FrameBuf packMsg(
+        const ReflectorMsg& msg);
+
+    /**
+     * @brief   Get the send queue coalescing key for a TCP message
+     * @param   msg The message to find the key for
+     * @return  Returns the key or an empty string if the message has none
+     */
+    static std::string txKey(const ReflectorMsg& msg);
+
+    /**
+     * @brief   Get the send queue statistics for this client
+     * @return  Returns the send queue statistics
+     */
+    const TxQueueStats& txQueueStats(void) const { return m_txq_stats; }
+
+    /**
+     * @brief   Get the number of bytes waiting to be sent to the client
+     * @return  Returns the number of bytes in the send queue
+     *
+     * The returned value include both the messages queued by this object and
+     * the data in the TCP connection transmit queue.
+     */
+    size_t txQueueSize(void) const
+    {
+      return m_txq_size + m_con->txQueueSize();
+    }
+
     /**
      * @brief   Handle a received UDP message
      * @param   The received UDP message
@@ -447,6 +532,15 @@ class ReflectorClient
      */
     uint32_t currentTG(void) const { return m_current_tg; }
 
+    /**
+     * @brief   Get the UDP traffic counters for the current talk group
+     * @return  Returns the counters
+     *
+     * The counters are looked up when the talk group is selected so this
+     * is cheap enough to be called for every UDP packet.
+     */
+    ReflectorMetrics::TgCounters& tgMetrics(void) { return *m_tg_metrics; }
+
     /**
      * @brief   Get the monitored talk groups
      * @return  Returns the monitored talk groups
@@ -513,9 +607,21 @@ class ReflectorClient
 
   private:
     using ClientIdRandomDist  = std::uniform_int_distribution<ClientId>;
-    using ClientMap           = std::map<ClientId, ReflectorClient*>;
-    using ClientSrcMap        = std::map<ClientSrc, ReflectorClient*>;
-    using ClientCallsignMap   = std::map<std::string, ReflectorClient*>;
+    struct ClientSrcHash
+    {
+      size_t operator()(const ClientSrc& src) const
+      {
+          // Fibonacci hashing of the IPv4 address and port
+        uint64_t key = (static_cast<uint64_t>(src.first.ip4Addr().s_addr) << 16)
+                       | src.second;
+        return static_cast<size_t>((key * 0x9e3779b97f4a7c15ULL) >> 16);
+      }
+    };
+    using ClientMap           = std::unordered_map<ClientId, ReflectorClient*>;
+    using ClientSrcMap        = std::unordered_map<ClientSrc, ReflectorClient*,
+                                                   ClientSrcHash>;
+    using ClientCallsignMap   = std::unordered_map<std::string,
+                                                   ReflectorClient*>;
 
     static const uint16_t MIN_MAJOR_VER = 0;
     static const uint16_t MIN_MINOR_VER = 6;
@@ -524,13 +630,26 @@ class ReflectorClient
     static const unsigned HEARTBEAT_RX_CNT_RESET      = 15;
     static const unsigned UDP_HEARTBEAT_TX_CNT_RESET  = 15;
     static const unsigned UDP_HEARTBEAT_RX_CNT_RESET  = 120;
+    static const size_t   TX_QUEUE_HIGH_WATERMARK     = 16384;
+    static const size_t   DEFAULT_TX_QUEUE_MAX        = 262144;
+
+    struct TxItem
+    {
+      unsigned                              type;
+      Async::FramedTcpConnection::FrameBuf  frame;
+      std::string                           key;
+    };
+    using TxQueue = std::deque<TxItem>;
 
     static const ClientId CLIENT_ID_MAX = std::numeric_limits<ClientId>::max();
     static const ClientId CLIENT_ID_MIN = 1;
+    static const size_t   CLIENT_MAP_RESERVE = 1024;
 
     static ClientMap            client_map;
     static ClientSrcMap         client_src_map;
     static ClientCallsignMap    client_callsign_map;
+    static ClientSrc            last_src;
+    static ReflectorClient*     last_src_client;
     static std::mt19937         id_gen;
     static ClientIdRandomDist   id_dist;
 
@@ -556,6 +675,7 @@ class ReflectorClient
     ProtoVer                    m_client_proto_ver;
     std::vector<std::string>    m_supported_codecs;
     uint32_t                    m_current_tg;
+    ReflectorMetrics::TgCounters* m_tg_metrics;
     std::set<uint32_t>          m_monitored_tgs;
     RxMap                       m_rx_map;
     TxMap                       m_tx_map;
@@ -564,6 +684,14 @@ class ReflectorClient
     std::vector<uint8_t>        m_udp_cipher_key;
     UdpCipher::IVCntr           m_udp_cipher_iv_cntr;
     Async::AtTimer              m_renew_cert_timer;
+    TxQueue                     m_txq[PRIO_CNT];
+    size_t                      m_txq_size = 0;
+    size_t                      m_txq_max_size = DEFAULT_TX_QUEUE_MAX;
+    TxQueueStats                m_txq_stats;
+    bool                        m_txq_overflow = false;
+    bool                        m_csr_pending = false;
+    std::chrono::steady_clock::time_point m_connect_time =
+                                    std::chrono::steady_clock::now();
 
     static ClientId newClientId(ReflectorClient* client);
     static ClientSrc newClientSrc(ReflectorClient* client);
@@ -578,6 +706,8 @@ class ReflectorClient
     void handleMsgStartEncryptionRequest(std::istream& is);
     void handleMsgAuthResponse(std::istream& is);
     void handleMsgClientCsr(std::istream& is);
+    void csrProcessed(const std::string& id, Async::SslX509& cert,
+                      bool csr_current);
     void handleSelectTG(std::istream& is);
     void handleTgMonitor(std::istream& is);
     void handleNodeInfo(std::istream& is);
@@ -586,6 +716,7 @@ class ReflectorClient
     void handleRequestQsy(std::istream& is);
     void handleStateEvent(std::istream& is);
     void handleMsgError(std::istream& is);
+    void setCurrentTG(uint32_t tg);
     void sendError(const std::string& msg);
     void onDiscTimeout(Async::Timer *t);
     void disconnect(void);
@@ -595,6 +726,12 @@ class ReflectorClient
     bool sendClientCert(const Async::SslX509& cert);
     void sendAuthChallenge(void);
     void renewClientCertificate(void);
+    void certificateRenewed(Async::SslX509& cert);
+    static MsgPrio msgPrio(unsigned type);
+    bool queueFrame(unsigned type,
+                    const Async::FramedTcpConnection::FrameBuf& frame,
+                    const std::string& key);
+    void onTxQueueEmptied(Async::TcpConnection *con);
 
 };  /* class ReflectorClient */
 
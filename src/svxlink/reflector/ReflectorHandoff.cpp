@@ -0,0 +1,609 @@
+/**
+@file	 ReflectorHandoff.cpp
+@brief   Hand over the server sockets to a new reflector process
+@author  Tobias Blomberg / SM0SVX
+@date	 2026-10-18
+
+\verbatim
+SvxReflector - An audio reflector for connecting SvxLink Servers
+Copyright (C) 2003-2026 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "ReflectorHandoff.h"
+
+
+/****************************************************************************
+ *
+ * Namespaces to use
+ *
+ ****************************************************************************/
+
+using namespace std;
+using namespace Async;
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local class definitions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local functions
+ *
+ ****************************************************************************/
+
+namespace {
+  const char*     CMD_TAKEOVER      = "TAKEOVER";
+  const char*     CMD_READY         = "READY";
+  const char*     CMD_SOCKETS       = "SOCKETS";
+  const size_t    MAX_SOCKETS       = 24;
+  const int       TAKEOVER_TIMEOUT  = 10000;
+
+  bool writeLine(int fd, const std::string& line)
+  {
+    std::string buf(line + "\n");
+    size_t pos = 0;
+    while (pos < buf.size())
+    {
+      ssize_t ret = ::write(fd, buf.data()+pos, buf.size()-pos);
+      if (ret < 0)
+      {
+        if (errno == EINTR)
+        {
+          continue;
+        }
+        return false;
+      }
+      pos += ret;
+    }
+    return true;
+  }
+
+  bool setUnixAddr(struct sockaddr_un& addr, const std::string& path)
+  {
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path))
+    {
+      std::cerr << "*** ERROR: The handoff socket path '" << path
+                << "' is too long" << std::endl;
+      return false;
+    }
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path)-1);
+    return true;
+  }
+
+    // Only a process running as the same user as this process is allowed
+    // to take part in a handoff since the sockets can be used to take over
+    // the reflector
+  bool peerIsSameUser(int sock)
+  {
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+    if (getsockopt(sock, SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0)
+    {
+      perror("getsockopt(SO_PEERCRED)");
+      return false;
+    }
+    if (cred.uid != geteuid())
+    {
+      std::cout << "*** WARNING: Rejecting handoff connection from process "
+                << cred.pid << " running as uid " << cred.uid << std::endl;
+      return false;
+    }
+    return true;
+  }
+}; /* End of anonymous namespace */
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ *
+ * Local Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Public member functions
+ *
+ ****************************************************************************/
+
+ReflectorHandoff::ReflectorHandoff(const std::string& path)
+  : m_path(path)
+{
+  m_listen_watch.activity.connect(
+      mem_fun(*this, &ReflectorHandoff::onConnection));
+  m_peer_watch.activity.connect(
+      mem_fun(*this, &ReflectorHandoff::onPeerActivity));
+} /* ReflectorHandoff::ReflectorHandoff */
+
+
+ReflectorHandoff::~ReflectorHandoff(void)
+{
+  closePeer();
+  closeTakenSockets();
+  m_listen_watch.setFd(-1, FdWatch::FD_WATCH_RD);
+  if (m_listen_sock >= 0)
+  {
+    ::close(m_listen_sock);
+    m_listen_sock = -1;
+  }
+} /* ReflectorHandoff::~ReflectorHandoff */
+
+
+bool ReflectorHandoff::takeOver(void)
+{
+  struct sockaddr_un addr;
+  if (!setUnixAddr(addr, m_path))
+  {
+    return false;
+  }
+
+  m_peer_sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (m_peer_sock < 0)
+  {
+    perror("socket(AF_UNIX)");
+    return false;
+  }
+  if (connect(m_peer_sock, reinterpret_cast<struct sockaddr*>(&addr),
+              sizeof(addr)) != 0)
+  {
+    std::cerr << "*** ERROR: Could not connect to the handoff socket '"
+              << m_path << "': " << strerror(errno) << std::endl;
+    closePeer();
+    return false;
+  }
+  if (!peerIsSameUser(m_peer_sock))
+  {
+    closePeer();
+    return false;
+  }
+
+  if (!writeLine(m_peer_sock, CMD_TAKEOVER) || !receiveSockets())
+  {
+    closePeer();
+    closeTakenSockets();
+    return false;
+  }
+
+  std::cout << "Took over " << m_taken.size()
+            << " sockets from the running reflector" << std::endl;
+
+  return true;
+} /* ReflectorHandoff::takeOver */
+
+
+int ReflectorHandoff::takeSocket(const std::string& name, uint16_t port)
+{
+  auto it = m_taken.find(name);
+  if (it == m_taken.end())
+  {
+    return -1;
+  }
+  int fd = it->second;
+  m_taken.erase(it);
+
+  struct sockaddr_in addr;
+  socklen_t len = sizeof(addr);
+  if ((getsockname(fd, reinterpret_cast<struct sockaddr*>(&addr), &len) != 0)
+      || (addr.sin_family != AF_INET) || (ntohs(addr.sin_port) != port))
+  {
+    std::cout << "*** WARNING: The " << name << " socket taken over from "
+                 "the running reflector is not bound to port " << port
+              << ". Ignoring it." << std::endl;
+    ::close(fd);
+    return -1;
+  }
+
+  return fd;
+} /* ReflectorHandoff::takeSocket */
+
+
+void ReflectorHandoff::addSocket(const std::string& name, int fd)
+{
+  if ((fd >= 0) && (m_sockets.size() < MAX_SOCKETS))
+  {
+    m_sockets.push_back(std::make_pair(name, fd));
+  }
+} /* ReflectorHandoff::addSocket */
+
+
+bool ReflectorHandoff::listen(void)
+{
+  if (m_peer_sock >= 0)
+  {
+    if (!writeLine(m_peer_sock, CMD_READY))
+    {
+      std::cout << "*** WARNING: Could not tell the old reflector process "
+                   "that the handoff is complete" << std::endl;
+    }
+    closePeer();
+  }
+  closeTakenSockets();
+
+  struct sockaddr_un addr;
+  if (!setUnixAddr(addr, m_path))
+  {
+    return false;
+  }
+
+  m_listen_sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (m_listen_sock < 0)
+  {
+    perror("socket(AF_UNIX)");
+    return false;
+  }
+  unlink(m_path.c_str());
+
+    // Create the socket file with no access for other users. The umask is
+    // used since the permissions of the file cannot be set in the call to
+    // bind and there must be no window where others can connect.
+  mode_t old_umask = umask(S_IRWXG | S_IRWXO);
+  int bind_ret = bind(m_listen_sock, reinterpret_cast<struct sockaddr*>(&addr),
+                      sizeof(addr));
+  umask(old_umask);
+  if ((bind_ret != 0) ||
+      (chmod(m_path.c_str(), S_IRUSR | S_IWUSR) != 0) ||
+      (::listen(m_listen_sock, 1) != 0))
+  {
+    std::cerr << "*** ERROR: Could not listen on the handoff socket '"
+              << m_path << "': " << strerror(errno) << std::endl;
+    ::close(m_listen_sock);
+    m_listen_sock = -1;
+    return false;
+  }
+  m_listen_watch.setFd(m_listen_sock, FdWatch::FD_WATCH_RD);
+  m_listen_watch.setEnabled(true);
+
+  return true;
+} /* ReflectorHandoff::listen */
+
+
+
+/****************************************************************************
+ *
+ * Protected member functions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Private member functions
+ *
+ ****************************************************************************/
+
+void ReflectorHandoff::onConnection(Async::FdWatch *w)
+{
+  int sock = accept4(m_listen_sock, nullptr, nullptr,
+                     SOCK_CLOEXEC | SOCK_NONBLOCK);
+  if (sock < 0)
+  {
+    perror("accept4");
+    return;
+  }
+  if (m_peer_sock >= 0)
+  {
+    std::cout << "*** WARNING: Rejecting handoff connection since another "
+                 "handoff is in progress" << std::endl;
+    ::close(sock);
+    return;
+  }
+  if (!peerIsSameUser(sock))
+  {
+    ::close(sock);
+    return;
+  }
+
+  m_peer_sock = sock;
+  m_rx_buf.clear();
+  m_sockets_sent = false;
+  m_peer_watch.setFd(m_peer_sock, FdWatch::FD_WATCH_RD);
+  m_peer_watch.setEnabled(true);
+} /* ReflectorHandoff::onConnection */
+
+
+void ReflectorHandoff::onPeerActivity(Async::FdWatch *w)
+{
+  char buf[256];
+  ssize_t len = recv(m_peer_sock, buf, sizeof(buf), 0);
+  if ((len < 0) && ((errno == EAGAIN) || (errno == EINTR)))
+  {
+    return;
+  }
+  if (len <= 0)
+  {
+    bool sockets_sent = m_sockets_sent;
+    closePeer();
+    if (sockets_sent)
+    {
+      std::cout << "*** WARNING: The new reflector process disconnected "
+                   "before being ready. Handoff aborted." << std::endl;
+      handoffAborted();
+    }
+    return;
+  }
+
+  m_rx_buf.append(buf, len);
+  size_t eol;
+  while ((m_peer_sock >= 0) &&
+         ((eol = m_rx_buf.find('\n')) != std::string::npos))
+  {
+    std::string cmd(m_rx_buf, 0, eol);
+    m_rx_buf.erase(0, eol+1);
+    handleCommand(cmd);
+  }
+} /* ReflectorHandoff::onPeerActivity */
+
+
+void ReflectorHandoff::handleCommand(const std::string& cmd)
+{
+  if ((cmd == CMD_TAKEOVER) && !m_sockets_sent)
+  {
+    std::cout << "A new reflector process requested a handoff" << std::endl;
+    handoffRequested();
+    if (!sendSockets())
+    {
+      closePeer();
+      handoffAborted();
+      return;
+    }
+    m_sockets_sent = true;
+  }
+  else if ((cmd == CMD_READY) && m_sockets_sent)
+  {
+    std::cout << "The new reflector process is ready" << std::endl;
+    closePeer();
+    handedOver();
+  }
+  else
+  {
+    std::cout << "*** WARNING: Unexpected handoff command '" << cmd
+              << "'" << std::endl;
+    bool sockets_sent = m_sockets_sent;
+    closePeer();
+    if (sockets_sent)
+    {
+      handoffAborted();
+    }
+  }
+} /* ReflectorHandoff::handleCommand */
+
+
+bool ReflectorHandoff::sendSockets(void)
+{
+  std::ostringstream ss;
+  ss << CMD_SOCKETS;
+  for (const auto& socket : m_sockets)
+  {
+    ss << " " << socket.first;
+  }
+  ss << "\n";
+  std::string payload(ss.str());
+
+  struct iovec iov;
+  iov.iov_base = const_cast<char*>(payload.data());
+  iov.iov_len = payload.size();
+
+  char cbuf[CMSG_SPACE(sizeof(int) * MAX_SOCKETS)];
+  memset(cbuf, 0, sizeof(cbuf));
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  if (!m_sockets.empty())
+  {
+    msg.msg_control = cbuf;
+    msg.msg_controllen = CMSG_SPACE(sizeof(int) * m_sockets.size());
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * m_sockets.size());
+    int *fds = reinterpret_cast<int*>(CMSG_DATA(cmsg));
+    for (size_t i=0; i<m_sockets.size(); ++i)
+    {
+      fds[i] = m_sockets[i].second;
+    }
+  }
+
+  if (sendmsg(m_peer_sock, &msg, MSG_NOSIGNAL) !=
+      static_cast<ssize_t>(payload.size()))
+  {
+    perror("sendmsg");
+    return false;
+  }
+
+  return true;
+} /* ReflectorHandoff::sendSockets */
+
+
+bool ReflectorHandoff::receiveSockets(void)
+{
+  std::string payload;
+  std::vector<int> fds;
+  while (payload.find('\n') == std::string::npos)
+  {
+    struct pollfd pfd = { m_peer_sock, POLLIN, 0 };
+    int ret = poll(&pfd, 1, TAKEOVER_TIMEOUT);
+    if (ret <= 0)
+    {
+      std::cerr << "*** ERROR: Timeout waiting for sockets from the running "
+                   "reflector" << std::endl;
+      break;
+    }
+
+    char buf[256];
+    struct iovec iov;
+    iov.iov_base = buf;
+    iov.iov_len = sizeof(buf);
+    char cbuf[CMSG_SPACE(sizeof(int) * MAX_SOCKETS)];
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = cbuf;
+    msg.msg_controllen = sizeof(cbuf);
+    ssize_t len = recvmsg(m_peer_sock, &msg, MSG_CMSG_CLOEXEC);
+    if ((len < 0) && (errno == EINTR))
+    {
+      continue;
+    }
+    if (len <= 0)
+    {
+      std::cerr << "*** ERROR: The running reflector closed the handoff "
+                   "connection" << std::endl;
+      break;
+    }
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr;
+         cmsg = CMSG_NXTHDR(&msg, cmsg))
+    {
+      if ((cmsg->cmsg_level == SOL_SOCKET) &&
+          (cmsg->cmsg_type == SCM_RIGHTS))
+      {
+        size_t cnt = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        const int *cfds = reinterpret_cast<const int*>(CMSG_DATA(cmsg));
+        fds.insert(fds.end(), cfds, cfds+cnt);
+      }
+    }
+    payload.append(buf, len);
+  }
+
+  std::istringstream ss(payload.substr(0, payload.find('\n')));
+  std::string cmd;
+  std::vector<std::string> names;
+  ss >> cmd;
+  std::string name;
+  while (ss >> name)
+  {
+    names.push_back(name);
+  }
+
+  if ((cmd != CMD_SOCKETS) || (names.size() != fds.size()))
+  {
+    if (payload.find('\n') != std::string::npos)
+    {
+      std::cerr << "*** ERROR: Malformed socket handoff message from the "
+                   "running reflector" << std::endl;
+    }
+    for (int fd : fds)
+    {
+      ::close(fd);
+    }
+    return false;
+  }
+
+  for (size_t i=0; i<names.size(); ++i)
+  {
+    auto it = m_taken.find(names[i]);
+    if (it != m_taken.end())
+    {
+      ::close(it->second);
+    }
+    m_taken[names[i]] = fds[i];
+  }
+
+  return true;
+} /* ReflectorHandoff::receiveSockets */
+
+
+void ReflectorHandoff::closePeer(void)
+{
+  m_peer_watch.setFd(-1, FdWatch::FD_WATCH_RD);
+  if (m_peer_sock >= 0)
+  {
+    ::close(m_peer_sock);
+    m_peer_sock = -1;
+  }
+  m_rx_buf.clear();
+  m_sockets_sent = false;
+} /* ReflectorHandoff::closePeer */
+
+
+void ReflectorHandoff::closeTakenSockets(void)
+{
+  for (const auto& taken : m_taken)
+  {
+    ::close(taken.second);
+  }
+  m_taken.clear();
+} /* ReflectorHandoff::closeTakenSockets */
+
+
+
+/*
+ * This file has not been truncated
+ */
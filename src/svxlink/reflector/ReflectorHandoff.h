@@ -0,0 +1,250 @@
+/**
+@file	 ReflectorHandoff.h
+@brief   Hand over the server sockets to a new reflector process
+@author  Tobias Blomberg / SM0SVX
+@date	 2026-10-18
+
+\verbatim
+SvxReflector - An audio reflector for connecting SvxLink Servers
+Copyright (C) 2003-2026 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+#ifndef REFLECTOR_HANDOFF_INCLUDED
+#define REFLECTOR_HANDOFF_INCLUDED
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <sigc++/sigc++.h>
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+#include <AsyncFdWatch.h>
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Forward declarations
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Namespace
+ *
+ ****************************************************************************/
+
+//namespace MyNameSpace
+//{
+
+
+/****************************************************************************
+ *
+ * Forward declarations of classes inside of the declared namespace
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Class definitions
+ *
+ ****************************************************************************/
+
+/**
+@brief	Hand over the server sockets to a new reflector process
+@author Tobias Blomberg / SM0SVX
+@date   2026-10-18
+
+This class is used to restart the reflector without closing the server ports.
+A running reflector listen on a UNIX domain socket. A new reflector process,
+started with the --takeover command line option, connect to that socket and
+receive the listening TCP sockets and the UDP sockets as file descriptors.
+The new process use these sockets instead of binding new ones so no
+connection attempt is refused during the restart. The handoffRequested
+signal should be used to stop accepting connections and reading datagrams in
+the old process so that they are left in the sockets for the new process.
+
+When the new process is fully initialized it tell the old process that it is
+ready. The old process then exit, disconnecting its clients. The clients will
+reconnect to the new process and, since the session ticket key is shared
+through TLS_SESSION_TICKET_KEYFILE, the TLS sessions are resumed without a
+full handshake.
+
+If the new process exit before being ready, the old process just continue
+running.
+*/
+class ReflectorHandoff : public sigc::trackable
+{
+  public:
+    /**
+     * @brief 	Constructor
+     * @param 	path The path to the UNIX domain socket
+     */
+    explicit ReflectorHandoff(const std::string& path);
+
+    /**
+     * @brief 	Destructor
+     */
+    ~ReflectorHandoff(void);
+
+    /**
+     * @brief   Take over the sockets from a running reflector process
+     * @return  Returns \em true on success or else \em false
+     *
+     * This function block until the sockets have been received from the
+     * running process or a timeout occurs. It should be called before any
+     * server sockets are created.
+     */
+    bool takeOver(void);
+
+    /**
+     * @brief   Get a socket that was taken over from the old process
+     * @param   name  The name of the socket
+     * @param   port  The port that the socket is expected to be bound to
+     * @return  Returns the file descriptor or -1 if not available
+     *
+     * The caller take ownership of the returned file descriptor. If the
+     * socket is bound to another port than the given one, e.g. since the
+     * configuration have been changed, it is closed and -1 is returned.
+     */
+    int takeSocket(const std::string& name, uint16_t port);
+
+    /**
+     * @brief   Add a socket to hand over to a new process
+     * @param   name  The name of the socket
+     * @param   fd    The file descriptor of the socket
+     *
+     * The ownership of the socket is not transferred to this object.
+     */
+    void addSocket(const std::string& name, int fd);
+
+    /**
+     * @brief   Start listening for handoff requests
+     * @return  Returns \em true on success or else \em false
+     *
+     * If sockets were taken over from another process, that process is first
+     * told that this process is ready so that it can exit.
+     */
+    bool listen(void);
+
+    /**
+     * @brief   A signal that is emitted when a new process request a handoff
+     *
+     * This signal is emitted just before the sockets are sent to the new
+     * process. Resources that the new process need exclusive access to, like
+     * the command PTY, should be released.
+     */
+    sigc::signal<void> handoffRequested;
+
+    /**
+     * @brief   A signal that is emitted when a handoff is aborted
+     *
+     * This signal is emitted if the new process disconnect without first
+     * reporting that it is ready. Resources released when the handoff was
+     * requested should be acquired again.
+     */
+    sigc::signal<void> handoffAborted;
+
+    /**
+     * @brief   A signal that is emitted when the new process is ready
+     *
+     * This process should exit when this signal is emitted.
+     */
+    sigc::signal<void> handedOver;
+
+  protected:
+
+  private:
+    using SocketList = std::vector<std::pair<std::string, int>>;
+    using TakenMap = std::map<std::string, int>;
+
+    std::string     m_path;
+    int             m_listen_sock = -1;
+    Async::FdWatch  m_listen_watch;
+    int             m_peer_sock = -1;
+    Async::FdWatch  m_peer_watch;
+    std::string     m_rx_buf;
+    bool            m_sockets_sent = false;
+    SocketList      m_sockets;
+    TakenMap        m_taken;
+
+    ReflectorHandoff(const ReflectorHandoff&);
+    ReflectorHandoff& operator=(const ReflectorHandoff&);
+    void onConnection(Async::FdWatch *w);
+    void onPeerActivity(Async::FdWatch *w);
+    void handleCommand(const std::string& cmd);
+    bool sendSockets(void);
+    bool receiveSockets(void);
+    void closePeer(void);
+    void closeTakenSockets(void);
+
+};  /* class ReflectorHandoff */
+
+
+//} /* namespace */
+
+#endif /* REFLECTOR_HANDOFF_INCLUDED */
+
+
+
+/*
+ * This file has not been truncated
+ */
@@ -0,0 +1,334 @@
+/**
+@file	 ReflectorMetrics.cpp
+@brief   Counters and histograms exported by the reflector
+@author  Tobias Blomberg / SM0SVX
+@date	 2026-10-18
+
+\verbatim
+SvxReflector - An audio reflector for connecting SvxLink Servers
+Copyright (C) 2003-2026 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <map>
+#include <sstream>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "ReflectorMetrics.h"
+
+
+/****************************************************************************
+ *
+ * Namespaces to use
+ *
+ ****************************************************************************/
+
+using namespace std;
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local class definitions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local functions
+ *
+ ****************************************************************************/
+
+namespace {
+  const std::vector<double> LOOP_BOUNDS {
+    0.0001, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25,
+    0.5, 1.0
+  };
+  const std::vector<double> TALKER_BOUNDS {
+    1, 2, 5, 10, 30, 60, 120, 300, 600, 1800
+  };
+  const std::vector<double> AUTH_BOUNDS {
+    0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30
+  };
+  const std::vector<double> CA_OP_BOUNDS {
+    0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10
+  };
+
+  std::string fmtDouble(double value)
+  {
+    std::ostringstream ss;
+    ss.precision(12);
+    ss << value;
+    return ss.str();
+  }
+}; /* End of anonymous namespace */
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ *
+ * Local Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Public member functions
+ *
+ ****************************************************************************/
+
+ReflectorMetrics::Histogram::Histogram(const std::vector<double>& bounds)
+  : m_bounds(bounds), m_buckets(new std::atomic<uint64_t>[bounds.size()+1])
+{
+  assert(std::is_sorted(m_bounds.begin(), m_bounds.end()));
+  for (size_t i=0; i<=m_bounds.size(); ++i)
+  {
+    m_buckets[i].store(0, std::memory_order_relaxed);
+  }
+} /* ReflectorMetrics::Histogram::Histogram */
+
+
+void ReflectorMetrics::Histogram::observe(double value)
+{
+  if (value < 0.0)
+  {
+    value = 0.0;
+  }
+  size_t idx = std::lower_bound(m_bounds.begin(), m_bounds.end(), value) -
+               m_bounds.begin();
+  m_buckets[idx].fetch_add(1, std::memory_order_relaxed);
+  m_count.fetch_add(1, std::memory_order_relaxed);
+  m_sum_ns.fetch_add(static_cast<uint64_t>(std::llround(value * 1e9)),
+                     std::memory_order_relaxed);
+} /* ReflectorMetrics::Histogram::observe */
+
+
+void ReflectorMetrics::Histogram::write(std::ostream& os,
+    const std::string& name, const std::string& help) const
+{
+  writeHeader(os, name, "histogram", help);
+  uint64_t cumulative = 0;
+  for (size_t i=0; i<m_bounds.size(); ++i)
+  {
+    cumulative += m_buckets[i].load(std::memory_order_relaxed);
+    os << name << "_bucket{le=\"" << fmtDouble(m_bounds[i]) << "\"} "
+       << cumulative << "\n";
+  }
+  cumulative += m_buckets[m_bounds.size()].load(std::memory_order_relaxed);
+  os << name << "_bucket{le=\"+Inf\"} " << cumulative << "\n";
+  os << name << "_sum "
+     << fmtDouble(m_sum_ns.load(std::memory_order_relaxed) / 1e9) << "\n";
+  os << name << "_count " << cumulative << "\n";
+} /* ReflectorMetrics::Histogram::write */
+
+
+void ReflectorMetrics::writeHeader(std::ostream& os, const std::string& name,
+                                   const char* type, const std::string& help)
+{
+  os << "# HELP " << name << " " << help << "\n";
+  os << "# TYPE " << name << " " << type << "\n";
+} /* ReflectorMetrics::writeHeader */
+
+
+std::string ReflectorMetrics::escapeLabel(const std::string& value)
+{
+  std::string escaped;
+  escaped.reserve(value.size());
+  for (char ch : value)
+  {
+    switch (ch)
+    {
+      case '\\': escaped += "\\\\"; break;
+      case '"':  escaped += "\\\""; break;
+      case '\n': escaped += "\\n";  break;
+      default:   escaped += ch;     break;
+    }
+  }
+  return escaped;
+} /* ReflectorMetrics::escapeLabel */
+
+
+ReflectorMetrics::ReflectorMetrics(void)
+  : event_loop_lag(LOOP_BOUNDS), timer_lateness(LOOP_BOUNDS),
+    talker_duration(TALKER_BOUNDS), auth_duration(AUTH_BOUNDS),
+    ca_queue_wait(CA_OP_BOUNDS), ca_op_duration(CA_OP_BOUNDS)
+{
+  m_tg_counters[0];
+} /* ReflectorMetrics::ReflectorMetrics */
+
+
+ReflectorMetrics::~ReflectorMetrics(void)
+{
+} /* ReflectorMetrics::~ReflectorMetrics */
+
+
+void ReflectorMetrics::setTgSeries(const std::set<uint32_t>& tgs)
+{
+  m_tg_counters.clear();
+  m_tg_counters[0];
+  for (uint32_t tg : tgs)
+  {
+    m_tg_counters[tg];
+  }
+} /* ReflectorMetrics::setTgSeries */
+
+
+ReflectorMetrics::TgCounters& ReflectorMetrics::tg(uint32_t tg)
+{
+  auto it = m_tg_counters.find(tg);
+  if (it == m_tg_counters.end())
+  {
+    return m_tg_other;
+  }
+  return it->second;
+} /* ReflectorMetrics::tg */
+
+
+void ReflectorMetrics::write(std::ostream& os) const
+{
+  writeTgCounter(os, "svxreflector_udp_rx_packets_total",
+      "UDP packets received from clients per talk group",
+      &TgCounters::rx_packets);
+  writeTgCounter(os, "svxreflector_udp_rx_bytes_total",
+      "UDP payload bytes received from clients per talk group",
+      &TgCounters::rx_bytes);
+  writeTgCounter(os, "svxreflector_udp_tx_packets_total",
+      "UDP packets sent to clients per talk group",
+      &TgCounters::tx_packets);
+  writeTgCounter(os, "svxreflector_udp_tx_bytes_total",
+      "UDP payload bytes sent to clients per talk group",
+      &TgCounters::tx_bytes);
+
+  writeHeader(os, "svxreflector_udp_decrypt_failures_total", "counter",
+      "Received UDP datagrams that could not be decrypted");
+  os << "svxreflector_udp_decrypt_failures_total "
+     << udp_decrypt_failures.value() << "\n";
+  writeHeader(os, "svxreflector_udp_seq_gaps_total", "counter",
+      "Gaps detected in the UDP sequence numbers from clients");
+  os << "svxreflector_udp_seq_gaps_total " << udp_seq_gaps.value() << "\n";
+  writeHeader(os, "svxreflector_udp_lost_frames_total", "counter",
+      "UDP frames from clients missing in sequence number gaps");
+  os << "svxreflector_udp_lost_frames_total "
+     << udp_lost_frames.value() << "\n";
+  writeHeader(os, "svxreflector_udp_out_of_seq_total", "counter",
+      "UDP frames from clients dropped since they were out of sequence");
+  os << "svxreflector_udp_out_of_seq_total " << udp_out_of_seq.value() << "\n";
+  writeHeader(os, "svxreflector_udp_rx_dropped_total", "counter",
+      "UDP datagrams dropped since the receiver thread queue was full");
+  os << "svxreflector_udp_rx_dropped_total " << udp_rx_dropped.value() << "\n";
+  writeHeader(os, "svxreflector_ca_jobs_rejected_total", "counter",
+      "CA operations rejected since the worker queue was full");
+  os << "svxreflector_ca_jobs_rejected_total "
+     << ca_jobs_rejected.value() << "\n";
+
+  event_loop_lag.write(os, "svxreflector_event_loop_lag_seconds",
+      "Time from a task being queued until the event loop ran it");
+  timer_lateness.write(os, "svxreflector_timer_lateness_seconds",
+      "How late a probe timer expired compared to its scheduled time");
+  talker_duration.write(os, "svxreflector_talker_duration_seconds",
+      "Length of talker sessions");
+  auth_duration.write(os, "svxreflector_auth_duration_seconds",
+      "Time from TCP connect until a client was authenticated");
+  ca_queue_wait.write(os, "svxreflector_ca_queue_wait_seconds",
+      "Time CA operations waited for a worker thread");
+  ca_op_duration.write(os, "svxreflector_ca_op_duration_seconds",
+      "Time it took a worker thread to run a CA operation");
+} /* ReflectorMetrics::write */
+
+
+
+/****************************************************************************
+ *
+ * Protected member functions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Private member functions
+ *
+ ****************************************************************************/
+
+void ReflectorMetrics::writeTgCounter(std::ostream& os,
+    const std::string& name, const std::string& help,
+    Counter TgCounters::*counter) const
+{
+  writeHeader(os, name, "counter", help);
+    // Sort on TG to get a stable output
+  std::map<uint32_t, const TgCounters*> sorted;
+  for (const auto& item : m_tg_counters)
+  {
+    sorted[item.first] = &item.second;
+  }
+  for (const auto& item : sorted)
+  {
+    os << name << "{tg=\"" << item.first << "\"} "
+       << (item.second->*counter).value() << "\n";
+  }
+  os << name << "{tg=\"other\"} " << (m_tg_other.*counter).value() << "\n";
+} /* ReflectorMetrics::writeTgCounter */
+
+
+
+/*
+ * This file has not been truncated
+ */
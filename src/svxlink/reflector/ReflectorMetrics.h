@@ -0,0 +1,308 @@
+/**
+@file	 ReflectorMetrics.h
+@brief   Counters and histograms exported by the reflector
+@author  Tobias Blomberg / SM0SVX
+@date	 2026-10-18
+
+\verbatim
+SvxReflector - An audio reflector for connecting SvxLink Servers
+Copyright (C) 2003-2026 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+#ifndef REFLECTOR_METRICS_INCLUDED
+#define REFLECTOR_METRICS_INCLUDED
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <ostream>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Forward declarations
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Namespace
+ *
+ ****************************************************************************/
+
+//namespace MyNameSpace
+//{
+
+
+/****************************************************************************
+ *
+ * Forward declarations of classes inside of the declared namespace
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Class definitions
+ *
+ ****************************************************************************/
+
+/**
+@brief	Counters and histograms exported by the reflector
+@author Tobias Blomberg / SM0SVX
+@date   2026-10-18
+
+This class hold the internal metrics of the reflector and know how to write
+them in the Prometheus text exposition format, which is what is served on the
+/metrics HTTP endpoint. Updating a metric is a relaxed atomic increment so it
+is cheap enough to be done for every UDP packet.
+
+Clients may select any talk group so only the talk groups given to the
+setTgSeries function get a series of their own. Traffic on all other talk
+groups is counted in a single series with the label tg="other".
+
+Metrics that are better read from the current state of the reflector, like
+the TCP queue depth of each client, are written by the Reflector class using
+the writeHeader function.
+*/
+class ReflectorMetrics
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief   A monotonically increasing counter
+     */
+    class Counter
+    {
+      public:
+        void inc(uint64_t n=1)
+        {
+          m_value.fetch_add(n, std::memory_order_relaxed);
+        }
+        uint64_t value(void) const
+        {
+          return m_value.load(std::memory_order_relaxed);
+        }
+
+      private:
+        std::atomic<uint64_t> m_value{0};
+    };
+
+    /**
+     * @brief   A histogram with fixed bucket boundaries
+     *
+     * Observed values are given in seconds. The sum is kept in nanoseconds
+     * so that it can be updated using an atomic integer operation.
+     */
+    class Histogram
+    {
+      public:
+        /**
+         * @brief   Constructor
+         * @param   bounds The upper bounds, in seconds, of the buckets in
+         *                 increasing order. A +Inf bucket is always added.
+         */
+        explicit Histogram(const std::vector<double>& bounds);
+
+        /**
+         * @brief   Add an observation to the histogram
+         * @param   value The observed value in seconds
+         */
+        void observe(double value);
+
+        /**
+         * @brief   Add an observation to the histogram
+         * @param   duration The observed duration
+         */
+        void observe(Clock::duration duration)
+        {
+          observe(std::chrono::duration<double>(duration).count());
+        }
+
+        /**
+         * @brief   Write the histogram in Prometheus text format
+         * @param   os    The stream to write to
+         * @param   name  The name of the metric
+         * @param   help  The help text for the metric
+         */
+        void write(std::ostream& os, const std::string& name,
+                   const std::string& help) const;
+
+      private:
+        std::vector<double>                     m_bounds;
+        std::unique_ptr<std::atomic<uint64_t>[]> m_buckets;
+        std::atomic<uint64_t>                   m_count{0};
+        std::atomic<uint64_t>                   m_sum_ns{0};
+
+        Histogram(const Histogram&);
+        Histogram& operator=(const Histogram&);
+    };
+
+    /**
+     * @brief   UDP traffic counters for one talk group
+     */
+    struct TgCounters
+    {
+      Counter rx_packets;
+      Counter rx_bytes;
+      Counter tx_packets;
+      Counter tx_bytes;
+    };
+
+    /**
+     * @brief   Write the HELP and TYPE lines for a metric
+     * @param   os    The stream to write to
+     * @param   name  The name of the metric
+     * @param   type  The metric type (counter, gauge, histogram)
+     * @param   help  The help text for the metric
+     */
+    static void writeHeader(std::ostream& os, const std::string& name,
+                            const char* type, const std::string& help);
+
+    /**
+     * @brief   Escape a string for use as a label value
+     * @param   value The label value to escape
+     * @return  Returns the escaped string
+     */
+    static std::string escapeLabel(const std::string& value);
+
+    Counter   udp_decrypt_failures;
+    Counter   udp_seq_gaps;
+    Counter   udp_lost_frames;
+    Counter   udp_out_of_seq;
+    Counter   udp_rx_dropped;
+    Counter   ca_jobs_rejected;
+    Histogram event_loop_lag;
+    Histogram timer_lateness;
+    Histogram talker_duration;
+    Histogram auth_duration;
+    Histogram ca_queue_wait;
+    Histogram ca_op_duration;
+
+    /**
+     * @brief 	Default constructor
+     */
+    ReflectorMetrics(void);
+
+    /**
+     * @brief 	Destructor
+     */
+    ~ReflectorMetrics(void);
+
+    /**
+     * @brief   Set the talk groups that should have counters of their own
+     * @param   tgs The talk groups
+     *
+     * Talk group 0, used for clients not on any talk group, always have
+     * counters of its own. This function must be called before any client
+     * hold a reference returned by the tg function.
+     */
+    void setTgSeries(const std::set<uint32_t>& tgs);
+
+    /**
+     * @brief   Get the UDP traffic counters for a talk group
+     * @param   tg The talk group, 0 for clients not on any talk group
+     * @return  Returns the counters for the given talk group
+     *
+     * The returned counters are shared by all talk groups that have not been
+     * given to setTgSeries. The counters live as long as this object. This
+     * is a hash table lookup so the result should be cached by the caller.
+     */
+    TgCounters& tg(uint32_t tg);
+
+    /**
+     * @brief   Write all metrics held by this object
+     * @param   os The stream to write to
+     */
+    void write(std::ostream& os) const;
+
+  protected:
+
+  private:
+    using TgCountersMap = std::unordered_map<uint32_t, TgCounters>;
+
+    TgCountersMap m_tg_counters;
+    TgCounters    m_tg_other;
+
+    ReflectorMetrics(const ReflectorMetrics&);
+    ReflectorMetrics& operator=(const ReflectorMetrics&);
+    void writeTgCounter(std::ostream& os, const std::string& name,
+                        const std::string& help,
+                        Counter TgCounters::*counter) const;
+
+};  /* class ReflectorMetrics */
+
+
+//} /* namespace */
+
+#endif /* REFLECTOR_METRICS_INCLUDED */
+
+
+
+/*
+ * This file has not been truncated
+ */
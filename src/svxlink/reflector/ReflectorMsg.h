@@ -312,7 +312,7 @@ class MsgProtoVer : public ReflectorMsgBase<5>
 {
   public:
     static const uint16_t MAJOR = 3;
-    static const uint16_t MINOR = 0;
+    static const uint16_t MINOR = 1;
     MsgProtoVer(void) : m_major(MAJOR), m_minor(MINOR) {}
     MsgProtoVer(uint16_t major, uint16_t minor)
       : m_major(major), m_minor(minor) {}
@@ -1395,6 +1395,262 @@ class MsgStartUdpEncryption : public ReflectorMsgBase<114>
 }; /* MsgStartUdpEncryption */
 
 
+/**
+@brief   Node list delta TCP network message
+@author  Tobias Blomberg / SM0SVX
+@date    2026-10-18
+
+This message is sent by the server to clients using protocol version 3.1 or
+later instead of MsgNodeJoined and MsgNodeLeft. Node join and leave events
+that happen within a short time window are coalesced into one message. Each
+node is only listed once, in the joined or the left list, depending on its
+state at the time the message was sent. The message describe the resulting
+state so it's safe to apply it on a node list that already contain the
+change.
+*/
+class MsgNodeListDelta : public ReflectorMsgBase<115>
+{
+  public:
+    MsgNodeListDelta(void) {}
+
+    std::vector<std::string>& joined(void) { return m_joined; }
+    const std::vector<std::string>& joined(void) const { return m_joined; }
+    std::vector<std::string>& left(void) { return m_left; }
+    const std::vector<std::string>& left(void) const { return m_left; }
+
+    ASYNC_MSG_MEMBERS(m_joined, m_left)
+
+  private:
+    std::vector<std::string> m_joined;
+    std::vector<std::string> m_left;
+}; /* MsgNodeListDelta */
+
+
+/****************************** Trunk Messages ******************************/
+
+/**
+@brief	 Trunk hello TCP network message
+@author  Tobias Blomberg / SM0SVX
+@date    2026-10-18
+
+This message is sent by both sides of a trunk between two reflectors when
+the TLS session has been established. It contain the trunk protocol
+version, the identity of the sending reflector and an authentication
+challenge. The other side answer with a MsgTrunkAuth.
+*/
+class MsgTrunkHello : public ReflectorMsgBase<200>
+{
+  public:
+    static const uint16_t MAJOR = 2;
+    static const uint16_t MINOR = 0;
+
+    MsgTrunkHello(const std::string& id="")
+      : m_major(MAJOR), m_minor(MINOR), m_id(id),
+        m_challenge(MsgAuthChallenge::LENGTH)
+    {
+      if (RAND_bytes(&m_challenge.front(), m_challenge.size()) != 1)
+      {
+        unsigned long err = ERR_get_error();
+        std::cerr << "*** WARNING: Failed to generate trunk challenge. "
+                     "RAND_bytes failed with error code " << err
+                  << std::endl;
+        m_challenge.clear();
+      }
+    }
+
+    uint16_t majorVer(void) const { return m_major; }
+    uint16_t minorVer(void) const { return m_minor; }
+    const std::string& id(void) const { return m_id; }
+
+    const uint8_t *challenge(void) const
+    {
+      if (m_challenge.size() != MsgAuthChallenge::LENGTH)
+      {
+        return nullptr;
+      }
+      return &m_challenge[0];
+    }
+
+    ASYNC_MSG_MEMBERS(m_major, m_minor, m_id, m_challenge);
+
+  private:
+    uint16_t             m_major;
+    uint16_t             m_minor;
+    std::string          m_id;
+    std::vector<uint8_t> m_challenge;
+}; /* MsgTrunkHello */
+
+
+/**
+@brief	 Trunk talk group interest TCP network message
+@author  Tobias Blomberg / SM0SVX
+@date    2026-10-18
+
+This message is sent over a trunk to tell the other reflector which talk
+groups that have local nodes with the talk group selected. Audio is only sent
+over the trunk for these talk groups. Nodes that only monitor a talk group
+do not receive audio for it so they do not count. Talker start and stop are
+sent for all talk groups so that monitoring nodes are still notified. The
+message is resent whenever the set change.
+*/
+class MsgTrunkInterest : public ReflectorMsgBase<201>
+{
+  public:
+    MsgTrunkInterest(void) {}
+    MsgTrunkInterest(const std::set<uint32_t>& tgs) : m_tgs(tgs) {}
+
+    const std::set<uint32_t>& tgs(void) const { return m_tgs; }
+
+    ASYNC_MSG_MEMBERS(m_tgs);
+
+  private:
+    std::set<uint32_t> m_tgs;
+}; /* MsgTrunkInterest */
+
+
+/**
+@brief	 Trunk talker start TCP network message
+@author  Tobias Blomberg / SM0SVX
+@date    2026-10-18
+
+This message is sent over a trunk when a node connected to the sending
+reflector become the talker on a talk group. It is sent to all trunks,
+independent of talk group interest, so that the talker lock is consistent
+across the cluster.
+*/
+class MsgTrunkTalkerStart : public ReflectorMsgBase<202>
+{
+  public:
+    MsgTrunkTalkerStart(uint32_t tg=0, const std::string& callsign="")
+      : m_tg(tg), m_callsign(callsign) {}
+
+    uint32_t tg(void) const { return m_tg; }
+    const std::string& callsign(void) const { return m_callsign; }
+
+    ASYNC_MSG_MEMBERS(m_tg, m_callsign);
+
+  private:
+    uint32_t    m_tg;
+    std::string m_callsign;
+}; /* MsgTrunkTalkerStart */
+
+
+/**
+@brief	 Trunk talker stop TCP network message
+@author  Tobias Blomberg / SM0SVX
+@date    2026-10-18
+
+This message is sent over a trunk when a node connected to the sending
+reflector stop being the talker on a talk group. It also mark the end of the
+audio stream.
+*/
+class MsgTrunkTalkerStop : public ReflectorMsgBase<203>
+{
+  public:
+    MsgTrunkTalkerStop(uint32_t tg=0, const std::string& callsign="")
+      : m_tg(tg), m_callsign(callsign) {}
+
+    uint32_t tg(void) const { return m_tg; }
+    const std::string& callsign(void) const { return m_callsign; }
+
+    ASYNC_MSG_MEMBERS(m_tg, m_callsign);
+
+  private:
+    uint32_t    m_tg;
+    std::string m_callsign;
+}; /* MsgTrunkTalkerStop */
+
+
+/**
+@brief	 Trunk audio TCP network message
+@author  Tobias Blomberg / SM0SVX
+@date    2026-10-18
+
+This message carry one encoded audio frame from the current talker on a talk
+group to the other side of a trunk. The audio data is forwarded as is, just
+like the payload of a MsgUdpAudio message.
+*/
+class MsgTrunkAudio : public ReflectorMsgBase<204>
+{
+  public:
+    MsgTrunkAudio(void) : m_tg(0) {}
+    MsgTrunkAudio(uint32_t tg, const std::vector<uint8_t>& audio_data)
+      : m_tg(tg), m_audio_data(audio_data) {}
+
+    uint32_t tg(void) const { return m_tg; }
+    const std::vector<uint8_t>& audioData(void) const { return m_audio_data; }
+
+    ASYNC_MSG_MEMBERS(m_tg, m_audio_data);
+
+  private:
+    uint32_t             m_tg;
+    std::vector<uint8_t> m_audio_data;
+}; /* MsgTrunkAudio */
+
+
+/**
+@brief	 Trunk authentication TCP network message
+@author  Tobias Blomberg / SM0SVX
+@date    2026-10-18
+
+This message is sent by both sides of a trunk in response to the
+MsgTrunkHello from the other side. The digest is a HMAC-SHA256, keyed with the
+shared trunk secret, calculated over authentication data that is put together
+by the ReflectorTrunk class. The data contain the identities of both
+reflectors, the role of the sender, both challenges and keying material
+exported from the TLS session so that a digest cannot be reflected back to its
+sender, replayed or relayed through a man in the middle.
+*/
+class MsgTrunkAuth : public ReflectorMsgBase<205>
+{
+  public:
+    MsgTrunkAuth(void) {}
+
+    /**
+     * @brief   Constructor
+     * @param   key   The shared trunk secret
+     * @param   data  The authentication data
+     */
+    MsgTrunkAuth(const std::string& key, const std::vector<uint8_t>& data)
+    {
+      if (!calcHMAC(m_digest, key, data))
+      {
+        std::cerr << "*** ERROR: Digest calculation failed in MsgTrunkAuth"
+                  << std::endl;
+        abort();
+      }
+    }
+
+    /**
+     * @brief   Verify that the given key and data match the digest
+     * @param   key   The shared trunk secret
+     * @param   data  The authentication data expected from the other side
+     */
+    bool verify(const std::string& key, const std::vector<uint8_t>& data) const
+    {
+      Async::Digest::Signature digest;
+      return calcHMAC(digest, key, data) &&
+             Async::Digest::sigEqual(m_digest, digest);
+    }
+
+    ASYNC_MSG_MEMBERS(m_digest);
+
+  private:
+    std::vector<uint8_t> m_digest;
+
+    static bool calcHMAC(Async::Digest::Signature& hmac,
+                         const std::string& key,
+                         const std::vector<uint8_t>& data)
+    {
+      Async::SslKeypair pkey;
+      Async::Digest dgst;
+      return pkey.newRawPrivateKey(EVP_PKEY_HMAC, key) &&
+             dgst.signInit("sha256", pkey) &&
+             dgst.sign(hmac, data);
+    }
+}; /* MsgTrunkAuth */
+
+
 /***************************** UDP Messages *****************************/
 
 /**
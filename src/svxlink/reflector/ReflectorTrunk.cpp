@@ -0,0 +1,637 @@
+/**
+@file	 ReflectorTrunk.cpp
+@brief   A trunk link between two reflectors
+@author  Tobias Blomberg / SM0SVX
+@date	 2026-10-18
+
+\verbatim
+SvxReflector - An audio reflector for connecting SvxLink Servers
+Copyright (C) 2003-2026 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <cassert>
+#include <iostream>
+#include <sstream>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+#include <AsyncConfig.h>
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "ReflectorTrunk.h"
+
+
+/****************************************************************************
+ *
+ * Namespaces to use
+ *
+ ****************************************************************************/
+
+using namespace std;
+using namespace Async;
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local class definitions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Prototypes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ *
+ * Local Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Public member functions
+ *
+ ****************************************************************************/
+
+ReflectorTrunk::ReflectorTrunk(Async::Config& cfg, const std::string& section,
+                               const std::string& local_id)
+  : m_cfg(cfg), m_section(section), m_local_id(local_id),
+    m_reconnect_timer(RECONNECT_INTERVAL, Timer::TYPE_ONESHOT, false),
+    m_heartbeat_timer(HEARTBEAT_INTERVAL, Timer::TYPE_PERIODIC, false)
+{
+  m_reconnect_timer.expired.connect(
+      [&](Async::Timer*)
+      {
+        m_client->connect();
+      });
+  m_heartbeat_timer.expired.connect(
+      mem_fun(*this, &ReflectorTrunk::handleHeartbeat));
+} /* ReflectorTrunk::ReflectorTrunk */
+
+
+ReflectorTrunk::~ReflectorTrunk(void)
+{
+  delete m_client;
+  m_client = nullptr;
+} /* ReflectorTrunk::~ReflectorTrunk */
+
+
+bool ReflectorTrunk::initialize(void)
+{
+  if (!m_cfg.getValue(m_section, "PEER_ID", m_peer_id) || m_peer_id.empty())
+  {
+    std::cerr << "*** ERROR: Config variable " << m_section
+              << "/PEER_ID not set" << std::endl;
+    return false;
+  }
+  if (m_peer_id == m_local_id)
+  {
+    std::cerr << "*** ERROR: " << m_section << "/PEER_ID must not be the same "
+                 "as GLOBAL/TRUNK_ID" << std::endl;
+    return false;
+  }
+  if (!m_cfg.getValue(m_section, "SECRET", m_secret) || m_secret.empty())
+  {
+    std::cerr << "*** ERROR: Config variable " << m_section
+              << "/SECRET not set" << std::endl;
+    return false;
+  }
+  m_cfg.getValue(m_section, "HOST", m_host);
+  m_cfg.getValue(m_section, "PORT", m_port);
+
+  if (!m_host.empty())
+  {
+    m_client = new FramedTcpClient(m_host, m_port);
+    m_client->setMaxFrameSize(ReflectorMsg::MAX_SSL_SETUP_FRAME_SIZE);
+    m_client->setSslContext(m_ssl_ctx);
+      // The certificate of the other reflector is not verified. The peer is
+      // authenticated using the shared secret in a way that is bound to the
+      // TLS session, so a man in the middle will be detected anyway.
+    m_client->verifyPeer.connect(
+        [](Async::TcpConnection*, bool, X509_STORE_CTX*) { return true; });
+    m_client->sslConnectionReady.connect(
+        mem_fun(*this, &ReflectorTrunk::onSslConnectionReady));
+    m_client->connected.connect(
+        mem_fun(*this, &ReflectorTrunk::onConnected));
+    m_client->disconnected.connect(
+        mem_fun(*this, &ReflectorTrunk::onDisconnected));
+    m_client->frameReceived.connect(
+        mem_fun(*this, &ReflectorTrunk::onFrameReceived));
+    m_client->connect();
+  }
+
+  return true;
+} /* ReflectorTrunk::initialize */
+
+
+bool ReflectorTrunk::acceptConnection(Async::FramedTcpConnection *con,
+                                      const MsgTrunkHello& hello)
+{
+  if (m_client != nullptr)
+  {
+    std::cerr << "*** WARNING[" << m_section << "]: Rejecting incoming trunk "
+                 "connection from " << con->remoteHost() << ":"
+              << con->remotePort() << " since HOST is set for this trunk. "
+                 "HOST should only be set on one side of a trunk."
+              << std::endl;
+    return false;
+  }
+  if (m_con != nullptr)
+  {
+    std::cout << m_section << ": Replacing trunk connection from "
+              << m_con->remoteHost() << ":" << m_con->remotePort()
+              << std::endl;
+    linkFailed("Replaced by new connection");
+  }
+
+  m_con = con;
+  startHandshake();
+  handleHello(hello);
+  return true;
+} /* ReflectorTrunk::acceptConnection */
+
+
+void ReflectorTrunk::connectionClosed(Async::FramedTcpConnection *con)
+{
+  if (con == m_con)
+  {
+    std::cout << m_section << ": Trunk connection closed by "
+              << con->remoteHost() << ":" << con->remotePort() << std::endl;
+    setDisconnected();
+  }
+} /* ReflectorTrunk::connectionClosed */
+
+
+void ReflectorTrunk::handleFrame(Async::FramedTcpConnection *con,
+                                 std::vector<uint8_t>& data)
+{
+  onFrameReceived(con, data);
+} /* ReflectorTrunk::handleFrame */
+
+
+void ReflectorTrunk::setLocalInterest(const std::set<uint32_t>& tgs)
+{
+  if (tgs == m_local_tgs)
+  {
+    return;
+  }
+  m_local_tgs = tgs;
+  if (isUp())
+  {
+    sendMsg(MsgTrunkInterest(m_local_tgs));
+  }
+} /* ReflectorTrunk::setLocalInterest */
+
+
+void ReflectorTrunk::sendTalkerStart(uint32_t tg, const std::string& callsign)
+{
+  if (isUp())
+  {
+    sendMsg(MsgTrunkTalkerStart(tg, callsign));
+  }
+} /* ReflectorTrunk::sendTalkerStart */
+
+
+void ReflectorTrunk::sendTalkerStop(uint32_t tg, const std::string& callsign)
+{
+  if (isUp())
+  {
+    sendMsg(MsgTrunkTalkerStop(tg, callsign));
+  }
+} /* ReflectorTrunk::sendTalkerStop */
+
+
+void ReflectorTrunk::sendAudio(uint32_t tg, const std::vector<uint8_t>& audio)
+{
+  if (isUp() && peerInterested(tg))
+  {
+    sendMsg(MsgTrunkAudio(tg, audio));
+  }
+} /* ReflectorTrunk::sendAudio */
+
+
+
+/****************************************************************************
+ *
+ * Protected member functions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Private member functions
+ *
+ ****************************************************************************/
+
+void ReflectorTrunk::onConnected(void)
+{
+  std::cout << m_section << ": Trunk connection established to "
+            << m_client->remoteHost() << ":" << m_client->remotePort()
+            << std::endl;
+  m_con = m_client;
+  m_state = STATE_EXPECT_SSL_CON_READY;
+  m_heartbeat_rx_cnt = 0;
+  m_heartbeat_timer.setEnable(true);
+  m_client->enableSsl(true);
+} /* ReflectorTrunk::onConnected */
+
+
+void ReflectorTrunk::onSslConnectionReady(Async::TcpConnection *con)
+{
+  if ((con != m_con) || (m_state != STATE_EXPECT_SSL_CON_READY))
+  {
+    linkFailed("Unexpected TLS connection ready event");
+    return;
+  }
+  startHandshake();
+} /* ReflectorTrunk::onSslConnectionReady */
+
+
+void ReflectorTrunk::onDisconnected(Async::TcpConnection *con,
+                                    Async::TcpConnection::DisconnectReason reason)
+{
+  if (m_con != nullptr)
+  {
+    std::cout << m_section << ": Trunk connection to "
+              << con->remoteHost() << ":" << con->remotePort()
+              << " closed: " << TcpConnection::disconnectReasonStr(reason)
+              << std::endl;
+  }
+  setDisconnected();
+} /* ReflectorTrunk::onDisconnected */
+
+
+void ReflectorTrunk::onFrameReceived(Async::FramedTcpConnection *con,
+                                     std::vector<uint8_t>& data)
+{
+  if ((con != m_con) || (m_state == STATE_DISCONNECTED))
+  {
+    return;
+  }
+
+  stringstream ss;
+  ss.write(reinterpret_cast<const char*>(data.data()), data.size());
+
+  ReflectorMsg header;
+  if (!header.unpack(ss))
+  {
+    linkFailed("Unpacking failed for trunk message header");
+    return;
+  }
+
+  m_heartbeat_rx_cnt = 0;
+
+  if ((m_state != STATE_UP) && (header.type() != MsgHeartbeat::TYPE) &&
+      (header.type() != MsgTrunkHello::TYPE) &&
+      (header.type() != MsgTrunkAuth::TYPE))
+  {
+    linkFailed("Unexpected message before authentication");
+    return;
+  }
+
+  switch (header.type())
+  {
+    case MsgHeartbeat::TYPE:
+      break;
+    case MsgTrunkHello::TYPE:
+    {
+      MsgTrunkHello msg;
+      if (!msg.unpack(ss))
+      {
+        linkFailed("Could not unpack MsgTrunkHello");
+        return;
+      }
+      handleHello(msg);
+      break;
+    }
+    case MsgTrunkAuth::TYPE:
+      handleAuth(ss);
+      break;
+    case MsgTrunkInterest::TYPE:
+      handleInterest(ss);
+      break;
+    case MsgTrunkTalkerStart::TYPE:
+      handleTalkerStart(ss);
+      break;
+    case MsgTrunkTalkerStop::TYPE:
+      handleTalkerStop(ss);
+      break;
+    case MsgTrunkAudio::TYPE:
+      handleAudio(ss);
+      break;
+    default:
+      // Ignore unknown messages to make it possible to extend the trunk
+      // protocol in a backwards compatible way
+      break;
+  }
+} /* ReflectorTrunk::onFrameReceived */
+
+
+void ReflectorTrunk::startHandshake(void)
+{
+  m_hello = MsgTrunkHello(m_local_id);
+  m_state = STATE_EXPECT_HELLO;
+  m_heartbeat_rx_cnt = 0;
+  m_heartbeat_timer.setEnable(true);
+  sendMsg(m_hello);
+} /* ReflectorTrunk::startHandshake */
+
+
+void ReflectorTrunk::handleHello(const MsgTrunkHello& msg)
+{
+  if (m_state != STATE_EXPECT_HELLO)
+  {
+    linkFailed("Unexpected MsgTrunkHello");
+    return;
+  }
+  if (msg.majorVer() != MsgTrunkHello::MAJOR)
+  {
+    std::ostringstream ss;
+    ss << "Unsupported trunk protocol version " << msg.majorVer() << "."
+       << msg.minorVer();
+    linkFailed(ss.str());
+    return;
+  }
+  if (msg.id() != m_peer_id)
+  {
+    linkFailed("Peer identified itself as \"" + msg.id() +
+               "\" but \"" + m_peer_id + "\" was expected");
+    return;
+  }
+  if ((msg.challenge() == nullptr) || (m_hello.challenge() == nullptr))
+  {
+    linkFailed("Invalid authentication challenge");
+    return;
+  }
+  m_peer_challenge.assign(msg.challenge(),
+                          msg.challenge() + MsgAuthChallenge::LENGTH);
+  const std::vector<uint8_t> auth_data(authData(true));
+  if (auth_data.empty())
+  {
+    linkFailed("Could not export keying material from the TLS session");
+    return;
+  }
+  sendMsg(MsgTrunkAuth(m_secret, auth_data));
+  m_state = STATE_EXPECT_AUTH;
+} /* ReflectorTrunk::handleHello */
+
+
+void ReflectorTrunk::handleAuth(std::istream& is)
+{
+  MsgTrunkAuth msg;
+  if (!msg.unpack(is))
+  {
+    linkFailed("Could not unpack MsgTrunkAuth");
+    return;
+  }
+  if (m_state != STATE_EXPECT_AUTH)
+  {
+    linkFailed("Unexpected MsgTrunkAuth");
+    return;
+  }
+  const std::vector<uint8_t> auth_data(authData(false));
+  if (auth_data.empty() || !msg.verify(m_secret, auth_data))
+  {
+    linkFailed("Authentication failed");
+    return;
+  }
+
+  m_con->setMaxRxFrameSize(ReflectorMsg::MAX_POSTAUTH_FRAME_SIZE);
+  m_state = STATE_UP;
+  std::cout << m_section << ": Trunk to " << m_peer_id << " is up"
+            << std::endl;
+  sendMsg(MsgTrunkInterest(m_local_tgs));
+  linkUp(this);
+} /* ReflectorTrunk::handleAuth */
+
+
+std::vector<uint8_t> ReflectorTrunk::authData(bool local_is_sender) const
+{
+    // The data is made unique for each direction by including the role of
+    // the sender and the identities in sender, receiver order. The
+    // challenges make it unique for each handshake and the keying material
+    // exported from TLS bind it to this very TLS session.
+  const bool local_is_client = (m_con == m_client);
+  const bool sender_is_client = (local_is_client == local_is_sender);
+  const std::string& sender_id = local_is_sender ? m_local_id : m_peer_id;
+  const std::string& receiver_id = local_is_sender ? m_peer_id : m_local_id;
+  const uint8_t* sender_challenge =
+    local_is_sender ? m_hello.challenge() : m_peer_challenge.data();
+  const uint8_t* receiver_challenge =
+    local_is_sender ? m_peer_challenge.data() : m_hello.challenge();
+
+  std::vector<uint8_t> data;
+  const std::string label("SvxReflector trunk");
+  data.insert(data.end(), label.begin(), label.end());
+  data.push_back(sender_is_client ? 'C' : 'S');
+  for (const std::string* id : {&sender_id, &receiver_id})
+  {
+    data.push_back(id->size() >> 8);
+    data.push_back(id->size() & 0xff);
+    data.insert(data.end(), id->begin(), id->end());
+  }
+  data.insert(data.end(), sender_challenge,
+              sender_challenge + MsgAuthChallenge::LENGTH);
+  data.insert(data.end(), receiver_challenge,
+              receiver_challenge + MsgAuthChallenge::LENGTH);
+
+  const size_t pos = data.size();
+  data.resize(pos + TLS_BINDING_LEN);
+  if (!m_con->sslExportKeyingMaterial(&data[pos], TLS_BINDING_LEN,
+                                      "EXPORTER-SvxReflector-trunk"))
+  {
+    data.clear();
+  }
+  return data;
+} /* ReflectorTrunk::authData */
+
+
+void ReflectorTrunk::handleInterest(std::istream& is)
+{
+  MsgTrunkInterest msg;
+  if (!msg.unpack(is))
+  {
+    linkFailed("Could not unpack MsgTrunkInterest");
+    return;
+  }
+  m_peer_tgs = msg.tgs();
+} /* ReflectorTrunk::handleInterest */
+
+
+void ReflectorTrunk::handleTalkerStart(std::istream& is)
+{
+  MsgTrunkTalkerStart msg;
+  if (!msg.unpack(is))
+  {
+    linkFailed("Could not unpack MsgTrunkTalkerStart");
+    return;
+  }
+  talkerStartReceived(this, msg.tg(), msg.callsign());
+} /* ReflectorTrunk::handleTalkerStart */
+
+
+void ReflectorTrunk::handleTalkerStop(std::istream& is)
+{
+  MsgTrunkTalkerStop msg;
+  if (!msg.unpack(is))
+  {
+    linkFailed("Could not unpack MsgTrunkTalkerStop");
+    return;
+  }
+  talkerStopReceived(this, msg.tg(), msg.callsign());
+} /* ReflectorTrunk::handleTalkerStop */
+
+
+void ReflectorTrunk::handleAudio(std::istream& is)
+{
+  MsgTrunkAudio msg;
+  if (!msg.unpack(is))
+  {
+    linkFailed("Could not unpack MsgTrunkAudio");
+    return;
+  }
+  audioReceived(this, msg.tg(), msg.audioData());
+} /* ReflectorTrunk::handleAudio */
+
+
+void ReflectorTrunk::sendMsg(const ReflectorMsg& msg)
+{
+  if ((m_con == nullptr) || !m_con->isConnected())
+  {
+    return;
+  }
+  ostringstream ss;
+  ReflectorMsg header(msg.type());
+  if (!header.pack(ss) || !msg.pack(ss))
+  {
+    std::cerr << "*** ERROR[" << m_section << "]: Failed to pack trunk "
+                 "message with type " << msg.type() << std::endl;
+    return;
+  }
+  const std::string buf(ss.str());
+  if (m_con->write(buf.data(), buf.size()) == -1)
+  {
+    linkFailed("Failed to write to trunk connection");
+  }
+} /* ReflectorTrunk::sendMsg */
+
+
+void ReflectorTrunk::handleHeartbeat(Async::Timer *t)
+{
+  if (++m_heartbeat_rx_cnt > HEARTBEAT_RX_CNT_MAX)
+  {
+    linkFailed("Heartbeat timeout");
+    return;
+  }
+  if (m_state != STATE_EXPECT_SSL_CON_READY)
+  {
+    sendMsg(MsgHeartbeat());
+  }
+} /* ReflectorTrunk::handleHeartbeat */
+
+
+void ReflectorTrunk::linkFailed(const std::string& reason)
+{
+  if (m_con == nullptr)
+  {
+    return;
+  }
+  std::cerr << "*** WARNING[" << m_section << "]: " << reason
+            << ". Closing trunk connection to " << m_con->remoteHost() << ":"
+            << m_con->remotePort() << std::endl;
+  Async::FramedTcpConnection *con = m_con;
+  setDisconnected();
+  con->disconnect();
+  if (con != m_client)
+  {
+      // Let the TCP server clean up the connection object
+    con->disconnected(con, TcpConnection::DR_ORDERED_DISCONNECT);
+  }
+} /* ReflectorTrunk::linkFailed */
+
+
+void ReflectorTrunk::setDisconnected(void)
+{
+  bool was_up = isUp();
+  m_con = nullptr;
+  m_state = STATE_DISCONNECTED;
+  m_heartbeat_timer.setEnable(false);
+  m_peer_tgs.clear();
+  if (m_client != nullptr)
+  {
+    m_reconnect_timer.setEnable(false);
+    m_reconnect_timer.setEnable(true);
+  }
+  if (was_up)
+  {
+    std::cout << m_section << ": Trunk to " << m_peer_id << " is down"
+              << std::endl;
+    linkDown(this);
+  }
+} /* ReflectorTrunk::setDisconnected */
+
+
+
+/*
+ * This file has not been truncated
+ */
@@ -0,0 +1,366 @@
+/**
+@file	 ReflectorTrunk.h
+@brief   A trunk link between two reflectors
+@author  Tobias Blomberg / SM0SVX
+@date	 2026-10-18
+
+\verbatim
+SvxReflector - An audio reflector for connecting SvxLink Servers
+Copyright (C) 2003-2026 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+#ifndef REFLECTOR_TRUNK_INCLUDED
+#define REFLECTOR_TRUNK_INCLUDED
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <sigc++/sigc++.h>
+#include <stdint.h>
+
+#include <set>
+#include <string>
+#include <vector>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+#include <AsyncTcpClient.h>
+#include <AsyncFramedTcpConnection.h>
+#include <AsyncSslContext.h>
+#include <AsyncTimer.h>
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "ReflectorMsg.h"
+
+
+/****************************************************************************
+ *
+ * Forward declarations
+ *
+ ****************************************************************************/
+
+namespace Async
+{
+  class Config;
+};
+
+
+/****************************************************************************
+ *
+ * Namespace
+ *
+ ****************************************************************************/
+
+//namespace MyNameSpace
+//{
+
+
+/****************************************************************************
+ *
+ * Forward declarations of classes inside of the declared namespace
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Class definitions
+ *
+ ****************************************************************************/
+
+/**
+@brief	A trunk link between two reflectors
+@author Tobias Blomberg / SM0SVX
+@date   2026-10-18
+
+This class handle one trunk link to another reflector in a cluster. A trunk
+is configured in a section of its own in the reflector configuration file.
+If the HOST configuration variable is set, this side will connect to the
+other reflector. Otherwise this side wait for the other reflector to connect
+to the trunk port. HOST should be set on one side of each trunk only.
+
+All traffic on the trunk is encrypted using TLS. The connecting side does not
+verify the certificate of the other reflector. Instead, when the TLS session
+has been established, both sides send a MsgTrunkHello containing their
+identity and an authentication challenge. The challenge is answered with a
+MsgTrunkAuth, a HMAC calculated using the shared secret over both identities,
+the role of the sender, both challenges and keying material exported from
+the TLS session. Binding the HMAC to the TLS session make sure that the peer
+is the one holding the secret and that there is no man in the middle. When
+both sides have verified the response the link is up and talker and audio
+messages may be exchanged.
+
+This class only handle the link itself. The talker arbitration and the
+forwarding of audio to and from the local nodes is done by the Reflector
+class using the signals emitted by this class.
+*/
+class ReflectorTrunk : public sigc::trackable
+{
+  public:
+    /**
+     * @brief 	Constructor
+     * @param 	cfg       The reflector configuration
+     * @param   section   The configuration section for this trunk
+     * @param   local_id  The identity of this reflector
+     */
+    ReflectorTrunk(Async::Config& cfg, const std::string& section,
+                   const std::string& local_id);
+
+    /**
+     * @brief 	Destructor
+     */
+    ~ReflectorTrunk(void);
+
+    /**
+     * @brief 	Initialize the trunk
+     * @return	Return \em true on success or else \em false
+     *
+     * Read the configuration and, if HOST is set, start connecting to the
+     * other reflector.
+     */
+    bool initialize(void);
+
+    /**
+     * @brief   Get the name of the configuration section for this trunk
+     * @return  Returns the name of the configuration section
+     */
+    const std::string& name(void) const { return m_section; }
+
+    /**
+     * @brief   Get the identity of the reflector at the other end
+     * @return  Returns the configured PEER_ID
+     */
+    const std::string& peerId(void) const { return m_peer_id; }
+
+    /**
+     * @brief   Check if the trunk link is up
+     * @return  Returns \em true if the link is authenticated and up
+     */
+    bool isUp(void) const { return m_state == STATE_UP; }
+
+    /**
+     * @brief   Check if the other side has nodes on a talk group
+     * @param   tg The talk group to check
+     * @return  Returns \em true if the other side want audio for the TG
+     */
+    bool peerInterested(uint32_t tg) const
+    {
+      return m_peer_tgs.find(tg) != m_peer_tgs.end();
+    }
+
+    /**
+     * @brief   Take over an incoming connection for this trunk
+     * @param   con   The connection accepted on the trunk port
+     * @param   hello The MsgTrunkHello already received on the connection
+     * @return  Returns \em true if the connection was taken over
+     *
+     * The caller remain the owner of the connection object. If \em false is
+     * returned the caller should close the connection. Otherwise the trunk
+     * close the connection when needed.
+     */
+    bool acceptConnection(Async::FramedTcpConnection *con,
+                          const MsgTrunkHello& hello);
+
+    /**
+     * @brief   Tell the trunk that an incoming connection has been closed
+     * @param   con The connection that was closed
+     */
+    void connectionClosed(Async::FramedTcpConnection *con);
+
+    /**
+     * @brief   Handle a frame received on an incoming connection
+     * @param   con   The connection the frame was received on
+     * @param   data  The received frame
+     *
+     * The owner of the incoming connection must forward all frames received
+     * after the connection has been taken over using this function.
+     */
+    void handleFrame(Async::FramedTcpConnection *con,
+                     std::vector<uint8_t>& data);
+
+    /**
+     * @brief   Send the set of talk groups that have local nodes
+     * @param   tgs The talk groups that are selected by local nodes
+     *
+     * The set is remembered and sent again when the link come up.
+     */
+    void setLocalInterest(const std::set<uint32_t>& tgs);
+
+    /**
+     * @brief   Tell the other side that a local node started talking
+     * @param   tg        The talk group
+     * @param   callsign  The callsign of the talker
+     */
+    void sendTalkerStart(uint32_t tg, const std::string& callsign);
+
+    /**
+     * @brief   Tell the other side that a local node stopped talking
+     * @param   tg        The talk group
+     * @param   callsign  The callsign of the talker
+     */
+    void sendTalkerStop(uint32_t tg, const std::string& callsign);
+
+    /**
+     * @brief   Send an audio frame to the other side
+     * @param   tg    The talk group
+     * @param   audio The encoded audio frame
+     *
+     * Nothing is sent if the other side have no nodes on the talk group.
+     */
+    void sendAudio(uint32_t tg, const std::vector<uint8_t>& audio);
+
+    /**
+     * @brief   A signal that is emitted when the link come up
+     * @param   trunk The trunk object
+     */
+    sigc::signal<void, ReflectorTrunk*> linkUp;
+
+    /**
+     * @brief   A signal that is emitted when the link go down
+     * @param   trunk The trunk object
+     */
+    sigc::signal<void, ReflectorTrunk*> linkDown;
+
+    /**
+     * @brief   A signal that is emitted when a remote talker start
+     * @param   trunk     The trunk object
+     * @param   tg        The talk group
+     * @param   callsign  The callsign of the talker
+     */
+    sigc::signal<void, ReflectorTrunk*, uint32_t,
+                 const std::string&> talkerStartReceived;
+
+    /**
+     * @brief   A signal that is emitted when a remote talker stop
+     * @param   trunk     The trunk object
+     * @param   tg        The talk group
+     * @param   callsign  The callsign of the talker
+     */
+    sigc::signal<void, ReflectorTrunk*, uint32_t,
+                 const std::string&> talkerStopReceived;
+
+    /**
+     * @brief   A signal that is emitted when an audio frame is received
+     * @param   trunk The trunk object
+     * @param   tg    The talk group
+     * @param   audio The encoded audio frame
+     */
+    sigc::signal<void, ReflectorTrunk*, uint32_t,
+                 const std::vector<uint8_t>&> audioReceived;
+
+  protected:
+
+  private:
+    using FramedTcpClient = Async::TcpClient<Async::FramedTcpConnection>;
+
+    typedef enum
+    {
+      STATE_DISCONNECTED, STATE_EXPECT_SSL_CON_READY, STATE_EXPECT_HELLO,
+      STATE_EXPECT_AUTH, STATE_UP
+    } State;
+
+    static const unsigned DEFAULT_PORT          = 5302;
+    static const unsigned RECONNECT_INTERVAL    = 5000;
+    static const unsigned HEARTBEAT_INTERVAL    = 10000;
+    static const unsigned HEARTBEAT_RX_CNT_MAX  = 3;
+    static const size_t   TLS_BINDING_LEN       = 32;
+
+    Async::Config&                m_cfg;
+    std::string                   m_section;
+    std::string                   m_local_id;
+    std::string                   m_peer_id;
+    std::string                   m_secret;
+    std::string                   m_host;
+    uint16_t                      m_port = DEFAULT_PORT;
+    Async::SslContext             m_ssl_ctx;
+    FramedTcpClient*              m_client = nullptr;
+    Async::FramedTcpConnection*   m_con = nullptr;
+    State                         m_state = STATE_DISCONNECTED;
+    MsgTrunkHello                 m_hello;
+    std::vector<uint8_t>          m_peer_challenge;
+    Async::Timer                  m_reconnect_timer;
+    Async::Timer                  m_heartbeat_timer;
+    unsigned                      m_heartbeat_rx_cnt = 0;
+    std::set<uint32_t>            m_local_tgs;
+    std::set<uint32_t>            m_peer_tgs;
+
+    ReflectorTrunk(const ReflectorTrunk&);
+    ReflectorTrunk& operator=(const ReflectorTrunk&);
+    void onConnected(void);
+    void onSslConnectionReady(Async::TcpConnection *con);
+    void onDisconnected(Async::TcpConnection *con,
+                        Async::TcpConnection::DisconnectReason reason);
+    void onFrameReceived(Async::FramedTcpConnection *con,
+                         std::vector<uint8_t>& data);
+    void startHandshake(void);
+    void handleHello(const MsgTrunkHello& msg);
+    void handleAuth(std::istream& is);
+    std::vector<uint8_t> authData(bool local_is_sender) const;
+    void handleInterest(std::istream& is);
+    void handleTalkerStart(std::istream& is);
+    void handleTalkerStop(std::istream& is);
+    void handleAudio(std::istream& is);
+    void sendMsg(const ReflectorMsg& msg);
+    void handleHeartbeat(Async::Timer *t);
+    void linkFailed(const std::string& reason);
+    void setDisconnected(void);
+
+};  /* class ReflectorTrunk */
+
+
+//} /* namespace */
+
+#endif /* REFLECTOR_TRUNK_INCLUDED */
+
+
+
+/*
+ * This file has not been truncated
+ */
@@ -0,0 +1,617 @@
+/**
+@file	 ReflectorUdpRx.cpp
+@brief   Receive and decrypt client UDP traffic in worker threads
+@author  Tobias Blomberg / SM0SVX
+@date	 2026-10-18
+
+\verbatim
+SvxReflector - An audio reflector for connecting SvxLink Servers
+Copyright (C) 2003-2026 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <openssl/evp.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "ReflectorUdpRx.h"
+#include "ReflectorMetrics.h"
+
+
+/****************************************************************************
+ *
+ * Namespaces to use
+ *
+ ****************************************************************************/
+
+using namespace std;
+using namespace Async;
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local class definitions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Prototypes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ *
+ * Local Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local functions
+ *
+ ****************************************************************************/
+
+namespace {
+    // The size of the associated data in the initial datagram from a client
+  const size_t INITIAL_AADLEN = UdpCipher::AADLEN +
+                                sizeof(UdpCipher::ClientId);
+
+  uint16_t readBe16(const uint8_t* buf)
+  {
+    return (static_cast<uint16_t>(buf[0]) << 8) | buf[1];
+  } /* readBe16 */
+
+
+  uint32_t readBe32(const uint8_t* buf)
+  {
+    return (static_cast<uint32_t>(buf[0]) << 24) |
+           (static_cast<uint32_t>(buf[1]) << 16) |
+           (static_cast<uint32_t>(buf[2]) << 8) | buf[3];
+  } /* readBe32 */
+
+
+  void writeBe32(uint8_t* buf, uint32_t val)
+  {
+    buf[0] = val >> 24;
+    buf[1] = val >> 16;
+    buf[2] = val >> 8;
+    buf[3] = val;
+  } /* writeBe32 */
+};
+
+
+
+/****************************************************************************
+ *
+ * Public member functions
+ *
+ ****************************************************************************/
+
+int ReflectorUdpRx::bindSocket(uint16_t port)
+{
+  int sock = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  if (sock < 0)
+  {
+    perror("socket");
+    return -1;
+  }
+
+  if (!setReusePort(sock))
+  {
+    close(sock);
+    return -1;
+  }
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = INADDR_ANY;
+  if (::bind(sock, reinterpret_cast<struct sockaddr *>(&addr),
+             sizeof(addr)) != 0)
+  {
+    perror("bind");
+    close(sock);
+    return -1;
+  }
+
+  return sock;
+} /* ReflectorUdpRx::bindSocket */
+
+
+bool ReflectorUdpRx::setReusePort(int sock)
+{
+  int on = 1;
+  if (setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) != 0)
+  {
+    perror("setsockopt(SO_REUSEPORT)");
+    return false;
+  }
+  return true;
+} /* ReflectorUdpRx::setReusePort */
+
+
+ReflectorUdpRx::ReflectorUdpRx(ReflectorMetrics& metrics)
+  : m_metrics(metrics)
+{
+  m_notifier_watch.activity.connect(
+      mem_fun(*this, &ReflectorUdpRx::notificationReceived));
+} /* ReflectorUdpRx::ReflectorUdpRx */
+
+
+ReflectorUdpRx::~ReflectorUdpRx(void)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_pause_mutex);
+    m_stopped = true;
+  }
+  m_pause_cond.notify_all();
+  if (m_stop_wr >= 0)
+  {
+    char ch = 0;
+    while ((write(m_stop_wr, &ch, 1) < 0) && (errno == EINTR)) {}
+  }
+  for (auto& thread : m_threads)
+  {
+    thread.join();
+  }
+  m_threads.clear();
+
+  for (int sock : m_socks)
+  {
+    close(sock);
+  }
+  m_socks.clear();
+
+  m_notifier_watch.setFd(-1, FdWatch::FD_WATCH_RD);
+  for (int fd : {m_stop_rd, m_stop_wr, m_notifier_rd, m_notifier_wr})
+  {
+    if (fd >= 0)
+    {
+      close(fd);
+    }
+  }
+} /* ReflectorUdpRx::~ReflectorUdpRx */
+
+
+bool ReflectorUdpRx::initialize(const std::vector<int>& socks)
+{
+  m_socks = socks;
+
+  m_cipher = EncryptedUdpSocket::fetchCipher(UdpCipher::NAME);
+  if (m_cipher == nullptr)
+  {
+    std::cerr << "*** ERROR: Unsupported UDP cipher " << UdpCipher::NAME
+              << std::endl;
+    return false;
+  }
+
+  int fd[2];
+  if (pipe2(fd, O_CLOEXEC | O_NONBLOCK) != 0)
+  {
+    perror("pipe2");
+    return false;
+  }
+  m_notifier_rd = fd[0];
+  m_notifier_wr = fd[1];
+  m_notifier_watch.setFd(m_notifier_rd, FdWatch::FD_WATCH_RD);
+  m_notifier_watch.setEnabled(true);
+
+  if (pipe2(fd, O_CLOEXEC | O_NONBLOCK) != 0)
+  {
+    perror("pipe2");
+    return false;
+  }
+  m_stop_rd = fd[0];
+  m_stop_wr = fd[1];
+
+  for (int sock : m_socks)
+  {
+    m_threads.emplace_back(&ReflectorUdpRx::threadFunc, this, sock);
+  }
+
+  return true;
+} /* ReflectorUdpRx::initialize */
+
+
+void ReflectorUdpRx::setClientKey(ClientId id,
+                                  const std::vector<uint8_t>& iv_rand,
+                                  const std::vector<uint8_t>& key)
+{
+    // The IV is prepared with the counter set to zero. Only the counter,
+    // which is the last field, have to be filled in for each datagram.
+  auto client_key = std::make_shared<ClientKey>();
+  client_key->iv = UdpCipher::IV(iv_rand, id, 0);
+  client_key->key = key;
+
+  std::lock_guard<std::mutex> lock(m_key_mutex);
+  auto& entry = m_keys[id];
+  if (entry != nullptr)
+  {
+    entry->revoked = true;
+  }
+  entry = std::move(client_key);
+} /* ReflectorUdpRx::setClientKey */
+
+
+void ReflectorUdpRx::removeClient(ClientId id)
+{
+  std::lock_guard<std::mutex> lock(m_key_mutex);
+  auto it = m_keys.find(id);
+  if (it != m_keys.end())
+  {
+    it->second->revoked = true;
+    m_keys.erase(it);
+  }
+} /* ReflectorUdpRx::removeClient */
+
+
+void ReflectorUdpRx::setPaused(bool paused)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_pause_mutex);
+    m_paused = paused;
+  }
+  m_pause_cond.notify_all();
+} /* ReflectorUdpRx::setPaused */
+
+
+
+/****************************************************************************
+ *
+ * Protected member functions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Private member functions
+ *
+ ****************************************************************************/
+
+void ReflectorUdpRx::threadFunc(int sock)
+{
+  EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+  if ((ctx == nullptr) ||
+      !EVP_DecryptInit_ex(ctx, m_cipher, NULL, NULL, NULL))
+  {
+    std::cerr << "*** ERROR: Could not set up the cipher for a UDP receiver "
+                 "thread" << std::endl;
+    EVP_CIPHER_CTX_free(ctx);
+    return;
+  }
+
+    // The source address to client mapping is only used by this thread.
+    // Since the kernel always deliver datagrams from one source address to
+    // the same socket there is no need to share it between the threads.
+  SrcMap src_map;
+  std::vector<Datagram> batch;
+  batch.reserve(RX_BATCH_MAX);
+  uint8_t buf[65536];
+  struct pollfd pfd[2];
+  pfd[0].fd = sock;
+  pfd[0].events = POLLIN;
+  pfd[1].fd = m_stop_rd;
+  pfd[1].events = POLLIN;
+  for (;;)
+  {
+    if (poll(pfd, 2, -1) < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      perror("poll");
+      break;
+    }
+    if (pfd[1].revents != 0)
+    {
+      break;
+    }
+    if (m_paused)
+    {
+      std::unique_lock<std::mutex> lock(m_pause_mutex);
+      m_pause_cond.wait(lock, [this] { return !m_paused || m_stopped; });
+      if (m_stopped)
+      {
+        break;
+      }
+      continue;
+    }
+
+    while (batch.size() < RX_BATCH_MAX)
+    {
+      struct sockaddr_in addr;
+      socklen_t addrlen = sizeof(addr);
+      ssize_t len = recvfrom(sock, buf, sizeof(buf), MSG_DONTWAIT,
+                             reinterpret_cast<struct sockaddr*>(&addr),
+                             &addrlen);
+      if (len < 0)
+      {
+        if (errno == EINTR)
+        {
+          continue;
+        }
+        if ((errno != EAGAIN) && (errno != EWOULDBLOCK))
+        {
+          perror("recvfrom");
+        }
+        break;
+      }
+      if (addr.sin_family != AF_INET)
+      {
+        continue;
+      }
+      batch.emplace_back();
+      if (!handleDatagram(ctx, src_map, addr, buf, len, batch.back()))
+      {
+        batch.pop_back();
+      }
+    }
+
+    if (!batch.empty())
+    {
+      deliver(batch);
+    }
+  }
+
+  EVP_CIPHER_CTX_free(ctx);
+} /* ReflectorUdpRx::threadFunc */
+
+
+bool ReflectorUdpRx::handleDatagram(EVP_CIPHER_CTX* ctx, SrcMap& src_map,
+                                    const struct sockaddr_in& addr,
+                                    const uint8_t* buf, size_t len,
+                                    Datagram& dg)
+{
+  if (len < UdpCipher::AADLEN)
+  {
+    return false;
+  }
+
+  dg.addr = IpAddress(addr.sin_addr);
+  dg.port = ntohs(addr.sin_port);
+
+    // The associated data is parsed directly from the datagram. It is the
+    // big endian IV counter, followed by the client id in the initial
+    // datagram.
+  const UdpCipher::IVCntr iv_cntr = readBe32(buf);
+
+  const uint64_t src = (static_cast<uint64_t>(addr.sin_addr.s_addr) << 16) |
+                       dg.port;
+  ClientKeyPtr key;
+  if (iv_cntr == 0)
+  {
+      // Client UDP registration. The client id is found in the AAD.
+    if (len < INITIAL_AADLEN)
+    {
+      return false;
+    }
+    key = clientKey(readBe16(buf + UdpCipher::AADLEN));
+    if (key == nullptr)
+    {
+      return false;
+    }
+    dg.aadlen = INITIAL_AADLEN;
+  }
+  else
+  {
+    auto it = src_map.find(src);
+    if ((it == src_map.end()) || it->second->revoked)
+    {
+      if (it != src_map.end())
+      {
+        src_map.erase(it);
+      }
+        // Not a known V3 client. Let the event loop handle it as a V2
+        // datagram.
+      dg.aadlen = 0;
+      dg.data.assign(buf, buf + len);
+      return true;
+    }
+    key = it->second;
+    dg.aadlen = UdpCipher::AADLEN;
+  }
+
+  if (!decrypt(ctx, *key, iv_cntr, buf, len, dg))
+  {
+    m_metrics.udp_decrypt_failures.inc();
+    return false;
+  }
+
+  if (iv_cntr == 0)
+  {
+    src_map[src] = std::move(key);
+  }
+
+  return true;
+} /* ReflectorUdpRx::handleDatagram */
+
+
+ReflectorUdpRx::ClientKeyPtr ReflectorUdpRx::clientKey(ClientId id)
+{
+  std::lock_guard<std::mutex> lock(m_key_mutex);
+  auto it = m_keys.find(id);
+  if (it == m_keys.end())
+  {
+    return nullptr;
+  }
+  return it->second;
+} /* ReflectorUdpRx::clientKey */
+
+
+bool ReflectorUdpRx::decrypt(EVP_CIPHER_CTX* ctx, const ClientKey& key,
+                             UdpCipher::IVCntr iv_cntr,
+                             const uint8_t* buf, size_t len, Datagram& dg)
+{
+  const size_t aadlen = dg.aadlen;
+  if ((len < aadlen + UdpCipher::TAGLEN) ||
+      (key.key.size() != static_cast<size_t>(EVP_CIPHER_CTX_key_length(ctx))) ||
+      (key.iv.size() != UdpCipher::IVLEN) ||
+      (UdpCipher::IVLEN != static_cast<size_t>(EVP_CIPHER_CTX_iv_length(ctx))))
+  {
+    return false;
+  }
+
+  uint8_t iv[UdpCipher::IVLEN];
+  std::memcpy(iv, key.iv.data(), UdpCipher::IVLEN);
+  writeBe32(iv + UdpCipher::IVLEN - sizeof(iv_cntr), iv_cntr);
+
+  int outlen = 0;
+  if (!EVP_DecryptInit_ex(ctx, NULL, NULL, key.key.data(), iv) ||
+      !EVP_DecryptUpdate(ctx, nullptr, &outlen, buf, aadlen) ||
+      !EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_TAG, UdpCipher::TAGLEN,
+                           const_cast<uint8_t*>(buf + aadlen)))
+  {
+    return false;
+  }
+
+  const uint8_t* inbuf = buf + aadlen + UdpCipher::TAGLEN;
+  const int inlen = len - aadlen - UdpCipher::TAGLEN;
+  dg.data.resize(aadlen + inlen + EVP_MAX_BLOCK_LENGTH);
+  std::memcpy(dg.data.data(), buf, aadlen);
+  uint8_t* outbuf = dg.data.data() + aadlen;
+  if (!EVP_DecryptUpdate(ctx, outbuf, &outlen, inbuf, inlen))
+  {
+    return false;
+  }
+  int totoutlen = outlen;
+  if (!EVP_DecryptFinal_ex(ctx, outbuf + outlen, &outlen))
+  {
+    return false;
+  }
+  totoutlen += outlen;
+  dg.data.resize(aadlen + totoutlen);
+
+  return true;
+} /* ReflectorUdpRx::decrypt */
+
+
+void ReflectorUdpRx::deliver(std::vector<Datagram>& batch)
+{
+  bool notify = false;
+  {
+    std::lock_guard<std::mutex> lock(m_rx_mutex);
+    notify = m_rx.empty();
+    for (auto& dg : batch)
+    {
+      if (m_rx.size() >= RX_QUEUE_MAX)
+      {
+        m_metrics.udp_rx_dropped.inc();
+        continue;
+      }
+      m_rx.push_back(std::move(dg));
+    }
+  }
+  batch.clear();
+
+  if (notify)
+  {
+    char ch = 0;
+    while ((write(m_notifier_wr, &ch, 1) < 0) && (errno == EINTR)) {}
+  }
+} /* ReflectorUdpRx::deliver */
+
+
+void ReflectorUdpRx::notificationReceived(Async::FdWatch *w)
+{
+  char buf[64];
+  while (read(m_notifier_rd, buf, sizeof(buf)) > 0) {}
+
+  std::deque<Datagram> rx;
+  {
+    std::lock_guard<std::mutex> lock(m_rx_mutex);
+    rx.swap(m_rx);
+  }
+
+  for (auto& dg : rx)
+  {
+    if (dg.aadlen > 0)
+    {
+      datagramReceived(dg.addr, dg.port, dg.data.data(), dg.aadlen,
+                       dg.data.data() + dg.aadlen,
+                       dg.data.size() - dg.aadlen);
+    }
+    else
+    {
+      datagramReceived(dg.addr, dg.port, nullptr, 0, dg.data.data(),
+                       dg.data.size());
+    }
+  }
+} /* ReflectorUdpRx::notificationReceived */
+
+
+
+/*
+ * This file has not been truncated
+ */
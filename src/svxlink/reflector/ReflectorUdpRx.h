@@ -0,0 +1,300 @@
+/**
+@file	 ReflectorUdpRx.h
+@brief   Receive and decrypt client UDP traffic in worker threads
+@author  Tobias Blomberg / SM0SVX
+@date	 2026-10-18
+
+\verbatim
+SvxReflector - An audio reflector for connecting SvxLink Servers
+Copyright (C) 2003-2026 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+#ifndef REFLECTOR_UDP_RX_INCLUDED
+#define REFLECTOR_UDP_RX_INCLUDED
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <sigc++/sigc++.h>
+#include <netinet/in.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+#include <AsyncFdWatch.h>
+#include <AsyncIpAddress.h>
+#include <AsyncEncryptedUdpSocket.h>
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "ReflectorMsg.h"
+
+
+/****************************************************************************
+ *
+ * Forward declarations
+ *
+ ****************************************************************************/
+
+class ReflectorMetrics;
+
+
+/****************************************************************************
+ *
+ * Namespace
+ *
+ ****************************************************************************/
+
+//namespace MyNameSpace
+//{
+
+
+/****************************************************************************
+ *
+ * Forward declarations of classes inside of the declared namespace
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Class definitions
+ *
+ ****************************************************************************/
+
+/**
+@brief	Receive and decrypt client UDP traffic in worker threads
+@author Tobias Blomberg / SM0SVX
+@date   2026-10-18
+
+All UDP sockets used by this class are bound to the reflector UDP port using
+the SO_REUSEPORT socket option. The kernel then spread the incoming datagrams
+over the sockets using a hash of the source address so all datagrams from one
+client always end up on the same socket, and thus in the same thread, as long
+as the set of sockets does not change.
+
+Each socket is read by a thread of its own which also decrypt the datagrams.
+The decrypted datagrams are then handed over to the event loop thread through
+the datagramReceived signal, in the order they were received. Datagrams that
+cannot be associated with a client are handed over without being decrypted
+so that they can be handled like V2 datagrams.
+
+The threads cannot access the client objects so the cipher key for each
+client must be registered using the setClientKey function. The source address
+of a client is learnt by the thread when it receive the initial datagram,
+which is the one carrying the client id in the associated data. The thread
+then keep a reference to the immutable key object in its source address map
+so the shared key map, and its lock, is only used for the initial datagram.
+A key that is replaced or removed is marked as revoked so that the threads
+stop using it.
+*/
+class ReflectorUdpRx : public sigc::trackable
+{
+  public:
+    using ClientId = UdpCipher::ClientId;
+
+    /**
+     * @brief   Create a UDP socket bound using SO_REUSEPORT
+     * @param   port The local UDP port to bind to
+     * @return  Returns the socket file descriptor or -1 on failure
+     */
+    static int bindSocket(uint16_t port);
+
+    /**
+     * @brief   Set the SO_REUSEPORT option on an already bound socket
+     * @param   sock The socket file descriptor
+     * @return  Returns \em true on success or else \em false
+     *
+     * This is used for sockets taken over from another reflector process,
+     * which may not have used SO_REUSEPORT, so that more sockets can be
+     * bound to the same port.
+     */
+    static bool setReusePort(int sock);
+
+    /**
+     * @brief 	Constructor
+     * @param 	metrics The metrics object to record failures in
+     */
+    explicit ReflectorUdpRx(ReflectorMetrics& metrics);
+
+    /**
+     * @brief 	Destructor
+     *
+     * Stop the receiver threads and close the sockets.
+     */
+    ~ReflectorUdpRx(void);
+
+    /**
+     * @brief   Start one receiver thread per socket
+     * @param   socks The bound sockets. This object take ownership of them.
+     * @return  Returns \em true on success or else \em false
+     */
+    bool initialize(const std::vector<int>& socks);
+
+    /**
+     * @brief   Get the sockets used by the receiver threads
+     * @return  Returns a vector of socket file descriptors
+     */
+    const std::vector<int>& sockets(void) const { return m_socks; }
+
+    /**
+     * @brief   Set the UDP cipher parameters for a client
+     * @param   id      The client id
+     * @param   iv_rand The random part of the client IV
+     * @param   key     The cipher key used by the client
+     */
+    void setClientKey(ClientId id, const std::vector<uint8_t>& iv_rand,
+                      const std::vector<uint8_t>& key);
+
+    /**
+     * @brief   Forget a client
+     * @param   id The client id
+     */
+    void removeClient(ClientId id);
+
+    /**
+     * @brief   Pause or resume reading from the sockets
+     * @param   paused Set to \em true to stop reading
+     *
+     * While paused, received datagrams are left in the socket buffers, e.g.
+     * for another process sharing the sockets to read. A batch that a
+     * thread is in the middle of reading when pausing is still delivered.
+     */
+    void setPaused(bool paused);
+
+    /**
+     * @brief   A signal that is emitted when a datagram has been received
+     * @param   addr    The IP address the datagram was received from
+     * @param   port    The source UDP port
+     * @param   aad     The associated data or nullptr if not decrypted
+     * @param   aadlen  The length of the associated data
+     * @param   buf     The decrypted payload, or the whole datagram if it was
+     *                  not decrypted
+     * @param   count   The number of bytes in buf
+     *
+     * This signal is always emitted in the event loop thread.
+     */
+    sigc::signal<void, const Async::IpAddress&, uint16_t,
+                 void*, size_t, void*, int> datagramReceived;
+
+  protected:
+
+  private:
+    struct ClientKey
+    {
+      std::vector<uint8_t>      iv;
+      std::vector<uint8_t>      key;
+      mutable std::atomic<bool> revoked{false};
+    };
+    using ClientKeyPtr  = std::shared_ptr<const ClientKey>;
+    struct Datagram
+    {
+      Async::IpAddress      addr;
+      uint16_t              port    = 0;
+      size_t                aadlen  = 0;
+      std::vector<uint8_t>  data;
+    };
+    using ClientKeyMap  = std::unordered_map<ClientId, ClientKeyPtr>;
+    using SrcMap        = std::unordered_map<uint64_t, ClientKeyPtr>;
+
+    static const size_t RX_BATCH_MAX  = 64;
+    static const size_t RX_QUEUE_MAX  = 8192;
+
+    ReflectorMetrics&                   m_metrics;
+    const Async::EncryptedUdpSocket::Cipher* m_cipher = nullptr;
+    std::vector<int>                    m_socks;
+    std::vector<std::thread>            m_threads;
+    std::mutex                          m_key_mutex;
+    ClientKeyMap                        m_keys;
+    std::mutex                          m_rx_mutex;
+    std::deque<Datagram>                m_rx;
+    std::atomic<bool>                   m_paused{false};
+    std::mutex                          m_pause_mutex;
+    std::condition_variable             m_pause_cond;
+    bool                                m_stopped       = false;
+    int                                 m_stop_rd       = -1;
+    int                                 m_stop_wr       = -1;
+    int                                 m_notifier_rd   = -1;
+    int                                 m_notifier_wr   = -1;
+    Async::FdWatch                      m_notifier_watch;
+
+    ReflectorUdpRx(const ReflectorUdpRx&);
+    ReflectorUdpRx& operator=(const ReflectorUdpRx&);
+    void threadFunc(int sock);
+    bool handleDatagram(EVP_CIPHER_CTX* ctx, SrcMap& src_map,
+                        const struct sockaddr_in& addr, const uint8_t* buf,
+                        size_t len, Datagram& dg);
+    ClientKeyPtr clientKey(ClientId id);
+    static bool decrypt(EVP_CIPHER_CTX* ctx, const ClientKey& key,
+                        UdpCipher::IVCntr iv_cntr, const uint8_t* buf,
+                        size_t len, Datagram& dg);
+    void deliver(std::vector<Datagram>& batch);
+    void notificationReceived(Async::FdWatch *w);
+
+};  /* class ReflectorUdpRx */
+
+
+//} /* namespace */
+
+#endif /* REFLECTOR_UDP_RX_INCLUDED */
+
+
+
+/*
+ * This file has not been truncated
+ */
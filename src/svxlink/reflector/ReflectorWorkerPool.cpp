@@ -0,0 +1,281 @@
+/**
+@file	 ReflectorWorkerPool.cpp
+@brief   A pool of threads running CA operations off the event loop
+@author  Tobias Blomberg / SM0SVX
+@date	 2026-10-18
+
+\verbatim
+SvxReflector - An audio reflector for connecting SvxLink Servers
+Copyright (C) 2003-2026 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "ReflectorWorkerPool.h"
+#include "ReflectorMetrics.h"
+
+
+/****************************************************************************
+ *
+ * Namespaces to use
+ *
+ ****************************************************************************/
+
+using namespace std;
+using namespace Async;
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local class definitions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Prototypes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ *
+ * Local Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Public member functions
+ *
+ ****************************************************************************/
+
+ReflectorWorkerPool::ReflectorWorkerPool(ReflectorMetrics& metrics)
+  : m_metrics(metrics)
+{
+  m_notifier_watch.activity.connect(
+      mem_fun(*this, &ReflectorWorkerPool::notificationReceived));
+} /* ReflectorWorkerPool::ReflectorWorkerPool */
+
+
+ReflectorWorkerPool::~ReflectorWorkerPool(void)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_cond.notify_all();
+  for (auto& thread : m_threads)
+  {
+    thread.join();
+  }
+  m_threads.clear();
+
+  m_notifier_watch.setFd(-1, FdWatch::FD_WATCH_RD);
+  if (m_notifier_rd >= 0)
+  {
+    close(m_notifier_rd);
+  }
+  if (m_notifier_wr >= 0)
+  {
+    close(m_notifier_wr);
+  }
+} /* ReflectorWorkerPool::~ReflectorWorkerPool */
+
+
+bool ReflectorWorkerPool::initialize(unsigned thread_cnt, size_t queue_max)
+{
+  int fd[2];
+  if (pipe2(fd, O_CLOEXEC | O_NONBLOCK) != 0)
+  {
+    perror("pipe2");
+    return false;
+  }
+  m_notifier_rd = fd[0];
+  m_notifier_wr = fd[1];
+  m_notifier_watch.setFd(m_notifier_rd, FdWatch::FD_WATCH_RD);
+  m_notifier_watch.setEnabled(true);
+
+  m_queue_max = queue_max;
+  for (unsigned i=0; i<std::max(1U, thread_cnt); ++i)
+  {
+    m_threads.emplace_back(&ReflectorWorkerPool::threadFunc, this);
+  }
+
+  return true;
+} /* ReflectorWorkerPool::initialize */
+
+
+bool ReflectorWorkerPool::submit(const std::string& key, Work work, Done done)
+{
+  JobPtr job(new Job);
+  job->key = key;
+  job->work = std::move(work);
+  job->done = std::move(done);
+  job->submitted = Clock::now();
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_threads.empty() || (m_jobs.size() >= m_queue_max))
+    {
+      m_metrics.ca_jobs_rejected.inc();
+      return false;
+    }
+    m_jobs.push_back(std::move(job));
+  }
+  m_cond.notify_one();
+  ++m_pending_cnt;
+  return true;
+} /* ReflectorWorkerPool::submit */
+
+
+
+/****************************************************************************
+ *
+ * Protected member functions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Private member functions
+ *
+ ****************************************************************************/
+
+std::deque<ReflectorWorkerPool::JobPtr>::iterator
+ReflectorWorkerPool::nextRunnableJob(void)
+{
+    // Skip jobs with a key that another thread is working on. Since the first
+    // queued job for each key is picked first, the queue order is kept.
+  return std::find_if(m_jobs.begin(), m_jobs.end(),
+      [this](const JobPtr& job)
+      {
+        return m_busy_keys.count(job->key) == 0;
+      });
+} /* ReflectorWorkerPool::nextRunnableJob */
+
+
+void ReflectorWorkerPool::threadFunc(void)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  for (;;)
+  {
+    m_cond.wait(lock, [this]
+        {
+          return m_stop || (nextRunnableJob() != m_jobs.end());
+        });
+    if (m_stop)
+    {
+      return;
+    }
+    auto it = nextRunnableJob();
+    JobPtr job = std::move(*it);
+    m_jobs.erase(it);
+    m_busy_keys.insert(job->key);
+    lock.unlock();
+
+    job->started = Clock::now();
+    job->work();
+    job->finished = Clock::now();
+
+    lock.lock();
+    m_busy_keys.erase(job->key);
+    m_finished.push_back(std::move(job));
+      // Another thread may be waiting for a job with the same key
+    m_cond.notify_all();
+    char ch = 0;
+    while ((write(m_notifier_wr, &ch, 1) < 0) && (errno == EINTR)) {}
+  }
+} /* ReflectorWorkerPool::threadFunc */
+
+
+void ReflectorWorkerPool::notificationReceived(Async::FdWatch *w)
+{
+  char buf[64];
+  while (read(m_notifier_rd, buf, sizeof(buf)) > 0) {}
+
+  std::deque<JobPtr> finished;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    finished.swap(m_finished);
+  }
+
+  for (auto& job : finished)
+  {
+    --m_pending_cnt;
+    m_metrics.ca_queue_wait.observe(job->started - job->submitted);
+    m_metrics.ca_op_duration.observe(job->finished - job->started);
+    job->done();
+  }
+} /* ReflectorWorkerPool::notificationReceived */
+
+
+
+/*
+ * This file has not been truncated
+ */
@@ -0,0 +1,232 @@
+/**
+@file	 ReflectorWorkerPool.h
+@brief   A pool of threads running CA operations off the event loop
+@author  Tobias Blomberg / SM0SVX
+@date	 2026-10-18
+
+\verbatim
+SvxReflector - An audio reflector for connecting SvxLink Servers
+Copyright (C) 2003-2026 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+#ifndef REFLECTOR_WORKER_POOL_INCLUDED
+#define REFLECTOR_WORKER_POOL_INCLUDED
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <sigc++/sigc++.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+#include <AsyncFdWatch.h>
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Forward declarations
+ *
+ ****************************************************************************/
+
+class ReflectorMetrics;
+
+
+/****************************************************************************
+ *
+ * Namespace
+ *
+ ****************************************************************************/
+
+//namespace MyNameSpace
+//{
+
+
+/****************************************************************************
+ *
+ * Forward declarations of classes inside of the declared namespace
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Class definitions
+ *
+ ****************************************************************************/
+
+/**
+@brief	A pool of threads running CA operations off the event loop
+@author Tobias Blomberg / SM0SVX
+@date   2026-10-18
+
+Key generation, certificate signing and the reading and writing of PEM files
+may take long enough to disturb the audio forwarding if done in the event
+loop. This class run such work in a fixed number of worker threads.
+
+A job consist of two functions. The work function is run in a worker thread
+and must not touch any state that is used by the event loop. The done
+function is then run in the event loop thread where it is safe to use the
+result. Both functions are always destroyed in the event loop thread, so it
+is safe to capture objects that are not thread safe as long as the work
+function does not use them.
+
+Each job is queued under a key, for example the callsign that the job work
+on. Jobs with the same key are never run at the same time and are run in the
+order they were queued. Jobs with different keys may run in parallel when
+more than one worker thread is used.
+
+The time that jobs spend in the queue and the time it take to run them are
+recorded in the reflector metrics.
+*/
+class ReflectorWorkerPool : public sigc::trackable
+{
+  public:
+    using Work = std::function<void(void)>;
+    using Done = std::function<void(void)>;
+
+    /**
+     * @brief 	Constructor
+     * @param 	metrics The metrics object to record job timing in
+     */
+    explicit ReflectorWorkerPool(ReflectorMetrics& metrics);
+
+    /**
+     * @brief 	Destructor
+     *
+     * Wait for running jobs to finish. Queued jobs are discarded without
+     * calling their done function.
+     */
+    ~ReflectorWorkerPool(void);
+
+    /**
+     * @brief   Start the worker threads
+     * @param   thread_cnt  The number of worker threads to start
+     * @param   queue_max   The maximum number of jobs waiting to be run
+     * @return  Returns \em true on success or else \em false
+     */
+    bool initialize(unsigned thread_cnt, size_t queue_max);
+
+    /**
+     * @brief   Queue a job
+     * @param   key   Jobs with the same key are run one at a time, in order
+     * @param   work  The function to run in a worker thread
+     * @param   done  The function to run in the event loop when finished
+     * @return  Returns \em true if the job was queued or \em false if the
+     *          queue is full
+     */
+    bool submit(const std::string& key, Work work, Done done);
+
+    /**
+     * @brief   Get the number of jobs that have not yet finished
+     * @return  Returns the number of queued or running jobs
+     */
+    size_t pendingCount(void) const { return m_pending_cnt; }
+
+  protected:
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Job
+    {
+      std::string       key;
+      Work              work;
+      Done              done;
+      Clock::time_point submitted;
+      Clock::time_point started;
+      Clock::time_point finished;
+    };
+    using JobPtr = std::unique_ptr<Job>;
+
+    ReflectorMetrics&         m_metrics;
+    std::vector<std::thread>  m_threads;
+    std::mutex                m_mutex;
+    std::condition_variable   m_cond;
+    std::deque<JobPtr>        m_jobs;
+    std::deque<JobPtr>        m_finished;
+    std::set<std::string>     m_busy_keys;
+    bool                      m_stop          = false;
+    int                       m_notifier_rd   = -1;
+    int                       m_notifier_wr   = -1;
+    Async::FdWatch            m_notifier_watch;
+    size_t                    m_queue_max     = 0;
+    size_t                    m_pending_cnt   = 0;
+
+    ReflectorWorkerPool(const ReflectorWorkerPool&);
+    ReflectorWorkerPool& operator=(const ReflectorWorkerPool&);
+    std::deque<JobPtr>::iterator nextRunnableJob(void);
+    void threadFunc(void);
+    void notificationReceived(Async::FdWatch *w);
+
+};  /* class ReflectorWorkerPool */
+
+
+//} /* namespace */
+
+#endif /* REFLECTOR_WORKER_POOL_INCLUDED */
+
+
+
+/*
+ * This file has not been truncated
+ */
@@ -0,0 +1,1542 @@
+/**
+@file	 svxreflector-bench.cpp
+@brief   A load generator and latency benchmark for the SvxReflector
+@author  Tobias Blomberg / SM0SVX
+@date	 2026-10-18
+
+This application simulate a number of SvxLink nodes that connect to a
+SvxReflector server, select talk groups and talk to each other. It is used to
+measure the capacity of a reflector without having to recruit real nodes.
+
+\verbatim
+SvxReflector - An audio reflector for connecting SvxLink Servers
+Copyright (C) 2003-2026 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <sys/resource.h>
+#include <sys/select.h>
+#include <unistd.h>
+
+#include <popt.h>
+#include <sigc++/sigc++.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <algorithm>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+#include <AsyncCppApplication.h>
+#include <AsyncTimer.h>
+#include <AsyncTcpClient.h>
+#include <AsyncFramedTcpConnection.h>
+#include <AsyncEncryptedUdpSocket.h>
+#include <AsyncSslContext.h>
+#include <AsyncSslKeypair.h>
+#include <AsyncSslCertSigningReq.h>
+#include <AsyncMsg.h>
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "version/SVXREFLECTOR.h"
+#include "ReflectorMsg.h"
+
+
+/****************************************************************************
+ *
+ * Namespaces to use
+ *
+ ****************************************************************************/
+
+using namespace std;
+using namespace Async;
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+#define PROGRAM_NAME "SvxReflectorBench"
+
+typedef std::chrono::steady_clock Clock;
+
+
+/****************************************************************************
+ *
+ * Local class definitions
+ *
+ ****************************************************************************/
+
+namespace {
+  /**
+   * @brief The header of the audio payload sent by the simulated talkers
+   *
+   * The rest of the audio payload is padding to make the frame as large as
+   * a real encoded audio frame.
+   */
+  struct BenchFrame : public Async::Msg
+  {
+    uint32_t  round   = 0;
+    uint32_t  talker  = 0;
+    uint32_t  seq     = 0;
+    uint64_t  sent_ns = 0;
+    ASYNC_MSG_MEMBERS(round, talker, seq, sent_ns)
+  };
+
+  uint64_t nowNs(void)
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        Clock::now().time_since_epoch()).count();
+  }
+
+  class Bench;
+
+  /**
+   * @brief A simulated SvxLink node connecting to the reflector
+   */
+  class BenchClient : public sigc::trackable
+  {
+    public:
+      BenchClient(Bench& bench, const std::string& callsign);
+      ~BenchClient(void);
+      const std::string& callsign(void) const { return m_callsign; }
+      void connect(void);
+      bool isConnected(void) const { return m_state == STATE_CONNECTED; }
+      bool hasFailed(void) const { return m_failed; }
+      double joinTime(void) const { return m_join_time; }
+      uint32_t tg(void) const { return m_tg; }
+      void selectTg(uint32_t tg);
+      void tick(void);
+      void sendAudio(const std::vector<uint8_t>& payload);
+      void flushAudio(void);
+
+    private:
+      typedef enum
+      {
+        STATE_DISCONNECTED, STATE_EXPECT_CA_INFO,
+        STATE_EXPECT_START_ENCRYPTION, STATE_EXPECT_SSL_CON_READY,
+        STATE_EXPECT_AUTH_CHALLENGE, STATE_EXPECT_AUTH_OK,
+        STATE_EXPECT_SERVER_INFO, STATE_EXPECT_START_UDP_ENCRYPTION,
+        STATE_EXPECT_UDP_HEARTBEAT, STATE_CONNECTED
+      } State;
+
+      static const unsigned TCP_HEARTBEAT_TX_CNT_RESET = 10;
+      static const unsigned UDP_HEARTBEAT_TX_CNT_RESET = 10;
+
+      Bench&                                      m_bench;
+      std::string                                 m_callsign;
+      Async::TcpClient<Async::FramedTcpConnection> m_con;
+      Async::EncryptedUdpSocket*                  m_udp_sock = nullptr;
+      State                                       m_state = STATE_DISCONNECTED;
+      bool                                        m_failed = false;
+      ReflectorUdpMsg::ClientId                   m_client_id = 0;
+      std::vector<uint8_t>                        m_udp_cipher_iv_rand;
+      UdpCipher::IVCntr                           m_udp_tx_cntr = 0;
+      UdpCipher::AAD                              m_aad;
+      Clock::time_point                           m_connect_start;
+      double                                      m_join_time = 0.0;
+      unsigned                                    m_tcp_heartbeat_tx_cnt = 0;
+      unsigned                                    m_udp_heartbeat_tx_cnt = 0;
+      uint32_t                                    m_tg = 0;
+
+      BenchClient(const BenchClient&);
+      BenchClient& operator=(const BenchClient&);
+      bool isV3(void) const;
+      void fail(const std::string& reason);
+      void onConnected(void);
+      void onDisconnected(FramedTcpConnection *con,
+                          TcpConnection::DisconnectReason reason);
+      bool onVerifyPeer(TcpConnection *con, bool preverify_ok,
+                        X509_STORE_CTX *x509_store_ctx);
+      void onSslConnectionReady(TcpConnection *con);
+      void onFrameReceived(FramedTcpConnection *con,
+                           std::vector<uint8_t>& data);
+      void handleMsgAuthChallenge(std::istream& is);
+      void handleMsgServerInfo(std::istream& is);
+      bool udpCipherDataReceived(const IpAddress& addr, uint16_t port,
+                                 void *buf, int count);
+      void udpDatagramReceived(const IpAddress& addr, uint16_t port,
+                               void *aad, void *buf, int count);
+      void handleUdpMsg(uint16_t type, std::istream& is);
+      void sendMsg(const ReflectorMsg& msg);
+      void sendUdpMsg(const UdpCipher::AAD& aad, const ReflectorUdpMsg& msg);
+      void sendUdpMsg(const ReflectorUdpMsg& msg);
+      void sendUdpRegisterMsg(void);
+  };
+
+  /**
+   * @brief The benchmark controller
+   *
+   * The benchmark is run in a number of phases. First all clients are
+   * connected. Then one measurement round is run for each number of talkers
+   * given on the command line. Each round consist of a settle phase, where
+   * the clients select talk groups, a run phase where the talkers send audio
+   * in bursts and a drain phase where late audio frames are collected.
+   */
+  class Bench : public sigc::trackable
+  {
+    public:
+      struct Options
+      {
+        std::string           host          = "localhost";
+        int                   port          = 5300;
+        int                   proto         = 3;
+        unsigned              clients       = 10;
+        unsigned              first         = 0;
+        std::string           prefix        = "SM0BCH";
+        std::string           auth_key;
+        uint32_t              tg            = 1000;
+        std::vector<unsigned> talkers       = {1};
+        unsigned              duration      = 30;
+        unsigned              burst_len     = 5000;
+        unsigned              burst_gap     = 1000;
+        unsigned              frame_size    = 64;
+        unsigned              connect_rate  = 50;
+        unsigned              join_timeout  = 60;
+        int                   reflector_pid = 0;
+      };
+
+      explicit Bench(const Options& opts);
+      bool initialize(void);
+      void start(void);
+      int exitCode(void) const { return m_exit_code; }
+      const Options& opts(void) const { return m_opts; }
+      SslContext& sslContext(void) { return m_ssl_ctx; }
+      std::string csrPem(const std::string& callsign);
+      void clientConnected(BenchClient& client);
+      void clientFailed(BenchClient& client);
+      void audioReceived(BenchClient& client,
+                         const std::vector<uint8_t>& data);
+
+    private:
+      typedef enum
+      {
+        PHASE_JOIN, PHASE_SETTLE, PHASE_RUN, PHASE_DRAIN, PHASE_DONE
+      } Phase;
+
+      static const unsigned FRAME_INTERVAL  = 20;
+      static const unsigned SETTLE_TIME     = 2000;
+      static const unsigned DRAIN_TIME      = 1000;
+
+      Options                                   m_opts;
+      SslContext                                m_ssl_ctx;
+      SslKeypair                                m_pkey;
+      std::vector<std::unique_ptr<BenchClient>> m_clients;
+      std::vector<BenchClient*>                 m_talkers;
+      std::vector<unsigned>                     m_listener_cnt;
+      Phase                                     m_phase = PHASE_JOIN;
+      size_t                                    m_next_connect = 0;
+      unsigned                                  m_connected_cnt = 0;
+      unsigned                                  m_failed_cnt = 0;
+      Clock::time_point                         m_join_start;
+      Timer                                     m_connect_timer;
+      Timer                                     m_tick_timer;
+      Timer                                     m_audio_timer;
+      Timer                                     m_phase_timer;
+      size_t                                    m_round = 0;
+      uint32_t                                  m_frame_no = 0;
+      uint64_t                                  m_frames_expected = 0;
+      uint64_t                                  m_frames_received = 0;
+      std::vector<double>                       m_latencies;
+      Clock::time_point                         m_run_start;
+      double                                    m_run_time = 0.0;
+      double                                    m_refl_cpu_start = 0.0;
+      double                                    m_bench_cpu_start = 0.0;
+      int                                       m_exit_code = 0;
+
+      void connectNext(void);
+      void tick(void);
+      void checkJoinDone(void);
+      void startRound(void);
+      void startRun(void);
+      void sendFrames(void);
+      void startDrain(void);
+      void finishRound(void);
+      void phaseTimeout(void);
+      double reflectorCpuTime(void) const;
+      double benchCpuTime(void) const;
+      static double percentile(const std::vector<double>& sorted, double q);
+  };
+}; /* End of anonymous namespace */
+
+
+
+/****************************************************************************
+ *
+ * Prototypes
+ *
+ ****************************************************************************/
+
+static void parse_arguments(int argc, const char **argv,
+                            Bench::Options& opts, bool& print_users);
+static bool parse_talkers(const std::string& str,
+                          std::vector<unsigned>& talkers);
+static std::string make_callsign(const std::string& prefix, unsigned num);
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ *
+ * Local Global Variables
+ *
+ ****************************************************************************/
+
+  // Each client use one TCP and one UDP socket and select cannot handle more
+  // than FD_SETSIZE file descriptors
+static const unsigned MAX_CLIENTS = (FD_SETSIZE - 32) / 2;
+
+  // The number of clients that can be named with a three character suffix
+static const unsigned MAX_CALLSIGNS = 36 * 36 * 36;
+
+
+/****************************************************************************
+ *
+ * MAIN
+ *
+ ****************************************************************************/
+
+/*
+ *----------------------------------------------------------------------------
+ * Function:  main
+ * Purpose:   Start everything...
+ * Input:     argc  - The number of arguments passed to this program
+ *    	      	      including the program name.
+ *    	      argv  - The arguments passed to this program. argv[0] is the
+ *    	      	      program name.
+ * Output:    Return 0 on success, else non-zero.
+ * Author:    Tobias Blomberg / SM0SVX
+ * Created:   2026-10-18
+ * Remarks:
+ * Bugs:
+ *----------------------------------------------------------------------------
+ */
+int main(int argc, const char **argv)
+{
+  Bench::Options opts;
+  bool print_users = false;
+  parse_arguments(argc, argv, opts, print_users);
+
+  if (print_users)
+  {
+    cout << "[USERS]" << endl;
+    for (unsigned i=0; i<opts.clients; ++i)
+    {
+      cout << make_callsign(opts.prefix, opts.first + i) << "=BENCH" << endl;
+    }
+    cout << "\n[PASSWORDS]\nBENCH=\"" << opts.auth_key << "\"" << endl;
+    exit(0);
+  }
+
+  CppApplication app;
+
+  Bench bench(opts);
+  if (!bench.initialize())
+  {
+    exit(1);
+  }
+  bench.start();
+
+  app.exec();
+
+  return bench.exitCode();
+} /* main */
+
+
+
+/****************************************************************************
+ *
+ * Functions
+ *
+ ****************************************************************************/
+
+/*
+ *----------------------------------------------------------------------------
+ * Function:  parse_arguments
+ * Purpose:   Parse the command line arguments.
+ * Input:     argc  - Number of arguments in the command line
+ *    	      argv  - Array of strings with the arguments
+ *    	      opts  - The benchmark options to fill in
+ *    	      print_users - Set to true if the user config should be printed
+ * Output:    None
+ * Author:    Tobias Blomberg / SM0SVX
+ * Created:   2026-10-18
+ * Remarks:
+ * Bugs:
+ *----------------------------------------------------------------------------
+ */
+static void parse_arguments(int argc, const char **argv,
+                            Bench::Options& opts, bool& print_users)
+{
+  char *host = NULL;
+  char *prefix = NULL;
+  char *auth_key = NULL;
+  char *talkers = NULL;
+  int port = opts.port;
+  int proto = opts.proto;
+  int clients = opts.clients;
+  int first = opts.first;
+  int tg = opts.tg;
+  int duration = opts.duration;
+  int burst_len = opts.burst_len;
+  int burst_gap = opts.burst_gap;
+  int frame_size = opts.frame_size;
+  int connect_rate = opts.connect_rate;
+  int join_timeout = opts.join_timeout;
+  int reflector_pid = opts.reflector_pid;
+  int print_users_arg = 0;
+  int print_version = 0;
+
+  poptContext optCon;
+  const struct poptOption optionsTable[] =
+  {
+    POPT_AUTOHELP
+    {"host", 0, POPT_ARG_STRING, &host, 0,
+            "The reflector host to connect to (localhost)", "<host>"},
+    {"port", 0, POPT_ARG_INT, &port, 0,
+            "The reflector port to connect to (5300)", "<port>"},
+    {"proto", 0, POPT_ARG_INT, &proto, 0,
+            "The protocol major version to use, 2 or 3 (3)", "<version>"},
+    {"clients", 0, POPT_ARG_INT, &clients, 0,
+            "The number of simulated clients (10)", "<count>"},
+    {"first", 0, POPT_ARG_INT, &first, 0,
+            "The number of the first client callsign (0)", "<number>"},
+    {"callsign-prefix", 0, POPT_ARG_STRING, &prefix, 0,
+            "The callsign prefix for the simulated clients (SM0BCH)",
+            "<callsign>"},
+    {"auth-key", 0, POPT_ARG_STRING, &auth_key, 0,
+            "The authentication key used by all clients", "<key>"},
+    {"tg", 0, POPT_ARG_INT, &tg, 0,
+            "The first talk group to use (1000)", "<tg>"},
+    {"talkers", 0, POPT_ARG_STRING, &talkers, 0,
+            "Comma separated list of talker counts, one round each (1)",
+            "<list>"},
+    {"duration", 0, POPT_ARG_INT, &duration, 0,
+            "The duration of each round in seconds (30)", "<seconds>"},
+    {"burst", 0, POPT_ARG_INT, &burst_len, 0,
+            "The length of each talker burst in milliseconds (5000)", "<ms>"},
+    {"gap", 0, POPT_ARG_INT, &burst_gap, 0,
+            "The gap between talker bursts in milliseconds (1000)", "<ms>"},
+    {"frame-size", 0, POPT_ARG_INT, &frame_size, 0,
+            "The size of each 20ms audio frame in bytes (64)", "<bytes>"},
+    {"connect-rate", 0, POPT_ARG_INT, &connect_rate, 0,
+            "The number of new connections per second (50)", "<count>"},
+    {"join-timeout", 0, POPT_ARG_INT, &join_timeout, 0,
+            "The maximum time to wait for all clients to connect (60)",
+            "<seconds>"},
+    {"reflector-pid", 0, POPT_ARG_INT, &reflector_pid, 0,
+            "The PID of a local reflector to measure the CPU usage of",
+            "<pid>"},
+    {"print-users", 0, POPT_ARG_NONE, &print_users_arg, 0,
+            "Print the reflector USERS and PASSWORDS configuration", NULL},
+    {"version", 0, POPT_ARG_NONE, &print_version, 0,
+	    "Print the application version string", NULL},
+    {NULL, 0, 0, NULL, 0}
+  };
+  int err;
+
+  optCon = poptGetContext(PROGRAM_NAME, argc, argv, optionsTable, 0);
+  poptReadDefaultConfig(optCon, 0);
+
+  err = poptGetNextOpt(optCon);
+  if (err != -1)
+  {
+    fprintf(stderr, "\t%s: %s\n",
+	    poptBadOption(optCon, POPT_BADOPTION_NOALIAS),
+	    poptStrerror(err));
+    exit(1);
+  }
+
+  poptFreeContext(optCon);
+
+  if (print_version)
+  {
+    std::cout << SVXREFLECTOR_VERSION << std::endl;
+    exit(0);
+  }
+
+  if (host != NULL)
+  {
+    opts.host = host;
+  }
+  if (prefix != NULL)
+  {
+    opts.prefix = prefix;
+  }
+  if (auth_key != NULL)
+  {
+    opts.auth_key = auth_key;
+  }
+  if ((talkers != NULL) && !parse_talkers(talkers, opts.talkers))
+  {
+    cerr << "*** ERROR: Illegal talker list \"" << talkers << "\"" << endl;
+    exit(1);
+  }
+  print_users = (print_users_arg != 0);
+
+  if (opts.auth_key.empty())
+  {
+    cerr << "*** ERROR: An authentication key must be given using "
+            "--auth-key" << endl;
+    exit(1);
+  }
+  if ((proto != 2) && (proto != 3))
+  {
+    cerr << "*** ERROR: The protocol version must be 2 or 3" << endl;
+    exit(1);
+  }
+  if ((clients < 2) || (first < 0) ||
+      (static_cast<unsigned>(first + clients) > MAX_CALLSIGNS))
+  {
+    cerr << "*** ERROR: The number of clients must be at least 2 and the "
+            "client numbers must be in the range 0 to "
+         << (MAX_CALLSIGNS - 1) << endl;
+    exit(1);
+  }
+  if (!print_users && (static_cast<unsigned>(clients) > MAX_CLIENTS))
+  {
+    cerr << "*** ERROR: At most " << MAX_CLIENTS << " clients can be "
+            "simulated by one process. Run more instances in parallel, "
+            "using --first and --tg to keep them apart." << endl;
+    exit(1);
+  }
+  if ((port <= 0) || (port > 65535) || (tg <= 0) || (duration <= 0) ||
+      (burst_len < static_cast<int>(2 * 20)) || (burst_gap < 0) ||
+      (frame_size < 32) || (frame_size > 1024) || (connect_rate <= 0) ||
+      (join_timeout <= 0) || (reflector_pid < 0))
+  {
+    cerr << "*** ERROR: Illegal option value. Use --help for more "
+            "information." << endl;
+    exit(1);
+  }
+  for (unsigned talker_cnt : opts.talkers)
+  {
+    if ((talker_cnt == 0) || (talker_cnt >= static_cast<unsigned>(clients)))
+    {
+      cerr << "*** ERROR: The number of talkers must be at least one and "
+              "less than the number of clients" << endl;
+      exit(1);
+    }
+  }
+
+  opts.port = port;
+  opts.proto = proto;
+  opts.clients = clients;
+  opts.first = first;
+  opts.tg = tg;
+  opts.duration = duration;
+  opts.burst_len = burst_len;
+  opts.burst_gap = burst_gap;
+  opts.frame_size = frame_size;
+  opts.connect_rate = connect_rate;
+  opts.join_timeout = join_timeout;
+  opts.reflector_pid = reflector_pid;
+} /* parse_arguments */
+
+
+static bool parse_talkers(const std::string& str,
+                          std::vector<unsigned>& talkers)
+{
+  talkers.clear();
+  std::istringstream is(str);
+  std::string token;
+  while (std::getline(is, token, ','))
+  {
+    char *endptr = nullptr;
+    unsigned long cnt = strtoul(token.c_str(), &endptr, 10);
+    if (token.empty() || (*endptr != '\0'))
+    {
+      return false;
+    }
+    talkers.push_back(cnt);
+  }
+  return !talkers.empty();
+} /* parse_talkers */
+
+
+static std::string make_callsign(const std::string& prefix, unsigned num)
+{
+  static const char digits[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+  std::string callsign(prefix + "-");
+  callsign += digits[(num / (36 * 36)) % 36];
+  callsign += digits[(num / 36) % 36];
+  callsign += digits[num % 36];
+  return callsign;
+} /* make_callsign */
+
+
+/****************************************************************************
+ *
+ * BenchClient member functions
+ *
+ ****************************************************************************/
+
+BenchClient::BenchClient(Bench& bench, const std::string& callsign)
+  : m_bench(bench), m_callsign(callsign),
+    m_con(bench.opts().host, bench.opts().port)
+{
+  m_con.connected.connect(sigc::mem_fun(*this, &BenchClient::onConnected));
+  m_con.disconnected.connect(
+      sigc::mem_fun(*this, &BenchClient::onDisconnected));
+  m_con.frameReceived.connect(
+      sigc::mem_fun(*this, &BenchClient::onFrameReceived));
+  m_con.verifyPeer.connect(sigc::mem_fun(*this, &BenchClient::onVerifyPeer));
+  m_con.sslConnectionReady.connect(
+      sigc::mem_fun(*this, &BenchClient::onSslConnectionReady));
+  m_con.setMaxFrameSize(ReflectorMsg::MAX_POSTAUTH_FRAME_SIZE);
+  m_con.setSslContext(bench.sslContext());
+} /* BenchClient::BenchClient */
+
+
+BenchClient::~BenchClient(void)
+{
+  m_con.disconnect();
+  delete m_udp_sock;
+  m_udp_sock = nullptr;
+} /* BenchClient::~BenchClient */
+
+
+void BenchClient::connect(void)
+{
+  m_connect_start = Clock::now();
+  m_con.connect();
+} /* BenchClient::connect */
+
+
+void BenchClient::selectTg(uint32_t tg)
+{
+  if (tg == m_tg)
+  {
+    return;
+  }
+  m_tg = tg;
+  if (isConnected())
+  {
+    sendMsg(MsgSelectTG(m_tg));
+  }
+} /* BenchClient::selectTg */
+
+
+void BenchClient::tick(void)
+{
+  if ((m_state == STATE_DISCONNECTED) || m_failed)
+  {
+    return;
+  }
+
+  if (--m_tcp_heartbeat_tx_cnt == 0)
+  {
+    sendMsg(MsgHeartbeat());
+  }
+
+  if (m_state == STATE_EXPECT_UDP_HEARTBEAT)
+  {
+    sendUdpRegisterMsg();
+  }
+  else if (isConnected() && (--m_udp_heartbeat_tx_cnt == 0))
+  {
+    sendUdpMsg(MsgUdpHeartbeat());
+  }
+} /* BenchClient::tick */
+
+
+void BenchClient::sendAudio(const std::vector<uint8_t>& payload)
+{
+  sendUdpMsg(MsgUdpAudio(payload));
+} /* BenchClient::sendAudio */
+
+
+void BenchClient::flushAudio(void)
+{
+  sendUdpMsg(MsgUdpFlushSamples());
+} /* BenchClient::flushAudio */
+
+
+bool BenchClient::isV3(void) const
+{
+  return m_bench.opts().proto >= 3;
+} /* BenchClient::isV3 */
+
+
+void BenchClient::fail(const std::string& reason)
+{
+  if (m_failed)
+  {
+    return;
+  }
+  cerr << "*** ERROR[" << m_callsign << "]: " << reason << endl;
+  m_failed = true;
+  m_state = STATE_DISCONNECTED;
+  m_con.disconnect();
+  m_bench.clientFailed(*this);
+} /* BenchClient::fail */
+
+
+void BenchClient::onConnected(void)
+{
+  m_tcp_heartbeat_tx_cnt = TCP_HEARTBEAT_TX_CNT_RESET;
+  if (isV3())
+  {
+    m_state = STATE_EXPECT_CA_INFO;
+    sendMsg(MsgProtoVer());
+  }
+  else
+  {
+    m_state = STATE_EXPECT_AUTH_CHALLENGE;
+    sendMsg(MsgProtoVer(2, 0));
+  }
+} /* BenchClient::onConnected */
+
+
+void BenchClient::onDisconnected(FramedTcpConnection *con,
+                                 TcpConnection::DisconnectReason reason)
+{
+  fail(std::string("Disconnected: ") +
+       TcpConnection::disconnectReasonStr(reason));
+} /* BenchClient::onDisconnected */
+
+
+bool BenchClient::onVerifyPeer(TcpConnection *con, bool preverify_ok,
+                               X509_STORE_CTX *x509_store_ctx)
+{
+    // The benchmark is run against a test reflector so the server
+    // certificate is not checked
+  return true;
+} /* BenchClient::onVerifyPeer */
+
+
+void BenchClient::onSslConnectionReady(TcpConnection *con)
+{
+  if (m_state != STATE_EXPECT_SSL_CON_READY)
+  {
+    fail("Unexpected SSL connection readiness");
+    return;
+  }
+  m_state = STATE_EXPECT_AUTH_CHALLENGE;
+} /* BenchClient::onSslConnectionReady */
+
+
+void BenchClient::onFrameReceived(FramedTcpConnection *con,
+                                  std::vector<uint8_t>& data)
+{
+  std::stringstream ss;
+  ss.write(reinterpret_cast<const char*>(data.data()), data.size());
+
+  ReflectorMsg header;
+  if (!header.unpack(ss))
+  {
+    fail("Unpacking failed for TCP message header");
+    return;
+  }
+
+  switch (header.type())
+  {
+    case MsgError::TYPE:
+    {
+      MsgError msg;
+      fail("Error message received from server: " +
+           (msg.unpack(ss) ? msg.message() : std::string("?")));
+      break;
+    }
+
+    case MsgProtoVerDowngrade::TYPE:
+      fail("The server asked for a protocol downgrade");
+      break;
+
+    case MsgCAInfo::TYPE:
+      if (m_state != STATE_EXPECT_CA_INFO)
+      {
+        fail("Unexpected MsgCAInfo");
+        return;
+      }
+      sendMsg(MsgStartEncryptionRequest());
+      m_state = STATE_EXPECT_START_ENCRYPTION;
+      break;
+
+    case MsgStartEncryption::TYPE:
+      if (m_state != STATE_EXPECT_START_ENCRYPTION)
+      {
+        fail("Unexpected MsgStartEncryption");
+        return;
+      }
+      m_state = STATE_EXPECT_SSL_CON_READY;
+      m_con.enableSsl(true);
+      break;
+
+    case MsgClientCsrRequest::TYPE:
+      if (m_state != STATE_EXPECT_AUTH_CHALLENGE)
+      {
+        fail("Unexpected MsgClientCsrRequest");
+        return;
+      }
+      sendMsg(MsgClientCsr(m_bench.csrPem(m_callsign)));
+      break;
+
+    case MsgClientCert::TYPE:
+      fail("The server sent a client certificate. Do not let the reflector "
+           "automatically sign certificates for the benchmark callsigns.");
+      break;
+
+    case MsgAuthChallenge::TYPE:
+      handleMsgAuthChallenge(ss);
+      break;
+
+    case MsgAuthOk::TYPE:
+      if (m_state != STATE_EXPECT_AUTH_OK)
+      {
+        fail("Unexpected MsgAuthOk");
+        return;
+      }
+      m_state = STATE_EXPECT_SERVER_INFO;
+      break;
+
+    case MsgServerInfo::TYPE:
+      handleMsgServerInfo(ss);
+      break;
+
+    case MsgStartUdpEncryption::TYPE:
+      if (m_state != STATE_EXPECT_START_UDP_ENCRYPTION)
+      {
+        fail("Unexpected MsgStartUdpEncryption");
+        return;
+      }
+      m_state = STATE_EXPECT_UDP_HEARTBEAT;
+      sendUdpRegisterMsg();
+      break;
+
+    default:
+        // Node list, talker and other status messages are not of interest
+      break;
+  }
+} /* BenchClient::onFrameReceived */
+
+
+void BenchClient::handleMsgAuthChallenge(std::istream& is)
+{
+  if (m_state != STATE_EXPECT_AUTH_CHALLENGE)
+  {
+    fail("Unexpected MsgAuthChallenge");
+    return;
+  }
+  MsgAuthChallenge msg;
+  if (!msg.unpack(is) || (msg.challenge() == nullptr))
+  {
+    fail("Could not unpack MsgAuthChallenge");
+    return;
+  }
+  sendMsg(MsgAuthResponse(m_callsign, m_bench.opts().auth_key,
+                          msg.challenge()));
+  m_state = STATE_EXPECT_AUTH_OK;
+} /* BenchClient::handleMsgAuthChallenge */
+
+
+void BenchClient::handleMsgServerInfo(std::istream& is)
+{
+  if (m_state != STATE_EXPECT_SERVER_INFO)
+  {
+    fail("Unexpected MsgServerInfo");
+    return;
+  }
+  MsgServerInfo msg;
+  if (!msg.unpack(is))
+  {
+    fail("Could not unpack MsgServerInfo");
+    return;
+  }
+  m_client_id = msg.clientId();
+
+  const auto cipher = EncryptedUdpSocket::fetchCipher(UdpCipher::NAME);
+  delete m_udp_sock;
+  m_udp_sock = new EncryptedUdpSocket;
+  m_udp_cipher_iv_rand.resize(UdpCipher::IVRANDLEN);
+  if (!m_udp_sock->initOk() || (cipher == nullptr) ||
+      !m_udp_sock->setCipher(cipher) ||
+      !EncryptedUdpSocket::randomBytes(m_udp_cipher_iv_rand) ||
+      !m_udp_sock->setCipherKey())
+  {
+    fail("Could not create UDP socket");
+    return;
+  }
+  m_udp_sock->setCipherAADLength(UdpCipher::AADLEN);
+  m_udp_sock->setTagLength(UdpCipher::TAGLEN);
+  m_udp_sock->cipherDataReceived.connect(
+      sigc::mem_fun(*this, &BenchClient::udpCipherDataReceived));
+  m_udp_sock->dataReceived.connect(
+      sigc::mem_fun(*this, &BenchClient::udpDatagramReceived));
+
+  const std::string json("{\"sw\":\"" PROGRAM_NAME "\",\"swVer\":\""
+                         SVXREFLECTOR_VERSION "\"}");
+  if (isV3())
+  {
+    m_udp_tx_cntr = 1;
+    sendMsg(MsgNodeInfo(m_udp_cipher_iv_rand, m_udp_sock->cipherKey(), json));
+    m_state = STATE_EXPECT_START_UDP_ENCRYPTION;
+  }
+  else
+  {
+    m_udp_tx_cntr = 0;
+    sendMsg(MsgNodeInfoV2(json));
+    m_state = STATE_EXPECT_UDP_HEARTBEAT;
+    sendUdpRegisterMsg();
+  }
+} /* BenchClient::handleMsgServerInfo */
+
+
+bool BenchClient::udpCipherDataReceived(const IpAddress& addr, uint16_t port,
+                                        void *buf, int count)
+{
+  if (!isV3())
+  {
+      // Protocol V2 datagrams are not encrypted
+    std::stringstream ss;
+    ss.write(reinterpret_cast<const char *>(buf), count);
+    ReflectorUdpMsgV2 header;
+    if (header.unpack(ss))
+    {
+      handleUdpMsg(header.type(), ss);
+    }
+    return true;
+  }
+
+  if (static_cast<size_t>(count) < UdpCipher::AADLEN)
+  {
+    return true;
+  }
+  std::stringstream ss;
+  ss.write(reinterpret_cast<const char *>(buf), UdpCipher::AADLEN);
+  if (!m_aad.unpack(ss))
+  {
+    return true;
+  }
+  m_udp_sock->setCipherIV(UdpCipher::IV{m_udp_cipher_iv_rand, 0,
+                                        m_aad.iv_cntr});
+  return false;
+} /* BenchClient::udpCipherDataReceived */
+
+
+void BenchClient::udpDatagramReceived(const IpAddress& addr, uint16_t port,
+                                      void *aad, void *buf, int count)
+{
+  std::stringstream ss;
+  ss.write(reinterpret_cast<const char *>(buf), count);
+  ReflectorUdpMsg header;
+  if (header.unpack(ss))
+  {
+    handleUdpMsg(header.type(), ss);
+  }
+} /* BenchClient::udpDatagramReceived */
+
+
+void BenchClient::handleUdpMsg(uint16_t type, std::istream& is)
+{
+  switch (type)
+  {
+    case MsgUdpHeartbeat::TYPE:
+      if (m_state == STATE_EXPECT_UDP_HEARTBEAT)
+      {
+        std::chrono::duration<double, std::milli> join_time =
+          Clock::now() - m_connect_start;
+        m_join_time = join_time.count();
+        m_state = STATE_CONNECTED;
+        m_udp_heartbeat_tx_cnt = UDP_HEARTBEAT_TX_CNT_RESET;
+        if (m_tg > 0)
+        {
+          sendMsg(MsgSelectTG(m_tg));
+        }
+        m_bench.clientConnected(*this);
+      }
+      break;
+
+    case MsgUdpAudio::TYPE:
+    {
+      MsgUdpAudio msg;
+      if (isConnected() && msg.unpack(is))
+      {
+        m_bench.audioReceived(*this, msg.audioData());
+      }
+      break;
+    }
+
+    default:
+      break;
+  }
+} /* BenchClient::handleUdpMsg */
+
+
+void BenchClient::sendMsg(const ReflectorMsg& msg)
+{
+  m_tcp_heartbeat_tx_cnt = TCP_HEARTBEAT_TX_CNT_RESET;
+
+  std::ostringstream ss;
+  ReflectorMsg header(msg.type());
+  if (!header.pack(ss) || !msg.pack(ss))
+  {
+    fail("Failed to pack reflector TCP message");
+    return;
+  }
+  if (m_con.write(ss.str().data(), ss.str().size()) == -1)
+  {
+    fail("Failed to write message to network connection");
+  }
+} /* BenchClient::sendMsg */
+
+
+void BenchClient::sendUdpMsg(const UdpCipher::AAD& aad,
+                             const ReflectorUdpMsg& msg)
+{
+  if (m_udp_sock == nullptr)
+  {
+    return;
+  }
+  m_udp_heartbeat_tx_cnt = UDP_HEARTBEAT_TX_CNT_RESET;
+
+  std::ostringstream ss;
+  if (!isV3())
+  {
+    ReflectorUdpMsgV2 header(msg.type(), m_client_id, aad.iv_cntr & 0xffff);
+    if (header.pack(ss) && msg.pack(ss))
+    {
+      m_udp_sock->UdpSocket::write(m_con.remoteHost(), m_con.remotePort(),
+                                   ss.str().data(), ss.str().size());
+    }
+    return;
+  }
+
+  ReflectorUdpMsg header(msg.type());
+  std::ostringstream adss;
+  if (!header.pack(ss) || !msg.pack(ss) || !aad.pack(adss))
+  {
+    return;
+  }
+  m_udp_sock->setCipherIV(UdpCipher::IV{m_udp_cipher_iv_rand, m_client_id,
+                                        aad.iv_cntr});
+  m_udp_sock->write(m_con.remoteHost(), m_con.remotePort(),
+                    adss.str().data(), adss.str().size(),
+                    ss.str().data(), ss.str().size());
+} /* BenchClient::sendUdpMsg */
+
+
+void BenchClient::sendUdpMsg(const ReflectorUdpMsg& msg)
+{
+  if (!isConnected())
+  {
+    return;
+  }
+  sendUdpMsg(UdpCipher::AAD{m_udp_tx_cntr++}, msg);
+} /* BenchClient::sendUdpMsg */
+
+
+void BenchClient::sendUdpRegisterMsg(void)
+{
+  if (isV3())
+  {
+    sendUdpMsg(UdpCipher::InitialAAD{m_client_id}, MsgUdpHeartbeat());
+  }
+  else
+  {
+    sendUdpMsg(UdpCipher::AAD{m_udp_tx_cntr++}, MsgUdpHeartbeat());
+  }
+} /* BenchClient::sendUdpRegisterMsg */
+
+
+/****************************************************************************
+ *
+ * Bench member functions
+ *
+ ****************************************************************************/
+
+Bench::Bench(const Options& opts)
+  : m_opts(opts),
+    m_connect_timer(1000 / std::min(opts.connect_rate, 1000U),
+                    Timer::TYPE_PERIODIC, false),
+    m_tick_timer(1000, Timer::TYPE_PERIODIC, false),
+    m_audio_timer(FRAME_INTERVAL, Timer::TYPE_PERIODIC, false),
+    m_phase_timer(0, Timer::TYPE_ONESHOT, false)
+{
+  m_connect_timer.expired.connect(
+      sigc::hide(sigc::mem_fun(*this, &Bench::connectNext)));
+  m_tick_timer.expired.connect(
+      sigc::hide(sigc::mem_fun(*this, &Bench::tick)));
+  m_audio_timer.expired.connect(
+      sigc::hide(sigc::mem_fun(*this, &Bench::sendFrames)));
+  m_phase_timer.expired.connect(
+      sigc::hide(sigc::mem_fun(*this, &Bench::phaseTimeout)));
+} /* Bench::Bench */
+
+
+bool Bench::initialize(void)
+{
+  if (m_opts.proto >= 3)
+  {
+      // All clients share the same key pair to avoid generating thousands
+      // of keys. It is only used to sign the CSRs that the reflector ask for
+      // before falling back to password authentication.
+    if (!m_pkey.generate(2048))
+    {
+      cerr << "*** ERROR: Failed to generate the client key pair" << endl;
+      return false;
+    }
+  }
+
+  for (unsigned i=0; i<m_opts.clients; ++i)
+  {
+    m_clients.emplace_back(
+        new BenchClient(*this, make_callsign(m_opts.prefix, m_opts.first + i)));
+  }
+
+  if ((m_opts.reflector_pid > 0) && (reflectorCpuTime() < 0.0))
+  {
+    cerr << "*** ERROR: Could not read the CPU usage of process "
+         << m_opts.reflector_pid << endl;
+    return false;
+  }
+
+  return true;
+} /* Bench::initialize */
+
+
+void Bench::start(void)
+{
+  cout << PROGRAM_NAME " v" SVXREFLECTOR_VERSION ": Connecting "
+       << m_clients.size() << " clients to " << m_opts.host << ":"
+       << m_opts.port << " using protocol V" << m_opts.proto << endl;
+  m_join_start = Clock::now();
+  m_phase = PHASE_JOIN;
+  m_connect_timer.setEnable(true);
+  m_tick_timer.setEnable(true);
+  m_phase_timer.setTimeout(1000 * m_opts.join_timeout);
+  m_phase_timer.setEnable(true);
+  connectNext();
+} /* Bench::start */
+
+
+std::string Bench::csrPem(const std::string& callsign)
+{
+  SslCertSigningReq req;
+  req.setVersion(SslCertSigningReq::VERSION_1);
+  req.addSubjectName("CN", callsign);
+  req.setPublicKey(m_pkey);
+  req.sign(m_pkey);
+  return req.pem();
+} /* Bench::csrPem */
+
+
+void Bench::clientConnected(BenchClient& client)
+{
+  ++m_connected_cnt;
+  checkJoinDone();
+} /* Bench::clientConnected */
+
+
+void Bench::clientFailed(BenchClient& client)
+{
+  ++m_failed_cnt;
+  if (m_phase == PHASE_JOIN)
+  {
+    checkJoinDone();
+  }
+} /* Bench::clientFailed */
+
+
+void Bench::audioReceived(BenchClient& client,
+                          const std::vector<uint8_t>& data)
+{
+  if ((m_phase != PHASE_RUN) && (m_phase != PHASE_DRAIN))
+  {
+    return;
+  }
+
+  std::stringstream ss;
+  ss.write(reinterpret_cast<const char *>(data.data()), data.size());
+  BenchFrame frame;
+  if (!frame.unpack(ss) || (frame.round != m_round))
+  {
+    return;
+  }
+
+  ++m_frames_received;
+  m_latencies.push_back((nowNs() - frame.sent_ns) / 1000000.0);
+} /* Bench::audioReceived */
+
+
+void Bench::connectNext(void)
+{
+  if (m_next_connect < m_clients.size())
+  {
+    m_clients[m_next_connect++]->connect();
+  }
+  if (m_next_connect >= m_clients.size())
+  {
+    m_connect_timer.setEnable(false);
+  }
+} /* Bench::connectNext */
+
+
+void Bench::tick(void)
+{
+  for (auto& client : m_clients)
+  {
+    client->tick();
+  }
+} /* Bench::tick */
+
+
+void Bench::checkJoinDone(void)
+{
+  if ((m_phase != PHASE_JOIN) ||
+      (m_connected_cnt + m_failed_cnt < m_clients.size()))
+  {
+    return;
+  }
+
+  m_connect_timer.setEnable(false);
+  m_phase_timer.setEnable(false);
+
+  std::vector<double> join_times;
+  for (const auto& client : m_clients)
+  {
+    if (client->isConnected())
+    {
+      join_times.push_back(client->joinTime());
+    }
+  }
+  std::sort(join_times.begin(), join_times.end());
+  std::chrono::duration<double> join_dur = Clock::now() - m_join_start;
+  cout << "Join: " << join_times.size() << "/" << m_clients.size()
+       << " clients connected in " << fixed << setprecision(1)
+       << join_dur.count() << "s";
+  if (!join_times.empty())
+  {
+    cout << ", join time ms"
+         << " p50=" << percentile(join_times, 0.5)
+         << " p90=" << percentile(join_times, 0.9)
+         << " p99=" << percentile(join_times, 0.99)
+         << " max=" << join_times.back();
+  }
+  cout << endl;
+
+  if (join_times.size() < 2)
+  {
+    cerr << "*** ERROR: Too few clients connected to run the benchmark"
+         << endl;
+    m_exit_code = 1;
+    m_phase = PHASE_DONE;
+    Application::app().quit();
+    return;
+  }
+
+  cout << setw(8) << "Talkers" << setw(10) << "Listeners"
+       << setw(10) << "Frames/s" << setw(8) << "Loss%"
+       << setw(9) << "p50 ms" << setw(9) << "p90 ms"
+       << setw(9) << "p99 ms" << setw(9) << "max ms";
+  if (m_opts.reflector_pid > 0)
+  {
+    cout << setw(10) << "Refl CPU%";
+  }
+  cout << setw(11) << "Bench CPU%" << endl;
+
+  m_round = 0;
+  startRound();
+} /* Bench::checkJoinDone */
+
+
+void Bench::startRound(void)
+{
+  m_phase = PHASE_SETTLE;
+
+    // Spread the connected clients over one talk group per talker. The first
+    // client in each talk group is the talker.
+  const unsigned talker_cnt = m_opts.talkers[m_round];
+  m_talkers.clear();
+  m_listener_cnt.assign(talker_cnt, 0);
+  unsigned cnt = 0;
+  for (auto& client : m_clients)
+  {
+    if (!client->isConnected())
+    {
+      continue;
+    }
+    const unsigned tg_idx = cnt++ % talker_cnt;
+    client->selectTg(m_opts.tg + tg_idx);
+    if (m_talkers.size() < talker_cnt)
+    {
+      m_talkers.push_back(client.get());
+    }
+    else
+    {
+      m_listener_cnt[tg_idx] += 1;
+    }
+  }
+
+  m_phase_timer.setTimeout(SETTLE_TIME);
+  m_phase_timer.setEnable(true);
+} /* Bench::startRound */
+
+
+void Bench::startRun(void)
+{
+  m_phase = PHASE_RUN;
+  m_frame_no = 0;
+  m_frames_expected = 0;
+  m_frames_received = 0;
+  m_latencies.clear();
+  m_refl_cpu_start = reflectorCpuTime();
+  m_bench_cpu_start = benchCpuTime();
+  m_run_start = Clock::now();
+  m_audio_timer.setEnable(true);
+  m_phase_timer.setTimeout(1000 * m_opts.duration);
+  m_phase_timer.setEnable(true);
+} /* Bench::startRun */
+
+
+void Bench::sendFrames(void)
+{
+  const uint32_t burst_frames = m_opts.burst_len / FRAME_INTERVAL;
+  const uint32_t gap_frames = m_opts.burst_gap / FRAME_INTERVAL;
+  const uint32_t pos = m_frame_no++ % (burst_frames + gap_frames + 1);
+  if (pos > burst_frames)
+  {
+    return;
+  }
+
+  for (size_t i=0; i<m_talkers.size(); ++i)
+  {
+    BenchClient *talker = m_talkers[i];
+    if (!talker->isConnected())
+    {
+      continue;
+    }
+    if (pos == burst_frames)
+    {
+      talker->flushAudio();
+      continue;
+    }
+
+    BenchFrame frame;
+    frame.round = m_round;
+    frame.talker = i;
+    frame.seq = m_frame_no;
+    frame.sent_ns = nowNs();
+    std::ostringstream ss;
+    frame.pack(ss);
+    const std::string packed(ss.str());
+    std::vector<uint8_t> payload(packed.begin(), packed.end());
+    payload.resize(std::max<size_t>(payload.size(), m_opts.frame_size));
+    talker->sendAudio(payload);
+    m_frames_expected += m_listener_cnt[i];
+  }
+} /* Bench::sendFrames */
+
+
+void Bench::startDrain(void)
+{
+  m_phase = PHASE_DRAIN;
+  m_audio_timer.setEnable(false);
+  std::chrono::duration<double> run_time = Clock::now() - m_run_start;
+  m_run_time = run_time.count();
+  for (auto talker : m_talkers)
+  {
+    if (talker->isConnected())
+    {
+      talker->flushAudio();
+    }
+  }
+  m_phase_timer.setTimeout(DRAIN_TIME);
+  m_phase_timer.setEnable(true);
+} /* Bench::startDrain */
+
+
+void Bench::finishRound(void)
+{
+  std::chrono::duration<double> meas_time = Clock::now() - m_run_start;
+  const double refl_cpu = reflectorCpuTime() - m_refl_cpu_start;
+  const double bench_cpu = benchCpuTime() - m_bench_cpu_start;
+
+  unsigned listener_cnt = 0;
+  for (unsigned cnt : m_listener_cnt)
+  {
+    listener_cnt += cnt;
+  }
+
+  std::sort(m_latencies.begin(), m_latencies.end());
+  double loss = 0.0;
+  if (m_frames_expected > 0)
+  {
+    loss = 100.0 * (1.0 - static_cast<double>(m_frames_received) /
+                          m_frames_expected);
+  }
+
+  cout << setw(8) << m_talkers.size() << setw(10) << listener_cnt
+       << fixed << setprecision(0)
+       << setw(10) << (m_frames_received / m_run_time)
+       << setprecision(2) << setw(8) << loss
+       << setw(9) << percentile(m_latencies, 0.5)
+       << setw(9) << percentile(m_latencies, 0.9)
+       << setw(9) << percentile(m_latencies, 0.99)
+       << setw(9) << (m_latencies.empty() ? 0.0 : m_latencies.back())
+       << setprecision(1);
+  if (m_opts.reflector_pid > 0)
+  {
+    cout << setw(10) << (100.0 * refl_cpu / meas_time.count());
+  }
+  cout << setw(11) << (100.0 * bench_cpu / meas_time.count()) << endl;
+
+  if (++m_round < m_opts.talkers.size())
+  {
+    startRound();
+  }
+  else
+  {
+    m_phase = PHASE_DONE;
+    m_tick_timer.setEnable(false);
+    const auto failed_cnt = std::count_if(m_clients.begin(), m_clients.end(),
+        [](const std::unique_ptr<BenchClient>& c) { return c->hasFailed(); });
+    if (failed_cnt > 0)
+    {
+      cerr << "*** WARNING: " << failed_cnt << " client(s) failed" << endl;
+    }
+    Application::app().quit();
+  }
+} /* Bench::finishRound */
+
+
+void Bench::phaseTimeout(void)
+{
+  switch (m_phase)
+  {
+    case PHASE_JOIN:
+      cerr << "*** WARNING: Join timeout. Running the benchmark with the "
+              "clients that did connect." << endl;
+      m_failed_cnt = m_clients.size() - m_connected_cnt;
+      checkJoinDone();
+      break;
+    case PHASE_SETTLE:
+      startRun();
+      break;
+    case PHASE_RUN:
+      startDrain();
+      break;
+    case PHASE_DRAIN:
+      finishRound();
+      break;
+    case PHASE_DONE:
+      break;
+  }
+} /* Bench::phaseTimeout */
+
+
+double Bench::reflectorCpuTime(void) const
+{
+  if (m_opts.reflector_pid <= 0)
+  {
+    return 0.0;
+  }
+
+  std::ostringstream path;
+  path << "/proc/" << m_opts.reflector_pid << "/stat";
+  std::ifstream ifs(path.str());
+  std::string stat;
+  if (!std::getline(ifs, stat))
+  {
+    return -1.0;
+  }
+
+    // The process name may contain spaces so start parsing after it. The
+    // utime and stime fields are field 14 and 15 in the stat file.
+  std::string::size_type pos = stat.rfind(')');
+  if (pos == std::string::npos)
+  {
+    return -1.0;
+  }
+  std::istringstream is(stat.substr(pos + 1));
+  std::string field;
+  for (int i=0; i<11; ++i)
+  {
+    is >> field;
+  }
+  unsigned long long utime = 0, stime = 0;
+  if (!(is >> utime >> stime))
+  {
+    return -1.0;
+  }
+  return static_cast<double>(utime + stime) / sysconf(_SC_CLK_TCK);
+} /* Bench::reflectorCpuTime */
+
+
+double Bench::benchCpuTime(void) const
+{
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+  {
+    return 0.0;
+  }
+  return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1000000.0 +
+         usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1000000.0;
+} /* Bench::benchCpuTime */
+
+
+double Bench::percentile(const std::vector<double>& sorted, double q)
+{
+  if (sorted.empty())
+  {
+    return 0.0;
+  }
+  size_t idx = static_cast<size_t>(q * sorted.size());
+  return sorted[std::min(idx, sorted.size() - 1)];
+} /* Bench::percentile */
+
+
+
+/*
+ * This file has not been truncated
+ */
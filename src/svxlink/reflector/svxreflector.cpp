@@ -143,6 +143,7 @@ static char             *logfile_name = NULL;
 static char             *runasuser = NULL;
 static char   	      	*config = NULL;
 static int    	      	daemonize = 0;
+static int    	      	takeover = 0;
 static int    	      	logfd = -1;
 static FdWatch	      	*stdin_watch = 0;
 static FdWatch	      	*stdout_watch = 0;
@@ -441,7 +442,7 @@ int main(int argc, const char *argv[])
   }
 
   Reflector ref;
-  if (ref.initialize(cfg))
+  if (ref.initialize(cfg, takeover != 0))
   {
     app.exec();
   }
@@ -517,6 +518,8 @@ static void parse_arguments(int argc, const char **argv)
 	    "Start " PROGRAM_NAME " as a daemon", NULL},
     {"version", 0, POPT_ARG_NONE, &print_version, 0,
 	    "Print the application version string", NULL},
+    {"takeover", 0, POPT_ARG_NONE, &takeover, 0,
+	    "Take over the server sockets from a running " PROGRAM_NAME, NULL},
     {NULL, 0, 0, NULL, 0}
   };
   int err;
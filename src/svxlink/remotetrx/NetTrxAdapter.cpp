@@ -42,6 +42,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include <Rx.h>
 #include <Tx.h>
+#include <AsyncApplication.h>
 #include <AsyncAudioValve.h>
 #include <AsyncAudioFifo.h>
 #include <AsyncAudioDebugger.h>
@@ -190,7 +191,7 @@ class RxAdapter : public Rx, public AudioSink
 
     void setSignalLevel(char rx_id, float new_siglev)
     {
-      clock_gettime(CLOCK_MONOTONIC, &last_siglev_time);
+      Application::app().clockGetTime(CLOCK_MONOTONIC, &last_siglev_time);
       setRxId(rx_id);
       siglev = new_siglev;
       signalLevelUpdated(siglev);
@@ -210,12 +211,9 @@ class RxAdapter : public Rx, public AudioSink
     void reportSiglev(Timer *t)
     {
       struct timespec ts;
-      long diff = 2000;
-      if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
-      {
-        diff =  1000 * (ts.tv_sec - last_siglev_time.tv_sec) +
-                (ts.tv_nsec - last_siglev_time.tv_nsec) / 1000000;
-      }
+      Application::app().clockGetTime(CLOCK_MONOTONIC, &ts);
+      long diff = 1000 * (ts.tv_sec - last_siglev_time.tv_sec) +
+                  (ts.tv_nsec - last_siglev_time.tv_nsec) / 1000000;
       if (diff > 1500)
       {
         signalLevelUpdated(siglev);
@@ -33,8 +33,10 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  ****************************************************************************/
 
 #include <iostream>
+#include <sstream>
 #include <cstring>
 #include <cerrno>
+#include <algorithm>
 
 
 /****************************************************************************
@@ -52,6 +54,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <AsyncAudioSplitter.h>
 #include <AsyncAudioSelector.h>
 #include <AsyncAudioPassthrough.h>
+#include <AsyncEncryptedUdpSocket.h>
+#include <NetTrxUdpLink.h>
 
 
 /****************************************************************************
@@ -125,11 +129,12 @@ using namespace NetTrxMsg;
 
 NetUplink::NetUplink(Config &cfg, const string &name, Rx *rx, Tx *tx,
       	      	     const string& port_str)
-  : server(0), con(0), recv_cnt(0), recv_exp(0), rx(rx), tx(tx), fifo(0),
-    cfg(cfg), name(name), last_msg_timestamp(), heartbeat_timer(0),
-    audio_enc(0), audio_dec(0), loopback_con(0), rx_splitter(0),
-    tx_selector(0), state(STATE_DISC), mute_tx_timer(0), tx_muted(false),
-    fallback_enabled(false), tx_ctrl_mode(Tx::TX_OFF)
+  : server(0), max_clients(1), tx_owner(0), rx(rx), tx(tx), fifo(0),
+    cfg(cfg), name(name), heartbeat_timer(0), loopback_con(0), rx_splitter(0),
+    tx_selector(0), mute_tx_timer(0), tx_muted(false),
+    fallback_enabled(false), tx_ctrl_mode(Tx::TX_OFF), udp_sock(0),
+    udp_jitter_buffer_delay(NetTrxJitterBuffer::DEFAULT_DELAY),
+    tcp_tx_queue_max(0)
 {
   heartbeat_timer = new Timer(10000);
   heartbeat_timer->setEnable(false);
@@ -146,8 +151,21 @@ NetUplink::NetUplink(Config &cfg, const string &name, Rx *rx, Tx *tx,
 
 NetUplink::~NetUplink(void)
 {
-  delete audio_enc;
-  delete audio_dec;
+  for (Clients::iterator it=clients.begin(); it!=clients.end(); ++it)
+  {
+    Client *client = (*it).second;
+    delete client->udp_link;
+    delete client->audio_dec;
+    delete client;
+  }
+  clients.clear();
+  for (RxEncoders::iterator it=rx_encoders.begin(); it!=rx_encoders.end(); ++it)
+  {
+    delete (*it).second->enc;
+    delete (*it).second;
+  }
+  rx_encoders.clear();
+  deleteReleasedRxEncoders();
   delete fifo;
   delete tx_selector;
   delete rx_splitter;
@@ -155,6 +173,7 @@ NetUplink::~NetUplink(void)
   delete server;
   delete heartbeat_timer;
   delete mute_tx_timer;
+  delete udp_sock;
   //delete siglev_check_timer;
 } /* NetUplink::~NetUplink */
 
@@ -193,6 +212,14 @@ bool NetUplink::initialize(void)
   
   cfg.getValue(name, "FALLBACK_REPEATER", fallback_enabled, true);
   cfg.getValue(name, "AUTH_KEY", auth_key, true);
+  cfg.getValue(name, "TCP_TX_QUEUE_MAX", tcp_tx_queue_max, true);
+
+  if (!cfg.getValue(name, "MAX_CLIENTS", 1U, 1000U, max_clients, true))
+  {
+    cerr << "*** ERROR: The value of configuration variable " << name
+         << "/MAX_CLIENTS is out of range. Valid range is 1 to 1000.\n";
+    return false;
+  }
   
   int mute_tx_on_rx = -1;
   cfg.getValue(name, "MUTE_TX_ON_RX", mute_tx_on_rx, true);
@@ -203,6 +230,34 @@ bool NetUplink::initialize(void)
     mute_tx_timer->expired.connect(mem_fun(*this, &NetUplink::unmuteTx));
   }
   
+  bool udp_audio = false;
+  cfg.getValue(name, "UDP_AUDIO", udp_audio);
+  if (udp_audio && auth_key.empty())
+  {
+      // The UDP cipher key is derived from the authentication key and is
+      // never sent over the network
+    cerr << "*** WARNING: UDP_AUDIO require AUTH_KEY to be set in NetUplink "
+         << name << ". Using TCP for audio.\n";
+    udp_audio = false;
+  }
+  if (udp_audio)
+  {
+    string udp_listen_port(listen_port);
+    cfg.getValue(name, "UDP_LISTEN_PORT", udp_listen_port);
+    cfg.getValue(name, "UDP_JITTER_BUFFER_DELAY", udp_jitter_buffer_delay);
+    udp_sock = new EncryptedUdpSocket(atoi(udp_listen_port.c_str()));
+    if (!NetTrxUdpLink::setupSocket(udp_sock))
+    {
+      cerr << "*** ERROR: Could not set up UDP audio socket on port "
+           << udp_listen_port << " in NetUplink " << name << endl;
+      return false;
+    }
+    udp_sock->cipherDataReceived.connect(
+        mem_fun(*this, &NetUplink::udpCipherDataReceived));
+    udp_sock->dataReceived.connect(
+        mem_fun(*this, &NetUplink::udpDatagramReceived));
+  }
+
   server = new TcpServer<>(listen_port);
   server->clientConnected.connect(mem_fun(*this, &NetUplink::clientConnected));
   server->clientDisconnected.connect(
@@ -271,47 +326,41 @@ bool NetUplink::initialize(void)
 
 void NetUplink::handleIncomingConnection(TcpConnection *incoming_con)
 {
-  assert(con == 0);
-  rx->reset();
-  if (fallback_enabled) // Deactivate fallback repeater mode
+  if (clients.empty())
   {
-    setFallbackActive(false);
-  }
-  
-  if (audio_enc != 0)
-  {
-    rx_splitter->removeSink(audio_enc);
-    delete audio_enc;
-    audio_enc = 0;
+    rx->reset();
+    if (fallback_enabled) // Deactivate fallback repeater mode
+    {
+      setFallbackActive(false);
+    }
+    heartbeat_timer->setEnable(true);
   }
   
-  delete audio_dec;
-  audio_dec = 0;
+  Client *client = new Client;
+  client->con = incoming_con;
+  Application::app().getTimeOfDay(&client->last_msg_timestamp);
+  clients[incoming_con] = client;
+
+  incoming_con->setRecvBufLen(Msg::MAX_SIZE);
+  incoming_con->setMaxTxQueueSize(tcp_tx_queue_max);
+  incoming_con->dataReceived.connect(
+      mem_fun(*this, &NetUplink::tcpDataReceived));
   
-  con = incoming_con;
-  con->dataReceived.connect(mem_fun(*this, &NetUplink::tcpDataReceived));
-  recv_exp = sizeof(Msg);
-  recv_cnt = 0;
-  heartbeat_timer->setEnable(true);
-  gettimeofday(&last_msg_timestamp, NULL);
-  
-  setState(STATE_CON_SETUP);
-
-  MsgProtoVer *ver_msg = new MsgProtoVer;
-  sendMsg(ver_msg);
+  MsgProtoVer ver_msg;
+  sendMsg(client, ver_msg);
   
   if (auth_key.empty())
   {
-    MsgAuthOk *auth_msg = new MsgAuthOk;
-    sendMsg(auth_msg);
-    setState(STATE_READY);
+    MsgAuthOk auth_msg;
+    sendMsg(client, auth_msg);
+    client->state = STATE_READY;
   }
   else
   {
-    MsgAuthChallenge *auth_msg = new MsgAuthChallenge;
-    memcpy(auth_challenge, auth_msg->challenge(),
+    MsgAuthChallenge auth_msg;
+    memcpy(client->auth_challenge, auth_msg.challenge(),
            MsgAuthChallenge::CHALLENGE_LEN);
-    sendMsg(auth_msg);
+    sendMsg(client, auth_msg);
   }
 } /* NetUplink::handleIncomingConnection */
 
@@ -321,35 +370,81 @@ void NetUplink::clientConnected(TcpConnection *incoming_con)
   cout << name << ": Client connected: " << incoming_con->remoteHost() << ":"
        << incoming_con->remotePort() << endl;
   
-  switch (state)
+  if (clients.size() >= max_clients)
   {
-    case STATE_DISC:
-      handleIncomingConnection(incoming_con);
-      break;
-    case STATE_CON_SETUP:
-    case STATE_READY:
+    if (max_clients == 1)
+    {
       cout << name << ": Only one client allowed. Disconnecting...\n";
-      // Fall through
-    case STATE_DISC_CLEANUP:
-      incoming_con->disconnect();
-      break;
+    }
+    else
+    {
+      cout << name << ": Only " << max_clients << " clients allowed. "
+              "Disconnecting...\n";
+    }
+    incoming_con->disconnect();
+    incoming_con->disconnected(incoming_con,
+                               TcpConnection::DR_ORDERED_DISCONNECT);
+    return;
   }
+
+  handleIncomingConnection(incoming_con);
 } /* NetUplink::clientConnected */
 
 
-void NetUplink::disconnectCleanup(void)
+void NetUplink::removeClient(Client *client)
 {
-  con = 0;
-  recv_exp = 0;
-  setState(STATE_DISC);
+  if (client->state == STATE_DISC)
+  {
+    return;
+  }
+  client->state = STATE_DISC;
+  clients.erase(client->con);
+  client->con = 0;
+
+  if (client->udp_link != 0)
+  {
+    udp_sessions.erase(client->udp_link->sessionId());
+  }
+
+  releaseRxEncoder(client);
+
+  if (tx_owner == client)
+  {
+    fifo->clear();
+    setTxOwner(0);
+  }
+
+    // The rest of the cleanup is done later since we may be deep down in a
+    // callback chain originating from the client
+  Application::app().runTask(
+      sigc::bind(mem_fun(*this, &NetUplink::disconnectCleanup), client));
+} /* NetUplink::removeClient */
+
+
+void NetUplink::disconnectCleanup(Client *client)
+{
+  deleteUdpLink(client);
+  delete client->audio_dec;
+  const bool had_tone_dets = !client->tone_dets.empty();
+  delete client;
+
+  if (!clients.empty())
+  {
+      // Reevaluate the shared receiver and transmitter state using the
+      // requests from the remaining clients
+    if (had_tone_dets)
+    {
+      resetRx(0);
+    }
+    updateRxMuteState();
+    updateTxCtrlMode();
+    updateCtcss();
+    return;
+  }
 
   rx->reset();
   tx->enableCtcss(false);
   fifo->clear();
-  if (audio_dec != 0)
-  {
-    audio_dec->flushEncodedSamples();
-  }
   tx->setTxCtrlMode(Tx::TX_OFF);
   heartbeat_timer->setEnable(false);
 
@@ -375,11 +470,14 @@ void NetUplink::disconnectCleanup(void)
 void NetUplink::clientDisconnected(TcpConnection *the_con,
                                    TcpConnection::DisconnectReason reason)
 {
+  Clients::iterator it = clients.find(the_con);
+  if (it == clients.end())
+  {
+    return;
+  }
   cout << name << ": Client disconnected: " << the_con->remoteHost() << ":"
        << the_con->remotePort() << endl;
-  con = 0;
-  setState(STATE_DISC_CLEANUP);
-  Application::app().runTask(mem_fun(*this, &NetUplink::disconnectCleanup));
+  removeClient((*it).second);
 } /* NetUplink::clientDisconnected */
 
 
@@ -391,82 +489,59 @@ int NetUplink::tcpDataReceived(TcpConnection *con, void *data, int size)
   //cout << "Received a TCP message with type " << msg->type()
   //     << " and size " << msg->size() << endl;
   
-    // Discard data if we are not in one of the "connected" states
-  if ((state != STATE_CON_SETUP) && (state != STATE_READY))
+    // Discard data if the client has been disconnected
+  Clients::iterator it = clients.find(con);
+  if (it == clients.end())
   {
     return size;
   }
+  Client *client = (*it).second;
 
-  if (recv_exp == 0)
-  {
-    cerr << "*** ERROR: Unexpected TCP data received in NetUplink "
-         << name << ". Throwing it away...\n";
-    return size;
-  }
-  
-  int orig_size = size;
-  
+    // Messages are handled in place in the receive buffer of the TCP
+    // connection. An incomplete message is left in the buffer until the
+    // rest of it has been received.
   char *buf = static_cast<char*>(data);
-  while (size > 0)
+  int processed = 0;
+  while (size - processed >= static_cast<int>(sizeof(Msg)))
   {
-    unsigned read_cnt = min(static_cast<unsigned>(size), recv_exp-recv_cnt);
-    if (recv_cnt+read_cnt > sizeof(recv_buf))
+    Msg *msg = reinterpret_cast<Msg*>(buf + processed);
+    if (msg->size() < sizeof(Msg))
+    {
+      cerr << "*** ERROR: Illegal message header received in NetUplink "
+           << name << ". Header length too small (" << msg->size()
+           << ")\n";
+      forceDisconnect(client);
+      return size;
+    }
+    if (msg->size() > Msg::MAX_SIZE)
     {
       cerr << "*** ERROR: TCP receive buffer overflow in NetUplink "
            << name << ". Disconnecting...\n";
-      forceDisconnect();
-      return orig_size;
+      forceDisconnect(client);
+      return size;
     }
-    memcpy(recv_buf+recv_cnt, buf, read_cnt);
-    size -= read_cnt;
-    recv_cnt += read_cnt;
-    buf += read_cnt;
-    
-    if (recv_cnt == recv_exp)
+    if (size - processed < static_cast<int>(msg->size()))
     {
-      if (recv_exp == sizeof(Msg))
-      {
-      	Msg *msg = reinterpret_cast<Msg*>(recv_buf);
-	if (msg->size() == sizeof(Msg))
-	{
-	  handleMsg(msg);
-	  recv_cnt = 0;
-	  recv_exp = sizeof(Msg);
-	}
-	else if (msg->size() > sizeof(Msg))
-	{
-      	  recv_exp = msg->size();
-	}
-	else
-	{
-	  cerr << "*** ERROR: Illegal message header received in NetUplink "
-               << name << ". Header length too small (" << msg->size()
-               << ")\n";
-          forceDisconnect();
-	  return orig_size;
-	}
-      }
-      else
-      {
-      	Msg *msg = reinterpret_cast<Msg*>(recv_buf);
-      	handleMsg(msg);
-	recv_cnt = 0;
-	recv_exp = sizeof(Msg);
-      }
+      break;
+    }
+    processed += msg->size();
+    handleMsg(client, msg);
+    if (client->state == STATE_DISC)
+    {
+      return size;
     }
   }
-  
-  return orig_size;
+
+  return processed;
   
 } /* NetUplink::tcpDataReceived */
 
 
-void NetUplink::handleMsg(Msg *msg)
+void NetUplink::handleMsg(Client *client, Msg *msg)
 {
-  switch (state)
+  switch (client->state)
   {
     case STATE_DISC:
-    case STATE_DISC_CLEANUP:
       return;
       
     case STATE_CON_SETUP:
@@ -474,24 +549,24 @@ void NetUplink::handleMsg(Msg *msg)
           msg->size() == sizeof(MsgAuthResponse))
       {
         MsgAuthResponse *resp_msg = reinterpret_cast<MsgAuthResponse *>(msg);
-        if (!resp_msg->verify(auth_key, auth_challenge))
+        if (!resp_msg->verify(auth_key, client->auth_challenge))
         {
           cerr << "*** ERROR: Authentication error in NetUplink "
                << name << ".\n";
-          forceDisconnect();
+          forceDisconnect(client);
           return;
         }
         else
         {
-          MsgAuthOk *ok_msg = new MsgAuthOk;
-          sendMsg(ok_msg);
+          MsgAuthOk ok_msg;
+          sendMsg(client, ok_msg);
         }
-        setState(STATE_READY);
+        client->state = STATE_READY;
       }
       else
       {
         cerr << "*** ERROR: Protocol error in NetUplink " << name << ".\n";
-        forceDisconnect();
+        forceDisconnect(client);
       }
       return;
     
@@ -499,18 +574,41 @@ void NetUplink::handleMsg(Msg *msg)
       break;
   }
   
-  gettimeofday(&last_msg_timestamp, NULL);
+  Application::app().getTimeOfDay(&client->last_msg_timestamp);
+
+  if ((client->udp_link != 0) && client->udp_link->holdTcpMsg(msg))
+  {
+    return;
+  }
+
+  dispatchMsg(client, msg);
   
+} /* NetUplink::handleMsg */
+
+
+void NetUplink::dispatchMsg(Client *client, Msg *msg)
+{
+  if (client->state != STATE_READY)
+  {
+    return;
+  }
+
   switch (msg->type())
   {
     case MsgHeartbeat::TYPE:
     {
       break;
     }
+
+    case MsgUdpSetup::TYPE:
+    {
+      handleUdpSetup(client);
+      break;
+    }
     
     case MsgReset::TYPE:
     {
-      rx->reset();
+      resetRx(client);
       break;
     }
     
@@ -537,7 +635,8 @@ void NetUplink::handleMsg(Msg *msg)
       cout << rx->name() << ": SetMuteState("
            << Rx::muteStateToString(mute_msg->muteState())
       	   << ")\n";
-      rx->setMuteState(mute_msg->muteState());
+      client->rx_mute_state = mute_msg->muteState();
+      updateRxMuteState();
       break;
     }
     
@@ -547,26 +646,30 @@ void NetUplink::handleMsg(Msg *msg)
       cout << rx->name() << ": AddToneDetector(" << atd->fq()
       	   << ", " << atd->bw()
 	   << ", " << atd->requiredDuration() << ")\n";
-      rx->addToneDetector(atd->fq(), atd->bw(), atd->thresh(),
-      	      	      	  atd->requiredDuration());
+      ToneDetParams params;
+      params.fq = atd->fq();
+      params.bw = atd->bw();
+      params.thresh = atd->thresh();
+      params.required_duration = atd->requiredDuration();
+      client->tone_dets.push_back(params);
+      rx->addToneDetector(params.fq, params.bw, params.thresh,
+      	      	      	  params.required_duration);
       break;
     }
     
     case MsgSetTxCtrlMode::TYPE:
     {
       MsgSetTxCtrlMode *mode_msg = reinterpret_cast<MsgSetTxCtrlMode *>(msg);
-      tx_ctrl_mode = mode_msg->mode();
-      if (!tx_muted)
-      {
-	tx->setTxCtrlMode(tx_ctrl_mode);
-      }
+      client->tx_ctrl_mode = mode_msg->mode();
+      updateTxCtrlMode();
       break;
     }
      
     case MsgEnableCtcss::TYPE:
     {
       MsgEnableCtcss *ctcss_msg = reinterpret_cast<MsgEnableCtcss *>(msg);
-      tx->enableCtcss(ctcss_msg->enable());
+      client->ctcss_enabled = ctcss_msg->enable();
+      updateCtcss();
       break;
     }
      
@@ -579,89 +682,60 @@ void NetUplink::handleMsg(Msg *msg)
     
     case MsgRxAudioCodecSelect::TYPE:
     {
-      MsgRxAudioCodecSelect *codec_msg = 
-          reinterpret_cast<MsgRxAudioCodecSelect *>(msg);
-      if (audio_enc != 0)
-      {
-	rx_splitter->removeSink(audio_enc);
-	delete audio_enc;
-      }
-      audio_enc = AudioEncoder::create(codec_msg->name());
-      if (audio_enc != 0)
-      {
-        audio_enc->writeEncodedSamples.connect(
-                mem_fun(*this, &NetUplink::writeEncodedSamples));
-        audio_enc->flushEncodedSamples.connect(
-                mem_fun(*audio_enc, &AudioEncoder::allEncodedSamplesFlushed));
-        //audio_enc->registerSource(rx);
-	rx_splitter->addSink(audio_enc);
-        cout << name << ": Using CODEC \"" << audio_enc->name()
-             << "\" to encode RX audio\n";
-	
-	MsgRxAudioCodecSelect::Opts opts;
-	codec_msg->options(opts);
-	MsgRxAudioCodecSelect::Opts::const_iterator it;
-	for (it=opts.begin(); it!=opts.end(); ++it)
-	{
-	  audio_enc->setOption((*it).first, (*it).second);
-	}
-	audio_enc->printCodecParams();
-      }
-      else
-      {
-        cerr << "*** ERROR: Received request for unknown RX audio codec ("
-             << codec_msg->name() << ") in NetUplink " << name << "\n";
-      }
+      selectRxCodec(client, reinterpret_cast<MsgRxAudioCodecSelect *>(msg));
       break;
     }
     
     case MsgTxAudioCodecSelect::TYPE:
     {
-      MsgTxAudioCodecSelect *codec_msg = 
-          reinterpret_cast<MsgTxAudioCodecSelect *>(msg);
-      delete audio_dec;
-      audio_dec = AudioDecoder::create(codec_msg->name());
-      if (audio_dec != 0)
-      {
-        audio_dec->registerSink(fifo);
-        audio_dec->allEncodedSamplesFlushed.connect(
-            mem_fun(*this, &NetUplink::allEncodedSamplesFlushed));
-        cout << name << ": Using CODEC \"" << audio_dec->name()
-             << "\" to decode TX audio\n";
-	
-	MsgRxAudioCodecSelect::Opts opts;
-	codec_msg->options(opts);
-	MsgTxAudioCodecSelect::Opts::const_iterator it;
-	for (it=opts.begin(); it!=opts.end(); ++it)
-	{
-	  audio_dec->setOption((*it).first, (*it).second);
-	}
-	audio_dec->printCodecParams();
-      }
-      else
-      {
-        cerr << "*** ERROR: Received request for unknown TX audio codec ("
-             << codec_msg->name() << ") in NetUplink " << name << "\n";
-      }
+      selectTxCodec(client, reinterpret_cast<MsgTxAudioCodecSelect *>(msg));
       break;
     }
     
     case MsgAudio::TYPE:
     {
       //cout << "NetUplink [MsgAudio]\n";
-      if (!tx_muted && (audio_dec != 0))
+      if (tx_muted || (client->audio_dec == 0))
       {
-        MsgAudio *audio_msg = reinterpret_cast<MsgAudio*>(msg);
-        audio_dec->writeEncodedSamples(audio_msg->buf(), audio_msg->size());
+        break;
       }
+      if (tx_owner == 0)
+      {
+        setTxOwner(client);
+      }
+      if (tx_owner != client)
+      {
+        if (!client->tx_blocked)
+        {
+          cout << name << ": Transmitter busy. Ignoring audio from "
+               << clientName(client) << endl;
+          client->tx_blocked = true;
+        }
+        break;
+      }
+      MsgAudio *audio_msg = reinterpret_cast<MsgAudio*>(msg);
+      client->audio_dec->writeEncodedSamples(audio_msg->buf(),
+                                             audio_msg->size());
       break;
     }
     
     case MsgFlush::TYPE:
     {
-      if (audio_dec != 0)
+      if (client->audio_dec == 0)
+      {
+        break;
+      }
+      if (tx_owner == client)
       {
-        audio_dec->flushEncodedSamples();
+        client->audio_dec->flushEncodedSamples();
+      }
+      else
+      {
+          // The audio from this client was thrown away so there is
+          // nothing to wait for
+        client->tx_blocked = false;
+        MsgAllSamplesFlushed flushed_msg;
+        sendMsg(client, flushed_msg);
       }
       break;
     } 
@@ -699,31 +773,410 @@ void NetUplink::handleMsg(Msg *msg)
       break;
   }
   
-} /* NetUplink::handleMsg */
+} /* NetUplink::dispatchMsg */
+
+
+void NetUplink::sendMsg(Client *client, Msg *msg)
+{
+  sendMsg(client, *msg);
+  delete msg;
+} /* NetUplink::sendMsg */
+
+
+void NetUplink::sendMsg(Client *client, const Msg& msg)
+{
+  if (client->state == STATE_DISC)
+  {
+    return;
+  }
+
+  if ((client->udp_link != 0) && client->udp_link->sendMsg(&msg))
+  {
+    return;
+  }
+
+    // A pending UDP sequence mark is framed together with the message so
+    // that both are written in one go
+  tx_batch.clear();
+  uint32_t seq;
+  if ((client->udp_link != 0) && client->udp_link->takeSeqMark(seq))
+  {
+    tx_batch.append(MsgUdpSeqMark(seq));
+  }
+  tx_batch.append(msg);
+
+  int written = client->con->write(tx_batch.data(), tx_batch.size());
+  if (written == -1)
+  {
+    cerr << "*** ERROR: TCP transmit error in NetUplink \"" << name
+         << "\": " << strerror(errno) << ".\n";
+    forceDisconnect(client);
+  }
+  else if (written != tx_batch.size())
+  {
+    cerr << "*** ERROR: TCP transmit buffer overflow in NetUplink "
+         << name << ".\n";
+    forceDisconnect(client);
+  }
+} /* NetUplink::sendMsg */
+
+
+void NetUplink::sendMsgToAll(Msg *msg)
+{
+  sendMsgToAll(*msg);
+  delete msg;
+} /* NetUplink::sendMsgToAll */
+
+
+void NetUplink::sendMsgToAll(const Msg& msg)
+{
+  Clients::iterator it = clients.begin();
+  while (it != clients.end())
+  {
+      // Step the iterator first since the client may be removed on error
+    Client *client = (*it++).second;
+    if (client->state == STATE_READY)
+    {
+      sendMsg(client, msg);
+    }
+  }
+} /* NetUplink::sendMsgToAll */
 
 
-void NetUplink::sendMsg(Msg *msg)
+void NetUplink::handleUdpSetup(Client *client)
 {
-  if ((state == STATE_CON_SETUP) || (state == STATE_READY))
+  if (udp_sock == 0)
+  {
+    cout << name << ": UDP audio requested by client but not enabled. "
+            "Using TCP.\n";
+    MsgUdpSetupAck ack;
+    sendMsg(client, ack);
+    return;
+  }
+
+  if (client->udp_link != 0)
+  {
+    cerr << "*** WARNING: Ignoring repeated UDP audio setup request in "
+            "NetUplink " << name << endl;
+    return;
+  }
+
+  uint32_t session_id;
+  do
+  {
+    gcry_create_nonce(&session_id, sizeof(session_id));
+  } while (udp_sessions.find(session_id) != udp_sessions.end());
+  MsgUdpSetupAck ack(udp_sock->localPort(), session_id);
+  gcry_create_nonce(ack.ivRand(), MsgUdpSetupAck::IV_RAND_LEN);
+  uint8_t key[MsgUdpSetupAck::KEY_LEN];
+  if (!MsgUdpSetupAck::deriveKey(key, auth_key, client->auth_challenge))
+  {
+    forceDisconnect(client);
+    return;
+  }
+
+  client->udp_link = new NetTrxUdpLink(name, udp_sock,
+                                       NetTrxUdpLink::ROLE_UPLINK, ack, key);
+  client->udp_link->setJitterBufferDelay(udp_jitter_buffer_delay);
+  client->udp_link->msgReceived.connect(
+      sigc::bind<0>(mem_fun(*this, &NetUplink::dispatchMsg), client));
+  udp_sessions[session_id] = client;
+  cout << name << ": UDP audio enabled on port " << udp_sock->localPort()
+       << " for " << clientName(client) << endl;
+
+  sendMsg(client, ack);
+} /* NetUplink::handleUdpSetup */
+
+
+void NetUplink::deleteUdpLink(Client *client)
+{
+  if (client->udp_link != 0)
+  {
+    client->udp_link->printStats();
+    delete client->udp_link;
+    client->udp_link = 0;
+  }
+} /* NetUplink::deleteUdpLink */
+
+
+NetUplink::Client *NetUplink::udpSessionClient(const void *hdr_buf, int count)
+{
+  UdpHeader hdr;
+  if (!NetTrxUdpLink::readHeader(hdr_buf, count, hdr))
+  {
+    return 0;
+  }
+  UdpSessions::iterator it = udp_sessions.find(hdr.session_id);
+  if ((it == udp_sessions.end()) || ((*it).second->state != STATE_READY))
+  {
+    return 0;
+  }
+  return (*it).second;
+} /* NetUplink::udpSessionClient */
+
+
+bool NetUplink::udpCipherDataReceived(const IpAddress& addr, uint16_t port,
+                                      void *buf, int count)
+{
+  Client *client = udpSessionClient(buf, count);
+  if (client == 0)
+  {
+    return true;
+  }
+  return client->udp_link->cipherDataReceived(addr, port, buf, count);
+} /* NetUplink::udpCipherDataReceived */
+
+
+void NetUplink::udpDatagramReceived(const IpAddress& addr, uint16_t port,
+                                    void *aad, void *buf, int count)
+{
+  if (aad == nullptr)
+  {
+    return;
+  }
+  Client *client = udpSessionClient(aad, sizeof(UdpHeader));
+  if (client != 0)
   {
-    int written = con->write(msg, msg->size());
-    if (written == -1)
+    client->udp_link->datagramReceived(addr, port, aad, buf, count);
+  }
+} /* NetUplink::udpDatagramReceived */
+
+
+void NetUplink::selectRxCodec(Client *client, MsgRxAudioCodecSelect *codec_msg)
+{
+  MsgRxAudioCodecSelect::Opts opts;
+  codec_msg->options(opts);
+
+    // Clients asking for the same codec with the same options share the
+    // encoder so that the audio only is encoded once
+  string key(codec_msg->name());
+  MsgRxAudioCodecSelect::Opts::const_iterator oit;
+  for (oit=opts.begin(); oit!=opts.end(); ++oit)
+  {
+    key += string(";") + (*oit).first + "=" + (*oit).second;
+  }
+
+  if ((client->rx_enc != 0) && (client->rx_enc->key == key))
+  {
+    return;
+  }
+  releaseRxEncoder(client);
+
+  RxEncoder *rx_enc = 0;
+  RxEncoders::iterator it = rx_encoders.find(key);
+  if (it != rx_encoders.end())
+  {
+    rx_enc = (*it).second;
+    cout << name << ": Using CODEC \"" << rx_enc->enc->name()
+         << "\" to encode RX audio (shared with " << rx_enc->clients.size()
+         << " other client(s))\n";
+  }
+  else
+  {
+    AudioEncoder *enc = AudioEncoder::create(codec_msg->name());
+    if (enc == 0)
     {
-      cerr << "*** ERROR: TCP transmit error in NetUplink \"" << name
-           << "\": " << strerror(errno) << ".\n";
-      forceDisconnect();
+      cerr << "*** ERROR: Received request for unknown RX audio codec ("
+           << codec_msg->name() << ") in NetUplink " << name << "\n";
+      return;
     }
-    else if (written != static_cast<int>(msg->size()))
+    rx_enc = new RxEncoder;
+    rx_enc->key = key;
+    rx_enc->enc = enc;
+    enc->writeEncodedSamples.connect(
+        sigc::bind<0>(mem_fun(*this, &NetUplink::writeEncodedSamples),
+                      rx_enc));
+    enc->flushEncodedSamples.connect(
+        mem_fun(*enc, &AudioEncoder::allEncodedSamplesFlushed));
+    //enc->registerSource(rx);
+    cout << name << ": Using CODEC \"" << enc->name()
+         << "\" to encode RX audio\n";
+    for (oit=opts.begin(); oit!=opts.end(); ++oit)
     {
-      cerr << "*** ERROR: TCP transmit buffer overflow in NetUplink "
-           << name << ".\n";
-      forceDisconnect();
+      enc->setOption((*oit).first, (*oit).second);
     }
+    enc->printCodecParams();
+    rx_splitter->addSink(enc);
+    rx_encoders[key] = rx_enc;
   }
-  
-  delete msg;
-  
-} /* NetUplink::sendMsg */
+  rx_enc->clients.insert(client);
+  client->rx_enc = rx_enc;
+} /* NetUplink::selectRxCodec */
+
+
+void NetUplink::releaseRxEncoder(Client *client)
+{
+  RxEncoder *rx_enc = client->rx_enc;
+  if (rx_enc == 0)
+  {
+    return;
+  }
+  client->rx_enc = 0;
+  rx_enc->clients.erase(client);
+  if (rx_enc->clients.empty())
+  {
+    rx_encoders.erase(rx_enc->key);
+    rx_splitter->removeSink(rx_enc->enc);
+
+      // The encoder is deleted later since we may be called from within
+      // its write callback, e.g. when a write to the last client failed
+    if (released_rx_encoders.empty())
+    {
+      Application::app().runTask(
+          mem_fun(*this, &NetUplink::deleteReleasedRxEncoders));
+    }
+    released_rx_encoders.push_back(rx_enc);
+  }
+} /* NetUplink::releaseRxEncoder */
+
+
+void NetUplink::deleteReleasedRxEncoders(void)
+{
+  for (RxEncoder *rx_enc : released_rx_encoders)
+  {
+    delete rx_enc->enc;
+    delete rx_enc;
+  }
+  released_rx_encoders.clear();
+} /* NetUplink::deleteReleasedRxEncoders */
+
+
+void NetUplink::selectTxCodec(Client *client, MsgTxAudioCodecSelect *codec_msg)
+{
+  if (tx_owner == client)
+  {
+    fifo->clear();
+    setTxOwner(0);
+  }
+  delete client->audio_dec;
+  client->audio_dec = AudioDecoder::create(codec_msg->name());
+  if (client->audio_dec != 0)
+  {
+    client->audio_dec->allEncodedSamplesFlushed.connect(
+        sigc::bind<0>(mem_fun(*this, &NetUplink::allEncodedSamplesFlushed),
+                      client));
+    cout << name << ": Using CODEC \"" << client->audio_dec->name()
+         << "\" to decode TX audio\n";
+
+    MsgRxAudioCodecSelect::Opts opts;
+    codec_msg->options(opts);
+    MsgTxAudioCodecSelect::Opts::const_iterator it;
+    for (it=opts.begin(); it!=opts.end(); ++it)
+    {
+      client->audio_dec->setOption((*it).first, (*it).second);
+    }
+    client->audio_dec->printCodecParams();
+  }
+  else
+  {
+    cerr << "*** ERROR: Received request for unknown TX audio codec ("
+         << codec_msg->name() << ") in NetUplink " << name << "\n";
+  }
+} /* NetUplink::selectTxCodec */
+
+
+void NetUplink::setTxOwner(Client *client)
+{
+  if (client == tx_owner)
+  {
+    return;
+  }
+
+    // Only the decoder of the client owning the transmitter is connected to
+    // the TX audio FIFO
+  if ((tx_owner != 0) && (tx_owner->audio_dec != 0))
+  {
+    tx_owner->audio_dec->unregisterSink();
+  }
+  tx_owner = client;
+  if (tx_owner != 0)
+  {
+    tx_owner->audio_dec->registerSink(fifo);
+    if (max_clients > 1)
+    {
+      cout << name << ": Transmitter owned by " << clientName(tx_owner)
+           << endl;
+    }
+  }
+} /* NetUplink::setTxOwner */
+
+
+void NetUplink::resetRx(Client *client)
+{
+  if (client != 0)
+  {
+    client->tone_dets.clear();
+    client->rx_mute_state = Rx::MUTE_ALL;
+  }
+
+    // A receiver reset remove all tone detectors so the ones belonging to
+    // other clients have to be added again
+  rx->reset();
+  for (Clients::iterator it=clients.begin(); it!=clients.end(); ++it)
+  {
+    const vector<ToneDetParams>& tone_dets = (*it).second->tone_dets;
+    vector<ToneDetParams>::const_iterator tit;
+    for (tit=tone_dets.begin(); tit!=tone_dets.end(); ++tit)
+    {
+      rx->addToneDetector((*tit).fq, (*tit).bw, (*tit).thresh,
+                          (*tit).required_duration);
+    }
+  }
+  updateRxMuteState();
+} /* NetUplink::resetRx */
+
+
+void NetUplink::updateRxMuteState(void)
+{
+  Rx::MuteState mute_state = Rx::MUTE_ALL;
+  for (Clients::iterator it=clients.begin(); it!=clients.end(); ++it)
+  {
+    mute_state = min(mute_state, (*it).second->rx_mute_state);
+  }
+  rx->setMuteState(mute_state);
+} /* NetUplink::updateRxMuteState */
+
+
+void NetUplink::updateTxCtrlMode(void)
+{
+  tx_ctrl_mode = Tx::TX_OFF;
+  for (Clients::iterator it=clients.begin(); it!=clients.end(); ++it)
+  {
+    Tx::TxCtrlMode mode = (*it).second->tx_ctrl_mode;
+    if (mode == Tx::TX_ON)
+    {
+      tx_ctrl_mode = Tx::TX_ON;
+      break;
+    }
+    else if (mode == Tx::TX_AUTO)
+    {
+      tx_ctrl_mode = Tx::TX_AUTO;
+    }
+  }
+  if (!tx_muted)
+  {
+    tx->setTxCtrlMode(tx_ctrl_mode);
+  }
+} /* NetUplink::updateTxCtrlMode */
+
+
+void NetUplink::updateCtcss(void)
+{
+  bool enable = false;
+  for (Clients::iterator it=clients.begin(); it!=clients.end(); ++it)
+  {
+    enable = enable || (*it).second->ctcss_enabled;
+  }
+  tx->enableCtcss(enable);
+} /* NetUplink::updateCtcss */
+
+
+string NetUplink::clientName(const Client *client) const
+{
+  ostringstream ss;
+  ss << client->con->remoteHost() << ":" << client->con->remotePort();
+  return ss.str();
+} /* NetUplink::clientName */
 
 
 void NetUplink::squelchOpen(bool is_open)
@@ -741,9 +1194,9 @@ void NetUplink::squelchOpen(bool is_open)
     }
   }
 
-  MsgSquelch *msg = new MsgSquelch(is_open, rx->signalStrength(),
-                                   rx->sqlRxId(), rx->squelchActivityInfo());
-  sendMsg(msg);
+  MsgSquelch msg(is_open, rx->signalStrength(), rx->sqlRxId(),
+                 rx->squelchActivityInfo());
+  sendMsgToAll(msg);
 } /* NetUplink::squelchOpen */
 
 
@@ -752,7 +1205,7 @@ void NetUplink::dtmfDigitDetected(char digit, int duration)
   cout << name << ": DTMF digit detected: " << digit << " with duration " << duration
        << " milliseconds" << endl;
   MsgDtmf *msg = new MsgDtmf(digit, duration);
-  sendMsg(msg);
+  sendMsgToAll(msg);
 } /* NetUplink::dtmfDigitDetected */
 
 
@@ -760,7 +1213,7 @@ void NetUplink::toneDetected(float tone_fq)
 {
   cout << name << ": Tone detected: " << tone_fq << endl;
   MsgTone *msg = new MsgTone(tone_fq);
-  sendMsg(msg);
+  sendMsgToAll(msg);
 } /* NetUplink::toneDetected */
 
 
@@ -768,11 +1221,12 @@ void NetUplink::selcallSequenceDetected(std::string sequence)
 {
   // cout "Sel5 sequence detected: " << sequence << endl;
   MsgSel5 *msg = new MsgSel5(sequence);
-  sendMsg(msg);
+  sendMsgToAll(msg);
 } /* NetUplink::selcallSequenceDetected */
 
 
-void NetUplink::writeEncodedSamples(const void *buf, int size)
+void NetUplink::writeEncodedSamples(RxEncoder *rx_enc, const void *buf,
+                                    int size)
 {
   //cout << "NetUplink::writeEncodedSamples: size=" << size << endl;
   const char *ptr = reinterpret_cast<const char *>(buf);
@@ -780,8 +1234,14 @@ void NetUplink::writeEncodedSamples(const void *buf, int size)
   {
     const int bufsize = MsgAudio::BUFSIZE;
     int len = min(size, bufsize);
-    MsgAudio *msg = new MsgAudio(ptr, len);
-    sendMsg(msg);
+    MsgAudio msg(ptr, len);
+    set<Client*>::iterator it = rx_enc->clients.begin();
+    while (it != rx_enc->clients.end())
+    {
+        // Step the iterator first since the client may be removed on error
+      Client *client = *it++;
+      sendMsg(client, msg);
+    }
     size -= len;
     ptr += len;
   }
@@ -791,7 +1251,7 @@ void NetUplink::writeEncodedSamples(const void *buf, int size)
 void NetUplink::txTimeout(void)
 {
   MsgTxTimeout *msg = new MsgTxTimeout;
-  sendMsg(msg);
+  sendMsgToAll(msg);
 } /* NetUplink::txTimeout */
 
 
@@ -799,32 +1259,46 @@ void NetUplink::transmitterStateChange(bool is_transmitting)
 {
   MsgTransmitterStateChange *msg =
       new MsgTransmitterStateChange(is_transmitting);
-  sendMsg(msg);
+  sendMsgToAll(msg);
 } /* NetUplink::transmitterStateChange */
 
 
-void NetUplink::allEncodedSamplesFlushed(void)
+void NetUplink::allEncodedSamplesFlushed(Client *client)
 {
+  if (tx_owner == client)
+  {
+    setTxOwner(0);
+  }
   MsgAllSamplesFlushed *msg = new MsgAllSamplesFlushed;
-  sendMsg(msg);
+  sendMsg(client, msg);
 } /* NetUplink::allEncodedSamplesFlushed */
 
 
 void NetUplink::heartbeat(Timer *t)
 {
-  MsgHeartbeat *msg = new MsgHeartbeat;
-  sendMsg(msg);
-  
-  struct timeval diff_tv;
   struct timeval now;
-  gettimeofday(&now, NULL);
-  timersub(&now, &last_msg_timestamp, &diff_tv);
-  int diff_ms = diff_tv.tv_sec * 1000 + diff_tv.tv_usec / 1000;
-  
-  if (diff_ms > 15000)
+  Application::app().getTimeOfDay(&now);
+
+  Clients::iterator it = clients.begin();
+  while (it != clients.end())
   {
-    cerr << "*** ERROR: Heartbeat timeout in NetUplink " << name << "\n";
-    forceDisconnect();
+      // Step the iterator first since the client may be removed
+    Client *client = (*it++).second;
+    MsgHeartbeat msg;
+    sendMsg(client, msg);
+    if (client->state == STATE_DISC)
+    {
+      continue;
+    }
+
+    struct timeval diff_tv;
+    timersub(&now, &client->last_msg_timestamp, &diff_tv);
+    int diff_ms = diff_tv.tv_sec * 1000 + diff_tv.tv_usec / 1000;
+    if (diff_ms > 15000)
+    {
+      cerr << "*** ERROR: Heartbeat timeout in NetUplink " << name << "\n";
+      forceDisconnect(client);
+    }
   }
   
   t->reset();
@@ -869,16 +1343,20 @@ void NetUplink::setFallbackActive(bool activate)
 
 void NetUplink::signalLevelUpdated(float siglev)
 {
-  MsgSiglevUpdate *msg = new MsgSiglevUpdate(rx->signalStrength(),
-					     rx->sqlRxId());
-  sendMsg(msg);  
+  MsgSiglevUpdate msg(rx->signalStrength(), rx->sqlRxId());
+  sendMsgToAll(msg);
 } /* NetUplink::signalLevelUpdated */
 
 
-void NetUplink::forceDisconnect(void)
+void NetUplink::forceDisconnect(Client *client)
 {
-  con->disconnect();
-  clientDisconnected(con, TcpConnection::DR_ORDERED_DISCONNECT);
+  if (client->state == STATE_DISC)
+  {
+    return;
+  }
+  TcpConnection *the_con = client->con;
+  the_con->disconnect();
+  the_con->disconnected(the_con, TcpConnection::DR_ORDERED_DISCONNECT);
 } /* NetUplink::forceDisconnect */
 
 
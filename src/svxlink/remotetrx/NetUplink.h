@@ -37,7 +37,10 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include <sys/time.h>
 
+#include <map>
+#include <set>
 #include <string>
+#include <vector>
 
 
 /****************************************************************************
@@ -77,6 +80,8 @@ namespace Async
   class AudioSplitter;
   class AudioSelector;
   class AudioPassthrough;
+  class EncryptedUdpSocket;
+  class IpAddress;
 };
 
 namespace NetTrxMsg
@@ -84,6 +89,8 @@ namespace NetTrxMsg
   class Msg;
 };
 
+class NetTrxUdpLink;
+
 /****************************************************************************
  *
  * Namespace
@@ -130,6 +137,18 @@ namespace NetTrxMsg
 @date   2006-04-14
 
 This class implements a remote transceiver uplink via an IP network.
+
+More than one client may be connected at the same time, up to the number
+given by the MAX_CLIENTS configuration variable. The receiver is shared so
+RX audio is encoded once for each distinct codec setup and the encoded audio
+is sent to all clients that use that setup. Receiver events are sent to all
+clients. The receiver mute state is the least muted state requested by any
+client.
+
+The transmitter is arbitrated between the clients. The first client sending
+audio become the owner of the transmitter until its audio has been
+flushed. Audio from other clients is thrown away meanwhile. The transmitter
+control mode is the most active mode requested by any client.
 */
 class NetUplink : public Uplink
 {
@@ -162,45 +181,108 @@ class NetUplink : public Uplink
   private:
     typedef enum
     {
-      STATE_DISC, STATE_CON_SETUP, STATE_READY, STATE_DISC_CLEANUP
+      STATE_CON_SETUP, STATE_READY, STATE_DISC
     } State;
-    
+
+    struct RxEncoder;
+
+    struct ToneDetParams
+    {
+      float fq;
+      int   bw;
+      float thresh;
+      int   required_duration;
+    };
+
+    struct Client
+    {
+      Async::TcpConnection*       con                 = nullptr;
+      State                       state               = STATE_CON_SETUP;
+      unsigned char               auth_challenge[
+                                    NetTrxMsg::MsgAuthChallenge::CHALLENGE_LEN];
+      struct timeval              last_msg_timestamp;
+      RxEncoder*                  rx_enc              = nullptr;
+      Async::AudioDecoder*        audio_dec           = nullptr;
+      Rx::MuteState               rx_mute_state       = Rx::MUTE_ALL;
+      std::vector<ToneDetParams>  tone_dets;
+      Tx::TxCtrlMode              tx_ctrl_mode        = Tx::TX_OFF;
+      bool                        ctcss_enabled       = false;
+      bool                        tx_blocked          = false;
+      NetTrxUdpLink*              udp_link            = nullptr;
+    };
+
+    struct RxEncoder
+    {
+      std::string                 key;
+      Async::AudioEncoder*        enc                 = nullptr;
+      std::set<Client*>           clients;
+    };
+
+    typedef std::map<Async::TcpConnection*, Client*>  Clients;
+    typedef std::map<std::string, RxEncoder*>         RxEncoders;
+    typedef std::map<uint32_t, Client*>               UdpSessions;
+
     Async::TcpServer<Async::TcpConnection>*  server;
-    Async::TcpConnection    *con;
-    char      	      	    recv_buf[4096];
-    unsigned       	    recv_cnt;
-    unsigned       	    recv_exp;
+    Clients                 clients;
+    unsigned                max_clients;
+    RxEncoders              rx_encoders;
+    std::vector<RxEncoder*> released_rx_encoders;
+    Client*                 tx_owner;
+    NetTrxMsg::MsgBatch     tx_batch;
     Rx	      	      	    *rx;
     Tx	      	      	    *tx;
     Async::AudioFifo  	    *fifo;
     Async::Config     	    &cfg;
     std::string       	    name;
-    struct timeval    	    last_msg_timestamp;
     Async::Timer      	    *heartbeat_timer;
-    Async::AudioEncoder     *audio_enc;
-    Async::AudioDecoder     *audio_dec;
     Async::AudioPassthrough *loopback_con;
     Async::AudioSplitter    *rx_splitter;
     Async::AudioSelector    *tx_selector;
-    State                   state;
     std::string             auth_key;
-    unsigned char           auth_challenge[NetTrxMsg::MsgAuthChallenge::CHALLENGE_LEN];
     //Async::Timer      	    *siglev_check_timer;
     Async::Timer	    *mute_tx_timer;
     bool		    tx_muted;
     bool                    fallback_enabled;
     Tx::TxCtrlMode	    tx_ctrl_mode;
+    Async::EncryptedUdpSocket *udp_sock;
+    UdpSessions             udp_sessions;
+    unsigned                udp_jitter_buffer_delay;
+    size_t                  tcp_tx_queue_max;
     
     NetUplink(const NetUplink&);
     NetUplink& operator=(const NetUplink&);
     void handleIncomingConnection(Async::TcpConnection *incoming_con);
     void clientConnected(Async::TcpConnection *con);
-    void disconnectCleanup(void);
+    void removeClient(Client *client);
+    void disconnectCleanup(Client *client);
     void clientDisconnected(Async::TcpConnection *con,
       	      	      	    Async::TcpConnection::DisconnectReason reason);
     int tcpDataReceived(Async::TcpConnection *con, void *data, int size);
-    void handleMsg(NetTrxMsg::Msg *msg);
-    void sendMsg(NetTrxMsg::Msg *msg);
+    void handleMsg(Client *client, NetTrxMsg::Msg *msg);
+    void dispatchMsg(Client *client, NetTrxMsg::Msg *msg);
+    void sendMsg(Client *client, NetTrxMsg::Msg *msg);
+    void sendMsg(Client *client, const NetTrxMsg::Msg& msg);
+    void sendMsgToAll(NetTrxMsg::Msg *msg);
+    void sendMsgToAll(const NetTrxMsg::Msg& msg);
+    void handleUdpSetup(Client *client);
+    void deleteUdpLink(Client *client);
+    bool udpCipherDataReceived(const Async::IpAddress& addr, uint16_t port,
+                               void *buf, int count);
+    void udpDatagramReceived(const Async::IpAddress& addr, uint16_t port,
+                             void *aad, void *buf, int count);
+    Client *udpSessionClient(const void *hdr_buf, int count);
+    void selectRxCodec(Client *client,
+                       NetTrxMsg::MsgRxAudioCodecSelect *codec_msg);
+    void releaseRxEncoder(Client *client);
+    void deleteReleasedRxEncoders(void);
+    void selectTxCodec(Client *client,
+                       NetTrxMsg::MsgTxAudioCodecSelect *codec_msg);
+    void setTxOwner(Client *client);
+    void resetRx(Client *client);
+    void updateRxMuteState(void);
+    void updateTxCtrlMode(void);
+    void updateCtcss(void);
+    std::string clientName(const Client *client) const;
 
     /**
      * @brief 	Set squelch state to open/closed
@@ -227,17 +309,16 @@ class NetUplink : public Uplink
     void selcallSequenceDetected(std::string sequence);
 
 
-    void writeEncodedSamples(const void *buf, int size);
+    void writeEncodedSamples(RxEncoder *rx_enc, const void *buf, int size);
     void txTimeout(void);
     void transmitterStateChange(bool is_transmitting);
-    void allEncodedSamplesFlushed(void);
+    void allEncodedSamplesFlushed(Client *client);
     void heartbeat(Async::Timer *t);
     //void checkSiglev(Async::Timer *t);
     void unmuteTx(Async::Timer *t);
     void setFallbackActive(bool activate);
     void signalLevelUpdated(float siglev);
-    void forceDisconnect(void);
-    void setState(State new_state) { state = new_state; }
+    void forceDisconnect(Client *client);
 
 };  /* class NetUplink */
 
@@ -0,0 +1,190 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+
+#include <AsyncCppApplication.h>
+#include <AsyncConfig.h>
+#include <AsyncTimer.h>
+#include <AsyncTcpClient.h>
+
+#include <DummyRxTx.h>
+#include <NetTrxMsg.h>
+
+#include "NetUplink.h"
+
+using namespace std;
+using namespace Async;
+using namespace NetTrxMsg;
+
+
+  // A receiver that can be told to emit a block of audio
+class TestRx : public DummyRx
+{
+  public:
+    TestRx(Config &cfg, const string &name) : DummyRx(cfg, name) {}
+
+    void emit(int count)
+    {
+      vector<float> samples(count, 0.1f);
+      sinkWriteSamples(samples.data(), count);
+    }
+};
+
+
+  // A NetTrx client that select the RAW RX codec and count received bytes
+class TestClient : public sigc::trackable
+{
+  public:
+    TcpClient<> con;
+    bool        is_connected = false;
+    bool        was_disconnected = false;
+    size_t      rx_bytes = 0;
+
+    TestClient(const string& port) : con("127.0.0.1", atoi(port.c_str()))
+    {
+      con.connected.connect(sigc::mem_fun(*this, &TestClient::onConnected));
+      con.disconnected.connect(
+          sigc::mem_fun(*this, &TestClient::onDisconnected));
+      con.dataReceived.connect(
+          sigc::mem_fun(*this, &TestClient::onDataReceived));
+      con.connect();
+    }
+
+  private:
+    void onConnected(void)
+    {
+      is_connected = true;
+      MsgRxAudioCodecSelect msg("RAW");
+      con.write(&msg, msg.size());
+    }
+
+    void onDisconnected(TcpConnection *, TcpConnection::DisconnectReason)
+    {
+      was_disconnected = true;
+    }
+
+    int onDataReceived(TcpConnection *, void *, int size)
+    {
+      rx_bytes += size;
+      return size;
+    }
+};
+
+
+namespace {
+const string port = "15210";
+TestRx *rx = 0;
+TestClient *c1 = 0;
+TestClient *c2 = 0;
+TestClient *c3 = 0;
+int step = 0;
+int result = 1;
+
+
+void finish(bool pass)
+{
+  cout << (pass ? "PASS" : "FAIL") << endl;
+  result = pass ? 0 : 1;
+  Application::app().quit();
+}
+
+
+void nextStep(Timer *t)
+{
+  switch (step)
+  {
+    case 0:
+      if (!c1->is_connected || !c2->is_connected)
+      {
+        return;
+      }
+      break;
+
+    case 1:
+        // Both clients now share the same encoder. Emit more audio than the
+        // TCP buffers can hold so that the writes to both clients fail
+        // while the encoder is writing.
+      cout << "Emitting audio to two clients sharing one encoder\n";
+      rx->emit(4000000);
+      break;
+
+    case 2:
+      if (!c1->was_disconnected || !c2->was_disconnected)
+      {
+        cout << "*** ERROR: The clients were not disconnected\n";
+        finish(false);
+        return;
+      }
+      c3 = new TestClient(port);
+      break;
+
+    case 3:
+      if (!c3->is_connected)
+      {
+        return;
+      }
+      break;
+
+    case 4:
+      c3->rx_bytes = 0;
+      rx->emit(512);
+      break;
+
+    case 5:
+      if (c3->rx_bytes < MsgAudio::BUFSIZE)
+      {
+        cout << "*** ERROR: No audio received by the new client\n";
+        finish(false);
+        return;
+      }
+      finish(true);
+      return;
+  }
+  ++step;
+}
+
+
+void timeout(Timer *t)
+{
+  cout << "*** ERROR: Timeout in step " << step << endl;
+  finish(false);
+}
+
+};
+
+
+int main(int argc, char **argv)
+{
+  CppApplication app;
+
+  Config cfg;
+  cfg.setValue("NetUplinkTrx", "LISTEN_PORT", port);
+  cfg.setValue("NetUplinkTrx", "MAX_CLIENTS", "2");
+  cfg.setValue("NetUplinkTrx", "TCP_TX_QUEUE_MAX", "65536");
+
+  TestRx test_rx(cfg, "Rx1");
+  rx = &test_rx;
+  DummyTx tx("Tx1");
+  NetUplink uplink(cfg, "NetUplinkTrx", rx, &tx);
+  if (!uplink.initialize())
+  {
+    cout << "*** ERROR: Could not initialize the NetUplink\n";
+    exit(1);
+  }
+
+  c1 = new TestClient(port);
+  c2 = new TestClient(port);
+  Timer step_timer(500, Timer::TYPE_PERIODIC);
+  step_timer.expired.connect(sigc::ptr_fun(&nextStep));
+  Timer timeout_timer(20000);
+  timeout_timer.expired.connect(sigc::ptr_fun(&timeout));
+
+  app.exec();
+
+  delete c1;
+  delete c2;
+  delete c3;
+
+  return result;
+}
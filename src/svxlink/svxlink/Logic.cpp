@@ -59,6 +59,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  ****************************************************************************/
 
 #include <AsyncConfig.h>
+#include <AsyncApplication.h>
 #include <AsyncTimer.h>
 #include <Rx.h>
 #include <Tx.h>
@@ -1079,7 +1080,7 @@ void Logic::squelchOpen(bool is_open)
   if (LocationInfo::has_instance())
   {
     struct timeval tv;
-    gettimeofday(&tv, NULL);
+    Application::app().getTimeOfDay(&tv);
     LocationInfo::instance()->setReceiving(name(), tv, is_open);
   }
 
@@ -1105,7 +1106,7 @@ void Logic::transmitterStateChange(bool is_transmitting)
       (LocationInfo::instance()->getTransmitting(name()) != is_transmitting))
   {
     struct timeval tv;
-    gettimeofday(&tv, NULL);
+    Application::app().getTimeOfDay(&tv);
     LocationInfo::instance()->setTransmitting(name(), tv, is_transmitting);
   }
 
@@ -1646,7 +1647,7 @@ void Logic::sendRgrSound(void)
 void Logic::timeoutNextMinute(void)
 {
   struct timeval tv;
-  gettimeofday(&tv, NULL);
+  Application::app().getTimeOfDay(&tv);
   struct tm tm;
   localtime_r(&tv.tv_sec, &tm);
   tm.tm_min += 1;
@@ -1665,7 +1666,7 @@ void Logic::everyMinute(AtTimer *t)
 void Logic::timeoutNextSecond(void)
 {
   struct timeval tv;
-  gettimeofday(&tv, NULL);
+  Application::app().getTimeOfDay(&tv);
   struct tm tm;
   localtime_r(&tv.tv_sec, &tm);
   tm.tm_sec += 1;
@@ -1796,7 +1797,7 @@ void Logic::onPublishStateEvent(const string &event_name, const string &msg)
     return;
   }
   struct timeval tv;
-  gettimeofday(&tv, NULL);
+  Application::app().getTimeOfDay(&tv);
   stringstream os;
   os << setfill('0');
   os << tv.tv_sec << "." << setw(3) << tv.tv_usec / 1000 << " ";
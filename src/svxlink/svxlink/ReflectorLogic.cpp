@@ -316,6 +316,10 @@ bool ReflectorLogic::initialize(Async::Config& cfgobj, const std::string& logic_
     }
   }
 
+  unsigned connect_attempt_delay = 250;
+  cfg().getValue(name(), "CONNECT_ATTEMPT_DELAY", connect_attempt_delay);
+  m_con.setConnectAttemptDelay(connect_attempt_delay);
+
   if (!cfg().getValue(name(), "CERT_PKI_DIR", m_pki_dir) || m_pki_dir.empty())
   {
     m_pki_dir = std::string(SVX_LOCAL_STATE_DIR) + "/pki";
@@ -480,6 +484,10 @@ bool ReflectorLogic::initialize(Async::Config& cfgobj, const std::string& logic_
     }
   }
 
+    // Offer the previous TLS session to the reflector on reconnect so that
+    // a full handshake can be avoided
+  m_ssl_ctx.enableClientSessionCache();
+
   string event_handler_str;
   if (!cfg().getValue(name(), "EVENT_HANDLER", event_handler_str) ||
       event_handler_str.empty())
@@ -1180,6 +1188,9 @@ void ReflectorLogic::onFrameReceived(FramedTcpConnection*,
     case MsgNodeLeft::TYPE:
       handleMsgNodeLeft(ss);
       break;
+    case MsgNodeListDelta::TYPE:
+      handleMsgNodeListDelta(ss);
+      break;
     case MsgTalkerStart::TYPE:
       handleMsgTalkerStart(ss);
       break;
@@ -1241,6 +1252,19 @@ void ReflectorLogic::handleMsgProtoVerDowngrade(std::istream& is)
   }
   else
 #endif
+  if ((msg.majorVer() == proto_ver.majorVer()) &&
+      (msg.minorVer() < proto_ver.minorVer()) &&
+      (m_con_state == STATE_EXPECT_CA_INFO))
+  {
+      // Minor protocol versions are backwards compatible so we can just
+      // announce the lower version and carry on.
+    std::cout << name()
+              << ": The server is requesting protocol downgrade to v"
+              << msg.majorVer() << "." << msg.minorVer() << ". Complying."
+              << std::endl;
+    sendMsg(MsgProtoVer(msg.majorVer(), msg.minorVer()));
+  }
+  else
   {
     std::cout << name()
          << ": Server too old and we cannot downgrade to protocol version "
@@ -1861,6 +1885,30 @@ void ReflectorLogic::handleMsgNodeLeft(std::istream& is)
 } /* ReflectorLogic::handleMsgNodeLeft */
 
 
+void ReflectorLogic::handleMsgNodeListDelta(std::istream& is)
+{
+  MsgNodeListDelta msg;
+  if (!msg.unpack(is))
+  {
+    cerr << "*** ERROR[" << name()
+         << "]: Could not unpack MsgNodeListDelta\n";
+    disconnect();
+    return;
+  }
+  if (m_verbose)
+  {
+    for (const auto& callsign : msg.joined())
+    {
+      std::cout << name() << ": Node joined: " << callsign << std::endl;
+    }
+    for (const auto& callsign : msg.left())
+    {
+      std::cout << name() << ": Node left: " << callsign << std::endl;
+    }
+  }
+} /* ReflectorLogic::handleMsgNodeListDelta */
+
+
 void ReflectorLogic::handleMsgTalkerStart(std::istream& is)
 {
   MsgTalkerStart msg;
@@ -2176,7 +2224,7 @@ void ReflectorLogic::udpDatagramReceived(const IpAddress& addr, uint16_t port,
       }
       if (!msg.audioData().empty())
       {
-        gettimeofday(&m_last_talker_timestamp, NULL);
+        Application::app().getTimeOfDay(&m_last_talker_timestamp);
         m_dec->writeEncodedSamples(
             &msg.audioData().front(), msg.audioData().size());
       }
@@ -2309,7 +2357,7 @@ void ReflectorLogic::handleTimerTick(Async::Timer *t)
   if (timerisset(&m_last_talker_timestamp))
   {
     struct timeval now, diff;
-    gettimeofday(&now, NULL);
+    Application::app().getTimeOfDay(&now);
     timersub(&now, &m_last_talker_timestamp, &diff);
     if (diff.tv_sec > 3)
     {
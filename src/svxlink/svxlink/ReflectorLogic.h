@@ -299,6 +299,7 @@ class ReflectorLogic : public LogicBase
     void handleMsgNodeList(std::istream& is);
     void handleMsgNodeJoined(std::istream& is);
     void handleMsgNodeLeft(std::istream& is);
+    void handleMsgNodeListDelta(std::istream& is);
     void handleMsgTalkerStart(std::istream& is);
     void handleMsgTalkerStop(std::istream& is);
     void handleMsgRequestQsy(std::istream& is);
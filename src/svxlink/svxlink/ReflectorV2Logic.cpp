@@ -45,6 +45,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  *
  ****************************************************************************/
 
+#include <AsyncApplication.h>
 #include <AsyncUdpSocket.h>
 #include <AsyncAudioPassthrough.h>
 #include <AsyncAudioValve.h>
@@ -1400,7 +1401,7 @@ void ReflectorLogic::udpDatagramReceived(const IpAddress& addr, uint16_t port,
       }
       if (!msg.audioData().empty())
       {
-        gettimeofday(&m_last_talker_timestamp, NULL);
+        Application::app().getTimeOfDay(&m_last_talker_timestamp);
         m_dec->writeEncodedSamples(
             &msg.audioData().front(), msg.audioData().size());
       }
@@ -1510,7 +1511,7 @@ void ReflectorLogic::handleTimerTick(Async::Timer *t)
   if (timerisset(&m_last_talker_timestamp))
   {
     struct timeval now, diff;
-    gettimeofday(&now, NULL);
+    Application::app().getTimeOfDay(&now);
     timersub(&now, &m_last_talker_timestamp, &diff);
     if (diff.tv_sec > 3)
     {
@@ -52,9 +52,11 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <iomanip>
 #include <algorithm>
 #include <vector>
+#include <memory>
 #include <cstring>
 #include <set>
 #include <cerrno>
+#include <climits>
 
 
 /****************************************************************************
@@ -64,6 +66,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  ****************************************************************************/
 
 #include <AsyncCppApplication.h>
+#include <AsyncSimApplication.h>
 #include <AsyncConfig.h>
 #include <AsyncTimer.h>
 #include <AsyncFdWatch.h>
@@ -155,6 +158,7 @@ static char   	      	  *logfile_name = NULL;
 static char   	      	  *runasuser = NULL;
 static char   	      	  *config = NULL;
 static int    	      	  daemonize = 0;
+static int    	      	  simulate = -1;
 static int    	      	  logfd = -1;
 static vector<LogicBase*> logic_vec;
 static FdWatch	      	  *stdin_watch = 0;
@@ -188,14 +192,28 @@ int main(int argc, char **argv)
 {
   setlocale(LC_ALL, "");
 
-  CppApplication app;
+  parse_arguments(argc, const_cast<const char **>(argv));
+
+    // When simulating, time is advanced as fast as the CPU allow instead of
+    // following the wall clock
+  std::unique_ptr<CppApplication> app_ptr;
+  SimApplication *sim_app = 0;
+  if (simulate >= 0)
+  {
+    sim_app = new SimApplication;
+    sim_app->setRunTime(1000 * simulate);
+    app_ptr.reset(sim_app);
+  }
+  else
+  {
+    app_ptr.reset(new CppApplication);
+  }
+  CppApplication& app = *app_ptr;
   app.catchUnixSignal(SIGHUP);
   app.catchUnixSignal(SIGINT);
   app.catchUnixSignal(SIGTERM);
   app.unixSignalCaught.connect(sigc::ptr_fun(&handle_unix_signal));
 
-  parse_arguments(argc, const_cast<const char **>(argv));
-
   int pipefd[2] = {-1, -1};
   int noclose = 0;
   if (logfile_name != 0)
@@ -526,6 +544,12 @@ int main(int argc, char **argv)
 
   app.exec();
 
+  if (sim_app != 0)
+  {
+    cout << "Simulated " << (sim_app->simulatedTime() / 1000.0)
+         << " seconds\n";
+  }
+
   LinkManager::deleteInstance();
   LocationInfo::deleteInstance();
 
@@ -604,6 +628,9 @@ static void parse_arguments(int argc, const char **argv)
     */
     {"daemon", 0, POPT_ARG_NONE, &daemonize, 0,
 	    "Start SvxLink as a daemon", NULL},
+    {"simulate", 0, POPT_ARG_INT, &simulate, 0,
+	    "Run on a simulated clock for the given time (0=until stopped)",
+	    "<seconds>"},
     {"version", 0, POPT_ARG_NONE, &print_version, 0,
 	    "Print the application version string", NULL},
     {NULL, 0, 0, NULL, 0}
@@ -642,6 +669,14 @@ static void parse_arguments(int argc, const char **argv)
 
   poptFreeContext(optCon);
 
+    // The simulated run time is given to a timer in milliseconds
+  if (simulate > INT_MAX / 1000)
+  {
+    std::cerr << "*** ERROR: The --simulate time must not be larger than "
+              << (INT_MAX / 1000) << " seconds" << std::endl;
+    exit(1);
+  }
+
   if (print_version)
   {
     std::cout << SVXLINK_VERSION << std::endl;
@@ -874,7 +909,7 @@ static bool logfile_write_timestamp(void)
   if (!tstamp_format.empty())
   {
     struct timeval tv;
-    gettimeofday(&tv, NULL);
+    Application::app().getTimeOfDay(&tv);
     string fmt(tstamp_format);
     const string frac_code("%f");
     size_t pos = fmt.find(frac_code);
@@ -72,6 +72,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "Ddr.h"
 #include "WbRxRtlSdr.h"
 #include "DdrFilterCoeffs.h"
+#include "DdrDemod.h"
 
 
 /****************************************************************************
@@ -423,17 +424,15 @@ namespace {
       void iq_received(vector<WbRxRtlSdr::Sample> &out,
                        const vector<WbRxRtlSdr::Sample> &in)
       {
-        out.clear();
-        out.reserve(in.size());
+          // The gain of each sample depend on the previous one so this loop
+          // cannot be vectorized. Keep it as lean as possible.
+        out.resize(in.size());
         float P = 0.0f;
-        for (vector<WbRxRtlSdr::Sample>::const_iterator it = in.begin();
-             it != in.end();
-             ++it)
+        for (size_t idx=0; idx<in.size(); ++idx)
         {
-          const WbRxRtlSdr::Sample &samp = *it;
-          WbRxRtlSdr::Sample osamp = m_gain * samp;
+          const WbRxRtlSdr::Sample osamp = m_gain * in[idx];
           P = osamp.real() * osamp.real() + osamp.imag() * osamp.imag();
-          out.push_back(osamp);
+          out[idx] = osamp;
 
           float err = m_reference - P;
           float rate;
@@ -473,7 +472,7 @@ namespace {
     public:
       virtual ~Demodulator(void) {}
 
-      virtual void iq_received(vector<WbRxRtlSdr::Sample> samples) = 0;
+      virtual void iq_received(const vector<WbRxRtlSdr::Sample>& samples) = 0;
 
       /**
        * @brief Resume audio output to the sink
@@ -503,7 +502,7 @@ namespace {
   {
     public:
       DemodulatorFm(unsigned samp_rate, double max_dev)
-        : iold(1.0f), qold(1.0f),
+        : prev(1.0f, 1.0f), atan2_acc(DdrDemod::ATAN2_HIGH),
           audio_dec(2, coeff_dec_audio_32k_16k, coeff_dec_audio_32k_16k_cnt),
           dec(0)
       {
@@ -553,39 +552,28 @@ namespace {
         dec->setGain(adj_db);
       }
 
-      void iq_received(vector<WbRxRtlSdr::Sample> samples)
+      void setAtan2Accuracy(DdrDemod::Atan2Accuracy acc)
+      {
+        atan2_acc = acc;
+      }
+
+      void iq_received(const vector<WbRxRtlSdr::Sample>& samples)
       {
-          // From article-sdr-is-qs.pdf: Watch your Is and Qs:
-          //   FM = (Qn.In-1 - In.Qn-1)/(In.In-1 + Qn.Qn-1)
-          //
           // A more indepth report:
           //   Implementation of FM demodulator algorithms on a
           //   high performance digital signal processor
-        vector<float> audio;
-        for (size_t idx=0; idx<samples.size(); ++idx)
-        {
-          complex<float> samp = samples[idx];
-
-            // Normalize signal amplitude
-          samp = samp / abs(samp);
-
-            // Mixed demodulator (delay demodulator + phase adapter demodulator)
-          float i = samp.real();
-          float q = samp.imag();
-          double demod = atan2(q*iold - i*qold, i*iold + q*qold);
-          iold = i;
-          qold = q;
-
-          audio.push_back(demod);
-        }
+        audio.resize(samples.size());
+        DdrDemod::fm(audio.data(), samples.data(), samples.size(), prev,
+                     atan2_acc);
         vector<float> dec_audio;
         dec->decimate(dec_audio, audio);
-        sinkWriteSamples(&dec_audio[0], dec_audio.size());
+        sinkWriteSamples(dec_audio.data(), dec_audio.size());
       }
 
     private:
-      float iold;
-      float qold;
+      DdrDemod::Sample        prev;
+      DdrDemod::Atan2Accuracy atan2_acc;
+      vector<float>           audio;
       Decimator<float> audio_dec_wb;
       Decimator<float> audio_dec;
       DecimatorMS<float> *dec;
@@ -602,23 +590,19 @@ namespace {
         agc.setReference(1);
       }
 
-      void iq_received(vector<WbRxRtlSdr::Sample> samples)
+      void iq_received(const vector<WbRxRtlSdr::Sample>& samples)
       {
-        vector<WbRxRtlSdr::Sample> gain_adjusted;
         agc.iq_received(gain_adjusted, samples);
-
-        vector<float> audio;
-        for (size_t idx=0; idx<gain_adjusted.size(); ++idx)
-        {
-          complex<float> samp = gain_adjusted[idx];
-          float demod = abs(samp);
-          audio.push_back(demod);
-        }
-        sinkWriteSamples(&audio[0], audio.size());
+        audio.resize(gain_adjusted.size());
+        DdrDemod::magnitude(audio.data(), gain_adjusted.data(),
+                            gain_adjusted.size());
+        sinkWriteSamples(audio.data(), audio.size());
       }
 
     private:
-      AGC              agc;
+      AGC                         agc;
+      vector<WbRxRtlSdr::Sample>  gain_adjusted;
+      vector<float>               audio;
   };
 
 
@@ -639,7 +623,7 @@ namespace {
         use_lsb = use;
       }
 
-      void iq_received(vector<WbRxRtlSdr::Sample> samples)
+      void iq_received(const vector<WbRxRtlSdr::Sample>& samples)
       {
         vector<float> Q, Qh, audio;
         Q.reserve(samples.size());
@@ -690,29 +674,21 @@ namespace {
         trans.setOffset(lsb ? 2000 : -2000);
       }
 
-      void iq_received(vector<WbRxRtlSdr::Sample> samples)
+      void iq_received(const vector<WbRxRtlSdr::Sample>& samples)
       {
-        vector<WbRxRtlSdr::Sample> gain_adjusted;
         agc.iq_received(gain_adjusted, samples);
-
-        vector<WbRxRtlSdr::Sample> translated;
         trans.iq_received(translated, gain_adjusted);
-
-        vector<float> audio;
-        audio.reserve(gain_adjusted.size());
-        for (vector<WbRxRtlSdr::Sample>::const_iterator it = translated.begin();
-             it != translated.end();
-             ++it)
-        {
-          float demod = it->real();
-          audio.push_back(demod);
-        }
-        sinkWriteSamples(&audio[0], audio.size());
+        audio.resize(translated.size());
+        DdrDemod::realPart(audio.data(), translated.data(), translated.size());
+        sinkWriteSamples(audio.data(), audio.size());
       }
 
     private:
-      Translate         trans;
-      AGC               agc;
+      Translate                   trans;
+      AGC                         agc;
+      vector<WbRxRtlSdr::Sample>  gain_adjusted;
+      vector<WbRxRtlSdr::Sample>  translated;
+      vector<float>               audio;
   };
 #endif
 
@@ -728,28 +704,21 @@ namespace {
         agc.setReference(0.05);
       }
 
-      void iq_received(vector<WbRxRtlSdr::Sample> samples)
+      void iq_received(const vector<WbRxRtlSdr::Sample>& samples)
       {
-        vector<WbRxRtlSdr::Sample> gain_adjusted;
         agc.iq_received(gain_adjusted, samples);
-
-        vector<WbRxRtlSdr::Sample> translated;
         trans.iq_received(translated, gain_adjusted);
-        vector<float> audio;
-        audio.reserve(translated.size());
-        for (vector<WbRxRtlSdr::Sample>::const_iterator it = translated.begin();
-             it != translated.end();
-             ++it)
-        {
-          float demod = it->real();
-          audio.push_back(demod);
-        }
-        sinkWriteSamples(&audio[0], audio.size());
+        audio.resize(translated.size());
+        DdrDemod::realPart(audio.data(), translated.data(), translated.size());
+        sinkWriteSamples(audio.data(), audio.size());
       }
 
     private:
-      Translate         trans;
-      AGC               agc;
+      Translate                   trans;
+      AGC                         agc;
+      vector<WbRxRtlSdr::Sample>  gain_adjusted;
+      vector<WbRxRtlSdr::Sample>  translated;
+      vector<float>               audio;
   };
 
 
@@ -1076,11 +1045,15 @@ class Ddr::Channel : public sigc::trackable, public Async::AudioSource
       return channelizer->chSampRate();
     }
 
-    void iq_received(vector<WbRxRtlSdr::Sample> samples)
+    void setFmAtan2Accuracy(DdrDemod::Atan2Accuracy acc)
+    {
+      fm_demod.setAtan2Accuracy(acc);
+    }
+
+    void iq_received(const vector<WbRxRtlSdr::Sample>& samples)
     {
       if (enabled)
       {
-        vector<WbRxRtlSdr::Sample> translated, channelized;
         trans.iq_received(translated, samples);
         channelizer->iq_received(channelized, translated);
         demod->iq_received(channelized);
@@ -1113,6 +1086,8 @@ class Ddr::Channel : public sigc::trackable, public Async::AudioSource
     bool enabled;
     int ch_offset;
     int fq_offset;
+    vector<WbRxRtlSdr::Sample> translated;
+    vector<WbRxRtlSdr::Sample> channelized;
 }; /* Channel */
 
 
@@ -1247,6 +1222,23 @@ bool Ddr::initialize(void)
     return false;
   }
 
+  string accstr("HIGH");
+  cfg.getValue(name(), "FM_DEMOD_ACCURACY", accstr);
+  DdrDemod::Atan2Accuracy acc;
+  if (DdrDemod::atan2AccuracyFromString(accstr, acc))
+  {
+    channel->setFmAtan2Accuracy(acc);
+  }
+  else
+  {
+    cout << "*** ERROR: Unknown FM demodulator accuracy " << accstr
+         << " specified in receiver " << name()
+         << ". Legal values are: EXACT, HIGH, MEDIUM and LOW\n";
+    delete channel;
+    channel = 0;
+    return false;
+  }
+
   if (!LocalRxBase::initialize())
   {
     delete channel;
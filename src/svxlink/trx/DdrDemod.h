@@ -0,0 +1,346 @@
+/**
+@file	 DdrDemod.h
+@brief   Demodulator kernels used by the digital drop receiver
+@author  Tobias Blomberg / SM0SVX
+@date	 2026-10-18
+
+\verbatim
+SvxLink - A Multi Purpose Voice Services System for Ham Radio Use
+Copyright (C) 2003-2026 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+
+#ifndef DDR_DEMOD_INCLUDED
+#define DDR_DEMOD_INCLUDED
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <complex>
+#include <string>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Forward declarations
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Namespace
+ *
+ ****************************************************************************/
+
+//namespace MyNameSpace
+//{
+
+
+/****************************************************************************
+ *
+ * Forward declarations of classes inside of the declared namespace
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Class definitions
+ *
+ ****************************************************************************/
+
+/**
+@brief	Demodulator kernels used by the digital drop receiver
+@author Tobias Blomberg / SM0SVX
+@date   2026-10-18
+
+This class collect the per sample loops of the Ddr demodulators. The loops
+are written without branches and without dependencies between the iterations
+so that the compiler can vectorize them.
+
+The FM discriminator need the phase difference between consecutive samples.
+The exact atan2 function from the math library cannot be vectorized and is
+the dominating cost of the FM demodulator, so a number of polynomial
+approximations are also available. The maximum phase error of each one is:
+
+  ATAN2_HIGH    1.2e-5 radians
+  ATAN2_MEDIUM  6.1e-4 radians
+  ATAN2_LOW     5.0e-3 radians
+
+Use the DdrDemodBench program to see how they affect the SINAD of the
+demodulated audio.
+*/
+class DdrDemod
+{
+  public:
+    using Sample = std::complex<float>;
+
+    /**
+     * @brief The accuracy of the atan2 function used by the FM discriminator
+     */
+    typedef enum
+    {
+      ATAN2_EXACT, ATAN2_HIGH, ATAN2_MEDIUM, ATAN2_LOW
+    } Atan2Accuracy;
+
+    /**
+     * @brief   Convert a string to an atan2 accuracy
+     * @param   str The string to convert (EXACT, HIGH, MEDIUM or LOW)
+     * @param   acc Set to the accuracy on success
+     * @return  Returns \em true on success or \em false if the string is not
+     *          a valid accuracy
+     */
+    static bool atan2AccuracyFromString(const std::string& str,
+                                        Atan2Accuracy& acc)
+    {
+      if (str == "EXACT")
+      {
+        acc = ATAN2_EXACT;
+      }
+      else if (str == "HIGH")
+      {
+        acc = ATAN2_HIGH;
+      }
+      else if (str == "MEDIUM")
+      {
+        acc = ATAN2_MEDIUM;
+      }
+      else if (str == "LOW")
+      {
+        acc = ATAN2_LOW;
+      }
+      else
+      {
+        return false;
+      }
+      return true;
+    }
+
+    /**
+     * @brief   Approximate atan2 using a 9th order polynomial
+     * @param   y The imaginary part
+     * @param   x The real part
+     * @return  Returns the angle in radians
+     *
+     * Abramowitz and Stegun, Handbook of Mathematical Functions, 4.4.49.
+     */
+    static float atan2High(float y, float x)
+    {
+      return atan2Reduce(y, x, [](float a, float s)
+          {
+            return a * (0.9998660f + s * (-0.3302995f + s * (0.1801410f +
+                        s * (-0.0851330f + s * 0.0208351f))));
+          });
+    }
+
+    /**
+     * @brief   Approximate atan2 using a 5th order polynomial
+     * @param   y The imaginary part
+     * @param   x The real part
+     * @return  Returns the angle in radians
+     */
+    static float atan2Medium(float y, float x)
+    {
+      return atan2Reduce(y, x, [](float a, float s)
+          {
+            return a * (0.995354f + s * (-0.288679f + s * 0.079331f));
+          });
+    }
+
+    /**
+     * @brief   Approximate atan2 using a 3rd order polynomial
+     * @param   y The imaginary part
+     * @param   x The real part
+     * @return  Returns the angle in radians
+     */
+    static float atan2Low(float y, float x)
+    {
+      return atan2Reduce(y, x, [](float a, float s)
+          {
+            return a * (0.97239411f - 0.19194795f * s);
+          });
+    }
+
+    /**
+     * @brief   Run the FM discriminator on a block of samples
+     * @param   out   Output buffer with room for n samples
+     * @param   in    The input samples
+     * @param   n     The number of samples
+     * @param   prev  The last sample of the previous block, updated on return
+     * @param   acc   Which atan2 function to use
+     *
+     * The output is the phase difference, in radians, between each sample
+     * and the one before it. The amplitude of the input does not matter so
+     * the samples do not have to be normalized.
+     */
+    static void fm(float* out, const Sample* in, size_t n, Sample& prev,
+                   Atan2Accuracy acc)
+    {
+      switch (acc)
+      {
+        case ATAN2_EXACT:
+          fmLoop(out, in, n, prev,
+              [](float y, float x) { return std::atan2(y, x); });
+          break;
+        case ATAN2_HIGH:
+          fmLoop(out, in, n, prev,
+              [](float y, float x) { return atan2High(y, x); });
+          break;
+        case ATAN2_MEDIUM:
+          fmLoop(out, in, n, prev,
+              [](float y, float x) { return atan2Medium(y, x); });
+          break;
+        case ATAN2_LOW:
+          fmLoop(out, in, n, prev,
+              [](float y, float x) { return atan2Low(y, x); });
+          break;
+      }
+      if (n > 0)
+      {
+        prev = in[n-1];
+      }
+    }
+
+    /**
+     * @brief   Calculate the magnitude of a block of samples
+     * @param   out   Output buffer with room for n samples
+     * @param   in    The input samples
+     * @param   n     The number of samples
+     */
+    static void magnitude(float* out, const Sample* in, size_t n)
+    {
+      for (size_t i=0; i<n; ++i)
+      {
+        const float re = in[i].real();
+        const float im = in[i].imag();
+        out[i] = std::sqrt(re * re + im * im);
+      }
+    }
+
+    /**
+     * @brief   Extract the real part of a block of samples
+     * @param   out   Output buffer with room for n samples
+     * @param   in    The input samples
+     * @param   n     The number of samples
+     */
+    static void realPart(float* out, const Sample* in, size_t n)
+    {
+      for (size_t i=0; i<n; ++i)
+      {
+        out[i] = in[i].real();
+      }
+    }
+
+  private:
+    template <typename Poly>
+    static float atan2Reduce(float y, float x, Poly poly)
+    {
+        // Reduce the argument to [0, 1] and then map the result back to the
+        // right octant. FLT_MIN keep atan2(0, 0) from becoming NaN.
+        // Only constants and signs are selected by the conditions. The
+        // compiler will not speculatively execute a floating point
+        // subtraction, so "cond ? C - r : r" would prevent vectorization.
+      const float ax = std::fabs(x);
+      const float ay = std::fabs(y);
+      const bool swap = ay > ax;
+      const float mx = std::max(ax, ay);
+      const float mn = std::min(ax, ay);
+      const float a = mn / (mx + FLT_MIN);
+      float r = poly(a, a * a);
+      r = (swap ? static_cast<float>(M_PI_2) : 0.0f) + (swap ? -r : r);
+      const bool mirror = x < 0.0f;
+      r = (mirror ? static_cast<float>(M_PI) : 0.0f) + (mirror ? -r : r);
+      return std::copysign(r, y);
+    }
+
+    template <typename Atan2>
+    static void fmLoop(float* out, const Sample* in, size_t n,
+                       const Sample& prev, Atan2 atan2)
+    {
+        // From article-sdr-is-qs.pdf: Watch your Is and Qs:
+        //   FM = (Qn.In-1 - In.Qn-1)/(In.In-1 + Qn.Qn-1)
+      if (n == 0)
+      {
+        return;
+      }
+      out[0] = atan2(in[0].imag() * prev.real() - in[0].real() * prev.imag(),
+                     in[0].real() * prev.real() + in[0].imag() * prev.imag());
+      for (size_t i=1; i<n; ++i)
+      {
+        const float i0 = in[i-1].real();
+        const float q0 = in[i-1].imag();
+        const float i1 = in[i].real();
+        const float q1 = in[i].imag();
+        out[i] = atan2(q1 * i0 - i1 * q0, i1 * i0 + q1 * q0);
+      }
+    }
+
+};  /* class DdrDemod */
+
+
+//} /* namespace */
+
+#endif /* DDR_DEMOD_INCLUDED */
+
+
+
+/*
+ * This file has not been truncated
+ */
@@ -0,0 +1,257 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "DdrDemod.h"
+
+using namespace std;
+
+
+typedef DdrDemod::Sample Sample;
+
+
+  // The channel sampling rate used by the FM demodulator
+static const unsigned SAMP_RATE = 32000;
+
+  // The number of samples in each block, about the same as the Ddr get
+static const size_t BLOCK_SIZE = 1024;
+
+
+  // The FM demodulator that Ddr used to have
+static void legacyFm(vector<float>& audio, const vector<Sample>& samples,
+                     float& iold, float& qold)
+{
+  audio.clear();
+  for (size_t idx=0; idx<samples.size(); ++idx)
+  {
+    complex<float> samp = samples[idx];
+    samp = samp / abs(samp);
+    float i = samp.real();
+    float q = samp.imag();
+    double demod = atan2(q*iold - i*qold, i*iold + q*qold);
+    iold = i;
+    qold = q;
+    audio.push_back(demod);
+  }
+}
+
+
+  // The AM demodulator that Ddr used to have
+static void legacyAm(vector<float>& audio, const vector<Sample>& samples)
+{
+  audio.clear();
+  for (size_t idx=0; idx<samples.size(); ++idx)
+  {
+    audio.push_back(abs(samples[idx]));
+  }
+}
+
+
+  // Generate a 1kHz tone frequency modulated with the given deviation.
+  // Noise is added to get the given carrier to noise ratio unless it is
+  // negative.
+static vector<Sample> fmSignal(size_t cnt, double dev, double cnr_db)
+{
+  mt19937 gen(4711);
+  normal_distribution<double> dist(0.0, sqrt(0.5 * pow(10.0, -cnr_db / 10.0)));
+  vector<Sample> samples(cnt);
+  double phase = 0.0;
+  for (size_t i=0; i<cnt; ++i)
+  {
+    phase += 2.0 * M_PI * dev * sin(2.0 * M_PI * 1000.0 * i / SAMP_RATE) /
+             SAMP_RATE;
+    complex<double> samp = polar(1.0, phase);
+    if (cnr_db >= 0.0)
+    {
+      samp += complex<double>(dist(gen), dist(gen));
+    }
+    samples[i] = Sample(samp.real(), samp.imag());
+  }
+  return samples;
+}
+
+
+  // Calculate the SINAD by fitting a 1kHz tone plus DC to the audio and
+  // regarding everything else as noise and distortion
+static double sinad(const vector<float>& audio)
+{
+  double cc = 0.0, ss = 0.0, cs = 0.0, xc = 0.0, xs = 0.0, mean = 0.0;
+  for (size_t i=0; i<audio.size(); ++i)
+  {
+    mean += audio[i];
+  }
+  mean /= audio.size();
+  for (size_t i=0; i<audio.size(); ++i)
+  {
+    double c = cos(2.0 * M_PI * 1000.0 * i / SAMP_RATE);
+    double s = sin(2.0 * M_PI * 1000.0 * i / SAMP_RATE);
+    double x = audio[i] - mean;
+    cc += c * c;
+    ss += s * s;
+    cs += c * s;
+    xc += x * c;
+    xs += x * s;
+  }
+  double det = cc * ss - cs * cs;
+  double a = (xc * ss - xs * cs) / det;
+  double b = (xs * cc - xc * cs) / det;
+  double total = 0.0;
+  double residual = 0.0;
+  for (size_t i=0; i<audio.size(); ++i)
+  {
+    double c = cos(2.0 * M_PI * 1000.0 * i / SAMP_RATE);
+    double s = sin(2.0 * M_PI * 1000.0 * i / SAMP_RATE);
+    double x = audio[i] - mean;
+    double e = x - a * c - b * s;
+    total += x * x;
+    residual += e * e;
+  }
+  return 10.0 * log10(total / residual);
+}
+
+
+  // Keep the compiler from optimizing the demodulators away
+static volatile float sink;
+
+
+  // Run a demodulator block by block and return the time per sample in ns
+template <class Func>
+static double run(const vector<Sample>& samples, Func func)
+{
+  vector<Sample> block(BLOCK_SIZE);
+  vector<float> audio(BLOCK_SIZE);
+  auto start = chrono::steady_clock::now();
+  for (size_t pos=0; pos+BLOCK_SIZE<=samples.size(); pos+=BLOCK_SIZE)
+  {
+    block.assign(samples.begin() + pos, samples.begin() + pos + BLOCK_SIZE);
+    func(audio, block);
+    sink = audio[BLOCK_SIZE / 2];
+  }
+  chrono::duration<double, nano> dur = chrono::steady_clock::now() - start;
+  return dur.count() / samples.size();
+}
+
+
+int main(int argc, char **argv)
+{
+  size_t samp_cnt = 10000000;
+  if (argc > 1)
+  {
+    samp_cnt = atol(argv[1]);
+  }
+
+  struct { const char* name; DdrDemod::Atan2Accuracy acc; } accs[] = {
+    { "EXACT",  DdrDemod::ATAN2_EXACT },
+    { "HIGH",   DdrDemod::ATAN2_HIGH },
+    { "MEDIUM", DdrDemod::ATAN2_MEDIUM },
+    { "LOW",    DdrDemod::ATAN2_LOW }
+  };
+
+    // First check the maximum error of the atan2 approximations
+  cout << setw(10) << "Accuracy" << setw(16) << "Max error rad" << endl;
+  for (const auto& a : accs)
+  {
+    double max_err = 0.0;
+    const unsigned steps = 100000;
+    for (unsigned i=0; i<steps; ++i)
+    {
+      double angle = -M_PI + 2.0 * M_PI * i / steps;
+      Sample s = polar(1.0f, static_cast<float>(angle));
+      Sample prev(1.0f, 0.0f);
+      float out = 0.0f;
+      DdrDemod::fm(&out, &s, 1, prev, a.acc);
+      double err = fabs(out - atan2(s.imag(), s.real()));
+      max_err = max(max_err, min(err, 2.0 * M_PI - err));
+    }
+    cout << setw(10) << a.name << setw(16) << scientific << setprecision(2)
+         << max_err << endl;
+  }
+  cout << endl;
+
+    // Then check how the approximations affect the demodulated audio
+  const double cnrs[] = { -1.0, 30.0, 20.0, 10.0 };
+  cout << setw(10) << "CNR dB";
+  for (const auto& a : accs)
+  {
+    cout << setw(10) << a.name;
+  }
+  cout << "  (SINAD dB, 3kHz deviation)" << endl;
+  for (double cnr : cnrs)
+  {
+    vector<Sample> samples = fmSignal(SAMP_RATE, 3000.0, cnr);
+    if (cnr < 0.0)
+    {
+      cout << setw(10) << "clean";
+    }
+    else
+    {
+      cout << setw(10) << fixed << setprecision(0) << cnr;
+    }
+    for (const auto& a : accs)
+    {
+      vector<float> audio(samples.size());
+      Sample prev = samples[0];
+      DdrDemod::fm(audio.data(), samples.data(), samples.size(), prev, a.acc);
+      cout << setw(10) << fixed << setprecision(1) << sinad(audio);
+    }
+    cout << endl;
+  }
+  cout << endl;
+
+    // Last, measure the throughput of the demodulators
+  vector<Sample> samples = fmSignal(samp_cnt, 3000.0, 20.0);
+  cout << "Samples per run: " << samp_cnt << endl;
+  cout << setw(16) << "Demodulator" << setw(10) << "ns/samp"
+       << setw(10) << "Speedup" << endl;
+  float iold = 1.0f;
+  float qold = 1.0f;
+  double legacy_fm = run(samples,
+      [&](vector<float>& audio, const vector<Sample>& block)
+      {
+        legacyFm(audio, block, iold, qold);
+      });
+  cout << setw(16) << "FM legacy" << setw(10) << fixed << setprecision(2)
+       << legacy_fm << endl;
+  for (const auto& a : accs)
+  {
+    Sample prev(1.0f, 1.0f);
+    double t = run(samples,
+        [&](vector<float>& audio, const vector<Sample>& block)
+        {
+          audio.resize(block.size());
+          DdrDemod::fm(audio.data(), block.data(), block.size(), prev, a.acc);
+        });
+    cout << setw(16) << (string("FM ") + a.name) << setw(10) << t
+         << setw(9) << setprecision(1) << (legacy_fm / t) << "x"
+         << setprecision(2) << endl;
+  }
+
+  double legacy_am = run(samples,
+      [&](vector<float>& audio, const vector<Sample>& block)
+      {
+        legacyAm(audio, block);
+      });
+  double am = run(samples,
+      [&](vector<float>& audio, const vector<Sample>& block)
+      {
+        audio.resize(block.size());
+        DdrDemod::magnitude(audio.data(), block.data(), block.size());
+      });
+  double real = run(samples,
+      [&](vector<float>& audio, const vector<Sample>& block)
+      {
+        audio.resize(block.size());
+        DdrDemod::realPart(audio.data(), block.data(), block.size());
+      });
+  cout << setw(16) << "AM legacy" << setw(10) << legacy_am << endl;
+  cout << setw(16) << "AM" << setw(10) << am << setw(9) << setprecision(1)
+       << (legacy_am / am) << "x" << setprecision(2) << endl;
+  cout << setw(16) << "SSB/CW" << setw(10) << real << endl;
+
+  return 0;
+}
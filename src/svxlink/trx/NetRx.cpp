@@ -33,6 +33,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  ****************************************************************************/
 
 #include <iostream>
+#include <chrono>
 #include <cassert>
 #include <cstring>
 #include <cstdlib>
@@ -45,6 +46,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  *
  ****************************************************************************/
 
+#include <AsyncApplication.h>
 #include <AsyncConfig.h>
 #include <AsyncAudioDecoder.h>
 
@@ -58,6 +60,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "NetRx.h"
 #include "NetTrxMsg.h"
 #include "NetTrxTcpClient.h"
+#include "NetTrxJitterBuffer.h"
 
 
 /****************************************************************************
@@ -136,7 +139,8 @@ NetRx::NetRx(Config &cfg, const string& name)
     log_disconnects_once(false), log_disconnect(true),
     last_signal_strength(0.0), last_sql_rx_id(Rx::ID_UNKNOWN),
     unflushed_samples(false), sql_is_open(false), audio_dec(0), fq(0),
-    modulation(Modulation::MOD_UNKNOWN)
+    modulation(Modulation::MOD_UNKNOWN), decode_deferred(false),
+    deferred_buffer_ms(0)
 {
 } /* NetRx::NetRx */
 
@@ -222,6 +226,14 @@ bool NetRx::initialize(void)
     return false;
   }
   tcp_con->setAuthKey(auth_key);
+  bool udp_audio = false;
+  cfg.getValue(name(), "UDP_AUDIO", udp_audio);
+  if (udp_audio)
+  {
+    unsigned udp_jitter_buffer_delay = NetTrxJitterBuffer::DEFAULT_DELAY;
+    cfg.getValue(name(), "UDP_JITTER_BUFFER_DELAY", udp_jitter_buffer_delay);
+    tcp_con->enableUdpAudio(udp_jitter_buffer_delay);
+  }
   tcp_con->isReady.connect(mem_fun(*this, &NetRx::connectionReady));
   tcp_con->msgReceived.connect(mem_fun(*this, &NetRx::handleMsg));
   tcp_con->connect();
@@ -247,6 +259,7 @@ void NetRx::setMuteState(Rx::MuteState new_mute_state)
       switch (mute_state)
       {
         case MUTE_CONTENT:  // MUTE_NONE -> MUTE_CONTENT
+          deferred_frames.clear();
           if (unflushed_samples)
           {
             audio_dec->flushEncodedSamples();
@@ -309,6 +322,7 @@ void NetRx::reset(void)
   last_signal_strength = 0;
   last_sql_rx_id = Rx::ID_UNKNOWN;
   sql_is_open = false;
+  deferred_frames.clear();
   
   if (unflushed_samples)
   {
@@ -342,6 +356,37 @@ void NetRx::setModulation(Modulation::Type mod)
 } /* NetRx::setModulation */
 
 
+bool NetRx::setDecodeDeferred(bool defer, unsigned buffer_ms)
+{
+  if (defer)
+  {
+    deferred_buffer_ms = buffer_ms;
+  }
+  if (defer == decode_deferred)
+  {
+    return true;
+  }
+  decode_deferred = defer;
+
+  if (!decode_deferred && !deferred_frames.empty())
+  {
+      // Back-fill the audio sink with the kept frames before any new audio
+      // arrive. The frames are only kept while the squelch is open and the
+      // receiver is not muted so they are valid to decode right away.
+    unflushed_samples = true;
+    DeferredFrames::iterator it;
+    for (it=deferred_frames.begin(); it!=deferred_frames.end(); ++it)
+    {
+      audio_dec->writeEncodedSamples(&(*it).data[0], (*it).data.size());
+    }
+    deferred_frames.clear();
+  }
+
+  return true;
+
+} /* NetRx::setDecodeDeferred */
+
+
 
 /****************************************************************************
  *
@@ -424,6 +469,7 @@ void NetRx::connectionReady(bool is_ready)
     log_disconnect = !log_disconnects_once;
     
     sql_is_open = false;
+    deferred_frames.clear();
     if (unflushed_samples)
     {
       last_sql_activity_info = "DISCONNECTED";
@@ -456,6 +502,7 @@ void NetRx::handleMsg(Msg *msg)
         }
         else
         {
+          deferred_frames.clear();
           if (unflushed_samples)
           {
             audio_dec->flushEncodedSamples();
@@ -507,8 +554,15 @@ void NetRx::handleMsg(Msg *msg)
       if ((muteState() == Rx::MUTE_NONE) && sql_is_open)
       {
 	MsgAudio *audio_msg = reinterpret_cast<MsgAudio*>(msg);
-	unflushed_samples = true;
-        audio_dec->writeEncodedSamples(audio_msg->buf(), audio_msg->size());
+        if (decode_deferred)
+        {
+          deferAudio(audio_msg->buf(), audio_msg->size());
+        }
+        else
+        {
+          unflushed_samples = true;
+          audio_dec->writeEncodedSamples(audio_msg->buf(), audio_msg->size());
+        }
       }
       break;
     }
@@ -571,6 +625,33 @@ void NetRx::publishSquelchState(void)
 } /* NetRx::publishSquelchState */
 
 
+void NetRx::deferAudio(const void *buf, int size)
+{
+  if ((deferred_buffer_ms == 0) || (size <= 0))
+  {
+    return;
+  }
+
+  const int64_t now = chrono::duration_cast<chrono::milliseconds>(
+      Application::SteadyClock::now().time_since_epoch()).count();
+
+    // Drop frames that have fallen out of the buffer window, reusing the
+    // storage of the last one dropped for the new frame
+  DeferredFrame frame;
+  while (!deferred_frames.empty() &&
+         (now - deferred_frames.front().timestamp >=
+          static_cast<int64_t>(deferred_buffer_ms)))
+  {
+    frame.data.swap(deferred_frames.front().data);
+    deferred_frames.pop_front();
+  }
+  frame.timestamp = now;
+  const uint8_t *ptr = static_cast<const uint8_t*>(buf);
+  frame.data.assign(ptr, ptr + size);
+  deferred_frames.push_back(std::move(frame));
+} /* NetRx::deferAudio */
+
+
 
 /*
  * This file has not been truncated
@@ -36,8 +36,11 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  ****************************************************************************/
 
 #include <sigc++/sigc++.h>
+#include <stdint.h>
 
+#include <deque>
 #include <string>
+#include <vector>
 
 
 /****************************************************************************
@@ -190,6 +193,14 @@ class NetRx : public Rx
      */
     virtual void setModulation(Modulation::Type mod);
 
+    /**
+     * @brief   Defer decoding of received audio
+     * @param   defer     Set to \em true to defer decoding
+     * @param   buffer_ms The amount of encoded audio to keep while deferred
+     * @return  Returns \em true since deferred decoding is supported
+     */
+    bool setDecodeDeferred(bool defer, unsigned buffer_ms=0) override;
+
     /**
      * @brief Resume audio output to the sink
      *
@@ -202,6 +213,13 @@ class NetRx : public Rx
   protected:
 
   private:
+    struct DeferredFrame
+    {
+      int64_t               timestamp;
+      std::vector<uint8_t>  data;
+    };
+    typedef std::deque<DeferredFrame> DeferredFrames;
+
     Async::Config     	&cfg;
     NetTrxTcpClient  	*tcp_con;
     bool                log_disconnects_once;
@@ -215,12 +233,16 @@ class NetRx : public Rx
     unsigned            fq;
     Modulation::Type    modulation;
     std::string         last_sql_activity_info;
+    bool                decode_deferred;
+    unsigned            deferred_buffer_ms;
+    DeferredFrames      deferred_frames;
 
     void connectionReady(bool is_ready);
     void handleMsg(NetTrxMsg::Msg *msg);
     void sendMsg(NetTrxMsg::Msg *msg);
     void allEncodedSamplesFlushed(void);
     void publishSquelchState(void);
+    void deferAudio(const void *buf, int size);
 
 };  /* class NetRx */
 
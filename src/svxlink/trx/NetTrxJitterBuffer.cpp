@@ -0,0 +1,325 @@
+/**
+@file	 NetTrxJitterBuffer.cpp
+@brief   A jitter buffer for messages received on the UDP audio plane
+@author  Tobias Blomberg / SM0SVX
+@date	 2026-10-18
+
+\verbatim
+SvxLink - A Multi Purpose Voice Services System for Ham Radio Use
+Copyright (C) 2003-2026 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <chrono>
+#include <cstdlib>
+#include <algorithm>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+#include <AsyncApplication.h>
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "NetTrxJitterBuffer.h"
+
+
+
+/****************************************************************************
+ *
+ * Namespaces to use
+ *
+ ****************************************************************************/
+
+using namespace std;
+using namespace Async;
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local class definitions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Prototypes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ *
+ * Local Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Public member functions
+ *
+ ****************************************************************************/
+
+NetTrxJitterBuffer::NetTrxJitterBuffer(unsigned delay)
+  : m_delay(delay), m_timer(0, Timer::TYPE_ONESHOT, false)
+{
+  m_timer.expired.connect(mem_fun(*this, &NetTrxJitterBuffer::release));
+} /* NetTrxJitterBuffer::NetTrxJitterBuffer */
+
+
+NetTrxJitterBuffer::~NetTrxJitterBuffer(void)
+{
+} /* NetTrxJitterBuffer::~NetTrxJitterBuffer */
+
+
+void NetTrxJitterBuffer::reset(void)
+{
+  m_timer.setEnable(false);
+  m_packets.clear();
+  m_have_seq = false;
+  m_have_ts = false;
+} /* NetTrxJitterBuffer::reset */
+
+
+void NetTrxJitterBuffer::write(uint32_t seq, uint32_t ts,
+                               const void *buf, int len)
+{
+  const int64_t t = now();
+  m_stats.received += 1;
+
+    // Unwrap the 32 bit sender timestamp and calculate the transit time.
+    // The absolute value is meaningless since the clocks are not
+    // synchronized but differences between packets are not.
+  int64_t ts_ext = ts;
+  if (m_have_ts)
+  {
+    ts_ext = m_last_ts_ext + static_cast<int32_t>(ts - m_last_ts);
+  }
+  const int64_t transit = t - ts_ext;
+  if (!m_have_ts || (t - m_last_arrival > STREAM_IDLE_TIME))
+  {
+    m_min_transit = transit;
+  }
+  else
+  {
+    const int64_t d = transit - m_last_transit;
+    m_stats.jitter += (llabs(d) - m_stats.jitter) / 16.0f;
+    m_min_transit = min(m_min_transit, transit);
+  }
+  m_have_ts = true;
+  m_last_ts = ts;
+  m_last_ts_ext = ts_ext;
+  m_last_transit = transit;
+  m_last_arrival = t;
+
+  if (!m_have_seq)
+  {
+    resync(seq);
+  }
+  const int64_t ext = extSeq(seq);
+  if (ext < m_next_ext)
+  {
+    m_stats.late += 1;
+    return;
+  }
+  if (m_packets.find(ext) != m_packets.end())
+  {
+    m_stats.duplicates += 1;
+    return;
+  }
+  if (!m_packets.empty() && (ext < m_packets.rbegin()->first))
+  {
+    m_stats.reordered += 1;
+  }
+
+  Packet& packet = m_packets[ext];
+  packet.playout = ts_ext + m_min_transit + m_delay;
+  const uint8_t *ptr = static_cast<const uint8_t*>(buf);
+  packet.data.assign(ptr, ptr + len);
+  m_stats.max_depth = max(m_stats.max_depth, m_packets.size());
+
+  release();
+} /* NetTrxJitterBuffer::write */
+
+
+bool NetTrxJitterBuffer::isPassed(uint32_t seq) const
+{
+  return m_have_seq && (extSeq(seq) < m_next_ext);
+} /* NetTrxJitterBuffer::isPassed */
+
+
+void NetTrxJitterBuffer::skipTo(uint32_t seq)
+{
+  if (!m_have_seq)
+  {
+    resync(seq + 1);
+    advanced();
+    return;
+  }
+
+  const int64_t ext = extSeq(seq);
+  bool did_advance = false;
+  while (!m_packets.empty() && (m_packets.begin()->first <= ext))
+  {
+    releaseFront();
+    did_advance = true;
+  }
+  if (ext >= m_next_ext)
+  {
+    m_stats.lost += ext + 1 - m_next_ext;
+    m_next_ext = ext + 1;
+    did_advance = true;
+  }
+  scheduleRelease(now());
+  if (did_advance)
+  {
+    advanced();
+  }
+} /* NetTrxJitterBuffer::skipTo */
+
+
+
+/****************************************************************************
+ *
+ * Protected member functions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Private member functions
+ *
+ ****************************************************************************/
+
+int64_t NetTrxJitterBuffer::now(void)
+{
+  return chrono::duration_cast<chrono::milliseconds>(
+      Application::SteadyClock::now().time_since_epoch()).count();
+} /* NetTrxJitterBuffer::now */
+
+
+int64_t NetTrxJitterBuffer::extSeq(uint32_t seq) const
+{
+  const uint32_t next_seq = m_base_seq + static_cast<uint32_t>(m_next_ext);
+  return m_next_ext + static_cast<int32_t>(seq - next_seq);
+} /* NetTrxJitterBuffer::extSeq */
+
+
+void NetTrxJitterBuffer::resync(uint32_t seq)
+{
+  m_packets.clear();
+  m_have_seq = true;
+  m_base_seq = seq;
+  m_next_ext = 0;
+} /* NetTrxJitterBuffer::resync */
+
+
+void NetTrxJitterBuffer::release(Timer *t)
+{
+  m_timer.setEnable(false);
+
+  const int64_t t_now = now();
+  bool did_advance = false;
+  while (!m_packets.empty() && (m_packets.begin()->second.playout <= t_now))
+  {
+    releaseFront();
+    did_advance = true;
+  }
+  scheduleRelease(t_now);
+  if (did_advance)
+  {
+    advanced();
+  }
+} /* NetTrxJitterBuffer::release */
+
+
+void NetTrxJitterBuffer::releaseFront(void)
+{
+  Packets::iterator it = m_packets.begin();
+  if (it->first > m_next_ext)
+  {
+    m_stats.lost += it->first - m_next_ext;
+  }
+  m_next_ext = it->first + 1;
+  vector<uint8_t> data;
+  data.swap(it->second.data);
+  m_packets.erase(it);
+  m_stats.released += 1;
+  packetReleased(data.data(), data.size());
+} /* NetTrxJitterBuffer::releaseFront */
+
+
+void NetTrxJitterBuffer::scheduleRelease(int64_t t_now)
+{
+  if (m_packets.empty())
+  {
+    m_timer.setEnable(false);
+    return;
+  }
+  const int64_t timeout = max(int64_t(0),
+                              m_packets.begin()->second.playout - t_now);
+  m_timer.setTimeout(static_cast<int>(timeout));
+  m_timer.setEnable(true);
+} /* NetTrxJitterBuffer::scheduleRelease */
+
+
+
+/*
+ * This file has not been truncated
+ */
@@ -0,0 +1,274 @@
+/**
+@file	 NetTrxJitterBuffer.h
+@brief   A jitter buffer for messages received on the UDP audio plane
+@author  Tobias Blomberg / SM0SVX
+@date	 2026-10-18
+
+\verbatim
+SvxLink - A Multi Purpose Voice Services System for Ham Radio Use
+Copyright (C) 2003-2026 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+
+#ifndef NET_TRX_JITTER_BUFFER_INCLUDED
+#define NET_TRX_JITTER_BUFFER_INCLUDED
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <sigc++/sigc++.h>
+#include <stdint.h>
+
+#include <map>
+#include <vector>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+#include <AsyncTimer.h>
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Forward declarations
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Namespace
+ *
+ ****************************************************************************/
+
+//namespace MyNameSpace
+//{
+
+
+/****************************************************************************
+ *
+ * Forward declarations of classes inside of the declared namespace
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Class definitions
+ *
+ ****************************************************************************/
+
+/**
+@brief	A jitter buffer for messages received on the UDP audio plane
+@author Tobias Blomberg / SM0SVX
+@date   2026-10-18
+
+Packets are written to the buffer tagged with the sequence number and the
+timestamp set by the sender. They are released in sequence number order when
+their playout time has been reached. The playout time of a packet is its
+sender timestamp, translated to the local clock using the smallest transit
+time seen in the current stream, plus the configured delay. A packet that is
+missing when the playout time for the packet following it has been reached is
+considered lost. Packets arriving after that are dropped as late.
+
+A new stream, with a new transit time reference, is started when no packets
+have been received for a while so that clock drift between the two hosts do
+not accumulate.
+*/
+class NetTrxJitterBuffer : public sigc::trackable
+{
+  public:
+    /**
+     * @brief Statistics for the buffer
+     */
+    struct Stats
+    {
+      uint64_t  received    = 0;  ///< Number of packets written
+      uint64_t  released    = 0;  ///< Number of packets released
+      uint64_t  lost        = 0;  ///< Packets that never showed up in time
+      uint64_t  late        = 0;  ///< Packets dropped due to late arrival
+      uint64_t  duplicates  = 0;  ///< Packets received more than once
+      uint64_t  reordered   = 0;  ///< Packets received out of order
+      float     jitter      = 0;  ///< Interarrival jitter in ms (RFC 3550)
+      size_t    max_depth   = 0;  ///< Max number of packets buffered
+    };
+
+    static const unsigned DEFAULT_DELAY = 60;
+
+    /**
+     * @brief 	Constuctor
+     * @param   delay The playout delay in milliseconds
+     */
+    explicit NetTrxJitterBuffer(unsigned delay=DEFAULT_DELAY);
+
+    /**
+     * @brief 	Destructor
+     */
+    ~NetTrxJitterBuffer(void);
+
+    /**
+     * @brief   Set the playout delay
+     * @param   delay The playout delay in milliseconds
+     */
+    void setDelay(unsigned delay) { m_delay = delay; }
+
+    /**
+     * @brief   Get the playout delay
+     * @return  Returns the playout delay in milliseconds
+     */
+    unsigned delay(void) const { return m_delay; }
+
+    /**
+     * @brief   Throw away all buffered packets and forget sequence state
+     */
+    void reset(void);
+
+    /**
+     * @brief   Write a packet to the buffer
+     * @param   seq The sequence number of the packet
+     * @param   ts  The sender timestamp in milliseconds
+     * @param   buf The packet payload
+     * @param   len The length of the payload
+     */
+    void write(uint32_t seq, uint32_t ts, const void *buf, int len);
+
+    /**
+     * @brief   Check if a sequence number has been passed
+     * @param   seq The sequence number to check
+     * @return  Returns \em true if the packet with the given sequence number,
+     *          and all packets before it, have been released or given up on
+     */
+    bool isPassed(uint32_t seq) const;
+
+    /**
+     * @brief   Release all packets up to and including the given sequence
+     *          number immediately
+     * @param   seq The sequence number to skip to
+     *
+     * Packets not received yet are counted as lost.
+     */
+    void skipTo(uint32_t seq);
+
+    /**
+     * @brief   Get the number of packets currently buffered
+     * @return  Returns the number of buffered packets
+     */
+    size_t depth(void) const { return m_packets.size(); }
+
+    /**
+     * @brief   Get statistics for the buffer
+     * @return  Returns the statistics
+     */
+    const Stats& stats(void) const { return m_stats; }
+
+    /**
+     * @brief   A signal that is emitted when a packet is released
+     * @param   buf The packet payload
+     * @param   len The length of the payload
+     */
+    sigc::signal<void, const void*, int> packetReleased;
+
+    /**
+     * @brief   A signal that is emitted after the buffer has advanced
+     *
+     * Emitted once after one or more packets have been released or given up
+     * on so that the owner can check on sequence numbers it wait for.
+     */
+    sigc::signal<void> advanced;
+
+  protected:
+
+  private:
+    struct Packet
+    {
+      int64_t               playout;
+      std::vector<uint8_t>  data;
+    };
+    typedef std::map<int64_t, Packet> Packets;
+
+    static const int64_t  STREAM_IDLE_TIME  = 1000;
+
+    unsigned      m_delay;
+    Packets       m_packets;
+    bool          m_have_seq      = false;
+    uint32_t      m_base_seq      = 0;
+    int64_t       m_next_ext      = 0;
+    bool          m_have_ts       = false;
+    uint32_t      m_last_ts       = 0;
+    int64_t       m_last_ts_ext   = 0;
+    int64_t       m_min_transit   = 0;
+    int64_t       m_last_transit  = 0;
+    int64_t       m_last_arrival  = 0;
+    Stats         m_stats;
+    Async::Timer  m_timer;
+
+    NetTrxJitterBuffer(const NetTrxJitterBuffer&);
+    NetTrxJitterBuffer& operator=(const NetTrxJitterBuffer&);
+    static int64_t now(void);
+    int64_t extSeq(uint32_t seq) const;
+    void resync(uint32_t seq);
+    void release(Async::Timer *t=0);
+    void releaseFront(void);
+    void scheduleRelease(int64_t now);
+
+};  /* class NetTrxJitterBuffer */
+
+
+//} /* namespace */
+
+#endif /* NET_TRX_JITTER_BUFFER_INCLUDED */
+
+
+
+/*
+ * This file has not been truncated
+ */
@@ -123,6 +123,11 @@ namespace NetTrxMsg
 class Msg
 {
   public:
+    /**
+     * @brief   The maximum size of a message, including the header
+     */
+    static const unsigned MAX_SIZE = 4096;
+
     /**
      * @brief 	Constuctor
      * @param 	type The message type
@@ -273,10 +278,116 @@ class MsgAuthOk : public Msg
   public:
     static const unsigned TYPE = 12;
     MsgAuthOk(void) : Msg(TYPE, sizeof(MsgAuthOk)) {}
-    
+
 };  /* MsgAuthOk */
 
 
+/**
+ * @brief Request that audio should be sent over UDP (client -> uplink)
+ *
+ * Sent by the client after authentication if it want to use the UDP audio
+ * plane. The uplink answers with a MsgUdpSetupAck. The protocol version is
+ * not changed by the UDP audio plane so that old and new versions can still
+ * talk to each other. An uplink that do not know about UDP audio ignore this
+ * message so the client just continue to use TCP. The message is only sent
+ * on authenticated connections since the cipher key is derived from the
+ * authentication key.
+ */
+class MsgUdpSetup : public Msg
+{
+  public:
+    static const unsigned TYPE = 13;
+    MsgUdpSetup(void) : Msg(TYPE, sizeof(MsgUdpSetup)) {}
+
+};  /* MsgUdpSetup */
+
+
+/**
+ * @brief Parameters for the UDP audio plane (uplink -> client)
+ *
+ * A UDP port of zero means that the uplink do not accept UDP audio so the
+ * client should continue to send everything over TCP. The cipher key is
+ * never transmitted. Both sides derive it from the authentication key and
+ * the authentication challenge so UDP audio is refused on connections that
+ * are not authenticated.
+ */
+class MsgUdpSetupAck : public Msg
+{
+  public:
+    static const unsigned TYPE        = 14;
+    static const int      KEY_LEN     = 16;
+    static const int      IV_RAND_LEN = 4;
+    MsgUdpSetupAck(uint16_t udp_port=0, uint32_t session_id=0)
+      : Msg(TYPE, sizeof(MsgUdpSetupAck)), m_udp_port(udp_port),
+        m_session_id(session_id)
+    {
+      memset(m_iv_rand, 0, sizeof(m_iv_rand));
+    }
+    uint16_t udpPort(void) const { return m_udp_port; }
+    uint32_t sessionId(void) const { return m_session_id; }
+    const uint8_t *ivRand(void) const { return m_iv_rand; }
+    uint8_t *ivRand(void) { return m_iv_rand; }
+
+    /**
+     * @brief   Derive the UDP cipher key from the authentication parameters
+     * @param   key       The buffer to store the KEY_LEN byte key in
+     * @param   auth_key  The authentication key
+     * @param   challenge The challenge sent in MsgAuthChallenge
+     * @return  Returns \em true on success or \em false on failure
+     */
+    static bool deriveKey(uint8_t *key, const std::string &auth_key,
+                          const unsigned char *challenge)
+    {
+      static const char label[] = "NetTrxUdpAudio";
+      gcry_md_hd_t hd = { 0 };
+      gcry_error_t err = gcry_md_open(&hd, GCRY_MD_SHA256, GCRY_MD_FLAG_HMAC);
+      if (err) goto error;
+      err = gcry_md_setkey(hd, auth_key.c_str(), auth_key.size());
+      if (err) goto error;
+      gcry_md_write(hd, label, sizeof(label)-1);
+      gcry_md_write(hd, challenge, MsgAuthChallenge::CHALLENGE_LEN);
+      memcpy(key, gcry_md_read(hd, 0), KEY_LEN);
+      gcry_md_close(hd);
+      return true;
+
+      error:
+        gcry_md_close(hd);
+        std::cerr << "*** ERROR: gcrypt error: "
+                  << gcry_strsource(err) << "/" << gcry_strerror(err)
+                  << std::endl;
+        return false;
+    }
+
+  private:
+    uint16_t  m_udp_port;
+    uint32_t  m_session_id;
+    uint8_t   m_iv_rand[IV_RAND_LEN];
+
+};  /* MsgUdpSetupAck */
+
+
+/**
+ * @brief Mark the position of a TCP message in the UDP message stream
+ *
+ * Sent on TCP right before any other message if UDP messages have been sent
+ * since the last mark. The receiver hold back TCP messages following the
+ * mark until all UDP messages up to and including the given sequence number
+ * have been delivered, or given up on.
+ */
+class MsgUdpSeqMark : public Msg
+{
+  public:
+    static const unsigned TYPE = 15;
+    MsgUdpSeqMark(uint32_t seq)
+      : Msg(TYPE, sizeof(MsgUdpSeqMark)), m_seq(seq) {}
+    uint32_t seq(void) const { return m_seq; }
+
+  private:
+    uint32_t m_seq;
+
+};  /* MsgUdpSeqMark */
+
+
 
 
 
@@ -750,9 +861,96 @@ class MsgAllSamplesFlushed : public Msg
 }; /* MsgAllSamplesFlushed */
 
 
+/****************************** UDP Datagrams ******************************/
+
+/**
+ * @brief The header that start each datagram on the UDP audio plane
+ *
+ * The header is sent in clear text but is authenticated as associated data
+ * by the AEAD cipher. The payload of a UDP_MSG datagram is one complete
+ * message, e.g. a MsgAudio or a MsgSiglevUpdate, in the same format as used
+ * on TCP. Sequence numbers for UDP_MSG datagrams and heartbeats are counted
+ * separately.
+ */
+struct UdpHeader
+{
+  typedef enum
+  {
+    UDP_MSG = 0, UDP_HEARTBEAT = 1, UDP_HEARTBEAT_REPLY = 2
+  } Type;
+
+  uint32_t session_id;
+  uint32_t seq;
+  uint32_t timestamp;   ///< Sender time in ms, echoed in heartbeat replies
+  uint8_t  type;
+
+}; /* UdpHeader */
+
+
 #pragma pack(pop)
 
 
+/**
+@brief	A reusable buffer for framing outgoing messages
+@author Tobias Blomberg / SM0SVX
+@date   2026-10-18
+
+Messages appended to a batch are laid out back to back, in the same format
+as they are sent on the wire, so that all of them can be sent using one
+call to TcpConnection::write. Only the used part of each message is copied,
+e.g. not the whole buffer of a short MsgAudio. The memory is kept when the
+batch is cleared so no allocations are made once the buffer has grown to its
+working size.
+*/
+class MsgBatch
+{
+  public:
+    /**
+     * @brief 	Constuctor
+     */
+    MsgBatch(void) { m_buf.reserve(INITIAL_CAPACITY); }
+
+    /**
+     * @brief   Append a message to the batch
+     * @param   msg The message to append
+     */
+    void append(const Msg& msg)
+    {
+      const char *ptr = reinterpret_cast<const char*>(&msg);
+      m_buf.insert(m_buf.end(), ptr, ptr + msg.size());
+    }
+
+    /**
+     * @brief   Remove all messages from the batch
+     */
+    void clear(void) { m_buf.clear(); }
+
+    /**
+     * @brief   Check if the batch is empty
+     * @return  Returns \em true if no messages have been appended
+     */
+    bool empty(void) const { return m_buf.empty(); }
+
+    /**
+     * @brief   Get the framed messages
+     * @return  Returns a pointer to the first byte of the first message
+     */
+    const void *data(void) const { return m_buf.data(); }
+
+    /**
+     * @brief   Get the total size of all messages in the batch
+     * @return  Returns the size in bytes
+     */
+    int size(void) const { return m_buf.size(); }
+
+  private:
+    static const size_t INITIAL_CAPACITY = 2 * Msg::MAX_SIZE;
+
+    std::vector<char> m_buf;
+
+};  /* MsgBatch */
+
+
 
 } /* namespace */
 
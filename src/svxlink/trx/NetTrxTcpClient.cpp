@@ -34,6 +34,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include <cerrno>
 #include <cstring>
+#include <algorithm>
+#include <sstream>
 
 
 /****************************************************************************
@@ -43,6 +45,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  ****************************************************************************/
 
 #include <AsyncTimer.h>
+#include <AsyncApplication.h>
+#include <AsyncEncryptedUdpSocket.h>
 
 
 /****************************************************************************
@@ -52,6 +56,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  ****************************************************************************/
 
 #include "NetTrxTcpClient.h"
+#include "NetTrxUdpLink.h"
 
 
 
@@ -151,7 +156,7 @@ NetTrxTcpClient *NetTrxTcpClient::instance(const std::string& remote_host,
       }
     }
 
-    con = new NetTrxTcpClient(remote_host, remote_port, RECV_BUF_SIZE);
+    con = new NetTrxTcpClient(remote_host, remote_port, Msg::MAX_SIZE);
     clients[key] = con;
   }
   
@@ -184,15 +189,22 @@ void NetTrxTcpClient::deleteInstance(void)
 
 
 void NetTrxTcpClient::sendMsg(Msg *msg)
+{
+  sendMsg(*msg);
+  delete msg;
+} /* NetTrxTcpClient::sendMsg */
+
+
+void NetTrxTcpClient::sendMsg(const Msg& msg)
 {
   if (state == STATE_READY)
   {
+    if ((udp_link != 0) && udp_link->sendMsg(&msg))
+    {
+      return;
+    }
     sendMsgP(msg);
   }
-  else
-  { 
-    delete msg;
-  }
 } /* NetTrxTcpClient::sendMsg */
 
 
@@ -205,6 +217,21 @@ void NetTrxTcpClient::connect(void)
 } /* NetTrxTcpClient::connect */
 
 
+void NetTrxTcpClient::enableUdpAudio(unsigned jitter_buffer_delay)
+{
+  udp_jitter_buffer_delay = max(udp_jitter_buffer_delay, jitter_buffer_delay);
+  if (udp_audio_requested)
+  {
+    return;
+  }
+  udp_audio_requested = true;
+  if (state == STATE_READY)
+  {
+    requestUdpAudio();
+  }
+} /* NetTrxTcpClient::enableUdpAudio */
+
+
 /****************************************************************************
  *
  * Protected member functions
@@ -213,9 +240,11 @@ void NetTrxTcpClient::connect(void)
 
 NetTrxTcpClient::NetTrxTcpClient(const std::string& remote_host,
       	      	      	      	 uint16_t remote_port, size_t recv_buf_len)
-  : TcpClient<>(remote_host, remote_port, recv_buf_len), recv_cnt(0),
-    recv_exp(0), reconnect_timer(0), last_msg_timestamp(), heartbeat_timer(0),
-    user_cnt(0), state(STATE_DISC), disc_reason(DR_SYSTEM_ERROR)
+  : TcpClient<>(remote_host, remote_port, recv_buf_len),
+    reconnect_timer(0), last_msg_timestamp(), heartbeat_timer(0),
+    user_cnt(0), state(STATE_DISC), disc_reason(DR_SYSTEM_ERROR),
+    auth_challenged(false), udp_audio_requested(false),
+    udp_jitter_buffer_delay(0), udp_sock(0), udp_link(0)
 {
   connected.connect(mem_fun(*this, &NetTrxTcpClient::tcpConnected));
   disconnected.connect(mem_fun(*this, &NetTrxTcpClient::tcpDisconnected));
@@ -236,6 +265,8 @@ NetTrxTcpClient::~NetTrxTcpClient(void)
 {
   delete reconnect_timer;
   delete heartbeat_timer;
+  delete udp_link;
+  delete udp_sock;
 } /* NetTrxTcpClient::~NetTrxTcpClient */
 
 
@@ -250,10 +281,9 @@ NetTrxTcpClient::~NetTrxTcpClient(void)
 
 void NetTrxTcpClient::tcpConnected(void)
 {
-  recv_cnt = 0;
-  recv_exp = sizeof(Msg);
-  gettimeofday(&last_msg_timestamp, NULL);
+  Application::app().getTimeOfDay(&last_msg_timestamp);
   heartbeat_timer->setEnable(true);
+  auth_challenged = false;
   state = STATE_VER_WAIT;
 } /* NetTx::tcpConnected */
 
@@ -262,8 +292,8 @@ void NetTrxTcpClient::tcpDisconnected(TcpConnection *con,
       	      	      	    TcpConnection::DisconnectReason reason)
 {
   disc_reason = reason;
-  recv_exp = 0;
   state = STATE_DISC;
+  deleteUdpLink();
   reconnect_timer->setEnable(true);
   heartbeat_timer->setEnable(false);
   isReady(false);
@@ -273,66 +303,45 @@ void NetTrxTcpClient::tcpDisconnected(TcpConnection *con,
 int NetTrxTcpClient::tcpDataReceived(TcpConnection *con, void *data, int size)
 {
   //cout << "NetTrxTcpClient::tcpDataReceived: size=" << size << endl;
-  
-  //Msg *msg = reinterpret_cast<Msg*>(data);
-  //cout << "Received a TCP message with type " << msg->type()
-  //     << " and size " << msg->size() << endl;
-  
-  int orig_size = size;
-  
+
+    // Messages are handled in place in the receive buffer of the TCP
+    // connection. An incomplete message is left in the buffer until the
+    // rest of it has been received.
   char *buf = static_cast<char*>(data);
-  while (size > 0)
+  int processed = 0;
+  while (size - processed >= static_cast<int>(sizeof(Msg)))
   {
-    unsigned read_cnt = min(static_cast<unsigned>(size), recv_exp-recv_cnt);
-    if (recv_cnt+read_cnt > sizeof(recv_buf))
+    Msg *msg = reinterpret_cast<Msg*>(buf + processed);
+    if (msg->size() < sizeof(Msg))
+    {
+      cerr << "*** ERROR: Illegal message header received. Header length "
+           << "too small (" << msg->size() << "). Disconnecting from "
+           << remoteHost().toString() << ":" << remotePort() << "...\n";
+      con->disconnect();
+      disconnected(con, TcpConnection::DR_ORDERED_DISCONNECT);
+      return size;
+    }
+    if (msg->size() > Msg::MAX_SIZE)
     {
       cerr << "*** ERROR: TCP receive buffer overflow. Disconnecting from "
            << remoteHost().toString() << ":" << remotePort() << "...\n";
       con->disconnect();
       disconnected(con, TcpConnection::DR_ORDERED_DISCONNECT);
-      return orig_size;
+      return size;
     }
-    memcpy(recv_buf+recv_cnt, buf, read_cnt);
-    size -= read_cnt;
-    recv_cnt += read_cnt;
-    buf += read_cnt;
-    
-    if (recv_cnt == recv_exp)
+    if (size - processed < static_cast<int>(msg->size()))
     {
-      if (recv_exp == sizeof(Msg))
-      {
-      	Msg *msg = reinterpret_cast<Msg*>(recv_buf);
-	if (msg->size() == sizeof(Msg))
-	{
-	  handleMsg(msg);
-	  recv_cnt = 0;
-	  recv_exp = sizeof(Msg);
-	}
-	else if (msg->size() > sizeof(Msg))
-	{
-      	  recv_exp = msg->size();
-	}
-	else
-	{
-	  cerr << "*** ERROR: Illegal message header received. Header length "
-	       << "too small (" << msg->size() << "). Disconnecting from "
-               << remoteHost().toString() << ":" << remotePort() << "...\n";
-	  con->disconnect();
-	  disconnected(con, TcpConnection::DR_ORDERED_DISCONNECT);
-	  return orig_size;
-	}
-      }
-      else
-      {
-      	Msg *msg = reinterpret_cast<Msg*>(recv_buf);
-	handleMsg(msg);
-	recv_cnt = 0;
-	recv_exp = sizeof(Msg);
-      }
+      break;
+    }
+    processed += msg->size();
+    handleMsg(msg);
+    if (state == STATE_DISC)
+    {
+      return size;
     }
   }
-  
-  return orig_size;
+
+  return processed;
   
 } /* NetTrxTcpClient::tcpDataReceived */
 
@@ -391,6 +400,9 @@ void NetTrxTcpClient::handleMsg(Msg *msg)
           return;
         }
         MsgAuthChallenge *chal_msg = reinterpret_cast<MsgAuthChallenge*>(msg);
+        memcpy(auth_challenge, chal_msg->challenge(),
+               MsgAuthChallenge::CHALLENGE_LEN);
+        auth_challenged = true;
         MsgAuthResponse *resp_msg =
             new MsgAuthResponse(auth_key, chal_msg->challenge());
         sendMsgP(resp_msg);
@@ -406,6 +418,10 @@ void NetTrxTcpClient::handleMsg(Msg *msg)
           return;
         }
         state = STATE_READY;
+        if (udp_audio_requested)
+        {
+          requestUdpAudio();
+        }
         isReady(true);
       }
       return;
@@ -414,8 +430,25 @@ void NetTrxTcpClient::handleMsg(Msg *msg)
       break;
   }
   
-  gettimeofday(&last_msg_timestamp, NULL);
+  Application::app().getTimeOfDay(&last_msg_timestamp);
+
+  if ((udp_link != 0) && udp_link->holdTcpMsg(msg))
+  {
+    return;
+  }
+
+  dispatchMsg(msg);
   
+} /* NetTrxTcpClient::handleMsg */
+
+
+void NetTrxTcpClient::dispatchMsg(Msg *msg)
+{
+  if (state != STATE_READY)
+  {
+    return;
+  }
+
   switch (msg->type())
   {
     case MsgHeartbeat::TYPE:
@@ -431,14 +464,105 @@ void NetTrxTcpClient::handleMsg(Msg *msg)
                << remoteHost().toString() << ":" << remotePort() << "...\n";
       localDisconnect();
       break;
+
+    case MsgUdpSetupAck::TYPE:
+      if (msg->size() != sizeof(MsgUdpSetupAck))
+      {
+        cerr << "*** ERROR: Protocol error. Wrong length of "
+                "MsgUdpSetupAck message. Disconnecting from "
+             << remoteHost().toString() << ":" << remotePort() << "...\n";
+        localDisconnect();
+        return;
+      }
+      handleUdpSetupAck(reinterpret_cast<MsgUdpSetupAck*>(msg));
+      break;
     
     default:
       msgReceived(msg);
       break;
   }
   
-  
-} /* NetTrxTcpClient::handleMsg */
+} /* NetTrxTcpClient::dispatchMsg */
+
+
+void NetTrxTcpClient::requestUdpAudio(void)
+{
+    // The UDP cipher key is derived from the authentication key so UDP
+    // audio cannot be used on an unauthenticated connection
+  if (!auth_challenged)
+  {
+    cerr << "*** WARNING: UDP audio requires an AUTH_KEY to be set for "
+         << remoteHost().toString() << ":" << remotePort()
+         << ". Using TCP.\n";
+    return;
+  }
+  sendMsgP(new MsgUdpSetup);
+} /* NetTrxTcpClient::requestUdpAudio */
+
+
+void NetTrxTcpClient::handleUdpSetupAck(MsgUdpSetupAck *ack)
+{
+  if (ack->udpPort() == 0)
+  {
+    cout << remoteHost().toString() << ":" << remotePort()
+         << ": UDP audio not accepted by the remote side. Using TCP.\n";
+    return;
+  }
+
+  uint8_t key[MsgUdpSetupAck::KEY_LEN];
+  if (!auth_challenged ||
+      !MsgUdpSetupAck::deriveKey(key, auth_key, auth_challenge))
+  {
+    cerr << "*** ERROR: Could not derive the UDP cipher key for "
+         << remoteHost().toString() << ":" << remotePort()
+         << ". Using TCP.\n";
+    return;
+  }
+
+  deleteUdpLink();
+  udp_sock = new EncryptedUdpSocket;
+  if (!NetTrxUdpLink::setupSocket(udp_sock))
+  {
+    cerr << "*** ERROR: Could not set up the UDP socket for "
+         << remoteHost().toString() << ":" << remotePort()
+         << ". Using TCP.\n";
+    delete udp_sock;
+    udp_sock = 0;
+    return;
+  }
+
+  ostringstream name;
+  name << remoteHost().toString() << ":" << remotePort();
+  udp_link = new NetTrxUdpLink(name.str(), udp_sock,
+                               NetTrxUdpLink::ROLE_CLIENT, *ack, key);
+  udp_link->setJitterBufferDelay(udp_jitter_buffer_delay);
+  udp_link->msgReceived.connect(
+      mem_fun(*this, &NetTrxTcpClient::dispatchMsg));
+  udp_sock->cipherDataReceived.connect(
+      mem_fun(*udp_link, &NetTrxUdpLink::cipherDataReceived));
+  udp_sock->dataReceived.connect(
+      mem_fun(*udp_link, &NetTrxUdpLink::datagramReceived));
+  udp_link->setRemoteAddr(remoteHost(), ack->udpPort());
+} /* NetTrxTcpClient::handleUdpSetupAck */
+
+
+void NetTrxTcpClient::deleteUdpLink(void)
+{
+  if (udp_link == 0)
+  {
+    return;
+  }
+
+    // The link may be emitting a message right now so the deletion is
+    // deferred until we are back in the main loop
+  udp_link->printStats();
+  udp_link->msgReceived.clear();
+  NetTrxUdpLink *link = udp_link;
+  EncryptedUdpSocket *sock = udp_sock;
+  udp_link = 0;
+  udp_sock = 0;
+  Application::app().runTask([=]{ delete link; delete sock; });
+} /* NetTrxTcpClient::deleteUdpLink */
 
 
 void NetTrxTcpClient::heartbeat(Timer *t)
@@ -448,7 +572,7 @@ void NetTrxTcpClient::heartbeat(Timer *t)
   
   struct timeval diff_tv;
   struct timeval now;
-  gettimeofday(&now, NULL);
+  Application::app().getTimeOfDay(&now);
   timersub(&now, &last_msg_timestamp, &diff_tv);
   int diff_ms = diff_tv.tv_sec * 1000 + diff_tv.tv_usec / 1000;
   
@@ -472,11 +596,28 @@ void NetTrxTcpClient::localDisconnect(void)
 
 
 void NetTrxTcpClient::sendMsgP(Msg *msg)
+{
+  sendMsgP(*msg);
+  delete msg;
+} /* NetTrxTcpClient::sendMsgP */
+
+
+void NetTrxTcpClient::sendMsgP(const Msg& msg)
 {
   assert(isConnected());
 
-  int written = write(msg, msg->size());
-  if (written != static_cast<int>(msg->size()))
+    // A pending UDP sequence mark is framed together with the message so
+    // that both are written in one go
+  tx_batch.clear();
+  uint32_t seq;
+  if ((udp_link != 0) && udp_link->takeSeqMark(seq))
+  {
+    tx_batch.append(MsgUdpSeqMark(seq));
+  }
+  tx_batch.append(msg);
+
+  int written = write(tx_batch.data(), tx_batch.size());
+  if (written != tx_batch.size())
   {
     if (written == -1)
     {
@@ -490,9 +631,6 @@ void NetTrxTcpClient::sendMsgP(Msg *msg)
     disconnect();
     disconnected(this, TcpConnection::DR_ORDERED_DISCONNECT);
   }
-  
-  delete msg;
-  
 } /* NetTrxTcpClient::sendMsgP */
 
 
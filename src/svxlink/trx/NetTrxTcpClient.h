@@ -69,6 +69,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 namespace Async
 {
   class Timer;
+  class EncryptedUdpSocket;
 };
 
 
@@ -88,7 +89,8 @@ namespace Async
  *
  ****************************************************************************/
 
-  
+class NetTrxUdpLink;
+
 
 /****************************************************************************
  *
@@ -149,9 +151,19 @@ class NetTrxTcpClient : public Async::TcpClient<>
     
     /**
      * @brief Send a message over the connection
-     * @param msg The message to send
+     * @param msg The message to send. Ownership is transferred.
      */
     void sendMsg(NetTrxMsg::Msg *msg);
+
+    /**
+     * @brief Send a message over the connection
+     * @param msg The message to send
+     *
+     * The message is framed directly into a reused transmit buffer so it
+     * may be allocated on the stack by the caller. Use this function for
+     * frequent messages, like audio, to avoid heap allocations.
+     */
+    void sendMsg(const NetTrxMsg::Msg& msg);
     
     /**
      * @brief Get the reason for the last disconnect
@@ -168,6 +180,18 @@ class NetTrxTcpClient : public Async::TcpClient<>
      */
     void connect(void);
 
+    /**
+     * @brief   Request that audio should be sent over UDP
+     * @param   jitter_buffer_delay The receive jitter buffer delay in ms
+     *
+     * The UDP audio plane will be requested from the remote side each time
+     * the connection has been established. If the remote side do not accept
+     * it, or if the UDP path is not working, TCP will be used for all
+     * messages. Since the connection may be shared, the largest requested
+     * jitter buffer delay will be used.
+     */
+    void enableUdpAudio(unsigned jitter_buffer_delay);
+
     /**
      * @brief A signal that is emitted when the connection to the remote side
      *        is ready for operation
@@ -210,12 +234,9 @@ class NetTrxTcpClient : public Async::TcpClient<>
       STATE_DISC, STATE_VER_WAIT, STATE_AUTH_WAIT, STATE_READY
     } State;
     
-    static const int RECV_BUF_SIZE = 4096;
     static Clients clients;
 
-    char      	    recv_buf[RECV_BUF_SIZE];
-    unsigned        recv_cnt;
-    unsigned        recv_exp;
+    NetTrxMsg::MsgBatch tx_batch;
     Async::Timer    *reconnect_timer;
     struct timeval  last_msg_timestamp;
     Async::Timer    *heartbeat_timer;
@@ -223,6 +244,12 @@ class NetTrxTcpClient : public Async::TcpClient<>
     std::string     auth_key;
     State           state;
     DiscReason      disc_reason;
+    unsigned char   auth_challenge[NetTrxMsg::MsgAuthChallenge::CHALLENGE_LEN];
+    bool            auth_challenged;
+    bool            udp_audio_requested;
+    unsigned        udp_jitter_buffer_delay;
+    Async::EncryptedUdpSocket *udp_sock;
+    NetTrxUdpLink   *udp_link;
     
     NetTrxTcpClient(const NetTrxTcpClient&);
     using TcpClientBase::operator=;
@@ -234,9 +261,14 @@ class NetTrxTcpClient : public Async::TcpClient<>
     int tcpDataReceived(TcpConnection *con, void *data, int size);
     void reconnect(Async::Timer *t);
     void handleMsg(NetTrxMsg::Msg *msg);
+    void dispatchMsg(NetTrxMsg::Msg *msg);
+    void requestUdpAudio(void);
+    void handleUdpSetupAck(NetTrxMsg::MsgUdpSetupAck *ack);
+    void deleteUdpLink(void);
     void heartbeat(Async::Timer *t);
     void localDisconnect(void);
     void sendMsgP(NetTrxMsg::Msg *msg);
+    void sendMsgP(const NetTrxMsg::Msg& msg);
 
 };  /* class NetTrxTcpClient */
 
@@ -0,0 +1,539 @@
+/**
+@file	 NetTrxUdpLink.cpp
+@brief   The UDP audio plane between a remote transceiver and its client
+@author  Tobias Blomberg / SM0SVX
+@date	 2026-10-18
+
+\verbatim
+SvxLink - A Multi Purpose Voice Services System for Ham Radio Use
+Copyright (C) 2003-2026 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+#include <AsyncApplication.h>
+#include <AsyncEncryptedUdpSocket.h>
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "NetTrxUdpLink.h"
+
+
+
+/****************************************************************************
+ *
+ * Namespaces to use
+ *
+ ****************************************************************************/
+
+using namespace std;
+using namespace Async;
+using namespace NetTrxMsg;
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local class definitions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Prototypes
+ *
+ ****************************************************************************/
+
+namespace {
+  int64_t now(void)
+  {
+    return chrono::duration_cast<chrono::milliseconds>(
+        Application::SteadyClock::now().time_since_epoch()).count();
+  }
+};
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ *
+ * Local Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Public member functions
+ *
+ ****************************************************************************/
+
+bool NetTrxUdpLink::setupSocket(EncryptedUdpSocket *sock)
+{
+  if (!sock->initOk() || !sock->setCipher(CIPHER))
+  {
+    return false;
+  }
+  sock->setCipherAADLength(sizeof(UdpHeader));
+  sock->setTagLength(TAGLEN);
+  return true;
+} /* NetTrxUdpLink::setupSocket */
+
+
+bool NetTrxUdpLink::isUdpMsg(const Msg *msg)
+{
+  return (msg->type() == MsgAudio::TYPE) ||
+         (msg->type() == MsgSiglevUpdate::TYPE);
+} /* NetTrxUdpLink::isUdpMsg */
+
+
+bool NetTrxUdpLink::readHeader(const void *buf, int count, UdpHeader& hdr)
+{
+  if ((count < 0) || (static_cast<size_t>(count) < sizeof(UdpHeader)))
+  {
+    return false;
+  }
+  memcpy(&hdr, buf, sizeof(UdpHeader));
+  return true;
+} /* NetTrxUdpLink::readHeader */
+
+
+NetTrxUdpLink::NetTrxUdpLink(const string& name, EncryptedUdpSocket *sock,
+                             Role role, const MsgUdpSetupAck& ack,
+                             const uint8_t *key)
+  : m_name(name), m_sock(sock), m_role(role), m_session_id(ack.sessionId()),
+    m_key(key, key + MsgUdpSetupAck::KEY_LEN),
+    m_hb_timer(HEARTBEAT_TICK, Timer::TYPE_PERIODIC, false),
+    m_mark_timer(0, Timer::TYPE_ONESHOT, false)
+{
+  memcpy(m_iv_rand, ack.ivRand(), sizeof(m_iv_rand));
+
+  m_jb.packetReleased.connect(mem_fun(*this, &NetTrxUdpLink::packetReleased));
+  m_jb.advanced.connect(mem_fun(*this, &NetTrxUdpLink::processHeld));
+    // Sequence numbers start at one
+  m_jb.skipTo(0);
+
+  m_hb_timer.expired.connect(mem_fun(*this, &NetTrxUdpLink::heartbeatTick));
+  m_mark_timer.expired.connect(mem_fun(*this, &NetTrxUdpLink::markTimeout));
+  if (m_role == ROLE_UPLINK)
+  {
+    m_hb_timer.setEnable(true);
+  }
+} /* NetTrxUdpLink::NetTrxUdpLink */
+
+
+NetTrxUdpLink::~NetTrxUdpLink(void)
+{
+} /* NetTrxUdpLink::~NetTrxUdpLink */
+
+
+void NetTrxUdpLink::setRemoteAddr(const IpAddress& ip, uint16_t port)
+{
+  m_remote_ip = ip;
+  m_remote_port = port;
+  m_hb_timer.setEnable(true);
+  sendHeartbeat();
+} /* NetTrxUdpLink::setRemoteAddr */
+
+
+bool NetTrxUdpLink::sendMsg(const Msg *msg)
+{
+  if (!m_is_up || !isUdpMsg(msg))
+  {
+    return false;
+  }
+
+  m_tx_seq += 1;
+  if (!sendDatagram(UdpHeader::UDP_MSG, m_tx_seq, timestamp(), msg))
+  {
+    cerr << "*** WARNING: " << m_name << ": UDP write failed. "
+            "Falling back to TCP." << endl;
+    setUp(false);
+    return false;
+  }
+  m_tx_cnt += 1;
+
+  return true;
+} /* NetTrxUdpLink::sendMsg */
+
+
+bool NetTrxUdpLink::takeSeqMark(uint32_t& seq)
+{
+  if (m_tx_seq == m_marked_seq)
+  {
+    return false;
+  }
+  m_marked_seq = m_tx_seq;
+  seq = m_tx_seq;
+  return true;
+} /* NetTrxUdpLink::takeSeqMark */
+
+
+bool NetTrxUdpLink::holdTcpMsg(Msg *msg)
+{
+  if (msg->type() == MsgUdpSeqMark::TYPE)
+  {
+    if (msg->size() == sizeof(MsgUdpSeqMark))
+    {
+      uint32_t seq = reinterpret_cast<MsgUdpSeqMark*>(msg)->seq();
+      if (!m_held.empty() || !m_jb.isPassed(seq))
+      {
+        m_held.push_back(Held{true, seq, {}});
+        processHeld();
+      }
+    }
+    return true;
+  }
+
+  if (m_held.empty())
+  {
+    return false;
+  }
+
+  const uint8_t *ptr = reinterpret_cast<const uint8_t*>(msg);
+  m_held.push_back(Held{false, 0, vector<uint8_t>(ptr, ptr + msg->size())});
+  return true;
+} /* NetTrxUdpLink::holdTcpMsg */
+
+
+bool NetTrxUdpLink::cipherDataReceived(const IpAddress& ip, uint16_t port,
+                                       void *buf, int count)
+{
+  UdpHeader hdr;
+  if (!readHeader(buf, count, hdr) || (hdr.session_id != m_session_id))
+  {
+    return true;
+  }
+  if ((m_role == ROLE_CLIENT) &&
+      ((ip != m_remote_ip) || (port != m_remote_port)))
+  {
+    return true;
+  }
+  m_sock->setCipherIV(cipherIV(false, hdr.type, hdr.seq));
+  m_sock->setCipherKey(m_key);
+  m_sock->setCipherAADLength(sizeof(UdpHeader));
+  return false;
+} /* NetTrxUdpLink::cipherDataReceived */
+
+
+void NetTrxUdpLink::datagramReceived(const IpAddress& ip, uint16_t port,
+                                     void *aad, void *buf, int count)
+{
+  UdpHeader hdr;
+  if ((aad == nullptr) || !readHeader(aad, sizeof(UdpHeader), hdr) ||
+      (hdr.session_id != m_session_id))
+  {
+    return;
+  }
+
+  switch (hdr.type)
+  {
+    case UdpHeader::UDP_MSG:
+    {
+      if ((count < static_cast<int>(sizeof(Msg))) ||
+          (count > static_cast<int>(sizeof(MsgAudio))))
+      {
+        return;
+      }
+      Msg *msg = reinterpret_cast<Msg*>(buf);
+      bool size_ok = false;
+      if (msg->type() == MsgAudio::TYPE)
+      {
+        const int hdr_size = sizeof(MsgAudio) - MsgAudio::BUFSIZE;
+        size_ok = (count >= hdr_size) &&
+                  (reinterpret_cast<MsgAudio*>(msg)->size() ==
+                   count - hdr_size);
+      }
+      else if (msg->type() == MsgSiglevUpdate::TYPE)
+      {
+        size_ok = (count == sizeof(MsgSiglevUpdate));
+      }
+      if (!size_ok || (msg->size() != static_cast<unsigned>(count)))
+      {
+        cerr << "*** WARNING: " << m_name << ": Malformed UDP message "
+                "received from " << ip << ":" << port << endl;
+        return;
+      }
+      m_jb.write(hdr.seq, hdr.timestamp, buf, count);
+      break;
+    }
+
+    case UdpHeader::UDP_HEARTBEAT:
+    {
+      if ((m_role != ROLE_UPLINK) ||
+          (static_cast<int32_t>(hdr.seq - m_hb_rx_seq) <= 0))
+      {
+        return;
+      }
+      m_hb_rx_seq = hdr.seq;
+      m_last_hb_rx = now();
+      m_remote_ip = ip;
+      m_remote_port = port;
+      MsgHeartbeat hb;
+      m_hb_tx_seq += 1;
+      sendDatagram(UdpHeader::UDP_HEARTBEAT_REPLY, m_hb_tx_seq,
+                   hdr.timestamp, &hb);
+      setUp(true);
+      break;
+    }
+
+    case UdpHeader::UDP_HEARTBEAT_REPLY:
+    {
+      if ((m_role != ROLE_CLIENT) ||
+          (static_cast<int32_t>(hdr.seq - m_hb_rx_seq) <= 0))
+      {
+        return;
+      }
+      m_hb_rx_seq = hdr.seq;
+      m_last_hb_rx = now();
+      m_rtt = static_cast<int32_t>(timestamp() - hdr.timestamp);
+      setUp(true);
+      break;
+    }
+
+    default:
+      break;
+  }
+} /* NetTrxUdpLink::datagramReceived */
+
+
+void NetTrxUdpLink::printStats(void) const
+{
+  const NetTrxJitterBuffer::Stats& s = m_jb.stats();
+  cout << m_name << ": UDP audio statistics:"
+       << " tx=" << m_tx_cnt
+       << " rx=" << s.received
+       << " lost=" << s.lost
+       << " late=" << s.late
+       << " dup=" << s.duplicates
+       << " reordered=" << s.reordered
+       << " jitter=" << static_cast<int>(s.jitter + 0.5f) << "ms"
+       << " max_depth=" << s.max_depth;
+  if (m_rtt >= 0)
+  {
+    cout << " rtt=" << m_rtt << "ms";
+  }
+  cout << endl;
+} /* NetTrxUdpLink::printStats */
+
+
+
+/****************************************************************************
+ *
+ * Protected member functions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Private member functions
+ *
+ ****************************************************************************/
+
+uint32_t NetTrxUdpLink::timestamp(void)
+{
+  return static_cast<uint32_t>(now());
+} /* NetTrxUdpLink::timestamp */
+
+
+const vector<uint8_t>& NetTrxUdpLink::cipherIV(bool tx, uint8_t type,
+                                               uint32_t seq)
+{
+    // Each direction and datagram class have its own sequence number
+    // space so both are included in the IV to make it unique. The IV
+    // buffer is reused to not allocate memory for each datagram.
+  const uint8_t dir = ((m_role == ROLE_CLIENT) != tx) ? 1 : 0;
+  const uint8_t cls = (type == UdpHeader::UDP_MSG) ? 0 : 1;
+  m_iv.assign(m_iv_rand, m_iv_rand + sizeof(m_iv_rand));
+  m_iv.push_back(dir);
+  m_iv.push_back(cls);
+  m_iv.push_back(0);
+  m_iv.push_back(0);
+  m_iv.push_back(seq >> 24);
+  m_iv.push_back(seq >> 16);
+  m_iv.push_back(seq >> 8);
+  m_iv.push_back(seq);
+  return m_iv;
+} /* NetTrxUdpLink::cipherIV */
+
+
+bool NetTrxUdpLink::sendDatagram(uint8_t type, uint32_t seq, uint32_t ts,
+                                 const Msg *msg)
+{
+  if (m_remote_port == 0)
+  {
+    return false;
+  }
+
+  UdpHeader hdr;
+  hdr.session_id = m_session_id;
+  hdr.seq = seq;
+  hdr.timestamp = ts;
+  hdr.type = type;
+  m_sock->setCipherIV(cipherIV(true, type, seq));
+  m_sock->setCipherKey(m_key);
+  return m_sock->write(m_remote_ip, m_remote_port, &hdr, sizeof(hdr),
+                       msg, msg->size());
+} /* NetTrxUdpLink::sendDatagram */
+
+
+void NetTrxUdpLink::sendHeartbeat(void)
+{
+  MsgHeartbeat hb;
+  m_hb_tx_seq += 1;
+  sendDatagram(UdpHeader::UDP_HEARTBEAT, m_hb_tx_seq, timestamp(), &hb);
+} /* NetTrxUdpLink::sendHeartbeat */
+
+
+void NetTrxUdpLink::heartbeatTick(Timer *t)
+{
+  if (m_is_up && (now() - m_last_hb_rx > PATH_TIMEOUT))
+  {
+    cerr << "*** WARNING: " << m_name << ": UDP heartbeat timeout. "
+            "Falling back to TCP." << endl;
+    setUp(false);
+  }
+
+  if (m_role == ROLE_CLIENT)
+  {
+    m_hb_tick_cnt += 1;
+    if (!m_is_up || (m_hb_tick_cnt % HEARTBEAT_INTERVAL == 0))
+    {
+      sendHeartbeat();
+    }
+  }
+} /* NetTrxUdpLink::heartbeatTick */
+
+
+void NetTrxUdpLink::setUp(bool is_up)
+{
+  if (is_up == m_is_up)
+  {
+    return;
+  }
+  m_is_up = is_up;
+  if (is_up)
+  {
+    cout << m_name << ": UDP audio path to " << m_remote_ip << ":"
+         << m_remote_port << " is up";
+    if (m_rtt >= 0)
+    {
+      cout << " (rtt " << m_rtt << "ms)";
+    }
+    cout << endl;
+  }
+} /* NetTrxUdpLink::setUp */
+
+
+void NetTrxUdpLink::packetReleased(const void *buf, int len)
+{
+  uint8_t msg_buf[sizeof(MsgAudio)];
+  assert((len >= static_cast<int>(sizeof(Msg))) &&
+         (len <= static_cast<int>(sizeof(msg_buf))));
+  memcpy(msg_buf, buf, len);
+  msgReceived(reinterpret_cast<Msg*>(msg_buf));
+} /* NetTrxUdpLink::packetReleased */
+
+
+void NetTrxUdpLink::processHeld(void)
+{
+  while (!m_held.empty())
+  {
+    if (m_held.front().is_mark)
+    {
+      const uint32_t seq = m_held.front().seq;
+      if (!m_jb.isPassed(seq))
+      {
+        if (!m_mark_timer.isEnabled())
+        {
+          m_mark_timer.setTimeout(m_jb.delay() + MARK_TIMEOUT_MARGIN);
+          m_mark_timer.setEnable(true);
+        }
+        return;
+      }
+      m_mark_timer.setEnable(false);
+      m_held.pop_front();
+      continue;
+    }
+
+    vector<uint8_t> msg_buf;
+    msg_buf.swap(m_held.front().msg);
+    m_held.pop_front();
+    msgReceived(reinterpret_cast<Msg*>(msg_buf.data()));
+  }
+  m_mark_timer.setEnable(false);
+} /* NetTrxUdpLink::processHeld */
+
+
+void NetTrxUdpLink::markTimeout(Timer *t)
+{
+  m_mark_timer.setEnable(false);
+  if (!m_held.empty() && m_held.front().is_mark)
+  {
+    m_jb.skipTo(m_held.front().seq);
+  }
+  processHeld();
+} /* NetTrxUdpLink::markTimeout */
+
+
+
+/*
+ * This file has not been truncated
+ */
@@ -0,0 +1,360 @@
+/**
+@file	 NetTrxUdpLink.h
+@brief   The UDP audio plane between a remote transceiver and its client
+@author  Tobias Blomberg / SM0SVX
+@date	 2026-10-18
+
+\verbatim
+SvxLink - A Multi Purpose Voice Services System for Ham Radio Use
+Copyright (C) 2003-2026 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+
+#ifndef NET_TRX_UDP_LINK_INCLUDED
+#define NET_TRX_UDP_LINK_INCLUDED
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <sigc++/sigc++.h>
+#include <stdint.h>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+#include <AsyncIpAddress.h>
+#include <AsyncTimer.h>
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "NetTrxMsg.h"
+#include "NetTrxJitterBuffer.h"
+
+
+/****************************************************************************
+ *
+ * Forward declarations
+ *
+ ****************************************************************************/
+
+namespace Async
+{
+  class EncryptedUdpSocket;
+};
+
+
+/****************************************************************************
+ *
+ * Namespace
+ *
+ ****************************************************************************/
+
+//namespace MyNameSpace
+//{
+
+
+/****************************************************************************
+ *
+ * Forward declarations of classes inside of the declared namespace
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Class definitions
+ *
+ ****************************************************************************/
+
+/**
+@brief	The UDP audio plane between a remote transceiver and its client
+@author Tobias Blomberg / SM0SVX
+@date   2026-10-18
+
+The TCP connection between a NetRx/NetTx and a RemoteTrx NetUplink is
+always used for control messages. When the UDP audio plane has been set up
+using MsgUdpSetup/MsgUdpSetupAck, latency sensitive messages (audio and
+signal level updates) are instead sent as AEAD encrypted UDP datagrams.
+
+The client side sends a heartbeat datagram every few seconds, which the
+uplink side answer. The uplink learns the address of the client from the
+heartbeats and the client will not consider the path to be up until it has
+received a reply. While the path is down, all messages are sent over TCP.
+
+Received datagrams pass through a jitter buffer before being delivered.
+To keep the relative order between TCP and UDP messages, the sender puts a
+MsgUdpSeqMark on TCP before a TCP message whenever UDP messages have been
+sent since the last mark. The receiver hold back TCP messages following the
+mark until the jitter buffer has passed the marked sequence number.
+*/
+class NetTrxUdpLink : public sigc::trackable
+{
+  public:
+    typedef enum
+    {
+      ROLE_CLIENT, ROLE_UPLINK
+    } Role;
+
+    static constexpr const char*  CIPHER = "AES-128-GCM";
+    static const size_t           TAGLEN = 8;
+
+    /**
+     * @brief   Set up the cipher parameters for a UDP socket
+     * @param   sock The socket to set up
+     * @return  Returns \em true on success or \em false on failure
+     */
+    static bool setupSocket(Async::EncryptedUdpSocket *sock);
+
+    /**
+     * @brief   Check if a message should be sent on the UDP audio plane
+     * @param   msg The message to check
+     * @return  Returns \em true if the message is eligible for UDP
+     */
+    static bool isUdpMsg(const NetTrxMsg::Msg *msg);
+
+    /**
+     * @brief   Read the header of a datagram
+     * @param   buf   The datagram
+     * @param   count The size of the datagram
+     * @param   hdr   The header will be stored here
+     * @return  Returns \em true if the datagram is long enough
+     */
+    static bool readHeader(const void *buf, int count,
+                           NetTrxMsg::UdpHeader& hdr);
+
+    /**
+     * @brief 	Constuctor
+     * @param   name  The name to use when logging
+     * @param   sock  The UDP socket to use, owned by the caller
+     * @param   role  Which side of the link this is
+     * @param   ack   The setup parameters
+     * @param   key   The cipher key, MsgUdpSetupAck::KEY_LEN bytes
+     */
+    NetTrxUdpLink(const std::string& name, Async::EncryptedUdpSocket *sock,
+                  Role role, const NetTrxMsg::MsgUdpSetupAck& ack,
+                  const uint8_t *key);
+
+    /**
+     * @brief 	Destructor
+     */
+    ~NetTrxUdpLink(void);
+
+    /**
+     * @brief   Get the session id
+     * @return  Returns the session id of this link
+     */
+    uint32_t sessionId(void) const { return m_session_id; }
+
+    /**
+     * @brief   Set the delay for the receive jitter buffer
+     * @param   delay The delay in milliseconds
+     */
+    void setJitterBufferDelay(unsigned delay) { m_jb.setDelay(delay); }
+
+    /**
+     * @brief   Set the address of the remote side
+     * @param   ip    The remote IP address
+     * @param   port  The remote UDP port
+     *
+     * Only used on the client side. The uplink side learn the address from
+     * the heartbeats. Setting the address will start the heartbeats.
+     */
+    void setRemoteAddr(const Async::IpAddress& ip, uint16_t port);
+
+    /**
+     * @brief   Check if the UDP path is usable for sending
+     * @return  Returns \em true if messages can be sent using UDP
+     */
+    bool isUp(void) const { return m_is_up; }
+
+    /**
+     * @brief   Try to send a message over UDP
+     * @param   msg The message to send
+     * @return  Returns \em true if the message was sent, \em false if it
+     *          should be sent on TCP instead
+     */
+    bool sendMsg(const NetTrxMsg::Msg *msg);
+
+    /**
+     * @brief   Check if a sequence mark must precede the next TCP message
+     * @param   seq The sequence number to mark is returned here
+     * @return  Returns \em true if a MsgUdpSeqMark should be sent
+     *
+     * The sequence number is recorded as marked when this function return
+     * \em true.
+     */
+    bool takeSeqMark(uint32_t& seq);
+
+    /**
+     * @brief   Hold back a received TCP message if necessary
+     * @param   msg The received message
+     * @return  Returns \em true if the message was consumed
+     *
+     * Call this function for each message received on TCP. If it returns
+     * \em true, the message must not be processed by the caller. It will
+     * be emitted through the msgReceived signal later if it was held back.
+     */
+    bool holdTcpMsg(NetTrxMsg::Msg *msg);
+
+    /**
+     * @brief   Prepare the socket for decryption of a datagram
+     * @return  Returns \em true if the datagram should be dropped
+     *
+     * Connect to, or call from, EncryptedUdpSocket::cipherDataReceived.
+     */
+    bool cipherDataReceived(const Async::IpAddress& ip, uint16_t port,
+                            void *buf, int count);
+
+    /**
+     * @brief   Handle a decrypted datagram
+     *
+     * Connect to, or call from, EncryptedUdpSocket::dataReceived.
+     */
+    void datagramReceived(const Async::IpAddress& ip, uint16_t port,
+                          void *aad, void *buf, int count);
+
+    /**
+     * @brief   Get the jitter buffer statistics
+     * @return  Returns the receive statistics
+     */
+    const NetTrxJitterBuffer::Stats& rxStats(void) const
+    {
+      return m_jb.stats();
+    }
+
+    /**
+     * @brief   Get the number of sent messages
+     * @return  Returns the number of messages sent on UDP
+     */
+    uint64_t txCount(void) const { return m_tx_cnt; }
+
+    /**
+     * @brief   Get the last measured round trip time
+     * @return  Returns the round trip time in ms or -1 if not known
+     */
+    int rtt(void) const { return m_rtt; }
+
+    /**
+     * @brief   Print link statistics to stdout
+     */
+    void printStats(void) const;
+
+    /**
+     * @brief   A signal emitted when a UDP or held back TCP message is
+     *          to be processed
+     * @param   msg The message
+     */
+    sigc::signal<void, NetTrxMsg::Msg*> msgReceived;
+
+  protected:
+
+  private:
+    struct Held
+    {
+      bool                  is_mark;
+      uint32_t              seq;
+      std::vector<uint8_t>  msg;
+    };
+
+    static const unsigned HEARTBEAT_TICK      = 1000;
+    static const unsigned HEARTBEAT_INTERVAL  = 5;
+    static const int64_t  PATH_TIMEOUT        = 15000;
+    static const unsigned MARK_TIMEOUT_MARGIN = 250;
+
+    std::string                 m_name;
+    Async::EncryptedUdpSocket*  m_sock;
+    Role                        m_role;
+    uint32_t                    m_session_id;
+    uint8_t                     m_iv_rand[NetTrxMsg::MsgUdpSetupAck::IV_RAND_LEN];
+    std::vector<uint8_t>        m_key;
+    std::vector<uint8_t>        m_iv;
+    Async::IpAddress            m_remote_ip;
+    uint16_t                    m_remote_port     = 0;
+    bool                        m_is_up           = false;
+    uint32_t                    m_tx_seq          = 0;
+    uint32_t                    m_marked_seq      = 0;
+    uint32_t                    m_hb_tx_seq       = 0;
+    uint32_t                    m_hb_rx_seq       = 0;
+    int64_t                     m_last_hb_rx      = 0;
+    unsigned                    m_hb_tick_cnt     = 0;
+    uint64_t                    m_tx_cnt          = 0;
+    int                         m_rtt             = -1;
+    NetTrxJitterBuffer          m_jb;
+    std::deque<Held>            m_held;
+    Async::Timer                m_hb_timer;
+    Async::Timer                m_mark_timer;
+
+    NetTrxUdpLink(const NetTrxUdpLink&);
+    NetTrxUdpLink& operator=(const NetTrxUdpLink&);
+    static uint32_t timestamp(void);
+    const std::vector<uint8_t>& cipherIV(bool tx, uint8_t type, uint32_t seq);
+    bool sendDatagram(uint8_t type, uint32_t seq, uint32_t ts,
+                      const NetTrxMsg::Msg *msg);
+    void sendHeartbeat(void);
+    void heartbeatTick(Async::Timer *t);
+    void setUp(bool is_up);
+    void packetReleased(const void *buf, int len);
+    void processHeld(void);
+    void markTimeout(Async::Timer *t);
+
+};  /* class NetTrxUdpLink */
+
+
+//} /* namespace */
+
+#endif /* NET_TRX_UDP_LINK_INCLUDED */
+
+
+
+/*
+ * This file has not been truncated
+ */
@@ -58,6 +58,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "NetTx.h"
 #include "NetTrxMsg.h"
 #include "NetTrxTcpClient.h"
+#include "NetTrxJitterBuffer.h"
 
 
 /****************************************************************************
@@ -207,6 +208,14 @@ bool NetTx::initialize(void)
     return false;
   }
   tcp_con->setAuthKey(auth_key);
+  bool udp_audio = false;
+  cfg.getValue(name(), "UDP_AUDIO", udp_audio);
+  if (udp_audio)
+  {
+    unsigned udp_jitter_buffer_delay = NetTrxJitterBuffer::DEFAULT_DELAY;
+    cfg.getValue(name(), "UDP_JITTER_BUFFER_DELAY", udp_jitter_buffer_delay);
+    tcp_con->enableUdpAudio(udp_jitter_buffer_delay);
+  }
   tcp_con->isReady.connect(mem_fun(*this, &NetTx::connectionReady));
   tcp_con->msgReceived.connect(mem_fun(*this, &NetTx::handleMsg));
   tcp_con->connect();
@@ -427,8 +436,8 @@ void NetTx::writeEncodedSamples(const void *buf, int size)
     {
       const int bufsize = MsgAudio::BUFSIZE;
       int len = min(size, bufsize);
-      MsgAudio *msg = new MsgAudio(ptr, len);
-      sendMsg(msg);
+      MsgAudio msg(ptr, len);
+      tcp_con->sendMsg(msg);
       size -= len;
       ptr += len;
     }
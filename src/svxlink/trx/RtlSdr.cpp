@@ -280,20 +280,29 @@ void RtlSdr::handleIq(const complex<uint8_t> *samples, int samp_count)
 {
   //cout << "RtlSdr::handleIq: samp_count=" << samp_count << endl;
 
-  vector<Sample> iq;
-  iq.reserve(samp_count);
-  for (int idx=0; idx<samp_count; ++idx)
+    // Convert the I and Q values as one flat array so that the compiler can
+    // vectorize the loops. A complex number is guaranteed to have the same
+    // layout as an array of two values.
+  const size_t value_count = 2 * samp_count;
+  const uint8_t *in = reinterpret_cast<const uint8_t*>(samples);
+  iq.resize(samp_count);
+  float *out = reinterpret_cast<float*>(iq.data());
+  for (size_t idx=0; idx<value_count; ++idx)
   {
-    if ((dist_print_cnt == 0) &&
-        ((samples[idx].real() == 255) || (samples[idx].imag() == 255)))
+    out[idx] = in[idx] / 127.5f - 1.0f;
+  }
+
+  if (dist_print_cnt == 0)
+  {
+    uint8_t max_value = 0;
+    for (size_t idx=0; idx<value_count; ++idx)
+    {
+      max_value = (in[idx] > max_value) ? in[idx] : max_value;
+    }
+    if (max_value == 255)
     {
       dist_print_cnt = samp_rate;
     }
-    float i = samples[idx].real();
-    i = i / 127.5f - 1.0f;
-    float q = samples[idx].imag();
-    q = q / 127.5f - 1.0f;
-    iq.push_back(complex<float>(i, q));
   }
 
   if (dist_print_cnt > 0)
@@ -251,6 +251,23 @@ class Rx : public sigc::trackable, public Async::AudioSource
      */
     virtual void setModulation(Modulation::Type mod) {}
 
+    /**
+     * @brief   Defer decoding of received audio
+     * @param   defer     Set to \em true to defer decoding
+     * @param   buffer_ms The amount of encoded audio to keep while deferred
+     * @return  Returns \em true if the receiver support deferred decoding
+     *
+     * A receiver that receive encoded audio may keep the latest buffer_ms
+     * milliseconds of encoded frames instead of decoding them while decoding
+     * is deferred. Squelch and signal level reporting is not affected. When
+     * decoding is no longer deferred, the kept frames are decoded before any
+     * new audio so that the audio sink get back-filled.
+     */
+    virtual bool setDecodeDeferred(bool defer, unsigned buffer_ms=0)
+    {
+      return false;
+    }
+
     /**
      * @brief 	A signal that indicates if the squelch is open or not
      * @param 	is_open \em True if the squelch is open or \em false if not
@@ -34,8 +34,6 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  *
  ****************************************************************************/
 
-#include <list>
-#include <set>
 #include <sigc++/sigc++.h>
 
 
@@ -55,6 +53,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  ****************************************************************************/
 
 #include "SigLevDet.h"
+#include "SlidingWindowMin.h"
 
 
 /****************************************************************************
@@ -208,10 +207,6 @@ class SigLevDetNoise : public SigLevDet
   protected:
     
   private:
-    typedef std::multiset<double> SsSet;
-    typedef SsSet::const_iterator SsSetIter;
-    typedef std::list<SsSetIter>  SsIndexList;
-
     static const unsigned BLOCK_TIME          = 25;     // milliseconds
 
     unsigned                  sample_rate;
@@ -223,8 +218,7 @@ class SigLevDetNoise : public SigLevDet
     int			      update_interval;
     int			      update_counter;
     unsigned		      integration_time;
-    SsSet                     ss_values;
-    SsIndexList               ss_idx;
+    SlidingWindowMin          ss_min;
     double                    ss;
     unsigned                  ss_cnt;
     float                     bogus_thresh;
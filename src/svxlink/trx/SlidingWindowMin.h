@@ -0,0 +1,258 @@
+/**
+@file	 SlidingWindowMin.h
+@brief   A fixed capacity sliding window minimum tracker
+@author  Tobias Blomberg / SM0SVX
+@date	 2026-10-18
+
+\verbatim
+SvxLink - A Multi Purpose Voice Services System for Ham Radio Use
+Copyright (C) 2003-2026 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+
+#ifndef SLIDING_WINDOW_MIN_INCLUDED
+#define SLIDING_WINDOW_MIN_INCLUDED
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <vector>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Forward declarations
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Namespace
+ *
+ ****************************************************************************/
+
+//namespace MyNameSpace
+//{
+
+
+/****************************************************************************
+ *
+ * Forward declarations of classes inside of the declared namespace
+ *
+ ****************************************************************************/
+
+  
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Class definitions
+ *
+ ****************************************************************************/
+
+/**
+@brief	A fixed capacity sliding window minimum tracker
+@author Tobias Blomberg / SM0SVX
+@date   2026-10-18
+
+This class keep track of the minimum of the last N values pushed to it. A
+monotonic queue is used, stored in a ring buffer with room for N entries.
+Each value pushed is compared to the newest entries in the queue which are
+removed if they are not smaller than the new value since they can never be
+the minimum again. The oldest entry is removed when it fall out of the window.
+This give amortized O(1) time for each push, O(1) time to get the minimum and
+no memory allocation except when the window length is changed.
+*/
+class SlidingWindowMin
+{
+  public:
+    /**
+     * @brief 	Constuctor
+     * @param 	window_len The number of values in the window
+     */
+    explicit SlidingWindowMin(size_t window_len=1)
+    {
+      setWindowLength(window_len);
+    }
+
+    /**
+     * @brief   Set the window length
+     * @param   window_len The number of values in the window
+     *
+     * The values already pushed are kept if they are within the new window.
+     */
+    void setWindowLength(size_t window_len)
+    {
+      window_len = std::max(window_len, size_t(1));
+      std::vector<Entry> buf(window_len);
+      size_t cnt = 0;
+      for (size_t i=0; i<m_cnt; ++i)
+      {
+        const Entry& e = at(i);
+        if (e.seq + window_len >= m_seq)
+        {
+          buf[cnt++] = e;
+        }
+      }
+      m_buf.swap(buf);
+      m_head = 0;
+      m_cnt = cnt;
+    }
+
+    /**
+     * @brief   Get the window length
+     * @return  Returns the number of values in the window
+     */
+    size_t windowLength(void) const { return m_buf.size(); }
+
+    /**
+     * @brief   Forget all values
+     */
+    void clear(void)
+    {
+      m_head = 0;
+      m_cnt = 0;
+      m_seq = 0;
+      m_last = 0.0;
+    }
+
+    /**
+     * @brief   Push a new value into the window
+     * @param   value The value to push
+     */
+    void push(double value)
+    {
+      while ((m_cnt > 0) && (at(m_cnt - 1).value >= value))
+      {
+        --m_cnt;
+      }
+      if ((m_cnt > 0) && (at(0).seq + m_buf.size() <= m_seq))
+      {
+        m_head = wrap(m_head + 1);
+        --m_cnt;
+      }
+      Entry& e = m_buf[wrap(m_head + m_cnt)];
+      e.value = value;
+      e.seq = m_seq++;
+      ++m_cnt;
+      m_last = value;
+    }
+
+    /**
+     * @brief   Check if the window is empty
+     * @return  Returns \em true if no values have been pushed
+     */
+    bool empty(void) const { return m_cnt == 0; }
+
+    /**
+     * @brief   Get the number of values currently in the window
+     * @return  Returns the number of values in the window
+     */
+    size_t size(void) const
+    {
+      return static_cast<size_t>(
+          std::min(m_seq, static_cast<uint64_t>(m_buf.size())));
+    }
+
+    /**
+     * @brief   Get the minimum value in the window
+     * @return  Returns the minimum value (undefined if the window is empty)
+     */
+    double min(void) const { return at(0).value; }
+
+    /**
+     * @brief   Get the value that was last pushed
+     * @return  Returns the last value (undefined if the window is empty)
+     */
+    double last(void) const { return m_last; }
+
+  private:
+    struct Entry
+    {
+      double    value = 0.0;
+      uint64_t  seq   = 0;
+    };
+
+    std::vector<Entry>  m_buf;
+    size_t              m_head  = 0;
+    size_t              m_cnt   = 0;
+    uint64_t            m_seq   = 0;
+    double              m_last  = 0.0;
+
+    size_t wrap(size_t i) const
+    {
+      return (i >= m_buf.size()) ? i - m_buf.size() : i;
+    }
+
+    const Entry& at(size_t i) const
+    {
+      return m_buf[wrap(m_head + i)];
+    }
+
+};  /* class SlidingWindowMin */
+
+
+//} /* namespace */
+
+#endif /* SLIDING_WINDOW_MIN_INCLUDED */
+
+
+
+/*
+ * This file has not been truncated
+ */
@@ -0,0 +1,124 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include <list>
+#include <set>
+#include <random>
+#include <vector>
+
+#include "SlidingWindowMin.h"
+
+using namespace std;
+
+
+  // The block time used by SigLevDetNoise
+static const unsigned BLOCK_TIME = 25;
+
+
+  // The multiset based implementation that SigLevDetNoise used to have
+class MultisetMin
+{
+  public:
+    explicit MultisetMin(size_t window_len) : window_len(window_len) {}
+
+    void push(double value)
+    {
+      idx.push_back(values.insert(value));
+      if (idx.size() > window_len)
+      {
+        values.erase(idx.front());
+        idx.pop_front();
+      }
+    }
+
+    double min(void) const { return *values.begin(); }
+
+  private:
+    typedef multiset<double> Set;
+    size_t                    window_len;
+    Set                       values;
+    list<Set::const_iterator> idx;
+};
+
+
+template <class T>
+static double run(T& tracker, const vector<double>& values, double& sum)
+{
+  auto start = chrono::steady_clock::now();
+  for (size_t i=0; i<values.size(); ++i)
+  {
+    tracker.push(values[i]);
+    sum += tracker.min();
+  }
+  chrono::duration<double, nano> dur = chrono::steady_clock::now() - start;
+  return dur.count() / values.size();
+}
+
+
+int main(int argc, char **argv)
+{
+  size_t block_cnt = 2000000;
+  if (argc > 1)
+  {
+    block_cnt = atol(argv[1]);
+  }
+
+    // Noise block energies are approximately log-normally distributed
+  mt19937 gen(4711);
+  lognormal_distribution<double> dist(0.0, 1.0);
+  vector<double> values(block_cnt);
+  for (size_t i=0; i<block_cnt; ++i)
+  {
+    values[i] = dist(gen);
+  }
+
+    // First verify that both implementations give the same answer
+  const unsigned verify_times[] = { 25, 50, 75, 250, 1000 };
+  for (unsigned time_ms : verify_times)
+  {
+    size_t window_len = time_ms / BLOCK_TIME;
+    MultisetMin ms(window_len);
+    SlidingWindowMin swm(window_len);
+    for (size_t i=0; i<min(block_cnt, size_t(100000)); ++i)
+    {
+      ms.push(values[i]);
+      swm.push(values[i]);
+      if (ms.min() != swm.min())
+      {
+        cout << "*** ERROR: Mismatch at block " << i << " for integration "
+                "time " << time_ms << "ms: " << ms.min() << " != "
+             << swm.min() << endl;
+        exit(1);
+      }
+    }
+  }
+
+  cout << "Blocks per run: " << block_cnt << endl;
+  cout << setw(12) << "Integration" << setw(10) << "Window"
+       << setw(16) << "multiset ns/op" << setw(16) << "ring ns/op"
+       << setw(10) << "Speedup" << endl;
+  const unsigned times[] = { 25, 100, 250, 500, 1000, 2000, 5000, 10000 };
+  for (unsigned time_ms : times)
+  {
+    size_t window_len = time_ms / BLOCK_TIME;
+    double sum1 = 0.0;
+    double sum2 = 0.0;
+    MultisetMin ms(window_len);
+    SlidingWindowMin swm(window_len);
+    double t1 = run(ms, values, sum1);
+    double t2 = run(swm, values, sum2);
+    if (sum1 != sum2)
+    {
+      cout << "*** ERROR: Result mismatch for integration time "
+           << time_ms << "ms\n";
+      exit(1);
+    }
+    cout << setw(10) << time_ms << "ms" << setw(10) << window_len
+         << fixed << setprecision(1)
+         << setw(16) << t1 << setw(16) << t2
+         << setw(9) << (t1 / t2) << "x" << endl;
+  }
+
+  return 0;
+}
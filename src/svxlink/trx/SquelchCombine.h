@@ -36,6 +36,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include <string>
 #include <deque>
+#include <vector>
+#include <cstdint>
 
 
 /****************************************************************************
@@ -135,6 +137,13 @@ SIGLEV_CLOSE_THRESH=2
 SQL_DET=COMBINE
 SQL_COMBINE=Rx1:CTCSS | Rx1:SIGLEV
 ...
+
+The expression is compiled into a flat postfix program when the squelch is
+initialized. At most 64 different squelch detectors may be combined. The state
+of all squelch detectors is kept in a bitmask. If there are no more than 16
+squelch detectors in the expression, the program is used to build a truth
+table that is indexed by the bitmask so that a squelch state change is
+handled by one table lookup.
 */
 class SquelchCombine : public Squelch
 {
@@ -199,24 +208,42 @@ class SquelchCombine : public Squelch
 
   private:
     typedef std::deque<std::string> Tokens;
-    class Node;
-    class LeafNode;
-    class UnaryOpNode;
-    struct NegationOpNode;
-    class BinaryOpNode;
-    struct OrOpNode;
-    struct AndOpNode;
-
-    Tokens  m_tokens;
-    Node*   m_comb    = nullptr;
-
-    void onSquelchOpen(bool is_open);
+    typedef uint64_t State;
+    enum class Op : uint8_t { SQL, NOT, AND, OR };
+    struct Instr
+    {
+      Op      op;
+      uint8_t sql;
+    };
+    typedef std::vector<Instr> Program;
+    struct SubSquelch
+    {
+      std::string name;
+      Squelch*    squelch = nullptr;
+    };
+    typedef std::vector<SubSquelch> SubSquelches;
+
+    static const size_t MAX_SUB_SQUELCHES   = 64;
+    static const size_t MAX_STACK_DEPTH     = 64;
+    static const size_t MAX_TABLE_SQUELCHES = 16;
+
+    Tokens                m_tokens;
+    SubSquelches          m_squelches;
+    Program               m_prog;
+    std::vector<uint64_t> m_table;
+    State                 m_state   = 0;
+
+    void onSubSquelchOpen(bool is_open, size_t idx);
+    bool evaluate(State state) const;
+    void buildTable(void);
+    std::string structure(void) const;
+    std::string activityInfo(const SubSquelch& sql) const;
     bool tokenize(const std::string& expr);
-    Node* parseInstExpression(void);
-    Node* parseUnaryOpExpression(void);
-    Node* parseAndExpression(void);
-    Node* parseOrExpression(void);
-    Node* parseExpression(void);
+    bool parseInstExpression(void);
+    bool parseUnaryOpExpression(void);
+    bool parseAndExpression(void);
+    bool parseOrExpression(void);
+    bool parseExpression(void);
 
 };  /* class SquelchCombine */
 
@@ -110,9 +110,11 @@ using namespace Async;
 class Voter::SatRx : public AudioSource, public sigc::trackable
 {
   public:
-    SatRx(Config &cfg, const string &rx_name, int id, int fifo_length_ms)
+    SatRx(Config &cfg, const string &rx_name, int id, int fifo_length_ms,
+          bool lazy_decoding)
       : rx_id(id), rx(0), fifo(0), sql_open(false), enabled(true),
-        mute_state(Rx::MUTE_ALL), sql_open_delay(0)
+        mute_state(Rx::MUTE_ALL), sql_open_delay(0),
+        fifo_length_ms(fifo_length_ms), lazy_decoding(lazy_decoding)
     {
       rx = RxFactory::createNamedRx(cfg, rx_name);
       if (rx != 0)
@@ -166,6 +168,15 @@ class Voter::SatRx : public AudioSource, public sigc::trackable
       	return false;
       }
       rx->setVerbose(false);
+      if (lazy_decoding)
+      {
+        lazy_decoding = rx->setDecodeDeferred(true, fifo_length_ms);
+        if (!lazy_decoding)
+        {
+          cout << "*** WARNING: Receiver " << rx->name()
+               << " does not support lazy decoding\n";
+        }
+      }
       return true;
     }
 
@@ -221,6 +232,13 @@ class Voter::SatRx : public AudioSource, public sigc::trackable
     
     void stopOutput(bool do_stop)
     {
+        // When output is started, the audio kept by the receiver while
+        // decoding was deferred is decoded into the FIFO before the valve
+        // is opened so that the voting delay buffer is back-filled
+      if (lazy_decoding)
+      {
+        rx->setDecodeDeferred(do_stop, fifo_length_ms);
+      }
       valve.setOpen(!do_stop);
       if (!do_stop)
       {
@@ -277,6 +295,8 @@ class Voter::SatRx : public AudioSource, public sigc::trackable
     bool          enabled;
     Rx::MuteState mute_state;
     unsigned      sql_open_delay;
+    int           fifo_length_ms;
+    bool          lazy_decoding;
     
     void onDtmfDigitDetected(char digit, int duration)
     {
@@ -462,6 +482,9 @@ bool Voter::initialize(void)
     return false;
   }
   
+  bool lazy_decoding = false;
+  cfg.getValue(name(), "LAZY_DECODING", lazy_decoding);
+
   float hysteresis = 100.0f * (DEFAULT_HYSTERESIS - 1.0f);
   cfg.getValue(name(), "HYSTERESIS", hysteresis);
   if ((hysteresis < 0.0f)
@@ -540,7 +563,8 @@ bool Voter::initialize(void)
     if (!rx_name.empty())
     {
       cout << "\tAdding receiver: " << rx_name << endl;
-      SatRx *srx = new SatRx(cfg, rx_name, rxs.size() + 1, buffer_length);
+      SatRx *srx = new SatRx(cfg, rx_name, rxs.size() + 1, buffer_length,
+                             lazy_decoding);
       srx->setSqlOpenDelay(sql_open_delay);
       srx->squelchOpen.connect(mem_fun(*this, &Voter::satSquelchOpen));
       srx->signalLevelUpdated.connect(